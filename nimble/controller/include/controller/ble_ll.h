@@ -203,6 +203,9 @@ STATS_SECT_START(ble_ll_stats)
     STATS_SECT_ENTRY(adv_evt_dropped)
     STATS_SECT_ENTRY(scan_timer_stopped)
     STATS_SECT_ENTRY(scan_timer_restarted)
+    STATS_SECT_ENTRY(scan_dup_hit)
+    STATS_SECT_ENTRY(scan_dup_miss)
+    STATS_SECT_ENTRY(scan_dup_evict)
     STATS_SECT_ENTRY(periodic_adv_drop_event)
     STATS_SECT_ENTRY(periodic_chain_drop_event)
     STATS_SECT_ENTRY(sync_event_failed)
@@ -79,6 +79,9 @@ extern uint8_t g_ble_ll_sched_offset_ticks;
 #define BLE_LL_SCHED_STATE_RUNNING  (0)
 #define BLE_LL_SCHED_STATE_DONE     (1)
 
+/* Number of express lanes (skip list levels) above the schedule queue */
+#define BLE_LL_SCHED_SKIP_LEVELS    (3)
+
 /* Callback function */
 struct ble_ll_sched_item;
 typedef int (*sched_cb_func)(struct ble_ll_sched_item *sch);
@@ -94,6 +97,8 @@ typedef int (* ble_ll_sched_preempt_cb_t)(struct ble_ll_sched_item *sch,
  *  enqueued: Flag denoting if item is on the scheduler list. 0: no, 1:yes
  *  remainder: # of usecs from offset till tx/rx should occur
  *  txrx_offset: Number of ticks from start time until tx/rx should occur.
+ *  skip_level: Number of express lanes this item is linked into.
+ *  skip: Next item on each express lane.
  *
  */
 struct ble_ll_sched_item
@@ -104,11 +109,13 @@ struct ble_ll_sched_item
 #endif
     uint8_t         enqueued;
     uint8_t         remainder;
+    uint8_t         skip_level;
     uint32_t        start_time;
     uint32_t        end_time;
     void            *cb_arg;
     sched_cb_func   sched_cb;
     TAILQ_ENTRY(ble_ll_sched_item) link;
+    struct ble_ll_sched_item *skip[BLE_LL_SCHED_SKIP_LEVELS];
 };
 
 /* Initialize the scheduler */
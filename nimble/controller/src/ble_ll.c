@@ -365,6 +365,9 @@ STATS_NAME_START(ble_ll_stats)
     STATS_NAME(ble_ll_stats, adv_evt_dropped)
     STATS_NAME(ble_ll_stats, scan_timer_stopped)
     STATS_NAME(ble_ll_stats, scan_timer_restarted)
+    STATS_NAME(ble_ll_stats, scan_dup_hit)
+    STATS_NAME(ble_ll_stats, scan_dup_miss)
+    STATS_NAME(ble_ll_stats, scan_dup_evict)
     STATS_NAME(ble_ll_stats, periodic_adv_drop_event)
     STATS_NAME(ble_ll_stats, periodic_chain_drop_event)
     STATS_NAME(ble_ll_stats, sync_event_failed)
@@ -729,51 +729,67 @@ ble_ll_resolv_local_rpa_get(uint8_t own_addr_type, uint8_t *rpa)
  *
  * @return int
  */
-int
-ble_ll_resolv_rpa(const uint8_t *rpa, const uint8_t *irk)
+static void
+ble_ll_resolv_rpa_prepare(struct ble_encryption_block *ecb, const uint8_t *rpa)
+{
+    uint32_t *pt32;
+
+    pt32 = (uint32_t *)&ecb->plain_text[0];
+    pt32[0] = 0;
+    pt32[1] = 0;
+    pt32[2] = 0;
+    pt32[3] = 0;
+
+    ecb->plain_text[15] = rpa[3];
+    ecb->plain_text[14] = rpa[4];
+    ecb->plain_text[13] = rpa[5];
+}
+
+/* Expects plain text to be set up by ble_ll_resolv_rpa_prepare() */
+static int
+ble_ll_resolv_rpa_irk(struct ble_encryption_block *ecb, const uint8_t *rpa,
+                      const uint8_t *irk)
 {
-    int rc;
     const uint32_t *irk32;
     uint32_t *key32;
-    uint32_t *pt32;
-    struct ble_encryption_block ecb;
 
     irk32 = (const uint32_t *)irk;
-    key32 = (uint32_t *)&ecb.key[0];
+    key32 = (uint32_t *)&ecb->key[0];
 
     key32[0] = irk32[0];
     key32[1] = irk32[1];
     key32[2] = irk32[2];
     key32[3] = irk32[3];
 
-    pt32 = (uint32_t *)&ecb.plain_text[0];
-    pt32[0] = 0;
-    pt32[1] = 0;
-    pt32[2] = 0;
-    pt32[3] = 0;
+    ble_hw_encrypt_block(ecb);
 
-    ecb.plain_text[15] = rpa[3];
-    ecb.plain_text[14] = rpa[4];
-    ecb.plain_text[13] = rpa[5];
+    return (ecb->cipher_text[15] == rpa[0]) &&
+           (ecb->cipher_text[14] == rpa[1]) &&
+           (ecb->cipher_text[13] == rpa[2]);
+}
 
-    ble_hw_encrypt_block(&ecb);
-    if ((ecb.cipher_text[15] == rpa[0]) && (ecb.cipher_text[14] == rpa[1]) &&
-        (ecb.cipher_text[13] == rpa[2])) {
-        rc = 1;
-    } else {
-        rc = 0;
-    }
+int
+ble_ll_resolv_rpa(const uint8_t *rpa, const uint8_t *irk)
+{
+    struct ble_encryption_block ecb;
 
-    return rc;
+    ble_ll_resolv_rpa_prepare(&ecb, rpa);
+
+    return ble_ll_resolv_rpa_irk(&ecb, rpa, irk);
 }
 
 int
 ble_ll_resolv_peer_rpa_any(const uint8_t *rpa)
 {
+    struct ble_encryption_block ecb;
     int i;
 
+    /* Plain text only depends on RPA so set it up once for all IRKs */
+    ble_ll_resolv_rpa_prepare(&ecb, rpa);
+
     for (i = 0; i < g_ble_ll_resolv_data.rl_cnt_hw; i++) {
-        if (ble_ll_resolv_rpa(rpa, g_ble_ll_resolv_list[i].rl_peer_irk)) {
+        if (ble_ll_resolv_rpa_irk(&ecb, rpa,
+                                  g_ble_ll_resolv_list[i].rl_peer_irk)) {
             return i;
         }
     }
@@ -121,13 +121,25 @@ struct ble_ll_scan_dup_entry {
     uint16_t adi;
 #endif
     TAILQ_ENTRY(ble_ll_scan_dup_entry) link;
+    LIST_ENTRY(ble_ll_scan_dup_entry) hash_link;
 };
 
+/*
+ * Entries are kept both on an LRU list (most recently used first) and in a
+ * hash keyed by entry type and address, so lookup on every received PDU does
+ * not depend on the number of cached advertisers.
+ */
+#define BLE_LL_SCAN_DUP_HASH_SIZE   MYNEWT_VAL(BLE_LL_NUM_SCAN_DUP_ADVS)
+
 static os_membuf_t g_scan_dup_mem[ OS_MEMPOOL_SIZE(
                                    MYNEWT_VAL(BLE_LL_NUM_SCAN_DUP_ADVS),
                                    sizeof(struct ble_ll_scan_dup_entry)) ];
 static struct os_mempool g_scan_dup_pool;
 static TAILQ_HEAD(ble_ll_scan_dup_list, ble_ll_scan_dup_entry) g_scan_dup_list;
+static LIST_HEAD(ble_ll_scan_dup_bucket, ble_ll_scan_dup_entry)
+    g_scan_dup_hash[BLE_LL_SCAN_DUP_HASH_SIZE];
+
+static void ble_ll_scan_dup_clear(void);
 
 #if MYNEWT_VAL(BLE_LL_CFG_FEAT_LL_EXT_ADV)
 static int
@@ -964,8 +976,7 @@ ble_ll_scan_sm_start(struct ble_ll_scan_sm *scansm)
     /* Forget filtered advertisers from previous scan. */
     g_ble_ll_scan_num_rsp_advs = 0;
 
-    os_mempool_clear(&g_scan_dup_pool);
-    TAILQ_INIT(&g_scan_dup_list);
+    ble_ll_scan_dup_clear();
 
     /*
      * First scan window can start when RF is enabled. Add 1 tick since we are
@@ -1783,8 +1794,43 @@ ble_ll_scan_dup_move_to_head(struct ble_ll_scan_dup_entry *e)
     }
 }
 
+static inline struct ble_ll_scan_dup_bucket *
+ble_ll_scan_dup_bucket(uint8_t type, const uint8_t *addr)
+{
+    uint32_t hash;
+    int i;
+
+    hash = type;
+    if (addr) {
+        for (i = 0; i < BLE_DEV_ADDR_LEN; i++) {
+            hash = hash * 31 + addr[i];
+        }
+    }
+
+    return &g_scan_dup_hash[hash % BLE_LL_SCAN_DUP_HASH_SIZE];
+}
+
+static struct ble_ll_scan_dup_entry *
+ble_ll_scan_dup_find(struct ble_ll_scan_dup_bucket *bucket, uint8_t type,
+                     const uint8_t *addr)
+{
+    struct ble_ll_scan_dup_entry *e;
+
+    LIST_FOREACH(e, bucket, hash_link) {
+        if ((e->type == type) &&
+            (!addr || !memcmp(e->addr, addr, BLE_DEV_ADDR_LEN))) {
+            STATS_INC(ble_ll_stats, scan_dup_hit);
+            return e;
+        }
+    }
+
+    STATS_INC(ble_ll_stats, scan_dup_miss);
+
+    return NULL;
+}
+
 static inline struct ble_ll_scan_dup_entry *
-ble_ll_scan_dup_new(void)
+ble_ll_scan_dup_new(struct ble_ll_scan_dup_bucket *bucket)
 {
     struct ble_ll_scan_dup_entry *e;
 
@@ -1792,27 +1838,43 @@ ble_ll_scan_dup_new(void)
     if (!e) {
         e = TAILQ_LAST(&g_scan_dup_list, ble_ll_scan_dup_list);
         TAILQ_REMOVE(&g_scan_dup_list, e, link);
+        LIST_REMOVE(e, hash_link);
+        STATS_INC(ble_ll_stats, scan_dup_evict);
     }
 
     memset(e, 0, sizeof(*e));
 
+    TAILQ_INSERT_HEAD(&g_scan_dup_list, e, link);
+    LIST_INSERT_HEAD(bucket, e, hash_link);
+
     return e;
 }
 
+static void
+ble_ll_scan_dup_clear(void)
+{
+    int i;
+
+    os_mempool_clear(&g_scan_dup_pool);
+    TAILQ_INIT(&g_scan_dup_list);
+
+    for (i = 0; i < BLE_LL_SCAN_DUP_HASH_SIZE; i++) {
+        LIST_INIT(&g_scan_dup_hash[i]);
+    }
+}
+
 static int
 ble_ll_scan_dup_check_legacy(uint8_t addr_type, uint8_t *addr, uint8_t pdu_type)
 {
+    struct ble_ll_scan_dup_bucket *bucket;
     struct ble_ll_scan_dup_entry *e;
     uint8_t type;
     int rc;
 
     type = BLE_LL_SCAN_ENTRY_TYPE_LEGACY(addr_type);
 
-    TAILQ_FOREACH(e, &g_scan_dup_list, link) {
-        if ((e->type == type) && !memcmp(e->addr, addr, 6)) {
-            break;
-        }
-    }
+    bucket = ble_ll_scan_dup_bucket(type, addr);
+    e = ble_ll_scan_dup_find(bucket, type, addr);
 
     if (e) {
         if (pdu_type == BLE_ADV_PDU_TYPE_ADV_DIRECT_IND) {
@@ -1827,12 +1889,10 @@ ble_ll_scan_dup_check_legacy(uint8_t addr_type, uint8_t *addr, uint8_t pdu_type)
     } else {
         rc = 0;
 
-        e = ble_ll_scan_dup_new();
+        e = ble_ll_scan_dup_new(bucket);
         e->flags = 0;
         e->type = type;
         memcpy(e->addr, addr, 6);
-
-        TAILQ_INSERT_HEAD(&g_scan_dup_list, e, link);
     }
 
     return rc;
@@ -1843,6 +1903,7 @@ int
 ble_ll_scan_dup_check_ext(uint8_t addr_type, uint8_t *addr, bool has_aux,
                           uint16_t adi)
 {
+    struct ble_ll_scan_dup_bucket *bucket;
     struct ble_ll_scan_dup_entry *e;
     bool is_anon;
     uint8_t type;
@@ -1853,12 +1914,8 @@ ble_ll_scan_dup_check_ext(uint8_t addr_type, uint8_t *addr, bool has_aux,
 
     type = BLE_LL_SCAN_ENTRY_TYPE_EXT(addr_type, has_aux, is_anon, adi);
 
-    TAILQ_FOREACH(e, &g_scan_dup_list, link) {
-        if ((e->type == type) &&
-            (is_anon || !memcmp(e->addr, addr, BLE_DEV_ADDR_LEN))) {
-            break;
-        }
-    }
+    bucket = ble_ll_scan_dup_bucket(type, addr);
+    e = ble_ll_scan_dup_find(bucket, type, addr);
 
     if (e) {
         if (e->adi != adi) {
@@ -1874,15 +1931,13 @@ ble_ll_scan_dup_check_ext(uint8_t addr_type, uint8_t *addr, bool has_aux,
     } else {
         rc = 0;
 
-        e = ble_ll_scan_dup_new();
+        e = ble_ll_scan_dup_new(bucket);
         e->flags = 0;
         e->type = type;
         e->adi = adi;
         if (!is_anon) {
             memcpy(e->addr, addr, 6);
         }
-
-        TAILQ_INSERT_HEAD(&g_scan_dup_list, e, link);
     }
 
     return rc;
@@ -2802,8 +2857,7 @@ ble_ll_scan_reset(void)
     g_ble_ll_scan_num_rsp_advs = 0;
     memset(&g_ble_ll_scan_rsp_advs[0], 0, sizeof(g_ble_ll_scan_rsp_advs));
 
-    os_mempool_clear(&g_scan_dup_pool);
-    TAILQ_INIT(&g_scan_dup_list);
+    ble_ll_scan_dup_clear();
 
     /* Call the common init function again */
     ble_ll_scan_common_init();
@@ -2830,7 +2884,7 @@ ble_ll_scan_init(void)
                           "ble_ll_scan_dup_pool");
     BLE_LL_ASSERT(err == 0);
 
-    TAILQ_INIT(&g_scan_dup_list);
+    ble_ll_scan_dup_clear();
 
     ble_ll_scan_common_init();
 #if MYNEWT_VAL(BLE_LL_CFG_FEAT_LL_EXT_ADV)
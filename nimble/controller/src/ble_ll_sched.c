@@ -87,6 +87,138 @@ static struct ble_ll_sched_css g_ble_ll_sched_css = {
 static TAILQ_HEAD(ll_sched_qhead, ble_ll_sched_item) g_ble_ll_sched_q;
 static uint8_t g_ble_ll_sched_q_head_changed;
 
+/*
+ * Items in the queue never overlap so they are sorted by both start and end
+ * time. On top of the queue there are express lanes (skip list) which allow
+ * to find position for given time in O(log n) instead of walking the whole
+ * queue. Each item is linked into a random number of lanes, each lane having
+ * on average 1/4 of the items of the lane below.
+ */
+static struct ble_ll_sched_item *g_ble_ll_sched_skip[BLE_LL_SCHED_SKIP_LEVELS];
+static uint32_t g_ble_ll_sched_skip_seed = 0x2545f491;
+
+static uint8_t
+ble_ll_sched_skip_level(void)
+{
+    uint32_t x;
+    uint8_t level;
+
+    /* xorshift32, good enough to balance the lanes */
+    x = g_ble_ll_sched_skip_seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_ble_ll_sched_skip_seed = x;
+
+    level = 0;
+    while ((level < BLE_LL_SCHED_SKIP_LEVELS) && ((x & 3) == 0)) {
+        level++;
+        x >>= 2;
+    }
+
+    return level;
+}
+
+/*
+ * Returns last item which ends not later than given time, or NULL if there is
+ * no such item. If 'update' is set, it is filled with links to be updated when
+ * inserting new item after returned one.
+ */
+static struct ble_ll_sched_item *
+ble_ll_sched_q_seek(uint32_t time, struct ble_ll_sched_item ***update)
+{
+    struct ble_ll_sched_item **lane;
+    struct ble_ll_sched_item *prev;
+    struct ble_ll_sched_item *next;
+    int i;
+
+    prev = NULL;
+    lane = g_ble_ll_sched_skip;
+
+    for (i = BLE_LL_SCHED_SKIP_LEVELS - 1; i >= 0; i--) {
+        while ((next = lane[i]) && LL_TMR_LEQ(next->end_time, time)) {
+            prev = next;
+            lane = next->skip;
+        }
+        if (update) {
+            update[i] = &lane[i];
+        }
+    }
+
+    next = prev ? TAILQ_NEXT(prev, link) : TAILQ_FIRST(&g_ble_ll_sched_q);
+    while (next && LL_TMR_LEQ(next->end_time, time)) {
+        prev = next;
+        next = TAILQ_NEXT(next, link);
+    }
+
+    return prev;
+}
+
+/* Returns first item which ends after given time */
+static inline struct ble_ll_sched_item *
+ble_ll_sched_q_find(uint32_t time)
+{
+    struct ble_ll_sched_item *prev;
+
+    prev = ble_ll_sched_q_seek(time, NULL);
+
+    return prev ? TAILQ_NEXT(prev, link) : TAILQ_FIRST(&g_ble_ll_sched_q);
+}
+
+/* Links item into queue; it must not overlap any queued item */
+static void
+ble_ll_sched_q_insert(struct ble_ll_sched_item *sch)
+{
+    struct ble_ll_sched_item **update[BLE_LL_SCHED_SKIP_LEVELS];
+    struct ble_ll_sched_item *prev;
+    int i;
+
+    prev = ble_ll_sched_q_seek(sch->start_time, update);
+    if (prev) {
+        TAILQ_INSERT_AFTER(&g_ble_ll_sched_q, prev, sch, link);
+    } else {
+        TAILQ_INSERT_HEAD(&g_ble_ll_sched_q, sch, link);
+    }
+
+    sch->skip_level = ble_ll_sched_skip_level();
+    for (i = 0; i < sch->skip_level; i++) {
+        sch->skip[i] = *update[i];
+        *update[i] = sch;
+    }
+
+    sch->enqueued = 1;
+}
+
+static void
+ble_ll_sched_q_remove(struct ble_ll_sched_item *sch)
+{
+    struct ble_ll_sched_item **lane;
+    struct ble_ll_sched_item *next;
+    int i;
+
+    lane = g_ble_ll_sched_skip;
+
+    for (i = BLE_LL_SCHED_SKIP_LEVELS - 1; i >= 0; i--) {
+        /* Lanes above the item only need to get us somewhere before it; stop
+         * on equal end time not to overshoot zero-length items.
+         */
+        while ((next = lane[i]) && (next != sch) &&
+               LL_TMR_LT(next->end_time, sch->end_time)) {
+            lane = next->skip;
+        }
+        if (i < sch->skip_level) {
+            while (lane[i] != sch) {
+                BLE_LL_ASSERT(lane[i]);
+                lane = lane[i]->skip;
+            }
+            lane[i] = sch->skip[i];
+        }
+    }
+
+    TAILQ_REMOVE(&g_ble_ll_sched_q, sch, link);
+    sch->enqueued = 0;
+}
+
 static int
 preempt_any(struct ble_ll_sched_item *sch,
             struct ble_ll_sched_item *item)
@@ -125,23 +257,26 @@ ble_ll_sched_check_overlap(struct ble_ll_sched_item *sch1,
            LL_TMR_GT(sch2->end_time, sch1->start_time);
 }
 
+/*
+ * Removes all items overlapping with 'sch' from the queue and notifies their
+ * owners. Callbacks may remove other items so queue is looked up again after
+ * each removal.
+ */
 static void
-ble_ll_sched_preempt(struct ble_ll_sched_item *sch,
-                     struct ble_ll_sched_item *first)
+ble_ll_sched_preempt(struct ble_ll_sched_item *sch)
 {
     struct ble_ll_sched_item *entry;
-    struct ble_ll_sched_item *next;
 #if MYNEWT_VAL(BLE_LL_ROLE_PERIPHERAL) || MYNEWT_VAL(BLE_LL_ROLE_CENTRAL)
     struct ble_ll_conn_sm *connsm;
 #endif
 
-    entry = first;
-
-    do {
-        next = TAILQ_NEXT(entry, link);
+    while (1) {
+        entry = ble_ll_sched_q_find(sch->start_time);
+        if (!entry || !ble_ll_sched_check_overlap(sch, entry)) {
+            break;
+        }
 
-        TAILQ_REMOVE(&g_ble_ll_sched_q, entry, link);
-        entry->enqueued = 0;
+        ble_ll_sched_q_remove(entry);
 
         switch (entry->sched_type) {
 #if MYNEWT_VAL(BLE_LL_ROLE_CENTRAL) || MYNEWT_VAL(BLE_LL_ROLE_PERIPHERAL)
@@ -187,9 +322,7 @@ ble_ll_sched_preempt(struct ble_ll_sched_item *sch,
                 BLE_LL_ASSERT(0);
                 break;
         }
-
-        entry = next;
-    } while (entry != sch);
+    }
 }
 
 static inline void
@@ -228,31 +361,24 @@ int
 ble_ll_sched_insert(struct ble_ll_sched_item *sch, uint32_t max_delay,
                     ble_ll_sched_preempt_cb_t preempt_cb)
 {
-    struct ble_ll_sched_item *preempt_first;
-    struct ble_ll_sched_item *first;
     struct ble_ll_sched_item *entry;
     uint32_t max_start_time;
     uint32_t duration;
+    uint8_t preempt;
 
     OS_ASSERT_CRITICAL();
 
-    preempt_first = NULL;
+    preempt = 0;
 
     max_start_time = sch->start_time + max_delay;
     duration = sch->end_time - sch->start_time;
 
-    first = TAILQ_FIRST(&g_ble_ll_sched_q);
-    if (!first) {
-        TAILQ_INSERT_HEAD(&g_ble_ll_sched_q, sch, link);
-        sch->enqueued = 1;
-        goto done;
-    }
+    /* Items which end before our item starts cannot overlap, skip them */
+    entry = ble_ll_sched_q_find(sch->start_time);
 
-    TAILQ_FOREACH(entry, &g_ble_ll_sched_q, link) {
+    for (; entry; entry = TAILQ_NEXT(entry, link)) {
         if (LL_TMR_LEQ(sch->end_time, entry->start_time)) {
-            TAILQ_INSERT_BEFORE(entry, sch, link);
-            sch->enqueued = 1;
-            goto done;
+            break;
         }
 
         /* If current item overlaps our item check if we can preempt. If we
@@ -262,11 +388,9 @@ ble_ll_sched_insert(struct ble_ll_sched_item *sch, uint32_t max_delay,
 
         if (ble_ll_sched_check_overlap(sch, entry)) {
             if (preempt_cb(sch, entry)) {
-                if (!preempt_first) {
-                    preempt_first = entry;
-                }
+                preempt = 1;
             } else {
-                preempt_first = NULL;
+                preempt = 0;
                 /*
                  * For the 32768 Hz crystal in nrf chip, 1 tick is 30.517us.
                  * The connection state machine use anchor point to store the
@@ -284,7 +408,7 @@ ble_ll_sched_insert(struct ble_ll_sched_item *sch, uint32_t max_delay,
                 if ((max_delay == 0) || LL_TMR_GEQ(sch->start_time,
                                                     max_start_time)) {
                     sch->enqueued = 0;
-                    goto done;
+                    return -1;
                 }
 
                 sch->end_time = sch->start_time + duration;
@@ -292,26 +416,23 @@ ble_ll_sched_insert(struct ble_ll_sched_item *sch, uint32_t max_delay,
         }
     }
 
-    if (!entry) {
-        TAILQ_INSERT_TAIL(&g_ble_ll_sched_q, sch, link);
-        sch->enqueued = 1;
+    /* Only items overlapping our item are left between its final position
+     * and previous item, remove them before inserting.
+     */
+    if (preempt) {
+        ble_ll_sched_preempt(sch);
     }
 
-done:
-    if (preempt_first) {
-        BLE_LL_ASSERT(sch->enqueued);
-        ble_ll_sched_preempt(sch, preempt_first);
-    }
+    ble_ll_sched_q_insert(sch);
 
     /* Pause scheduler if inserted as 1st item, we do not want to miss this
      * one. Caller should restart outside critical section.
      */
     if (TAILQ_FIRST(&g_ble_ll_sched_q) == sch) {
-        BLE_LL_ASSERT(sch->enqueued);
         ble_ll_sched_q_head_changed();
     }
 
-    return sch->enqueued ? 0 : -1;
+    return 0;
 }
 
 /*
@@ -890,8 +1011,7 @@ ble_ll_sched_rmv_elem(struct ble_ll_sched_item *sch)
             first_removed = 1;
         }
 
-        TAILQ_REMOVE(&g_ble_ll_sched_q, sch, link);
-        sch->enqueued = 0;
+        ble_ll_sched_q_remove(sch);
 
         rc = 0;
     } else {
@@ -914,23 +1034,26 @@ ble_ll_sched_rmv_elem_type(uint8_t type, sched_remove_cb_func remove_cb)
 {
     struct ble_ll_sched_item *first;
     struct ble_ll_sched_item *entry;
+    struct ble_ll_sched_item *next;
     uint8_t first_removed;
     os_sr_t sr;
 
     OS_ENTER_CRITICAL(sr);
 
+    first_removed = 0;
+
     first = TAILQ_FIRST(&g_ble_ll_sched_q);
-    if (first->sched_type == type) {
+    if (first && (first->sched_type == type)) {
         first_removed = 1;
     }
 
-    TAILQ_FOREACH(entry, &g_ble_ll_sched_q, link) {
+    for (entry = first; entry; entry = next) {
+        next = TAILQ_NEXT(entry, link);
         if (entry->sched_type != type) {
             continue;
         }
-        TAILQ_REMOVE(&g_ble_ll_sched_q, entry, link);
+        ble_ll_sched_q_remove(entry);
         remove_cb(entry);
-        entry->enqueued = 0;
     }
 
     if (first_removed) {
@@ -1063,8 +1186,7 @@ ble_ll_sched_run(void *arg)
 #endif
 
         /* Remove schedule item and execute the callback */
-        TAILQ_REMOVE(&g_ble_ll_sched_q, sch, link);
-        sch->enqueued = 0;
+        ble_ll_sched_q_remove(sch);
         g_ble_ll_sched_q_head_changed = 1;
 
         ble_ll_sched_execute_item(sch);
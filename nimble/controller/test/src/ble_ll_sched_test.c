@@ -0,0 +1,577 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <os/os.h>
+#include <controller/ble_ll.h>
+#include <controller/ble_ll_conn.h>
+#include <controller/ble_ll_sched.h>
+#include <controller/ble_ll_tmr.h>
+#include <testutil/testutil.h>
+
+/* 64 connections, 8 periodic advertising trains and 4 BIGs */
+#define SCHED_TEST_CONN_CNT         (64)
+#define SCHED_TEST_PERIODIC_CNT     (8)
+#define SCHED_TEST_BIG_CNT          (4)
+#define SCHED_TEST_ITEM_CNT         (SCHED_TEST_CONN_CNT + \
+                                     SCHED_TEST_PERIODIC_CNT + \
+                                     SCHED_TEST_BIG_CNT)
+
+/* Spacing of items laid out by sched_test_layout() */
+#define SCHED_TEST_SLOT             (ble_ll_tmr_u2t(10000))
+
+#define SCHED_TEST_BENCH_ITEM_CNT   (128)
+#define SCHED_TEST_BENCH_ITERS      (200000)
+
+static struct ble_ll_sched_item sched_test_items[SCHED_TEST_ITEM_CNT];
+static struct ble_ll_conn_sm sched_test_conns[SCHED_TEST_CONN_CNT];
+static uint8_t sched_test_preemptible[SCHED_TEST_ITEM_CNT];
+static uint8_t sched_test_preempted[SCHED_TEST_CONN_CNT];
+
+static void
+sched_test_conn_ev_end(struct ble_npl_event *ev)
+{
+    struct ble_ll_conn_sm *connsm;
+
+    connsm = ble_npl_event_get_arg(ev);
+    sched_test_preempted[connsm - sched_test_conns] = 1;
+}
+
+static void
+sched_test_init(void)
+{
+    struct ble_ll_sched_item *sch;
+    int i;
+
+    memset(sched_test_items, 0, sizeof(sched_test_items));
+    memset(sched_test_conns, 0, sizeof(sched_test_conns));
+    memset(sched_test_preemptible, 0, sizeof(sched_test_preemptible));
+    memset(sched_test_preempted, 0, sizeof(sched_test_preempted));
+
+    for (i = 0; i < SCHED_TEST_ITEM_CNT; i++) {
+        sch = &sched_test_items[i];
+        if (i < SCHED_TEST_CONN_CNT) {
+            sch->sched_type = BLE_LL_SCHED_TYPE_CONN;
+            sch->cb_arg = &sched_test_conns[i];
+            ble_npl_event_init(&sched_test_conns[i].conn_ev_end,
+                               sched_test_conn_ev_end, &sched_test_conns[i]);
+        } else if (i < SCHED_TEST_CONN_CNT + SCHED_TEST_PERIODIC_CNT) {
+            sch->sched_type = BLE_LL_SCHED_TYPE_PERIODIC;
+        } else {
+            sch->sched_type = BLE_LL_SCHED_TYPE_BIG;
+        }
+    }
+}
+
+static void
+sched_test_cleanup(void)
+{
+    int i;
+
+    for (i = 0; i < SCHED_TEST_ITEM_CNT; i++) {
+        ble_ll_sched_rmv_elem(&sched_test_items[i]);
+    }
+
+    for (i = 0; i < SCHED_TEST_CONN_CNT; i++) {
+        ble_ll_event_remove(&sched_test_conns[i].conn_ev_end);
+    }
+}
+
+static int
+sched_test_preempt_none(struct ble_ll_sched_item *sch,
+                        struct ble_ll_sched_item *item)
+{
+    return 0;
+}
+
+/* Only connections can be preempted, other types have no owner here */
+static int
+sched_test_preempt_marked(struct ble_ll_sched_item *sch,
+                          struct ble_ll_sched_item *item)
+{
+    return (item->sched_type == BLE_LL_SCHED_TYPE_CONN) &&
+           sched_test_preemptible[item - sched_test_items];
+}
+
+static int
+sched_test_insert(struct ble_ll_sched_item *sch, uint32_t start_time,
+                  uint32_t duration, uint32_t max_delay,
+                  ble_ll_sched_preempt_cb_t preempt_cb)
+{
+    os_sr_t sr;
+    int rc;
+
+    sch->start_time = start_time;
+    sch->end_time = start_time + duration;
+
+    OS_ENTER_CRITICAL(sr);
+    rc = ble_ll_sched_insert(sch, max_delay, preempt_cb);
+    OS_EXIT_CRITICAL(sr);
+    ble_ll_sched_restart();
+
+    TEST_ASSERT((rc == 0) == sch->enqueued);
+    if (rc == 0) {
+        TEST_ASSERT(sch->end_time - sch->start_time == duration);
+    }
+
+    return rc;
+}
+
+/*
+ * Returns whether connection item was preempted since last call, i.e. it was
+ * removed from the queue and its connection event end was posted.
+ */
+static int
+sched_test_was_preempted(int idx)
+{
+    struct ble_npl_event *ev;
+    int preempted;
+
+    ev = &sched_test_conns[idx].conn_ev_end;
+    preempted = sched_test_preempted[idx] || ble_npl_event_is_queued(ev);
+
+    ble_ll_event_remove(ev);
+    sched_test_preempted[idx] = 0;
+
+    TEST_ASSERT(!preempted || !sched_test_items[idx].enqueued);
+
+    return preempted;
+}
+
+static void
+sched_test_verify(void)
+{
+    struct ble_ll_sched_item *a;
+    struct ble_ll_sched_item *b;
+    uint32_t next_time;
+    uint32_t first;
+    int found;
+    int i;
+    int j;
+
+    found = 0;
+    first = 0;
+
+    for (i = 0; i < SCHED_TEST_ITEM_CNT; i++) {
+        a = &sched_test_items[i];
+        if (!a->enqueued) {
+            continue;
+        }
+
+        if (!found || LL_TMR_LT(a->start_time, first)) {
+            first = a->start_time;
+        }
+        found = 1;
+
+        for (j = i + 1; j < SCHED_TEST_ITEM_CNT; j++) {
+            b = &sched_test_items[j];
+            if (!b->enqueued) {
+                continue;
+            }
+            TEST_ASSERT(LL_TMR_LEQ(a->end_time, b->start_time) ||
+                        LL_TMR_LEQ(b->end_time, a->start_time));
+        }
+    }
+
+    TEST_ASSERT(ble_ll_sched_next_time(&next_time) == found);
+    if (found) {
+        TEST_ASSERT(next_time == first);
+    }
+}
+
+/*
+ * Queues all connection items back to back, item i at base + i slots and
+ * taking half a slot.
+ */
+static void
+sched_test_layout(uint32_t base)
+{
+    int rc;
+    int i;
+
+    for (i = 0; i < SCHED_TEST_CONN_CNT; i++) {
+        ble_ll_sched_rmv_elem(&sched_test_items[i]);
+        rc = sched_test_insert(&sched_test_items[i], base + i * SCHED_TEST_SLOT,
+                               SCHED_TEST_SLOT / 2, 0, sched_test_preempt_none);
+        TEST_ASSERT_FATAL(rc == 0);
+    }
+
+    sched_test_verify();
+}
+
+/*
+ * Moves every queued connection item to a random free spot and back again,
+ * so lookups and unlinks go through all express lanes after preemption.
+ */
+static void
+sched_test_churn(uint32_t base)
+{
+    struct ble_ll_sched_item *sch;
+    uint32_t start_time;
+    int i;
+
+    for (i = 0; i < SCHED_TEST_CONN_CNT; i++) {
+        sch = &sched_test_items[i];
+        if (!sch->enqueued) {
+            continue;
+        }
+
+        start_time = sch->start_time;
+        TEST_ASSERT(ble_ll_sched_rmv_elem(sch) == 0);
+        sched_test_insert(sch, base + ble_ll_tmr_u2t(rand() % 1000000),
+                          SCHED_TEST_SLOT / 2, SCHED_TEST_SLOT * 4,
+                          sched_test_preempt_none);
+        sched_test_verify();
+
+        if (sch->enqueued) {
+            TEST_ASSERT(ble_ll_sched_rmv_elem(sch) == 0);
+        }
+        TEST_ASSERT(sched_test_insert(sch, start_time, SCHED_TEST_SLOT / 2, 0,
+                                      sched_test_preempt_none) == 0);
+    }
+
+    sched_test_verify();
+}
+
+/*
+ * Preempts connection items first..last with a single item and checks that
+ * only those are removed and notified.
+ */
+static void
+sched_test_preempt_range(uint32_t base, int first, int last)
+{
+    struct ble_ll_sched_item *sch;
+    uint32_t start_time;
+    uint32_t duration;
+    int rc;
+    int i;
+
+    sch = &sched_test_items[SCHED_TEST_CONN_CNT];
+
+    memset(sched_test_preemptible, 1, sizeof(sched_test_preemptible));
+
+    start_time = base + first * SCHED_TEST_SLOT;
+    duration = (last - first) * SCHED_TEST_SLOT + 1;
+
+    rc = sched_test_insert(sch, start_time, duration, 0,
+                           sched_test_preempt_marked);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(sch->start_time == start_time);
+
+    for (i = 0; i < SCHED_TEST_CONN_CNT; i++) {
+        if ((i >= first) && (i <= last)) {
+            TEST_ASSERT(sched_test_was_preempted(i));
+        } else {
+            TEST_ASSERT(!sched_test_was_preempted(i));
+            TEST_ASSERT(sched_test_items[i].enqueued);
+        }
+    }
+
+    sched_test_verify();
+    sched_test_churn(base);
+
+    TEST_ASSERT(ble_ll_sched_rmv_elem(sch) == 0);
+}
+
+TEST_CASE_SELF(ble_ll_sched_test_stress)
+{
+    struct ble_ll_sched_item *sch;
+    uint32_t base;
+    uint32_t duration;
+    int iter;
+    int rc;
+
+    sched_test_init();
+
+    /* Keep everything far in the future so nothing is executed */
+    base = ble_ll_tmr_get() + ble_ll_tmr_u2t(10000000);
+    srand(1);
+
+    for (iter = 0; iter < 20000; iter++) {
+        sch = &sched_test_items[rand() % SCHED_TEST_ITEM_CNT];
+
+        if (sch->enqueued) {
+            rc = ble_ll_sched_rmv_elem(sch);
+            TEST_ASSERT(rc == 0);
+            TEST_ASSERT(!sch->enqueued);
+        } else {
+            duration = ble_ll_tmr_u2t(1250 + (rand() % 2500));
+            sched_test_insert(sch, base + ble_ll_tmr_u2t(rand() % 400000),
+                              duration, ble_ll_tmr_u2t(rand() % 20000),
+                              sched_test_preempt_none);
+        }
+
+        if ((iter % 64) == 0) {
+            sched_test_verify();
+        }
+    }
+
+    sched_test_verify();
+    sched_test_cleanup();
+    sched_test_verify();
+}
+
+TEST_CASE_SELF(ble_ll_sched_test_preempt_head)
+{
+    uint32_t base;
+
+    sched_test_init();
+
+    base = ble_ll_tmr_get() + ble_ll_tmr_u2t(10000000);
+    srand(2);
+
+    sched_test_layout(base);
+    sched_test_preempt_range(base, 0, 0);
+
+    sched_test_layout(base);
+    sched_test_preempt_range(base, 0, 3);
+
+    sched_test_cleanup();
+}
+
+TEST_CASE_SELF(ble_ll_sched_test_preempt_middle)
+{
+    uint32_t base;
+    int round;
+    int top;
+    int i;
+
+    sched_test_init();
+
+    base = ble_ll_tmr_get() + ble_ll_tmr_u2t(10000000);
+    srand(3);
+
+    /* Several items in the middle, at least one of them in express lanes */
+    sched_test_layout(base);
+    for (i = 8; i < SCHED_TEST_CONN_CNT - 8; i++) {
+        if (sched_test_items[i].skip_level > 0) {
+            break;
+        }
+    }
+    TEST_ASSERT_FATAL(i < SCHED_TEST_CONN_CNT - 8);
+    sched_test_preempt_range(base, i - 2, i + 2);
+
+    /* Item linked in the most express lanes, on a few different layouts */
+    for (round = 0; round < 4; round++) {
+        sched_test_layout(base);
+        top = 1;
+        for (i = 2; i < SCHED_TEST_CONN_CNT - 1; i++) {
+            if (sched_test_items[i].skip_level >
+                sched_test_items[top].skip_level) {
+                top = i;
+            }
+        }
+        TEST_ASSERT(sched_test_items[top].skip_level > 0);
+        sched_test_preempt_range(base, top, top);
+    }
+
+    /* Tail and whole queue */
+    sched_test_layout(base);
+    sched_test_preempt_range(base, SCHED_TEST_CONN_CNT - 4,
+                             SCHED_TEST_CONN_CNT - 1);
+
+    sched_test_layout(base);
+    sched_test_preempt_range(base, 0, SCHED_TEST_CONN_CNT - 1);
+
+    sched_test_cleanup();
+}
+
+TEST_CASE_SELF(ble_ll_sched_test_preempt_blocked)
+{
+    struct ble_ll_sched_item *sch;
+    uint32_t base;
+    uint32_t start_time;
+    uint32_t end_time;
+    int overlaps;
+    int rc;
+    int i;
+
+    sched_test_init();
+
+    base = ble_ll_tmr_get() + ble_ll_tmr_u2t(10000000);
+    sch = &sched_test_items[SCHED_TEST_CONN_CNT];
+
+    sched_test_layout(base);
+    memset(sched_test_preemptible, 1, sizeof(sched_test_preemptible));
+    sched_test_preemptible[11] = 0;
+
+    /* Item 11 cannot be preempted and there is no room to move: nothing
+     * should be preempted, not even item 10 which overlaps first.
+     */
+    start_time = base + 10 * SCHED_TEST_SLOT;
+    rc = sched_test_insert(sch, start_time, SCHED_TEST_SLOT * 3 / 2, 0,
+                           sched_test_preempt_marked);
+    TEST_ASSERT(rc != 0);
+    for (i = 0; i < SCHED_TEST_CONN_CNT; i++) {
+        TEST_ASSERT(!sched_test_was_preempted(i));
+    }
+
+    /* With delay allowed item is moved past item 11 and preempts whatever
+     * overlaps it there instead (item 12 at least), leaving item 10 alone.
+     */
+    end_time = sched_test_items[11].end_time;
+    rc = sched_test_insert(sch, start_time, SCHED_TEST_SLOT * 3 / 2,
+                           SCHED_TEST_SLOT * 4, sched_test_preempt_marked);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(sch->start_time == end_time + 1);
+    for (i = 0; i < SCHED_TEST_CONN_CNT; i++) {
+        overlaps = (i > 11) &&
+                   LL_TMR_LT(base + i * SCHED_TEST_SLOT, sch->end_time);
+        TEST_ASSERT(sched_test_was_preempted(i) == overlaps);
+    }
+    TEST_ASSERT(!sched_test_items[12].enqueued);
+    TEST_ASSERT(sched_test_items[10].enqueued);
+    TEST_ASSERT(sched_test_items[11].enqueued);
+
+    sched_test_verify();
+    sched_test_churn(base);
+    sched_test_cleanup();
+}
+
+TEST_CASE_SELF(ble_ll_sched_test_preempt_stress)
+{
+    struct ble_ll_sched_item *sch;
+    uint8_t enqueued[SCHED_TEST_ITEM_CNT];
+    uint32_t base;
+    uint32_t duration;
+    int iter;
+    int rc;
+    int i;
+
+    sched_test_init();
+
+    base = ble_ll_tmr_get() + ble_ll_tmr_u2t(10000000);
+    srand(4);
+
+    for (iter = 0; iter < 20000; iter++) {
+        sch = &sched_test_items[rand() % SCHED_TEST_ITEM_CNT];
+
+        if (sch->enqueued) {
+            TEST_ASSERT(ble_ll_sched_rmv_elem(sch) == 0);
+            continue;
+        }
+
+        for (i = 0; i < SCHED_TEST_ITEM_CNT; i++) {
+            enqueued[i] = sched_test_items[i].enqueued;
+            sched_test_preemptible[i] = rand() & 1;
+        }
+
+        duration = ble_ll_tmr_u2t(1250 + (rand() % 10000));
+        rc = sched_test_insert(sch, base + ble_ll_tmr_u2t(rand() % 400000),
+                               duration, ble_ll_tmr_u2t(rand() % 20000),
+                               sched_test_preempt_marked);
+
+        /* Only preemptible connections may disappear and each of them must
+         * be notified.
+         */
+        for (i = 0; i < SCHED_TEST_ITEM_CNT; i++) {
+            if (&sched_test_items[i] == sch) {
+                continue;
+            }
+            if (i >= SCHED_TEST_CONN_CNT) {
+                TEST_ASSERT(enqueued[i] == sched_test_items[i].enqueued);
+                continue;
+            }
+            if (enqueued[i] && !sched_test_items[i].enqueued) {
+                TEST_ASSERT(rc == 0);
+                TEST_ASSERT(sched_test_preemptible[i]);
+                TEST_ASSERT(sched_test_was_preempted(i));
+            } else {
+                TEST_ASSERT(enqueued[i] == sched_test_items[i].enqueued);
+                TEST_ASSERT(!sched_test_was_preempted(i));
+            }
+        }
+
+        if ((iter % 64) == 0) {
+            sched_test_verify();
+        }
+    }
+
+    sched_test_verify();
+    sched_test_cleanup();
+    sched_test_verify();
+}
+
+TEST_SUITE(ble_ll_sched_test_suite)
+{
+    ble_ll_sched_test_stress();
+    ble_ll_sched_test_preempt_head();
+    ble_ll_sched_test_preempt_middle();
+    ble_ll_sched_test_preempt_blocked();
+    ble_ll_sched_test_preempt_stress();
+}
+
+/*
+ * Scheduler microbenchmark, not part of the regular test run. Keeps a rolling
+ * schedule of given depth (each iteration removes the earliest item and
+ * queues it again at the end, as periodic events do) and reports the average
+ * cost of one remove and insert.
+ */
+void
+ble_ll_sched_bench(void)
+{
+    static struct ble_ll_sched_item items[SCHED_TEST_BENCH_ITEM_CNT];
+    static const int depths[] = { 8, 16, 32, 64, 128 };
+    struct ble_ll_sched_item *sch;
+    uint32_t start_time;
+    clock_t start;
+    int depth;
+    int iter;
+    int rc;
+    int i;
+    int j;
+
+    printf("depth  remove+insert(ns)\n");
+
+    for (i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        depth = depths[i];
+
+        memset(items, 0, sizeof(items));
+        start_time = ble_ll_tmr_get() + ble_ll_tmr_u2t(10000000);
+
+        for (j = 0; j < depth; j++) {
+            items[j].sched_type = BLE_LL_SCHED_TYPE_PERIODIC;
+            rc = sched_test_insert(&items[j], start_time, SCHED_TEST_SLOT / 2,
+                                   0, sched_test_preempt_none);
+            TEST_ASSERT_FATAL(rc == 0);
+            start_time += SCHED_TEST_SLOT;
+        }
+
+        start = clock();
+        for (iter = 0; iter < SCHED_TEST_BENCH_ITERS; iter++) {
+            sch = &items[iter % depth];
+            ble_ll_sched_rmv_elem(sch);
+            sched_test_insert(sch, start_time, SCHED_TEST_SLOT / 2, 0,
+                              sched_test_preempt_none);
+            start_time += SCHED_TEST_SLOT;
+        }
+
+        printf("%5d  %17.1f\n", depth,
+               (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 /
+               SCHED_TEST_BENCH_ITERS);
+
+        for (j = 0; j < depth; j++) {
+            ble_ll_sched_rmv_elem(&items[j]);
+        }
+    }
+}
@@ -17,6 +17,7 @@
  * under the License.
  */
 
+#include <string.h>
 #include <syscfg/syscfg.h>
 #include <testutil/testutil.h>
 
@@ -27,6 +28,9 @@ TEST_SUITE_DECL(ble_ll_crypto_test_suite);
 TEST_SUITE_DECL(ble_ll_csa2_test_suite);
 TEST_SUITE_DECL(ble_ll_isoal_test_suite);
 TEST_SUITE_DECL(ble_ll_iso_test_suite);
+TEST_SUITE_DECL(ble_ll_sched_test_suite);
+
+void ble_ll_sched_bench(void);
 
 int
 main(int argc, char **argv)
@@ -36,6 +40,12 @@ main(int argc, char **argv)
     ble_ll_csa2_test_suite();
     ble_ll_isoal_test_suite();
     ble_ll_iso_test_suite();
+    ble_ll_sched_test_suite();
+
+    /* "bench" times a rolling periodic schedule 8 to 128 items deep. */
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        ble_ll_sched_bench();
+    }
 
     return tu_any_failed;
 }
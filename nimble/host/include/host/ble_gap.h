@@ -261,6 +261,9 @@ struct hci_conn_update;
 /** GAP event: BIG (Broadcast Isochronous Group) information report */
 #define BLE_GAP_EVENT_BIGINFO_REPORT        30
 
+/** GAP event: Batch of discovery events */
+#define BLE_GAP_EVENT_DISC_BATCH            31
+
 /** @} */
 
 /**
@@ -685,6 +688,21 @@ struct ble_gap_event {
          */
         struct ble_gap_disc_desc disc;
 
+        /**
+         * Represents all advertising reports carried by a single HCI event,
+         * received during a discovery procedure with batching enabled (see
+         * ble_gap_disc_set_batch()).  The descriptors are only valid for the
+         * duration of the callback.  Valid for the following event types:
+         *     o BLE_GAP_EVENT_DISC_BATCH
+         */
+        struct {
+            /** Array of advertising report descriptors */
+            const struct ble_gap_disc_desc *descs;
+
+            /** Number of descriptors in the array */
+            uint8_t num_descs;
+        } disc_batch;
+
 #if MYNEWT_VAL(BLE_EXT_ADV)
         /**
          * Represents an extended advertising report received during a discovery
@@ -2094,6 +2112,24 @@ int ble_gap_ext_disc(uint8_t own_addr_type, uint16_t duration, uint16_t period,
  */
 int ble_gap_disc_cancel(void);
 
+/**
+ * Configures how advertising reports are delivered during the discovery
+ * procedure.  With batching enabled, all reports carried by a single HCI
+ * event are delivered in one BLE_GAP_EVENT_DISC_BATCH event instead of one
+ * BLE_GAP_EVENT_DISC event per report, both to the discovery callback and to
+ * GAP event listeners.  The setting persists across discovery procedures.
+ *
+ * Batching applies to legacy advertising reports only, so it is not
+ * available when extended advertising is enabled.
+ *
+ * @param enable                1 to deliver reports in batches;
+ *                              0 to deliver them one by one (default).
+ *
+ * @return                      0 on success;
+ *                              BLE_HS_ENOTSUP if not supported.
+ */
+int ble_gap_disc_set_batch(int enable);
+
 /**
  * Indicates whether a discovery procedure is currently in progress.
  *
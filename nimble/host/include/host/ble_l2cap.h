@@ -504,6 +504,56 @@ struct ble_l2cap_chan_info {
     uint16_t peer_coc_mtu;
 };
 
+/**
+ * @brief Per-channel LE CoC statistics.
+ *
+ * Retrieved with ble_l2cap_get_coc_stats(). Counters start when the channel
+ * is created; throughput figures are averages over the channel lifetime.
+ */
+struct ble_l2cap_coc_stats {
+    /** Time since the channel was created, in milliseconds. */
+    uint32_t uptime_ms;
+
+    /** Number of SDU payload bytes received. */
+    uint32_t rx_bytes;
+
+    /** Number of complete SDUs received. */
+    uint32_t rx_sdus;
+
+    /** Average receive throughput, in bytes per second. */
+    uint32_t rx_bytes_per_sec;
+
+    /** Credits granted to the peer after channel establishment. */
+    uint32_t rx_credits;
+
+    /** Number of times the peer ran out of credits. */
+    uint32_t rx_stalls;
+
+    /** Total time the peer spent without credits, in milliseconds. */
+    uint32_t rx_stall_ms;
+
+    /** Number of SDU payload bytes transmitted. */
+    uint32_t tx_bytes;
+
+    /** Number of complete SDUs transmitted. */
+    uint32_t tx_sdus;
+
+    /** Average transmit throughput, in bytes per second. */
+    uint32_t tx_bytes_per_sec;
+
+    /** Number of times transmission stalled waiting for peer credits. */
+    uint32_t tx_stalls;
+
+    /** Total time transmission spent stalled, in milliseconds. */
+    uint32_t tx_stall_ms;
+
+    /**
+     * Current receive window, in credits. Equals the initial number of
+     * credits unless BLE_L2CAP_COC_AUTO_CREDITS is enabled.
+     */
+    uint16_t rx_window;
+};
+
 /**
  * @brief Function pointer type for handling L2CAP events.
  *
@@ -625,6 +675,21 @@ int ble_l2cap_recv_ready(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_rx);
  */
 int ble_l2cap_get_chan_info(struct ble_l2cap_chan *chan, struct ble_l2cap_chan_info *chan_info);
 
+/**
+ * @brief Get statistics of an LE CoC channel.
+ *
+ * Requires BLE_L2CAP_COC_STATS.
+ *
+ * @param chan          Pointer to the L2CAP channel structure to retrieve statistics from.
+ * @param stats         Pointer to the `ble_l2cap_coc_stats` structure to populate.
+ *
+ * @return              0 on success;
+ *                      BLE_HS_ENOTSUP if statistics are not enabled;
+ *                      A non-zero value on failure.
+ */
+int ble_l2cap_get_coc_stats(struct ble_l2cap_chan *chan,
+                            struct ble_l2cap_coc_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -303,14 +303,45 @@ struct ble_sm_io {
  * Generates Out of Band (OOB) data used during the authentication process.
  * The data consists of 128-bit Random Number and 128-bit Confirm Value.
  *
+ * With BLE_SM_SC_HCI_ECC our public key is read from the controller.  Until
+ * it is available this returns BLE_HS_EAGAIN and starts reading it; call
+ * again later.
+ *
+ * Key rotation (BLE_SM_SC_KEY_ROTATE_PAIRINGS, BLE_SM_SC_KEY_ROTATE_TIME) is
+ * held off from this call until the data has been injected into a pairing
+ * with ble_sm_inject_io(), so that the Confirm Value stays valid.
+ *
  * @param oob_data              A pointer to the structure where the generated
  *                              OOB data will be stored.
  *
  * @return                      0 on success;
+ *                              BLE_HS_EAGAIN if our public key is still being
+ *                                  read from the controller;
  *                              Non-zero on failure.
  */
 int ble_sm_sc_oob_generate_data(struct ble_sm_sc_oob_data *oob_data);
 
+/**
+ * Returns the number of pre-generated LE Secure Connections key pairs that
+ * are ready for use (see BLE_SM_SC_KEY_POOL_SIZE).
+ *
+ * @return                      The number of key pairs in the pool.
+ */
+int ble_sm_sc_key_pool_count(void);
+
+struct ble_npl_eventq;
+
+/**
+ * Sets the event queue from which the LE Secure Connections key pool
+ * (BLE_SM_SC_KEY_POOL_SIZE) is filled.  Generating a P-256 key pair takes a
+ * long time, so the queue should be serviced by a task of lower priority
+ * than the host.  The pool is not filled until a queue is set; filling
+ * starts on the next host timer run.
+ *
+ * @param evq                   The event queue to generate key pairs from.
+ */
+void ble_sm_sc_key_pool_evq_set(struct ble_npl_eventq *evq);
+
 #if MYNEWT_VAL(BLE_SM_CSIS_SIRK)
 /**
  * Resolves CSIS RSI to check if advertising device is part of the same Coordinated Set,
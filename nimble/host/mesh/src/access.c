@@ -50,6 +50,19 @@ struct mod_pub_val {
 
 static const struct bt_mesh_comp *dev_comp;
 static uint16_t dev_primary_addr;
+
+#if MYNEWT_VAL(BLE_MESH_MODEL_OP_TABLE_SIZE) > 0
+/* Opcode lookup table, sorted by opcode and element index. Holds the op
+ * that find_op() would return for each (opcode, element) pair.
+ */
+static struct op_entry {
+	uint32_t opcode;
+	struct bt_mesh_model *model;
+	const struct bt_mesh_model_op *op;
+} op_table[MYNEWT_VAL(BLE_MESH_MODEL_OP_TABLE_SIZE)];
+static uint16_t op_table_count;
+static bool op_table_valid;
+#endif
 static void (*msg_cb)(uint32_t opcode, struct bt_mesh_msg_ctx *ctx, struct os_mbuf *buf);
 
 void bt_mesh_model_foreach(void (*func)(struct bt_mesh_model *mod,
@@ -357,6 +370,97 @@ static void mod_init(struct bt_mesh_model *mod, struct bt_mesh_elem *elem,
 	}
 }
 
+#if MYNEWT_VAL(BLE_MESH_MODEL_OP_TABLE_SIZE) > 0
+/* Returns the position of the first entry not below (opcode, elem_idx) */
+static uint16_t op_table_lower(uint32_t opcode, uint8_t elem_idx)
+{
+	const struct op_entry *entry;
+	uint16_t lo = 0, hi = op_table_count, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		entry = &op_table[mid];
+
+		if (entry->opcode < opcode ||
+		    (entry->opcode == opcode &&
+		     entry->model->elem_idx < elem_idx)) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+static void op_table_add_model(struct bt_mesh_model *mod, bool vnd)
+{
+	const struct bt_mesh_model_op *op;
+	struct op_entry *entry;
+	uint16_t pos;
+
+	for (op = mod->op; op->func; op++) {
+		/* find_op() looks up SIG opcodes in SIG models only and vendor
+		 * opcodes in vendor models of the same company only.
+		 */
+		if (vnd != (BT_MESH_MODEL_OP_LEN(op->opcode) == 3)) {
+			continue;
+		}
+
+		if (vnd && CONFIG_BT_MESH_MODEL_VND_MSG_CID_FORCE &&
+		    (op->opcode & 0xffff) != mod->vnd.company) {
+			continue;
+		}
+
+		pos = op_table_lower(op->opcode, mod->elem_idx);
+		entry = &op_table[pos];
+
+		/* The first model on the element handling the opcode wins */
+		if (pos < op_table_count && entry->opcode == op->opcode &&
+		    entry->model->elem_idx == mod->elem_idx) {
+			continue;
+		}
+
+		if (op_table_count == ARRAY_SIZE(op_table)) {
+			op_table_valid = false;
+			return;
+		}
+
+		memmove(entry + 1, entry,
+			(op_table_count - pos) * sizeof(*entry));
+		entry->opcode = op->opcode;
+		entry->model = mod;
+		entry->op = op;
+		op_table_count++;
+	}
+}
+
+static void op_table_build(void)
+{
+	struct bt_mesh_elem *elem;
+	int i, j;
+
+	op_table_count = 0;
+	op_table_valid = true;
+
+	for (i = 0; i < dev_comp->elem_count && op_table_valid; i++) {
+		elem = &dev_comp->elem[i];
+
+		for (j = 0; j < elem->model_count && op_table_valid; j++) {
+			op_table_add_model(&elem->models[j], false);
+		}
+
+		for (j = 0; j < elem->vnd_model_count && op_table_valid; j++) {
+			op_table_add_model(&elem->vnd_models[j], true);
+		}
+	}
+
+	if (!op_table_valid) {
+		BT_WARN("Opcode table too small, using linear lookup");
+	}
+}
+#endif
+
 int bt_mesh_comp_register(const struct bt_mesh_comp *comp)
 {
 	int err;
@@ -371,6 +475,10 @@ int bt_mesh_comp_register(const struct bt_mesh_comp *comp)
 	err = 0;
 	bt_mesh_model_foreach(mod_init, &err);
 
+#if MYNEWT_VAL(BLE_MESH_MODEL_OP_TABLE_SIZE) > 0
+	op_table_build();
+#endif
+
 	return err;
 }
 
@@ -666,6 +774,37 @@ static int get_opcode(struct os_mbuf *buf, uint32_t *opcode)
 	CODE_UNREACHABLE;
 }
 
+static void model_recv(struct bt_mesh_net_rx *rx, struct os_mbuf *buf,
+		       uint32_t opcode, struct bt_mesh_model *model,
+		       const struct bt_mesh_model_op *op)
+{
+	struct net_buf_simple_state state;
+
+	if (!bt_mesh_model_has_key(model, rx->ctx.app_idx)) {
+		return;
+	}
+
+	if (!model_has_dst(model, rx->ctx.recv_dst)) {
+		return;
+	}
+
+	if ((op->len >= 0) && (buf->om_len < (size_t)op->len)) {
+		BT_ERR("Too short message for OpCode 0x%08x", opcode);
+		return;
+	} else if ((op->len < 0) && (buf->om_len != (size_t)(-op->len))) {
+		BT_ERR("Invalid message size for OpCode 0x%08x", opcode);
+		return;
+	}
+
+	/* The callback will likely parse the buffer, so
+	 * store the parsing state in case multiple models
+	 * receive the message.
+	 */
+	net_buf_simple_save(buf, &state);
+	(void)op->func(model, &rx->ctx, buf);
+	net_buf_simple_restore(buf, &state);
+}
+
 void bt_mesh_model_recv(struct bt_mesh_net_rx *rx, struct os_mbuf *buf)
 {
 	struct bt_mesh_model *model;
@@ -684,9 +823,19 @@ void bt_mesh_model_recv(struct bt_mesh_net_rx *rx, struct os_mbuf *buf)
 
 	BT_DBG("OpCode 0x%08x", (unsigned) opcode);
 
-	for (i = 0; i < dev_comp->elem_count; i++) {
-		struct net_buf_simple_state state;
+#if MYNEWT_VAL(BLE_MESH_MODEL_OP_TABLE_SIZE) > 0
+	if (op_table_valid) {
+		for (i = op_table_lower(opcode, 0);
+		     i < op_table_count && op_table[i].opcode == opcode; i++) {
+			model_recv(rx, buf, opcode, op_table[i].model,
+				   op_table[i].op);
+		}
+
+		goto done;
+	}
+#endif
 
+	for (i = 0; i < dev_comp->elem_count; i++) {
 		op = find_op(&dev_comp->elem[i], opcode, &model);
 
 		if (!op) {
@@ -694,32 +843,13 @@ void bt_mesh_model_recv(struct bt_mesh_net_rx *rx, struct os_mbuf *buf)
 			continue;
 		}
 
-		if (!bt_mesh_model_has_key(model, rx->ctx.app_idx)) {
-				continue;
-			}
-
-		if (!model_has_dst(model, rx->ctx.recv_dst)) {
-			continue;
-		}
-
-		if ((op->len >= 0) && (buf->om_len < (size_t)op->len)) {
-			BT_ERR("Too short message for OpCode 0x%08x", opcode);
-			continue;
-		} else if ((op->len < 0) && (buf->om_len != (size_t)(-op->len))) {
-			BT_ERR("Invalid message size for OpCode 0x%08x",
-			       opcode);
-			continue;
-		}
-
-		/* The callback will likely parse the buffer, so
-		 * store the parsing state in case multiple models
-		 * receive the message.
-		 */
-		net_buf_simple_save(buf, &state);
-		(void)op->func(model, &rx->ctx, buf);
-		net_buf_simple_restore(buf, &state);
+		model_recv(rx, buf, opcode, model, op);
 	}
 
+#if MYNEWT_VAL(BLE_MESH_MODEL_OP_TABLE_SIZE) > 0
+done:
+#endif
+
 	if (MYNEWT_VAL(BLE_MESH_ACCESS_LAYER_MSG) && msg_cb) {
 		msg_cb(opcode, &rx->ctx, buf);
 	}
@@ -10,6 +10,19 @@
 
 #include "crypto.h"
 
+/* Key schedule is expanded once per CCM operation rather than for every
+ * block, as bt_encrypt_be() would do.
+ */
+static int ccm_encrypt_block(struct tc_aes_key_sched_struct *sched,
+			     const uint8_t in[16], uint8_t out[16])
+{
+	if (tc_aes_encrypt(out, in, sched) == TC_CRYPTO_FAIL) {
+		return BLE_HS_EUNKNOWN;
+	}
+
+	return 0;
+}
+
 static inline void xor16(uint8_t *dst, const uint8_t *a, const uint8_t *b)
 {
 	dst[0] = a[0] ^ b[0];
@@ -31,7 +44,8 @@ static inline void xor16(uint8_t *dst, const uint8_t *a, const uint8_t *b)
 }
 
 /* pmsg is assumed to have the nonce already present in bytes 1-13 */
-static int ccm_calculate_X0(const uint8_t key[16], const uint8_t *aad, uint8_t aad_len,
+static int ccm_calculate_X0(struct tc_aes_key_sched_struct *sched,
+			    const uint8_t *aad, uint8_t aad_len,
 			    size_t mic_size, uint8_t msg_len, uint8_t b[16],
 			    uint8_t X0[16])
 {
@@ -42,7 +56,7 @@ static int ccm_calculate_X0(const uint8_t key[16], const uint8_t *aad, uint8_t a
 
 	sys_put_be16(msg_len, b + 14);
 
-	err = bt_encrypt_be(key, b, X0);
+	err = ccm_encrypt_block(sched, b, X0);
 	if (err) {
 		return err;
 	}
@@ -66,7 +80,7 @@ static int ccm_calculate_X0(const uint8_t key[16], const uint8_t *aad, uint8_t a
 			aad_len -= 16;
 			i = 0;
 
-			err = bt_encrypt_be(key, b, X0);
+			err = ccm_encrypt_block(sched, b, X0);
 			if (err) {
 				return err;
 			}
@@ -80,7 +94,7 @@ static int ccm_calculate_X0(const uint8_t key[16], const uint8_t *aad, uint8_t a
 			b[i] = X0[i];
 		}
 
-		err = bt_encrypt_be(key, b, X0);
+		err = ccm_encrypt_block(sched, b, X0);
 		if (err) {
 			return err;
 		}
@@ -89,7 +103,8 @@ static int ccm_calculate_X0(const uint8_t key[16], const uint8_t *aad, uint8_t a
 	return 0;
 }
 
-static int ccm_auth(const uint8_t key[16], uint8_t nonce[13],
+static int ccm_auth(struct tc_aes_key_sched_struct *sched,
+		    uint8_t nonce[13],
 		    const uint8_t *cleartext_msg, size_t msg_len, const uint8_t *aad,
 		    size_t aad_len, uint8_t *mic, size_t mic_size)
 {
@@ -109,12 +124,15 @@ static int ccm_auth(const uint8_t key[16], uint8_t nonce[13],
 	/* S[0] = e(AppKey, 0x01 || nonce || 0x0000) */
 	sys_put_be16(0x0000, &b[14]);
 
-	err = bt_encrypt_be(key, b, s0);
+	err = ccm_encrypt_block(sched, b, s0);
 	if (err) {
 		return err;
 	}
 
-	ccm_calculate_X0(key, aad, aad_len, mic_size, msg_len, b, Xn);
+	err = ccm_calculate_X0(sched, aad, aad_len, mic_size, msg_len, b, Xn);
+	if (err) {
+		return err;
+	}
 
 	for (j = 0; j < blk_cnt; j++) {
 		/* X_1 = e(AppKey, X_0 ^ Payload[0-15]) */
@@ -128,7 +146,7 @@ static int ccm_auth(const uint8_t key[16], uint8_t nonce[13],
 			xor16(b, Xn, &cleartext_msg[j * 16]);
 		}
 
-		err = bt_encrypt_be(key, b, Xn);
+		err = ccm_encrypt_block(sched, b, Xn);
 		if (err) {
 			return err;
 		}
@@ -142,7 +160,8 @@ static int ccm_auth(const uint8_t key[16], uint8_t nonce[13],
 	return 0;
 }
 
-static int ccm_crypt(const uint8_t key[16], const uint8_t nonce[13],
+static int ccm_crypt(struct tc_aes_key_sched_struct *sched,
+		     const uint8_t nonce[13],
 		     const uint8_t *in_msg, uint8_t *out_msg, size_t msg_len)
 {
 	uint8_t a_i[16], s_i[16];
@@ -163,7 +182,7 @@ static int ccm_crypt(const uint8_t key[16], const uint8_t nonce[13],
 		/* S_1 = e(AppKey, 0x01 || nonce || 0x0001) */
 		sys_put_be16(j + 1, &a_i[14]);
 
-		err = bt_encrypt_be(key, a_i, s_i);
+		err = ccm_encrypt_block(sched, a_i, s_i);
 		if (err) {
 			return err;
 		}
@@ -185,15 +204,28 @@ int bt_ccm_decrypt(const uint8_t key[16], uint8_t nonce[13], const uint8_t *enc_
 		   size_t msg_len, const uint8_t *aad, size_t aad_len,
 		   uint8_t *out_msg, size_t mic_size)
 {
+	struct tc_aes_key_sched_struct sched;
 	uint8_t mic[16];
+	int err;
 
 	if (aad_len >= 0xff00 || mic_size > sizeof(mic)) {
 		return -EINVAL;
 	}
 
-	ccm_crypt(key, nonce, enc_msg, out_msg, msg_len);
+	if (tc_aes128_set_encrypt_key(&sched, key) == TC_CRYPTO_FAIL) {
+		return BLE_HS_EUNKNOWN;
+	}
 
-	ccm_auth(key, nonce, out_msg, msg_len, aad, aad_len, mic, mic_size);
+	err = ccm_crypt(&sched, nonce, enc_msg, out_msg, msg_len);
+	if (err) {
+		return err;
+	}
+
+	err = ccm_auth(&sched, nonce, out_msg, msg_len, aad, aad_len, mic,
+		       mic_size);
+	if (err) {
+		return err;
+	}
 
 	if (memcmp(mic, enc_msg + msg_len, mic_size)) {
 		return -EBADMSG;
@@ -206,7 +238,9 @@ int bt_ccm_encrypt(const uint8_t key[16], uint8_t nonce[13], const uint8_t *msg,
 		   size_t msg_len, const uint8_t *aad, size_t aad_len,
 		   uint8_t *out_msg, size_t mic_size)
 {
+	struct tc_aes_key_sched_struct sched;
 	uint8_t *mic = out_msg + msg_len;
+	int err;
 
 	BT_DBG("key %s", bt_hex(key, 16));
 	BT_DBG("nonce %s", bt_hex(nonce, 13));
@@ -218,9 +252,15 @@ int bt_ccm_encrypt(const uint8_t key[16], uint8_t nonce[13], const uint8_t *msg,
 		return -EINVAL;
 	}
 
-	ccm_auth(key, nonce, out_msg, msg_len, aad, aad_len, mic, mic_size);
+	if (tc_aes128_set_encrypt_key(&sched, key) == TC_CRYPTO_FAIL) {
+		return BLE_HS_EUNKNOWN;
+	}
 
-	ccm_crypt(key, nonce, msg, out_msg, msg_len);
+	err = ccm_auth(&sched, nonce, msg, msg_len, aad, aad_len, mic,
+		       mic_size);
+	if (err) {
+		return err;
+	}
 
-	return 0;
+	return ccm_crypt(&sched, nonce, msg, out_msg, msg_len);
 }
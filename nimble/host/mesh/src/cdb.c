@@ -87,6 +87,54 @@ struct bt_mesh_cdb bt_mesh_cdb = {
 	},
 };
 
+/*
+ * Indexes of allocated nodes in bt_mesh_cdb.nodes, sorted by their primary
+ * address. Node address ranges never overlap, so the node owning an element
+ * address can be found with a binary search.
+ */
+static uint16_t node_sorted[CONFIG_BT_MESH_NODE_COUNT];
+static uint16_t node_sorted_cnt;
+
+/* Returns the position of the first node with primary address above addr */
+static uint16_t node_sorted_upper(uint16_t addr)
+{
+	uint16_t lo = 0, hi = node_sorted_cnt, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (bt_mesh_cdb.nodes[node_sorted[mid]].addr > addr) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	return lo;
+}
+
+static void node_sorted_add(const struct bt_mesh_cdb_node *node)
+{
+	uint16_t pos = node_sorted_upper(node->addr);
+
+	memmove(&node_sorted[pos + 1], &node_sorted[pos],
+		(node_sorted_cnt - pos) * sizeof(node_sorted[0]));
+	node_sorted[pos] = node - bt_mesh_cdb.nodes;
+	node_sorted_cnt++;
+}
+
+static void node_sorted_del(const struct bt_mesh_cdb_node *node)
+{
+	uint16_t pos = node_sorted_upper(node->addr);
+
+	if (pos == 0 || node_sorted[pos - 1] != node - bt_mesh_cdb.nodes) {
+		return;
+	}
+
+	memmove(&node_sorted[pos - 1], &node_sorted[pos],
+		(node_sorted_cnt - pos) * sizeof(node_sorted[0]));
+	node_sorted_cnt--;
+}
+
 /*
  * Check if an address range from addr_start for addr_start + num_elem - 1 is
  * free for use. When a conflict is found, next will be set to the next address
@@ -862,6 +910,7 @@ struct bt_mesh_cdb_node *bt_mesh_cdb_node_alloc(const uint8_t uuid[16], uint16_t
 			node->num_elem = num_elem;
 			node->net_idx = net_idx;
 			atomic_set(node->flags, 0);
+			node_sorted_add(node);
 			return node;
 		}
 	}
@@ -877,21 +926,24 @@ void bt_mesh_cdb_node_del(struct bt_mesh_cdb_node *node, bool store)
 		update_cdb_node_settings(node, false);
 	}
 
+	node_sorted_del(node);
 	node->addr = BT_MESH_ADDR_UNASSIGNED;
 	memset(node->dev_key, 0, sizeof(node->dev_key));
 }
 
 struct bt_mesh_cdb_node *bt_mesh_cdb_node_get(uint16_t addr)
 {
-	int i;
+	struct bt_mesh_cdb_node *node;
+	uint16_t pos;
 
-	for (i = 0; i < ARRAY_SIZE(bt_mesh_cdb.nodes); i++) {
-		struct bt_mesh_cdb_node *node = &bt_mesh_cdb.nodes[i];
+	pos = node_sorted_upper(addr);
+	if (pos == 0) {
+		return NULL;
+	}
 
-		if (addr >= node->addr &&
-		    addr <= node->addr + node->num_elem - 1) {
-			return node;
-		}
+	node = &bt_mesh_cdb.nodes[node_sorted[pos - 1]];
+	if (addr <= node->addr + node->num_elem - 1) {
+		return node;
 	}
 
 	return NULL;
@@ -16,6 +16,8 @@
 #include <stdbool.h>
 
 #include "os/os_mbuf.h"
+#include "stats/stats.h"
+#include "sysinit/sysinit.h"
 #include "mesh/mesh.h"
 
 #include "crypto.h"
@@ -44,7 +46,6 @@
 #define IV_UPDATE_SEQ_LIMIT CONFIG_BT_MESH_IV_UPDATE_SEQ_LIMIT
 
 #define IVI(pdu)           ((pdu)[0] >> 7)
-#define NID(pdu)           ((pdu)[0] & 0x7f)
 #define CTL(pdu)           ((pdu)[1] >> 7)
 #define TTL(pdu)           ((pdu)[1] & 0x7f)
 #define SEQ(pdu)           (sys_get_be24(&pdu[2]))
@@ -76,12 +77,30 @@ struct iv_val {
 	iv_duration:7;
 } __packed;
 
+STATS_SECT_START(ble_mesh_net_stats)
+	STATS_SECT_ENTRY(rx_decrypt)
+	STATS_SECT_ENTRY(rx_decrypt_fail)
+STATS_SECT_END
+
+STATS_SECT_DECL(ble_mesh_net_stats) ble_mesh_net_stats;
+STATS_NAME_START(ble_mesh_net_stats)
+	STATS_NAME(ble_mesh_net_stats, rx_decrypt)
+	STATS_NAME(ble_mesh_net_stats, rx_decrypt_fail)
+STATS_NAME_END(ble_mesh_net_stats)
+
 static struct {
 	uint32_t src : 15, /* MSb of source is always 0 */
 	      seq : 17;
 } msg_cache[MYNEWT_VAL(BLE_MESH_MSG_CACHE_SIZE)];
 static uint16_t msg_cache_next;
 
+/* Open addressed (linear probing) index into msg_cache, keyed on src and
+ * seq. Each slot holds msg_cache index + 1, zero marks an empty slot. The
+ * table is kept at most half full so that probe sequences stay short.
+ */
+#define MSG_CACHE_HASH_SIZE (2 * MYNEWT_VAL(BLE_MESH_MSG_CACHE_SIZE))
+static uint16_t msg_cache_hash[MSG_CACHE_HASH_SIZE];
+
 /* Singleton network context (the implementation only supports one) */
 struct bt_mesh_net bt_mesh = {
 	.local_queue = STAILQ_HEAD_INITIALIZER(bt_mesh.local_queue),
@@ -125,13 +144,27 @@ static bool check_dup(struct os_mbuf *data)
 	return false;
 }
 
-static bool msg_cache_match(struct os_mbuf *pdu)
+static uint16_t msg_cache_hash_slot(uint16_t src, uint32_t seq)
 {
-	uint16_t i;
+	uint32_t key = src | (seq << 15);
+
+	/* Multiplicative hashing; the high half of the product depends on
+	 * every bit of the key, the low half only on the low bits of it.
+	 */
+	return ((key * 2654435761U) >> 16) % MSG_CACHE_HASH_SIZE;
+}
+
+static bool msg_cache_match(uint16_t src, uint32_t seq)
+{
+	uint16_t slot;
+	uint16_t idx;
+
+	seq &= BIT_MASK(17);
 
-	for (i = 0; i < ARRAY_SIZE(msg_cache); i++) {
-		if (msg_cache[i].src == SRC(pdu->om_data) &&
-		    msg_cache[i].seq == (SEQ(pdu->om_data) & BIT_MASK(17))) {
+	for (slot = msg_cache_hash_slot(src, seq); msg_cache_hash[slot];
+	     slot = (slot + 1) % MSG_CACHE_HASH_SIZE) {
+		idx = msg_cache_hash[slot] - 1;
+		if (msg_cache[idx].src == src && msg_cache[idx].seq == seq) {
 			return true;
 		}
 	}
@@ -139,15 +172,111 @@ static bool msg_cache_match(struct os_mbuf *pdu)
 	return false;
 }
 
+static void msg_cache_hash_del(uint16_t idx)
+{
+	uint16_t slot;
+	uint16_t next;
+	uint16_t home;
+	uint16_t i;
+
+	slot = msg_cache_hash_slot(msg_cache[idx].src, msg_cache[idx].seq);
+	while (msg_cache_hash[slot] != idx + 1) {
+		if (!msg_cache_hash[slot]) {
+			return;
+		}
+
+		slot = (slot + 1) % MSG_CACHE_HASH_SIZE;
+	}
+
+	/* Shift following entries of the probe sequence back so that no
+	 * lookup stops early at the emptied slot.
+	 */
+	msg_cache_hash[slot] = 0U;
+	for (next = (slot + 1) % MSG_CACHE_HASH_SIZE; msg_cache_hash[next];
+	     next = (next + 1) % MSG_CACHE_HASH_SIZE) {
+		i = msg_cache_hash[next] - 1;
+		home = msg_cache_hash_slot(msg_cache[i].src, msg_cache[i].seq);
+
+		/* Entry may move to the gap only if its home slot is not in
+		 * the cyclic range (slot, next].
+		 */
+		if ((next > slot && (home <= slot || home > next)) ||
+		    (next < slot && (home <= slot && home > next))) {
+			msg_cache_hash[slot] = msg_cache_hash[next];
+			msg_cache_hash[next] = 0U;
+			slot = next;
+		}
+	}
+}
+
+static void msg_cache_hash_add(uint16_t idx)
+{
+	uint16_t slot;
+
+	slot = msg_cache_hash_slot(msg_cache[idx].src, msg_cache[idx].seq);
+	while (msg_cache_hash[slot]) {
+		slot = (slot + 1) % MSG_CACHE_HASH_SIZE;
+	}
+
+	msg_cache_hash[slot] = idx + 1;
+}
+
 static void msg_cache_add(struct bt_mesh_net_rx *rx)
 {
-	/* Add to the cache */
+	/* Add to the cache, evicting the oldest entry */
 	rx->msg_cache_idx = msg_cache_next++;
+	if (msg_cache[rx->msg_cache_idx].src != BT_MESH_ADDR_UNASSIGNED) {
+		msg_cache_hash_del(rx->msg_cache_idx);
+	}
+
 	msg_cache[rx->msg_cache_idx].src = rx->ctx.addr;
 	msg_cache[rx->msg_cache_idx].seq = rx->seq;
+	msg_cache_hash_add(rx->msg_cache_idx);
 	msg_cache_next %= ARRAY_SIZE(msg_cache);
 }
 
+static void msg_cache_del(uint16_t idx)
+{
+	msg_cache_hash_del(idx);
+	msg_cache[idx].src = BT_MESH_ADDR_UNASSIGNED;
+	/* Rewind the next index now that we're not using this entry */
+	msg_cache_next = idx;
+}
+
+static void msg_cache_clear(void)
+{
+	(void)memset(msg_cache, 0, sizeof(msg_cache));
+	(void)memset(msg_cache_hash, 0, sizeof(msg_cache_hash));
+	msg_cache_next = 0U;
+}
+
+#if MYNEWT_VAL(SELFTEST)
+bool bt_mesh_net_msg_cache_test_add(uint16_t src, uint32_t seq,
+				    uint16_t *idx)
+{
+	struct bt_mesh_net_rx rx = { .ctx.addr = src, .seq = seq };
+
+	if (msg_cache_match(src, seq)) {
+		return false;
+	}
+
+	msg_cache_add(&rx);
+	*idx = rx.msg_cache_idx;
+
+	return true;
+}
+
+void bt_mesh_net_msg_cache_test_del(uint16_t idx)
+{
+	msg_cache_del(idx);
+}
+
+void bt_mesh_net_msg_cache_test_clear(void)
+{
+	msg_cache_clear();
+}
+#endif
+
 static void store_iv(bool only_duration)
 {
 #if MYNEWT_VAL(BLE_MESH_SETTINGS)
@@ -192,8 +321,7 @@ int bt_mesh_net_create(uint16_t idx, uint8_t flags, const uint8_t key[16],
 		return err;
 	}
 
-	(void)memset(msg_cache, 0, sizeof(msg_cache));
-	msg_cache_next = 0U;
+	msg_cache_clear();
 
 	bt_mesh.iv_index = iv_index;
 	atomic_set_bit_to(bt_mesh.flags, BT_MESH_IVU_IN_PROGRESS,
@@ -599,12 +727,9 @@ static bool net_decrypt(struct bt_mesh_net_rx *rx, struct os_mbuf *in,
 			const struct bt_mesh_net_cred *cred)
 {
 	bool proxy = (rx->net_if == BT_MESH_NET_IF_PROXY_CFG);
+	int err;
 
-	if (NID(in->om_data) != cred->nid) {
-		return false;
-	}
-
-	BT_DBG("NID 0x%02x", NID(in->om_data));
+	/* bt_mesh_net_cred_find() only passes credentials with matching NID */
 	BT_DBG("IVI %u net->iv_index 0x%08x", IVI(in->om_data), bt_mesh.iv_index);
 
 	rx->old_iv = (IVI(in->om_data) != (bt_mesh.iv_index & 0x01));
@@ -627,14 +752,25 @@ static bool net_decrypt(struct bt_mesh_net_rx *rx, struct os_mbuf *in,
 		return false;
 	}
 
-	if (rx->net_if == BT_MESH_NET_IF_ADV && msg_cache_match(out)) {
+	if (rx->net_if == BT_MESH_NET_IF_ADV &&
+	    msg_cache_match(rx->ctx.addr, SEQ(out->om_data))) {
 		BT_DBG("Duplicate found in Network Message Cache");
 		return false;
 	}
 
 	BT_DBG("src 0x%04x", rx->ctx.addr);
-	return bt_mesh_net_decrypt(cred->enc, out, BT_MESH_NET_IVI_RX(rx),
-				   proxy) == 0;
+	STATS_INC(ble_mesh_net_stats, rx_decrypt);
+	err = bt_mesh_net_decrypt(cred->enc, out, BT_MESH_NET_IVI_RX(rx),
+				  proxy);
+	if (err) {
+		/* NID collision with a credential of another subnet or
+		 * friendship, or a corrupted PDU.
+		 */
+		STATS_INC(ble_mesh_net_stats, rx_decrypt_fail);
+		return false;
+	}
+
+	return true;
 }
 
 /* Relaying from advertising to the advertising bearer should only happen
@@ -855,9 +991,7 @@ void bt_mesh_net_recv(struct os_mbuf *data, int8_t rssi,
 	 */
 	if (bt_mesh_trans_recv(buf, &rx) == -EAGAIN) {
 		BT_WARN("Removing rejected message from Network Message Cache");
-		msg_cache[rx.msg_cache_idx].src = BT_MESH_ADDR_UNASSIGNED;
-		/* Rewind the next index now that we're not using this entry */
-		msg_cache_next = rx.msg_cache_idx;
+		msg_cache_del(rx.msg_cache_idx);
 	}
 
 	/* Relay if this was a group/virtual address, or if the destination
@@ -1044,6 +1178,13 @@ void bt_mesh_net_init(void)
 {
 	int rc;
 
+	rc = stats_init_and_reg(
+		STATS_HDR(ble_mesh_net_stats),
+		STATS_SIZE_INIT_PARMS(ble_mesh_net_stats, STATS_SIZE_32),
+		STATS_NAME_INIT_PARMS(ble_mesh_net_stats), "ble_mesh_net");
+	SYSINIT_PANIC_ASSERT_MSG(rc == 0,
+				 "Failed to register ble_mesh_net stats");
+
 #if MYNEWT_VAL(BLE_MESH_SETTINGS)
 	rc = conf_register(&bt_mesh_net_conf_handler);
 
@@ -309,6 +309,16 @@ void bt_mesh_net_pending_seq_store(void);
 void bt_mesh_net_clear(void);
 void bt_mesh_net_settings_commit(void);
 
+#if MYNEWT_VAL(SELFTEST)
+/* Network Message Cache access for unit tests. Adding returns false if the
+ * (src, seq) pair is already cached.
+ */
+bool bt_mesh_net_msg_cache_test_add(uint16_t src, uint32_t seq,
+				    uint16_t *idx);
+void bt_mesh_net_msg_cache_test_del(uint16_t idx);
+void bt_mesh_net_msg_cache_test_clear(void);
+#endif
+
 static inline void send_cb_finalize(const struct bt_mesh_send_cb *cb,
 				    void *cb_data)
 {
@@ -27,11 +27,117 @@ struct rpl_val {
 static struct bt_mesh_rpl replay_list[MYNEWT_VAL(BLE_MESH_CRPL)];
 static ATOMIC_DEFINE(store, MYNEWT_VAL(BLE_MESH_CRPL));
 
+/* Open addressed (linear probing) index into replay_list keyed on source
+ * address. Each slot holds replay_list index + 1, zero marks an empty slot.
+ */
+#define RPL_HASH_SIZE (2 * MYNEWT_VAL(BLE_MESH_CRPL))
+static uint16_t rpl_hash[RPL_HASH_SIZE];
+/* Where to start looking for an empty replay_list entry */
+static uint16_t rpl_free_hint;
+
 static inline int rpl_idx(const struct bt_mesh_rpl *rpl)
 {
 	return rpl - &replay_list[0];
 }
 
+static uint16_t rpl_hash_slot(uint16_t src)
+{
+	return ((uint32_t)src * 2654435761U) % RPL_HASH_SIZE;
+}
+
+static struct bt_mesh_rpl *rpl_lookup(uint16_t src)
+{
+	struct bt_mesh_rpl *rpl;
+	uint16_t slot;
+
+	for (slot = rpl_hash_slot(src); rpl_hash[slot];
+	     slot = (slot + 1) % RPL_HASH_SIZE) {
+		rpl = &replay_list[rpl_hash[slot] - 1];
+		if (rpl->src == src) {
+			return rpl;
+		}
+	}
+
+	return NULL;
+}
+
+static void rpl_hash_add(struct bt_mesh_rpl *rpl)
+{
+	uint16_t slot;
+
+	slot = rpl_hash_slot(rpl->src);
+	while (rpl_hash[slot]) {
+		slot = (slot + 1) % RPL_HASH_SIZE;
+	}
+
+	rpl_hash[slot] = rpl_idx(rpl) + 1;
+}
+
+static void rpl_hash_del(struct bt_mesh_rpl *rpl)
+{
+	uint16_t slot, next, home;
+
+	slot = rpl_hash_slot(rpl->src);
+	while (rpl_hash[slot] != rpl_idx(rpl) + 1) {
+		if (!rpl_hash[slot]) {
+			return;
+		}
+
+		slot = (slot + 1) % RPL_HASH_SIZE;
+	}
+
+	/* Shift following entries of the probe sequence back so that no
+	 * lookup stops early at the emptied slot.
+	 */
+	rpl_hash[slot] = 0U;
+	for (next = (slot + 1) % RPL_HASH_SIZE; rpl_hash[next];
+	     next = (next + 1) % RPL_HASH_SIZE) {
+		home = rpl_hash_slot(replay_list[rpl_hash[next] - 1].src);
+
+		/* Entry may move to the gap only if its home slot is not in
+		 * the cyclic range (slot, next].
+		 */
+		if ((next > slot && (home <= slot || home > next)) ||
+		    (next < slot && (home <= slot && home > next))) {
+			rpl_hash[slot] = rpl_hash[next];
+			rpl_hash[next] = 0U;
+			slot = next;
+		}
+	}
+}
+
+static struct bt_mesh_rpl *rpl_free_slot(void)
+{
+	uint16_t idx;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(replay_list); i++) {
+		idx = (rpl_free_hint + i) % ARRAY_SIZE(replay_list);
+		if (!replay_list[idx].src) {
+			rpl_free_hint = idx;
+			return &replay_list[idx];
+		}
+	}
+
+	return NULL;
+}
+
+static void rpl_assign(struct bt_mesh_rpl *rpl, uint16_t src)
+{
+	rpl->src = src;
+	rpl_hash_add(rpl);
+}
+
+static void rpl_release(struct bt_mesh_rpl *rpl)
+{
+	if (rpl->src) {
+		rpl_hash_del(rpl);
+	}
+
+	(void)memset(rpl, 0, sizeof(*rpl));
+	rpl_free_hint = rpl_idx(rpl);
+}
+
 static void clear_rpl(struct bt_mesh_rpl *rpl)
 {
 #if MYNEWT_VAL(BLE_MESH_SETTINGS)
@@ -50,7 +156,7 @@ static void clear_rpl(struct bt_mesh_rpl *rpl)
 		BT_DBG("Cleared RPL");
 	}
 
-	(void)memset(rpl, 0, sizeof(*rpl));
+	rpl_release(rpl);
 	atomic_clear_bit(store, rpl_idx(rpl));
 #endif
 }
@@ -87,7 +193,17 @@ void bt_mesh_rpl_update(struct bt_mesh_rpl *rpl,
 		rpl->seg = 0;
 	}
 
-	rpl->src = rx->ctx.addr;
+	/* Empty slot handed out by bt_mesh_rpl_check(), or one that got
+	 * assigned to another source in the meantime.
+	 */
+	if (rpl->src != rx->ctx.addr) {
+		if (rpl->src) {
+			rpl_hash_del(rpl);
+		}
+
+		rpl_assign(rpl, rx->ctx.addr);
+	}
+
 	rpl->seq = rx->seq;
 	rpl->old_iv = rx->old_iv;
 
@@ -104,7 +220,7 @@ void bt_mesh_rpl_update(struct bt_mesh_rpl *rpl,
 bool bt_mesh_rpl_check(struct bt_mesh_net_rx *rx,
 		struct bt_mesh_rpl **match)
 {
-	int i;
+	struct bt_mesh_rpl *rpl;
 
 	/* Don't bother checking messages from ourselves */
 	if (rx->net_if == BT_MESH_NET_IF_LOCAL) {
@@ -116,42 +232,40 @@ bool bt_mesh_rpl_check(struct bt_mesh_net_rx *rx,
 		return false;
 	}
 
-	for (i = 0; i < ARRAY_SIZE(replay_list); i++) {
-		struct bt_mesh_rpl *rpl = &replay_list[i];
-
+	rpl = rpl_lookup(rx->ctx.addr);
+	if (!rpl) {
 		/* Empty slot */
-		if (!rpl->src) {
-			if (match) {
-				*match = rpl;
-			} else {
-				bt_mesh_rpl_update(rpl, rx);
-			}
+		rpl = rpl_free_slot();
+		if (!rpl) {
+			BT_ERR("RPL is full!");
+			return true;
+		}
 
-			return false;
+		if (match) {
+			*match = rpl;
+		} else {
+			bt_mesh_rpl_update(rpl, rx);
 		}
 
-		/* Existing slot for given address */
-		if (rpl->src == rx->ctx.addr) {
-			if (rx->old_iv && !rpl->old_iv) {
-				return true;
-			}
+		return false;
+	}
 
-			if ((!rx->old_iv && rpl->old_iv) ||
-			    rpl->seq < rx->seq) {
-				if (match) {
-					*match = rpl;
-				} else {
-					bt_mesh_rpl_update(rpl, rx);
-				}
+	/* Existing slot for given address */
+	if (rx->old_iv && !rpl->old_iv) {
+		return true;
+	}
 
-				return false;
-			} else {
-				return true;
-			}
+	if ((!rx->old_iv && rpl->old_iv) ||
+	    rpl->seq < rx->seq) {
+		if (match) {
+			*match = rpl;
+		} else {
+			bt_mesh_rpl_update(rpl, rx);
 		}
+
+		return false;
 	}
 
-	BT_ERR("RPL is full!");
 	return true;
 }
 
@@ -163,35 +277,22 @@ void bt_mesh_rpl_clear(void)
 		schedule_rpl_clear();
 	} else {
 		(void)memset(replay_list, 0, sizeof(replay_list));
+		(void)memset(rpl_hash, 0, sizeof(rpl_hash));
+		rpl_free_hint = 0U;
 	}
 }
 
 #if MYNEWT_VAL(BLE_MESH_SETTINGS)
-static struct bt_mesh_rpl *bt_mesh_rpl_find(uint16_t src)
-{
-	int i;
-
-	for (i = 0; i < ARRAY_SIZE(replay_list); i++) {
-		if (replay_list[i].src == src) {
-			return &replay_list[i];
-		}
-	}
-
-	return NULL;
-}
-
 static struct bt_mesh_rpl *bt_mesh_rpl_alloc(uint16_t src)
 {
-	int i;
+	struct bt_mesh_rpl *rpl;
 
-	for (i = 0; i < ARRAY_SIZE(replay_list); i++) {
-		if (!replay_list[i].src) {
-			replay_list[i].src = src;
-			return &replay_list[i];
-		}
+	rpl = rpl_free_slot();
+	if (rpl) {
+		rpl_assign(rpl, src);
 	}
 
-	return NULL;
+	return rpl;
 }
 #endif
 
@@ -210,7 +311,7 @@ void bt_mesh_rpl_reset(void)
 				if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
 					clear_rpl(rpl);
 				} else {
-					(void)memset(rpl, 0, sizeof(*rpl));
+					rpl_release(rpl);
 				}
 			} else {
 				rpl->old_iv = true;
@@ -238,11 +339,11 @@ static int rpl_set(int argc, char **argv, char *val)
 	BT_DBG("argv[0] %s val %s", argv[0], val ? val : "(null)");
 
 	src = strtol(argv[0], NULL, 16);
-	entry = bt_mesh_rpl_find(src);
+	entry = rpl_lookup(src);
 
 	if (!val) {
 		if (entry) {
-			memset(entry, 0, sizeof(*entry));
+			rpl_release(entry);
 		} else {
 			BT_WARN("Unable to find RPL entry for 0x%04x", src);
 		}
@@ -325,8 +426,18 @@ static void store_pending_rpl(struct bt_mesh_rpl *rpl)
 	}
 }
 
+static void pending_store_one(struct bt_mesh_rpl *rpl)
+{
+	if (atomic_test_bit(bt_mesh.flags, BT_MESH_VALID)) {
+		store_pending_rpl(rpl);
+	} else {
+		clear_rpl(rpl);
+	}
+}
+
 void bt_mesh_rpl_pending_store(uint16_t addr)
 {
+	struct bt_mesh_rpl *rpl;
 	int i;
 
 	if (!IS_ENABLED(CONFIG_BT_SETTINGS) ||
@@ -335,25 +446,19 @@ void bt_mesh_rpl_pending_store(uint16_t addr)
 		return;
 	}
 
-	if (addr == BT_MESH_ADDR_ALL_NODES) {
-		bt_mesh_settings_store_cancel(BT_MESH_SETTINGS_RPL_PENDING);
-	}
-
-	for (i = 0; i < ARRAY_SIZE(replay_list); i++) {
-		if (addr != BT_MESH_ADDR_ALL_NODES &&
-		addr != replay_list[i].src) {
-			continue;
+	if (addr != BT_MESH_ADDR_ALL_NODES) {
+		rpl = rpl_lookup(addr);
+		if (rpl) {
+			pending_store_one(rpl);
 		}
 
-		if (atomic_test_bit(bt_mesh.flags, BT_MESH_VALID)) {
-			store_pending_rpl(&replay_list[i]);
-		} else {
-			clear_rpl(&replay_list[i]);
-		}
+		return;
+	}
 
-		if (addr != BT_MESH_ADDR_ALL_NODES) {
-			break;
-		}
+	bt_mesh_settings_store_cancel(BT_MESH_SETTINGS_RPL_PENDING);
+
+	for (i = 0; i < ARRAY_SIZE(replay_list); i++) {
+		pending_store_one(&replay_list[i]);
 	}
 }
 
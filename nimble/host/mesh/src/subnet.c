@@ -733,16 +733,18 @@ bool bt_mesh_net_cred_find(struct bt_mesh_net_rx *rx, struct os_mbuf *in,
 				      struct os_mbuf *out,
 				      const struct bt_mesh_net_cred *cred))
 {
+	uint8_t nid = in->om_data[0] & 0x7f;
 	int i, j;
 
-	BT_DBG("");
+	BT_DBG("NID 0x%02x", nid);
 
 #if MYNEWT_VAL(BLE_MESH_LOW_POWER)
 	if (bt_mesh_lpn_waiting_update()) {
 		rx->sub = bt_mesh.lpn.sub;
 
 		for (j = 0; j < ARRAY_SIZE(bt_mesh.lpn.cred); j++) {
-			if (!rx->sub->keys[j].valid) {
+			if (!rx->sub->keys[j].valid ||
+			    bt_mesh.lpn.cred[j].nid != nid) {
 				continue;
 			}
 
@@ -773,7 +775,8 @@ bool bt_mesh_net_cred_find(struct bt_mesh_net_rx *rx, struct os_mbuf *in,
 		rx->sub = frnd->subnet;
 
 		for (j = 0; j < ARRAY_SIZE(frnd->cred); j++) {
-			if (!rx->sub->keys[j].valid) {
+			if (!rx->sub->keys[j].valid ||
+			    frnd->cred[j].nid != nid) {
 				continue;
 			}
 
@@ -794,7 +797,8 @@ bool bt_mesh_net_cred_find(struct bt_mesh_net_rx *rx, struct os_mbuf *in,
 		}
 
 		for (j = 0; j < ARRAY_SIZE(rx->sub->keys); j++) {
-			if (!rx->sub->keys[j].valid) {
+			if (!rx->sub->keys[j].valid ||
+			    rx->sub->keys[j].msg.nid != nid) {
 				continue;
 			}
 
@@ -148,12 +148,16 @@ int bt_mesh_friend_cred_create(struct bt_mesh_net_cred *cred,
 			       const uint8_t key[16]);
 
 /** @brief Iterate through all valid network credentials to decrypt a message.
+ *
+ *  Only credentials whose NID matches the NID of the input PDU are passed to
+ *  the callback.
  *
  *  @param rx Network RX parameters, passed to the callback.
  *  @param in Input message buffer, passed to the callback.
  *  @param out Output message buffer, passed to the callback.
- *  @param cb Callback to call for each known network credential. Iteration
- *            stops when this callback returns @c true.
+ *  @param cb Callback to call for each known network credential with a
+ *            matching NID. Iteration stops when this callback returns
+ *            @c true.
  *
  *  @returns Whether any of the credentials got a @c true return from the
  *           callback.
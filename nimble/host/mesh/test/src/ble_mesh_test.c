@@ -0,0 +1,56 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <string.h>
+#include "sysinit/sysinit.h"
+#include "testutil/testutil.h"
+
+TEST_SUITE_DECL(ble_mesh_access_test_suite);
+TEST_SUITE_DECL(ble_mesh_crypto_test_suite);
+TEST_SUITE_DECL(ble_mesh_net_test_suite);
+TEST_SUITE_DECL(ble_mesh_rpl_test_suite);
+
+void ble_mesh_crypto_bench(void);
+void ble_mesh_net_bench(void);
+void ble_mesh_rpl_bench(void);
+
+TEST_SUITE(ble_mesh_test)
+{
+    ble_mesh_access_test_suite();
+    ble_mesh_crypto_test_suite();
+    ble_mesh_net_test_suite();
+    ble_mesh_rpl_test_suite();
+}
+
+int
+main(int argc, char **argv)
+{
+    sysinit();
+
+    ble_mesh_test();
+
+    /* "bench" also times the crypto, network message cache and RPL paths. */
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        ble_mesh_crypto_bench();
+        ble_mesh_net_bench();
+        ble_mesh_rpl_bench();
+    }
+
+    return tu_any_failed;
+}
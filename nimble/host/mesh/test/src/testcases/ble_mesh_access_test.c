@@ -0,0 +1,505 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <string.h>
+#include "testutil/testutil.h"
+
+#include "mesh/mesh.h"
+#include "mesh/glue.h"
+#include "net.h"
+#include "access.h"
+
+#define BLE_MESH_ACCESS_TEST_ADDR       0x0100
+#define BLE_MESH_ACCESS_TEST_GROUP      0xc000
+#define BLE_MESH_ACCESS_TEST_CID1       0x0059
+#define BLE_MESH_ACCESS_TEST_CID2       0x05f1
+#define BLE_MESH_ACCESS_TEST_MAX_CALLS  8
+
+static struct bt_mesh_model *
+    ble_mesh_access_test_calls[BLE_MESH_ACCESS_TEST_MAX_CALLS];
+static int ble_mesh_access_test_num_calls;
+
+static int
+ble_mesh_access_test_op_cb(struct bt_mesh_model *model,
+                           struct bt_mesh_msg_ctx *ctx, struct os_mbuf *buf)
+{
+    TEST_ASSERT_FATAL(ble_mesh_access_test_num_calls <
+                      BLE_MESH_ACCESS_TEST_MAX_CALLS);
+    ble_mesh_access_test_calls[ble_mesh_access_test_num_calls++] = model;
+
+    /* Consume the payload; the next model must still see all of it. */
+    net_buf_simple_pull_mem(buf, buf->om_len);
+
+    return 0;
+}
+
+#define BLE_MESH_ACCESS_TEST_OP(_opcode, _len) \
+    { (_opcode), (_len), ble_mesh_access_test_op_cb }
+
+#define BLE_MESH_ACCESS_TEST_VND_OP(_b0, _cid) \
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_3(_b0, _cid), 0)
+
+/*
+ * Element 0 has two SIG models sharing opcode 0x8202, and two vendor
+ * models of different companies sharing the first octet of an opcode.
+ * Opcode 0x8201 is handled on elements 0 and 1, 0x8202 on 0 and 2.
+ * A SIG model listing a vendor opcode and a vendor model listing a SIG
+ * opcode never get them; find_op() only looks in the matching list.
+ */
+static const struct bt_mesh_model_op ble_mesh_access_test_ops0[] = {
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_2(0x82, 0x01), 0),
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_2(0x82, 0x02), 0),
+    BT_MESH_MODEL_OP_END,
+};
+
+static const struct bt_mesh_model_op ble_mesh_access_test_ops1[] = {
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_2(0x82, 0x02), 0),
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_1(0x01), BT_MESH_LEN_EXACT(2)),
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_1(0x02), BT_MESH_LEN_MIN(3)),
+    BT_MESH_MODEL_OP_END,
+};
+
+static const struct bt_mesh_model_op ble_mesh_access_test_ops2[] = {
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_2(0x82, 0x01), 0),
+    BT_MESH_MODEL_OP_END,
+};
+
+static const struct bt_mesh_model_op ble_mesh_access_test_ops3[] = {
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_2(0x82, 0x02), 0),
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_2(0x82, 0x03), 0),
+    BLE_MESH_ACCESS_TEST_VND_OP(0x02, BLE_MESH_ACCESS_TEST_CID1),
+    BT_MESH_MODEL_OP_END,
+};
+
+static const struct bt_mesh_model_op ble_mesh_access_test_vnd_ops0[] = {
+    BLE_MESH_ACCESS_TEST_VND_OP(0x01, BLE_MESH_ACCESS_TEST_CID1),
+    BLE_MESH_ACCESS_TEST_VND_OP(0x02, BLE_MESH_ACCESS_TEST_CID1),
+    /* Passes the company check of registration. */
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_1(BLE_MESH_ACCESS_TEST_CID1), 0),
+    BT_MESH_MODEL_OP_END,
+};
+
+static const struct bt_mesh_model_op ble_mesh_access_test_vnd_ops1[] = {
+    BLE_MESH_ACCESS_TEST_VND_OP(0x01, BLE_MESH_ACCESS_TEST_CID2),
+    BT_MESH_MODEL_OP_END,
+};
+
+static const struct bt_mesh_model_op ble_mesh_access_test_vnd_ops2[] = {
+    BLE_MESH_ACCESS_TEST_VND_OP(0x01, BLE_MESH_ACCESS_TEST_CID2),
+    BLE_MESH_ACCESS_TEST_VND_OP(0x03, BLE_MESH_ACCESS_TEST_CID2),
+    BT_MESH_MODEL_OP_END,
+};
+
+/* Vendor opcode of another company than the model's. */
+static const struct bt_mesh_model_op ble_mesh_access_test_vnd_ops_bad[] = {
+    BLE_MESH_ACCESS_TEST_VND_OP(0x01, BLE_MESH_ACCESS_TEST_CID2),
+    BT_MESH_MODEL_OP_END,
+};
+
+#define BLE_MESH_ACCESS_TEST_OPS4(_b1)                                 \
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_2(0x83, (_b1)), 0),       \
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_2(0x83, (_b1) + 1), 0),   \
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_2(0x83, (_b1) + 2), 0),   \
+    BLE_MESH_ACCESS_TEST_OP(BT_MESH_MODEL_OP_2(0x83, (_b1) + 3), 0)
+
+/* More opcodes than the opcode table of the test configuration holds. */
+static const struct bt_mesh_model_op ble_mesh_access_test_ops_many[] = {
+    BLE_MESH_ACCESS_TEST_OPS4(0x00),
+    BLE_MESH_ACCESS_TEST_OPS4(0x04),
+    BLE_MESH_ACCESS_TEST_OPS4(0x08),
+    BLE_MESH_ACCESS_TEST_OPS4(0x0c),
+    BLE_MESH_ACCESS_TEST_OPS4(0x10),
+    BLE_MESH_ACCESS_TEST_OPS4(0x14),
+    BLE_MESH_ACCESS_TEST_OPS4(0x18),
+    BLE_MESH_ACCESS_TEST_OPS4(0x1c),
+    BT_MESH_MODEL_OP_END,
+};
+
+static struct bt_mesh_model ble_mesh_access_test_models0[] = {
+    BT_MESH_MODEL(0x1000, ble_mesh_access_test_ops0, NULL, NULL),
+    BT_MESH_MODEL(0x1001, ble_mesh_access_test_ops1, NULL, NULL),
+};
+
+static struct bt_mesh_model ble_mesh_access_test_vnd_models0[] = {
+    BT_MESH_MODEL_VND(BLE_MESH_ACCESS_TEST_CID1, 0x0001,
+                      ble_mesh_access_test_vnd_ops0, NULL, NULL),
+    BT_MESH_MODEL_VND(BLE_MESH_ACCESS_TEST_CID2, 0x0001,
+                      ble_mesh_access_test_vnd_ops1, NULL, NULL),
+};
+
+static struct bt_mesh_model ble_mesh_access_test_models1[] = {
+    BT_MESH_MODEL(0x1002, ble_mesh_access_test_ops2, NULL, NULL),
+};
+
+static struct bt_mesh_model ble_mesh_access_test_vnd_models1[] = {
+    BT_MESH_MODEL_VND(BLE_MESH_ACCESS_TEST_CID2, 0x0002,
+                      ble_mesh_access_test_vnd_ops2, NULL, NULL),
+};
+
+static struct bt_mesh_model ble_mesh_access_test_models2[] = {
+    BT_MESH_MODEL(0x1003, ble_mesh_access_test_ops3, NULL, NULL),
+};
+
+static struct bt_mesh_model ble_mesh_access_test_models_many[] = {
+    BT_MESH_MODEL(0x1004, ble_mesh_access_test_ops_many, NULL, NULL),
+    BT_MESH_MODEL(0x1005, ble_mesh_access_test_ops0, NULL, NULL),
+};
+
+static struct bt_mesh_model ble_mesh_access_test_vnd_models_bad[] = {
+    BT_MESH_MODEL_VND(BLE_MESH_ACCESS_TEST_CID1, 0x0003,
+                      ble_mesh_access_test_vnd_ops_bad, NULL, NULL),
+};
+
+static struct bt_mesh_elem ble_mesh_access_test_elems[] = {
+    BT_MESH_ELEM(0, ble_mesh_access_test_models0,
+                 ble_mesh_access_test_vnd_models0),
+    BT_MESH_ELEM(0, ble_mesh_access_test_models1,
+                 ble_mesh_access_test_vnd_models1),
+    BT_MESH_ELEM(0, ble_mesh_access_test_models2, BT_MESH_MODEL_NONE),
+};
+
+static struct bt_mesh_elem ble_mesh_access_test_elems_many[] = {
+    BT_MESH_ELEM(0, ble_mesh_access_test_models_many, BT_MESH_MODEL_NONE),
+    BT_MESH_ELEM(0, ble_mesh_access_test_models0,
+                 ble_mesh_access_test_vnd_models0),
+};
+
+static struct bt_mesh_elem ble_mesh_access_test_elems_bad[] = {
+    BT_MESH_ELEM(0, ble_mesh_access_test_models0,
+                 ble_mesh_access_test_vnd_models_bad),
+};
+
+static const struct bt_mesh_comp ble_mesh_access_test_comp = {
+    .cid = BLE_MESH_ACCESS_TEST_CID1,
+    .elem = ble_mesh_access_test_elems,
+    .elem_count = ARRAY_SIZE(ble_mesh_access_test_elems),
+};
+
+static const struct bt_mesh_comp ble_mesh_access_test_comp_many = {
+    .cid = BLE_MESH_ACCESS_TEST_CID1,
+    .elem = ble_mesh_access_test_elems_many,
+    .elem_count = ARRAY_SIZE(ble_mesh_access_test_elems_many),
+};
+
+static const struct bt_mesh_comp ble_mesh_access_test_comp_bad = {
+    .cid = BLE_MESH_ACCESS_TEST_CID1,
+    .elem = ble_mesh_access_test_elems_bad,
+    .elem_count = ARRAY_SIZE(ble_mesh_access_test_elems_bad),
+};
+
+/**
+ * Reference dispatch: the model find_op() picks on each element, followed
+ * by the checks bt_mesh_model_recv() applies to it.
+ */
+static int
+ble_mesh_access_test_ref_recv(const struct bt_mesh_comp *comp,
+                              uint32_t opcode, uint16_t app_idx,
+                              uint16_t dst, uint16_t len,
+                              struct bt_mesh_model **out_models)
+{
+    const struct bt_mesh_model_op *op;
+    struct bt_mesh_model *models;
+    struct bt_mesh_model *mod;
+    struct bt_mesh_elem *elem;
+    bool vnd;
+    int count;
+    int num;
+    int i;
+    int j;
+
+    vnd = BT_MESH_MODEL_OP_LEN(opcode) == 3;
+
+    num = 0;
+    for (i = 0; i < comp->elem_count; i++) {
+        elem = &comp->elem[i];
+        models = vnd ? elem->vnd_models : elem->models;
+        count = vnd ? elem->vnd_model_count : elem->model_count;
+
+        op = NULL;
+        for (j = 0; j < count && op == NULL; j++) {
+            mod = &models[j];
+            if (vnd && CONFIG_BT_MESH_MODEL_VND_MSG_CID_FORCE &&
+                mod->vnd.company != (opcode & 0xffff)) {
+                continue;
+            }
+
+            for (op = mod->op; op->func != NULL; op++) {
+                if (op->opcode == opcode) {
+                    break;
+                }
+            }
+            if (op->func == NULL) {
+                op = NULL;
+            }
+        }
+
+        if (op == NULL || !bt_mesh_model_has_key(mod, app_idx)) {
+            continue;
+        }
+
+        if (BT_MESH_ADDR_IS_UNICAST(dst)) {
+            if (elem->addr != dst) {
+                continue;
+            }
+        } else if (BT_MESH_ADDR_IS_GROUP(dst) ||
+                   BT_MESH_ADDR_IS_VIRTUAL(dst)) {
+            for (j = 0; j < ARRAY_SIZE(mod->groups); j++) {
+                if (mod->groups[j] == dst) {
+                    break;
+                }
+            }
+            if (j == ARRAY_SIZE(mod->groups)) {
+                continue;
+            }
+        } else if (i != 0) {
+            continue;
+        }
+
+        if ((op->len >= 0 && len < op->len) ||
+            (op->len < 0 && len != -op->len)) {
+            continue;
+        }
+
+        out_models[num++] = mod;
+    }
+
+    return num;
+}
+
+static void
+ble_mesh_access_test_util_register(const struct bt_mesh_comp *comp)
+{
+    struct bt_mesh_model *mod;
+    int i;
+    int j;
+
+    TEST_ASSERT_FATAL(bt_mesh_comp_register(comp) == 0);
+    bt_mesh_comp_provision(BLE_MESH_ACCESS_TEST_ADDR);
+
+    /* The second SIG model of each element is bound to AppKey 1, all
+     * other models to AppKey 0. The first SIG and the first vendor model
+     * of each element subscribe to the group.
+     */
+    for (i = 0; i < comp->elem_count; i++) {
+        for (j = 0; j < comp->elem[i].model_count; j++) {
+            mod = &comp->elem[i].models[j];
+            mod->keys[0] = j == 1 ? 1 : 0;
+            mod->groups[0] = j == 0 ? BLE_MESH_ACCESS_TEST_GROUP :
+                                      BT_MESH_ADDR_UNASSIGNED;
+        }
+
+        for (j = 0; j < comp->elem[i].vnd_model_count; j++) {
+            mod = &comp->elem[i].vnd_models[j];
+            mod->keys[0] = 0;
+            mod->groups[0] = j == 0 ? BLE_MESH_ACCESS_TEST_GROUP :
+                                      BT_MESH_ADDR_UNASSIGNED;
+        }
+    }
+}
+
+/** Dispatches the message and compares the handlers called. */
+static void
+ble_mesh_access_test_util_recv(const struct bt_mesh_comp *comp,
+                               uint32_t opcode, uint16_t app_idx,
+                               uint16_t dst, uint16_t len)
+{
+    struct bt_mesh_model *exp[BLE_MESH_ACCESS_TEST_MAX_CALLS];
+    struct bt_mesh_net_rx rx;
+    struct os_mbuf *buf;
+    int num_exp;
+    int i;
+
+    num_exp = ble_mesh_access_test_ref_recv(comp, opcode, app_idx, dst,
+                                            len, exp);
+
+    buf = NET_BUF_SIMPLE(16);
+    TEST_ASSERT_FATAL(buf != NULL);
+    net_buf_simple_init(buf, 0);
+
+    switch (BT_MESH_MODEL_OP_LEN(opcode)) {
+    case 1:
+        net_buf_simple_add_u8(buf, opcode);
+        break;
+    case 2:
+        net_buf_simple_add_be16(buf, opcode);
+        break;
+    default:
+        net_buf_simple_add_u8(buf, opcode >> 16);
+        net_buf_simple_add_le16(buf, opcode);
+        break;
+    }
+    for (i = 0; i < len; i++) {
+        net_buf_simple_add_u8(buf, i);
+    }
+
+    memset(&rx, 0, sizeof rx);
+    rx.ctx.app_idx = app_idx;
+    rx.ctx.addr = 0x0001;
+    rx.ctx.recv_dst = dst;
+
+    ble_mesh_access_test_num_calls = 0;
+    bt_mesh_model_recv(&rx, buf);
+    os_mbuf_free_chain(buf);
+
+    TEST_ASSERT_FATAL(ble_mesh_access_test_num_calls == num_exp);
+    for (i = 0; i < num_exp; i++) {
+        TEST_ASSERT(ble_mesh_access_test_calls[i] == exp[i]);
+    }
+}
+
+/** Sends every opcode of the composition, and a few unknown ones, to
+ *  every destination and AppKey.
+ */
+static void
+ble_mesh_access_test_util_recv_all(const struct bt_mesh_comp *comp)
+{
+    static const uint32_t unknown[] = {
+        BT_MESH_MODEL_OP_1(0x03),
+        BT_MESH_MODEL_OP_2(0x82, 0x00),
+        BT_MESH_MODEL_OP_2(0x82, 0x04),
+        BT_MESH_MODEL_OP_3(0x01, 0x1234),
+        BT_MESH_MODEL_OP_3(0x02, BLE_MESH_ACCESS_TEST_CID2),
+    };
+    const struct bt_mesh_model_op *op;
+    const struct bt_mesh_elem *elem;
+    uint16_t dsts[6];
+    int num_dsts;
+    int i;
+    int j;
+    int k;
+    int d;
+
+    num_dsts = 0;
+    for (i = 0; i < comp->elem_count; i++) {
+        dsts[num_dsts++] = comp->elem[i].addr;
+    }
+    dsts[num_dsts++] = comp->elem[i - 1].addr + 1;
+    dsts[num_dsts++] = BLE_MESH_ACCESS_TEST_GROUP;
+    dsts[num_dsts++] = BT_MESH_ADDR_ALL_NODES;
+
+    for (d = 0; d < num_dsts; d++) {
+        for (i = 0; i < comp->elem_count; i++) {
+            elem = &comp->elem[i];
+
+            for (j = 0; j < elem->model_count + elem->vnd_model_count; j++) {
+                op = j < elem->model_count ?
+                     elem->models[j].op :
+                     elem->vnd_models[j - elem->model_count].op;
+
+                for (; op->func != NULL; op++) {
+                    for (k = 0; k < 2; k++) {
+                        ble_mesh_access_test_util_recv(comp, op->opcode, k,
+                                                       dsts[d], 2);
+                    }
+                    ble_mesh_access_test_util_recv(comp, op->opcode, 0,
+                                                   dsts[d], 3);
+                }
+            }
+        }
+
+        for (i = 0; i < ARRAY_SIZE(unknown); i++) {
+            ble_mesh_access_test_util_recv(comp, unknown[i], 0, dsts[d], 2);
+        }
+    }
+}
+
+TEST_CASE_SELF(ble_mesh_access_test_dispatch)
+{
+    struct bt_mesh_model *mod0;
+    struct bt_mesh_model *mod1;
+
+    ble_mesh_access_test_util_register(&ble_mesh_access_test_comp);
+    ble_mesh_access_test_util_recv_all(&ble_mesh_access_test_comp);
+
+    mod0 = &ble_mesh_access_test_models0[0];
+    mod1 = &ble_mesh_access_test_models0[1];
+
+    /* The first model on an element handling an opcode gets it, even
+     * when it is not bound to the AppKey and a later one is.
+     */
+    ble_mesh_access_test_util_recv(&ble_mesh_access_test_comp,
+                                   BT_MESH_MODEL_OP_2(0x82, 0x02), 0,
+                                   BT_MESH_ADDR_ALL_NODES, 0);
+    TEST_ASSERT(ble_mesh_access_test_num_calls == 1);
+    TEST_ASSERT(ble_mesh_access_test_calls[0] == mod0);
+
+    ble_mesh_access_test_util_recv(&ble_mesh_access_test_comp,
+                                   BT_MESH_MODEL_OP_2(0x82, 0x02), 1,
+                                   BT_MESH_ADDR_ALL_NODES, 0);
+    TEST_ASSERT(ble_mesh_access_test_num_calls == 0);
+
+    ble_mesh_access_test_util_recv(&ble_mesh_access_test_comp,
+                                   BT_MESH_MODEL_OP_1(0x01), 1,
+                                   BT_MESH_ADDR_ALL_NODES, 2);
+    TEST_ASSERT(ble_mesh_access_test_num_calls == 1);
+    TEST_ASSERT(ble_mesh_access_test_calls[0] == mod1);
+
+    /* Vendor opcodes only reach models of the same company. */
+    ble_mesh_access_test_util_recv(&ble_mesh_access_test_comp,
+                                   BT_MESH_MODEL_OP_3(0x01,
+                                                      BLE_MESH_ACCESS_TEST_CID2),
+                                   0, BT_MESH_ADDR_ALL_NODES, 0);
+    TEST_ASSERT(ble_mesh_access_test_num_calls == 1);
+    TEST_ASSERT(ble_mesh_access_test_calls[0] ==
+                &ble_mesh_access_test_vnd_models0[1]);
+
+    /* An opcode handled on several elements reaches all of them. */
+    ble_mesh_access_test_util_recv(&ble_mesh_access_test_comp,
+                                   BT_MESH_MODEL_OP_2(0x82, 0x01), 0,
+                                   BLE_MESH_ACCESS_TEST_GROUP, 0);
+    TEST_ASSERT(ble_mesh_access_test_num_calls == 2);
+    TEST_ASSERT(ble_mesh_access_test_calls[0] == mod0);
+    TEST_ASSERT(ble_mesh_access_test_calls[1] ==
+                &ble_mesh_access_test_models1[0]);
+}
+
+TEST_CASE_SELF(ble_mesh_access_test_dispatch_many)
+{
+    /* The composition does not fit in the opcode table; dispatch falls
+     * back to the linear scan.
+     */
+    ble_mesh_access_test_util_register(&ble_mesh_access_test_comp_many);
+    ble_mesh_access_test_util_recv_all(&ble_mesh_access_test_comp_many);
+
+    /* Registering a composition that fits brings the table back. */
+    ble_mesh_access_test_util_register(&ble_mesh_access_test_comp);
+    ble_mesh_access_test_util_recv_all(&ble_mesh_access_test_comp);
+}
+
+TEST_CASE_SELF(ble_mesh_access_test_vnd_cid)
+{
+    int rc;
+
+    /* Vendor models with opcodes of another company are rejected, so
+     * the table never holds opcodes find_op() would not return.
+     */
+    rc = bt_mesh_comp_register(&ble_mesh_access_test_comp_bad);
+    TEST_ASSERT(rc == (CONFIG_BT_MESH_MODEL_VND_MSG_CID_FORCE ?
+                       -EINVAL : 0));
+
+    ble_mesh_access_test_util_register(&ble_mesh_access_test_comp);
+    ble_mesh_access_test_util_recv_all(&ble_mesh_access_test_comp);
+}
+
+TEST_SUITE(ble_mesh_access_test_suite)
+{
+    ble_mesh_access_test_dispatch();
+    ble_mesh_access_test_dispatch_many();
+    ble_mesh_access_test_vnd_cid();
+}
@@ -0,0 +1,270 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include "testutil/testutil.h"
+
+#include "crypto.h"
+
+/* RFC 3610, Packet Vector #1 */
+static const uint8_t ble_mesh_crypto_test_rfc_key[16] = {
+    0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+    0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+};
+static const uint8_t ble_mesh_crypto_test_rfc_nonce[13] = {
+    0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xa0,
+    0xa1, 0xa2, 0xa3, 0xa4, 0xa5,
+};
+static const uint8_t ble_mesh_crypto_test_rfc_aad[8] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+};
+static const uint8_t ble_mesh_crypto_test_rfc_msg[23] = {
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+    0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e,
+};
+static const uint8_t ble_mesh_crypto_test_rfc_enc[23 + 8] = {
+    0x58, 0x8c, 0x97, 0x9a, 0x61, 0xc6, 0x63, 0xd2,
+    0xf0, 0x66, 0xd0, 0xc2, 0xc0, 0xf9, 0x89, 0x80,
+    0x6d, 0x5f, 0x6b, 0x61, 0xda, 0xc3, 0x84,
+    /* MIC */
+    0x17, 0xe8, 0xd1, 0x2c, 0xfd, 0xf9, 0x26, 0xe0,
+};
+
+/* Application-style PDU: 16-byte label UUID as AAD and a 32-bit MIC */
+static const uint8_t ble_mesh_crypto_test_app_key[16] = {
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+    0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+};
+static const uint8_t ble_mesh_crypto_test_app_nonce[13] = {
+    0x01, 0x00, 0x00, 0x01, 0x12, 0x34, 0x56, 0x78,
+    0x00, 0x00, 0x00, 0x00, 0x01,
+};
+static const uint8_t ble_mesh_crypto_test_app_aad[16] = {
+    0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+};
+static const uint8_t ble_mesh_crypto_test_app_msg[20] = {
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+    0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+    0x40, 0x41, 0x42, 0x43,
+};
+static const uint8_t ble_mesh_crypto_test_app_enc[20 + 4] = {
+    0xea, 0x83, 0x60, 0x6d, 0xe1, 0x67, 0x6c, 0x08,
+    0x16, 0x44, 0xa5, 0x68, 0xc7, 0x14, 0x53, 0x1b,
+    0xc2, 0xf9, 0x7d, 0x75,
+    /* MIC */
+    0xd4, 0x7f, 0x5c, 0x5d,
+};
+
+static const uint8_t ble_mesh_crypto_test_privacy_key[16] = {
+    0x8b, 0x84, 0xee, 0xde, 0xc1, 0x00, 0x06, 0x7d,
+    0x67, 0x09, 0x71, 0xdd, 0x2a, 0xa7, 0x00, 0xcf,
+};
+#define BLE_MESH_CRYPTO_TEST_IV_INDEX   0x12345678
+static const uint8_t ble_mesh_crypto_test_net_pdu[20] = {
+    0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77,
+    0x78, 0x79, 0x7a, 0x7b,
+};
+static const uint8_t ble_mesh_crypto_test_net_obf[20] = {
+    0x68, 0xc5, 0xdd, 0x0d, 0x91, 0x5e, 0x29, 0x6f,
+    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77,
+    0x78, 0x79, 0x7a, 0x7b,
+};
+
+static void
+ble_mesh_crypto_test_util_ccm(const uint8_t *key, const uint8_t *nonce,
+                              const uint8_t *aad, size_t aad_len,
+                              const uint8_t *msg, size_t msg_len,
+                              const uint8_t *enc, size_t mic_len)
+{
+    uint8_t nonce_buf[13];
+    uint8_t buf[64];
+    int rc;
+
+    memcpy(nonce_buf, nonce, sizeof nonce_buf);
+
+    rc = bt_ccm_encrypt(key, nonce_buf, msg, msg_len, aad, aad_len, buf,
+                        mic_len);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(memcmp(buf, enc, msg_len + mic_len) == 0);
+
+    rc = bt_ccm_decrypt(key, nonce_buf, enc, msg_len, aad, aad_len, buf,
+                        mic_len);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(memcmp(buf, msg, msg_len) == 0);
+
+    /* In-place operation, as used for network and access PDUs. */
+    memcpy(buf, msg, msg_len);
+    rc = bt_ccm_encrypt(key, nonce_buf, buf, msg_len, aad, aad_len, buf,
+                        mic_len);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(memcmp(buf, enc, msg_len + mic_len) == 0);
+
+    /* Tampering with the payload or the MIC is detected. */
+    memcpy(buf, enc, msg_len + mic_len);
+    buf[0] ^= 0x01;
+    rc = bt_ccm_decrypt(key, nonce_buf, buf, msg_len, aad, aad_len, buf,
+                        mic_len);
+    TEST_ASSERT(rc == -EBADMSG);
+
+    memcpy(buf, enc, msg_len + mic_len);
+    buf[msg_len + mic_len - 1] ^= 0x80;
+    rc = bt_ccm_decrypt(key, nonce_buf, buf, msg_len, aad, aad_len, buf,
+                        mic_len);
+    TEST_ASSERT(rc == -EBADMSG);
+}
+
+TEST_CASE_SELF(ble_mesh_crypto_test_ccm)
+{
+    ble_mesh_crypto_test_util_ccm(ble_mesh_crypto_test_rfc_key,
+                                  ble_mesh_crypto_test_rfc_nonce,
+                                  ble_mesh_crypto_test_rfc_aad,
+                                  sizeof ble_mesh_crypto_test_rfc_aad,
+                                  ble_mesh_crypto_test_rfc_msg,
+                                  sizeof ble_mesh_crypto_test_rfc_msg,
+                                  ble_mesh_crypto_test_rfc_enc, 8);
+
+    ble_mesh_crypto_test_util_ccm(ble_mesh_crypto_test_app_key,
+                                  ble_mesh_crypto_test_app_nonce,
+                                  ble_mesh_crypto_test_app_aad,
+                                  sizeof ble_mesh_crypto_test_app_aad,
+                                  ble_mesh_crypto_test_app_msg,
+                                  sizeof ble_mesh_crypto_test_app_msg,
+                                  ble_mesh_crypto_test_app_enc, 4);
+}
+
+TEST_CASE_SELF(ble_mesh_crypto_test_obfuscate)
+{
+    uint8_t pdu[sizeof ble_mesh_crypto_test_net_pdu];
+    int rc;
+
+    memcpy(pdu, ble_mesh_crypto_test_net_pdu, sizeof pdu);
+
+    rc = bt_mesh_net_obfuscate(pdu, BLE_MESH_CRYPTO_TEST_IV_INDEX,
+                               ble_mesh_crypto_test_privacy_key);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(memcmp(pdu, ble_mesh_crypto_test_net_obf, sizeof pdu) == 0);
+
+    /* Obfuscation is its own inverse. */
+    rc = bt_mesh_net_obfuscate(pdu, BLE_MESH_CRYPTO_TEST_IV_INDEX,
+                               ble_mesh_crypto_test_privacy_key);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(memcmp(pdu, ble_mesh_crypto_test_net_pdu, sizeof pdu) == 0);
+}
+
+TEST_SUITE(ble_mesh_crypto_test_suite)
+{
+    ble_mesh_crypto_test_ccm();
+    ble_mesh_crypto_test_obfuscate();
+}
+
+/*****************************************************************************
+ * $bench                                                                    *
+ *****************************************************************************/
+
+#define BLE_MESH_CRYPTO_BENCH_ITERS     20000
+#define BLE_MESH_CRYPTO_BENCH_RUNS      5
+
+typedef double ble_mesh_crypto_bench_fn(void);
+
+static double
+ble_mesh_crypto_bench_net(void)
+{
+    uint8_t nonce[13];
+    uint8_t pdu[29];
+    clock_t start;
+    int i;
+
+    memset(nonce, 0, sizeof nonce);
+    memset(pdu, 0x5a, sizeof pdu);
+
+    start = clock();
+    for (i = 0; i < BLE_MESH_CRYPTO_BENCH_ITERS; i++) {
+        /* Network PDU with a 16-byte transport payload, 4-byte NetMIC. */
+        bt_ccm_encrypt(ble_mesh_crypto_test_app_key, nonce, &pdu[7], 18,
+                       NULL, 0, &pdu[7], 4);
+        bt_mesh_net_obfuscate(pdu, BLE_MESH_CRYPTO_TEST_IV_INDEX,
+                              ble_mesh_crypto_test_privacy_key);
+
+        bt_mesh_net_obfuscate(pdu, BLE_MESH_CRYPTO_TEST_IV_INDEX,
+                              ble_mesh_crypto_test_privacy_key);
+        bt_ccm_decrypt(ble_mesh_crypto_test_app_key, nonce, &pdu[7], 18,
+                       NULL, 0, &pdu[7], 4);
+    }
+
+    return (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 /
+           BLE_MESH_CRYPTO_BENCH_ITERS;
+}
+
+static double
+ble_mesh_crypto_bench_app(void)
+{
+    uint8_t nonce[13];
+    uint8_t msg[15];
+    clock_t start;
+    int i;
+
+    memset(nonce, 0, sizeof nonce);
+    memset(msg, 0x5a, sizeof msg);
+
+    start = clock();
+    for (i = 0; i < BLE_MESH_CRYPTO_BENCH_ITERS; i++) {
+        /* Unsegmented access message, 4-byte TransMIC. */
+        bt_ccm_encrypt(ble_mesh_crypto_test_rfc_key, nonce, msg, 11,
+                       NULL, 0, msg, 4);
+        bt_ccm_decrypt(ble_mesh_crypto_test_rfc_key, nonce, msg, 11,
+                       NULL, 0, msg, 4);
+    }
+
+    return (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 /
+           BLE_MESH_CRYPTO_BENCH_ITERS;
+}
+
+/** Best of several runs, to filter out scheduling noise. */
+static double
+ble_mesh_crypto_bench_best(ble_mesh_crypto_bench_fn *fn)
+{
+    double best;
+    double ns;
+    int i;
+
+    best = fn();
+    for (i = 1; i < BLE_MESH_CRYPTO_BENCH_RUNS; i++) {
+        ns = fn();
+        if (ns < best) {
+            best = ns;
+        }
+    }
+
+    return best;
+}
+
+void
+ble_mesh_crypto_bench(void)
+{
+    printf("mesh crypto (ns per encrypt+decrypt)\n");
+    printf("  net pdu + obfuscation: %8.0f\n",
+           ble_mesh_crypto_bench_best(ble_mesh_crypto_bench_net));
+    printf("  access pdu:            %8.0f\n",
+           ble_mesh_crypto_bench_best(ble_mesh_crypto_bench_app));
+}
@@ -0,0 +1,246 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "testutil/testutil.h"
+
+#include "mesh/glue.h"
+#include "net.h"
+
+#define BLE_MESH_NET_TEST_CACHE_SIZE    MYNEWT_VAL(BLE_MESH_MSG_CACHE_SIZE)
+
+/* Reference model of the Network Message Cache: a FIFO ring searched
+ * linearly, as the cache was before it got its hash index.
+ */
+static struct {
+    uint16_t src;
+    uint32_t seq;
+} ble_mesh_net_test_ref[BLE_MESH_NET_TEST_CACHE_SIZE];
+static uint16_t ble_mesh_net_test_ref_next;
+
+static void
+ble_mesh_net_test_util_clear(void)
+{
+    memset(ble_mesh_net_test_ref, 0, sizeof ble_mesh_net_test_ref);
+    ble_mesh_net_test_ref_next = 0;
+
+    bt_mesh_net_msg_cache_test_clear();
+}
+
+static bool
+ble_mesh_net_test_ref_match(uint16_t src, uint32_t seq)
+{
+    int i;
+
+    for (i = 0; i < BLE_MESH_NET_TEST_CACHE_SIZE; i++) {
+        if (ble_mesh_net_test_ref[i].src == src &&
+            ble_mesh_net_test_ref[i].seq == (seq & 0x1ffff)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool
+ble_mesh_net_test_ref_add(uint16_t src, uint32_t seq)
+{
+    if (ble_mesh_net_test_ref_match(src, seq)) {
+        return false;
+    }
+
+    ble_mesh_net_test_ref[ble_mesh_net_test_ref_next].src = src;
+    ble_mesh_net_test_ref[ble_mesh_net_test_ref_next].seq = seq & 0x1ffff;
+    ble_mesh_net_test_ref_next = (ble_mesh_net_test_ref_next + 1) %
+                                 BLE_MESH_NET_TEST_CACHE_SIZE;
+
+    return true;
+}
+
+/** Adds (src, seq) to the cache and the reference; both must agree. */
+static int
+ble_mesh_net_test_util_add(uint16_t src, uint32_t seq, uint16_t *out_idx)
+{
+    uint16_t ref_idx;
+    uint16_t idx;
+    bool added;
+
+    ref_idx = ble_mesh_net_test_ref_next;
+    added = bt_mesh_net_msg_cache_test_add(src, seq, &idx);
+    TEST_ASSERT_FATAL(added == ble_mesh_net_test_ref_add(src, seq));
+
+    if (added) {
+        TEST_ASSERT_FATAL(idx == ref_idx);
+
+        if (out_idx != NULL) {
+            *out_idx = idx;
+        }
+    }
+
+    return added;
+}
+
+static void
+ble_mesh_net_test_util_del(uint16_t idx)
+{
+    bt_mesh_net_msg_cache_test_del(idx);
+
+    ble_mesh_net_test_ref[idx].src = 0;
+    ble_mesh_net_test_ref[idx].seq = 0;
+    ble_mesh_net_test_ref_next = idx;
+}
+
+TEST_CASE_SELF(ble_mesh_net_test_cache_dup)
+{
+    ble_mesh_net_test_util_clear();
+
+    TEST_ASSERT(ble_mesh_net_test_util_add(0x0001, 100, NULL));
+    TEST_ASSERT(!ble_mesh_net_test_util_add(0x0001, 100, NULL));
+
+    /* Same source, other sequence number and vice versa. */
+    TEST_ASSERT(ble_mesh_net_test_util_add(0x0001, 101, NULL));
+    TEST_ASSERT(ble_mesh_net_test_util_add(0x0002, 100, NULL));
+    TEST_ASSERT(!ble_mesh_net_test_util_add(0x0002, 100, NULL));
+
+    /* Only the 17 least significant bits of SEQ are cached. */
+    TEST_ASSERT(!ble_mesh_net_test_util_add(0x0001, 100 + 0x20000, NULL));
+}
+
+TEST_CASE_SELF(ble_mesh_net_test_cache_evict)
+{
+    int i;
+
+    ble_mesh_net_test_util_clear();
+
+    for (i = 0; i < BLE_MESH_NET_TEST_CACHE_SIZE; i++) {
+        TEST_ASSERT(ble_mesh_net_test_util_add(0x0100 + i, 7, NULL));
+    }
+    for (i = 0; i < BLE_MESH_NET_TEST_CACHE_SIZE; i++) {
+        TEST_ASSERT(!ble_mesh_net_test_util_add(0x0100 + i, 7, NULL));
+    }
+
+    /* One more entry evicts the oldest one only. */
+    TEST_ASSERT(ble_mesh_net_test_util_add(0x0200, 7, NULL));
+    for (i = 1; i < BLE_MESH_NET_TEST_CACHE_SIZE; i++) {
+        TEST_ASSERT(!ble_mesh_net_test_util_add(0x0100 + i, 7, NULL));
+    }
+
+    /* The evicted entry is accepted again, evicting the next oldest. */
+    TEST_ASSERT(ble_mesh_net_test_util_add(0x0100, 7, NULL));
+    TEST_ASSERT(ble_mesh_net_test_util_add(0x0101, 7, NULL));
+}
+
+TEST_CASE_SELF(ble_mesh_net_test_cache_reject)
+{
+    uint16_t idx;
+
+    ble_mesh_net_test_util_clear();
+
+    TEST_ASSERT(ble_mesh_net_test_util_add(0x0010, 1, NULL));
+    TEST_ASSERT(ble_mesh_net_test_util_add(0x0011, 1, &idx));
+
+    /* A message rejected by the transport layer is removed and its entry
+     * is reused by the next message.
+     */
+    ble_mesh_net_test_util_del(idx);
+    TEST_ASSERT(ble_mesh_net_test_util_add(0x0012, 1, NULL));
+    TEST_ASSERT(ble_mesh_net_test_util_add(0x0011, 1, NULL));
+    TEST_ASSERT(!ble_mesh_net_test_util_add(0x0010, 1, NULL));
+    TEST_ASSERT(!ble_mesh_net_test_util_add(0x0012, 1, NULL));
+}
+
+TEST_CASE_SELF(ble_mesh_net_test_cache_random)
+{
+    uint32_t seed;
+    uint16_t idx;
+    int i;
+
+    ble_mesh_net_test_util_clear();
+
+    /* Few distinct sources and sequence numbers so that duplicates, hash
+     * collisions and long probe sequences are frequent; every insert,
+     * eviction and removal is checked against the reference model.
+     */
+    seed = 1;
+    for (i = 0; i < 20000; i++) {
+        seed = seed * 1103515245 + 12345;
+
+        if (ble_mesh_net_test_util_add(1 + (seed >> 16) % 6,
+                                       (seed >> 24) % 8, &idx) &&
+            ((seed >> 8) & 0x7) == 0) {
+            ble_mesh_net_test_util_del(idx);
+        }
+    }
+}
+
+TEST_SUITE(ble_mesh_net_test_suite)
+{
+    ble_mesh_net_test_cache_dup();
+    ble_mesh_net_test_cache_evict();
+    ble_mesh_net_test_cache_reject();
+    ble_mesh_net_test_cache_random();
+}
+
+/*****************************************************************************
+ * $bench                                                                    *
+ *****************************************************************************/
+
+#define BLE_MESH_NET_BENCH_PKTS     200000
+#define BLE_MESH_NET_BENCH_SRCS     32
+
+/*
+ * Relay node traffic: BLE_MESH_NET_BENCH_SRCS sources send in round robin
+ * and every packet is heard twice, so half of the lookups hit the cache.
+ * Compares the cache against the linear scan of the reference model.
+ */
+void
+ble_mesh_net_bench(void)
+{
+    uint32_t seq;
+    clock_t start;
+    double hash_ns;
+    double ref_ns;
+    uint16_t idx;
+    int i;
+
+    ble_mesh_net_test_util_clear();
+
+    start = clock();
+    for (i = 0; i < BLE_MESH_NET_BENCH_PKTS; i++) {
+        seq = i / (2 * BLE_MESH_NET_BENCH_SRCS);
+        bt_mesh_net_msg_cache_test_add(1 + (i / 2) % BLE_MESH_NET_BENCH_SRCS,
+                                       seq, &idx);
+    }
+    hash_ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 /
+              BLE_MESH_NET_BENCH_PKTS;
+
+    start = clock();
+    for (i = 0; i < BLE_MESH_NET_BENCH_PKTS; i++) {
+        seq = i / (2 * BLE_MESH_NET_BENCH_SRCS);
+        ble_mesh_net_test_ref_add(1 + (i / 2) % BLE_MESH_NET_BENCH_SRCS, seq);
+    }
+    ref_ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 /
+             BLE_MESH_NET_BENCH_PKTS;
+
+    printf("mesh net msg cache (ns per packet, %d entries)\n",
+           BLE_MESH_NET_TEST_CACHE_SIZE);
+    printf("  hashed %6.1f  linear scan %6.1f\n", hash_ns, ref_ns);
+}
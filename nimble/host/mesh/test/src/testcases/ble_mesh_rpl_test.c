@@ -0,0 +1,370 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "testutil/testutil.h"
+
+#include "mesh/glue.h"
+#include "net.h"
+#include "rpl.h"
+
+#define BLE_MESH_RPL_TEST_CRPL      MYNEWT_VAL(BLE_MESH_CRPL)
+
+#define BLE_MESH_RPL_TEST_NUM_SRCS  (BLE_MESH_RPL_TEST_CRPL + 4)
+
+/* Reference model of the Replay Protection List: an array searched
+ * linearly, as the list was before it got its hash index.
+ */
+static struct {
+    uint16_t src;
+    uint32_t seq;
+    bool old_iv;
+} ble_mesh_rpl_test_ref[BLE_MESH_RPL_TEST_CRPL];
+
+/* Sources sharing the home slot of the first one in the RPL hash index. */
+static uint16_t ble_mesh_rpl_test_srcs[BLE_MESH_RPL_TEST_NUM_SRCS];
+
+static void
+ble_mesh_rpl_test_util_init_srcs(void)
+{
+    uint32_t home;
+    uint16_t src;
+    int i;
+
+    /* Same hash as rpl_hash_slot(). */
+    home = (1U * 2654435761U) % (2 * BLE_MESH_RPL_TEST_CRPL);
+
+    i = 0;
+    for (src = 1; i < BLE_MESH_RPL_TEST_NUM_SRCS; src++) {
+        if (((uint32_t)src * 2654435761U) % (2 * BLE_MESH_RPL_TEST_CRPL) ==
+            home) {
+            ble_mesh_rpl_test_srcs[i++] = src;
+        }
+    }
+}
+
+static void
+ble_mesh_rpl_test_ref_remove(int i)
+{
+    memset(&ble_mesh_rpl_test_ref[i], 0, sizeof ble_mesh_rpl_test_ref[i]);
+}
+
+static bool
+ble_mesh_rpl_test_ref_check(uint16_t src, uint32_t seq, bool old_iv,
+                            bool update)
+{
+    int free_idx;
+    int i;
+
+    free_idx = -1;
+    for (i = 0; i < BLE_MESH_RPL_TEST_CRPL; i++) {
+        if (ble_mesh_rpl_test_ref[i].src == src) {
+            break;
+        }
+        if (ble_mesh_rpl_test_ref[i].src == 0 && free_idx == -1) {
+            free_idx = i;
+        }
+    }
+
+    if (i == BLE_MESH_RPL_TEST_CRPL) {
+        if (free_idx == -1) {
+            return true;
+        }
+
+        if (update) {
+            ble_mesh_rpl_test_ref[free_idx].src = src;
+            ble_mesh_rpl_test_ref[free_idx].seq = seq;
+            ble_mesh_rpl_test_ref[free_idx].old_iv = old_iv;
+        }
+        return false;
+    }
+
+    if (old_iv && !ble_mesh_rpl_test_ref[i].old_iv) {
+        return true;
+    }
+
+    if ((!old_iv && ble_mesh_rpl_test_ref[i].old_iv) ||
+        ble_mesh_rpl_test_ref[i].seq < seq) {
+        if (update) {
+            ble_mesh_rpl_test_ref[i].seq = seq;
+            ble_mesh_rpl_test_ref[i].old_iv = old_iv;
+        }
+        return false;
+    }
+
+    return true;
+}
+
+static void
+ble_mesh_rpl_test_util_clear(void)
+{
+    ble_mesh_rpl_test_util_init_srcs();
+
+    memset(ble_mesh_rpl_test_ref, 0, sizeof ble_mesh_rpl_test_ref);
+    bt_mesh_rpl_clear();
+}
+
+static void
+ble_mesh_rpl_test_util_reset(void)
+{
+    int i;
+
+    for (i = 0; i < BLE_MESH_RPL_TEST_CRPL; i++) {
+        if (ble_mesh_rpl_test_ref[i].old_iv) {
+            ble_mesh_rpl_test_ref_remove(i);
+        } else {
+            ble_mesh_rpl_test_ref[i].old_iv = true;
+        }
+    }
+
+    bt_mesh_rpl_reset();
+}
+
+/**
+ * Runs a message from src through the RPL and the reference; both must
+ * agree. With match set, the slot is updated through bt_mesh_rpl_update()
+ * only if update is set, as done for segmented messages.
+ *
+ * @return                      true if the message is a replay.
+ */
+static bool
+ble_mesh_rpl_test_util_check(uint16_t src, uint32_t seq, bool old_iv,
+                             bool match, bool update)
+{
+    struct bt_mesh_net_rx rx;
+    struct bt_mesh_rpl *rpl;
+    bool replay;
+
+    memset(&rx, 0, sizeof rx);
+    rx.ctx.addr = src;
+    rx.seq = seq;
+    rx.old_iv = old_iv;
+    rx.net_if = BT_MESH_NET_IF_ADV;
+    rx.local_match = 1;
+
+    if (!match) {
+        update = true;
+    }
+
+    rpl = NULL;
+    replay = bt_mesh_rpl_check(&rx, match ? &rpl : NULL);
+    TEST_ASSERT_FATAL(replay ==
+                      ble_mesh_rpl_test_ref_check(src, seq, old_iv, update));
+
+    if (match && !replay) {
+        TEST_ASSERT_FATAL(rpl != NULL);
+        if (update) {
+            bt_mesh_rpl_update(rpl, &rx);
+        }
+    }
+
+    return replay;
+}
+
+static bool
+ble_mesh_rpl_test_util_rx(uint16_t src, uint32_t seq, bool old_iv)
+{
+    return ble_mesh_rpl_test_util_check(src, seq, old_iv, false, true);
+}
+
+TEST_CASE_SELF(ble_mesh_rpl_test_insert_lookup)
+{
+    uint16_t src;
+    int i;
+
+    ble_mesh_rpl_test_util_clear();
+
+    /* All sources share one home slot, so every lookup walks the probe
+     * sequence.
+     */
+    for (i = 0; i < BLE_MESH_RPL_TEST_CRPL; i++) {
+        src = ble_mesh_rpl_test_srcs[i];
+        TEST_ASSERT(!ble_mesh_rpl_test_util_rx(src, 10, false));
+    }
+
+    for (i = 0; i < BLE_MESH_RPL_TEST_CRPL; i++) {
+        src = ble_mesh_rpl_test_srcs[i];
+        TEST_ASSERT(ble_mesh_rpl_test_util_rx(src, 10, false));
+        TEST_ASSERT(ble_mesh_rpl_test_util_rx(src, 9, false));
+        TEST_ASSERT(!ble_mesh_rpl_test_util_rx(src, 11, false));
+    }
+
+    /* List is full. */
+    TEST_ASSERT(ble_mesh_rpl_test_util_rx(0x7000, 1, false));
+
+    /* Slot handed out for a segmented message is only taken once the
+     * message is complete.
+     */
+    ble_mesh_rpl_test_util_clear();
+    TEST_ASSERT(!ble_mesh_rpl_test_util_check(5, 1, false, true, false));
+    TEST_ASSERT(!ble_mesh_rpl_test_util_check(5, 1, false, true, true));
+    TEST_ASSERT(ble_mesh_rpl_test_util_rx(5, 1, false));
+}
+
+TEST_CASE_SELF(ble_mesh_rpl_test_release)
+{
+    uint16_t src;
+    int i;
+
+    ble_mesh_rpl_test_util_clear();
+
+    for (i = 0; i < BLE_MESH_RPL_TEST_CRPL; i++) {
+        src = ble_mesh_rpl_test_srcs[i];
+        TEST_ASSERT(!ble_mesh_rpl_test_util_rx(src, 10, false));
+    }
+
+    /* Every other source is heard on the new IV index; the remaining ones
+     * are released by the next IV update, leaving holes in the middle of
+     * the probe sequence.
+     */
+    ble_mesh_rpl_test_util_reset();
+    for (i = 1; i < BLE_MESH_RPL_TEST_CRPL; i += 2) {
+        src = ble_mesh_rpl_test_srcs[i];
+        TEST_ASSERT(!ble_mesh_rpl_test_util_rx(src, 20, false));
+    }
+    ble_mesh_rpl_test_util_reset();
+
+    /* Survivors are still found past the holes. */
+    for (i = 1; i < BLE_MESH_RPL_TEST_CRPL; i += 2) {
+        src = ble_mesh_rpl_test_srcs[i];
+        TEST_ASSERT(ble_mesh_rpl_test_util_rx(src, 20, true));
+    }
+
+    /* Released sources start over and their slots are reused. */
+    for (i = 0; i < BLE_MESH_RPL_TEST_CRPL; i += 2) {
+        src = ble_mesh_rpl_test_srcs[i];
+        TEST_ASSERT(!ble_mesh_rpl_test_util_rx(src, 1, false));
+    }
+    TEST_ASSERT(ble_mesh_rpl_test_util_rx(0x7000, 1, false));
+}
+
+TEST_CASE_SELF(ble_mesh_rpl_test_clear)
+{
+    uint16_t src;
+    int round;
+    int i;
+
+    /* A stale hash index would fill up after a few rounds. */
+    for (round = 0; round < 4; round++) {
+        ble_mesh_rpl_test_util_clear();
+
+        for (i = 0; i < BLE_MESH_RPL_TEST_CRPL; i++) {
+            src = ble_mesh_rpl_test_srcs[i] + round * 0x100;
+            TEST_ASSERT(!ble_mesh_rpl_test_util_rx(src, 10, false));
+            TEST_ASSERT(ble_mesh_rpl_test_util_rx(src, 10, false));
+        }
+        TEST_ASSERT(ble_mesh_rpl_test_util_rx(0x7000, 1, false));
+    }
+}
+
+TEST_CASE_SELF(ble_mesh_rpl_test_random)
+{
+    uint32_t seed;
+    uint16_t src;
+    uint32_t op;
+    int i;
+
+    ble_mesh_rpl_test_util_clear();
+
+    /* More sources than the list holds, half of them sharing one home
+     * slot; every check, IV update and clear is compared against the
+     * reference model.
+     */
+    seed = 1;
+    for (i = 0; i < 20000; i++) {
+        seed = seed * 1103515245 + 12345;
+        op = (seed >> 16) % 64;
+
+        src = (seed >> 8) % BLE_MESH_RPL_TEST_NUM_SRCS;
+        if (src & 1) {
+            src = ble_mesh_rpl_test_srcs[src];
+        } else {
+            src = 0x1000 + src;
+        }
+
+        if (op == 0) {
+            ble_mesh_rpl_test_util_clear();
+        } else if (op < 4) {
+            ble_mesh_rpl_test_util_reset();
+        } else {
+            ble_mesh_rpl_test_util_check(src, (seed >> 24) % 16,
+                                         (op & 3) == 0, op & 4, op & 8);
+        }
+    }
+}
+
+TEST_SUITE(ble_mesh_rpl_test_suite)
+{
+    ble_mesh_rpl_test_insert_lookup();
+    ble_mesh_rpl_test_release();
+    ble_mesh_rpl_test_clear();
+    ble_mesh_rpl_test_random();
+}
+
+/*****************************************************************************
+ * $bench                                                                    *
+ *****************************************************************************/
+
+#define BLE_MESH_RPL_BENCH_MSGS     200000
+
+/*
+ * Every RPL entry in use, with its sources sending in round robin so that
+ * each message is new and updates its entry. Compares the RPL against the
+ * linear scan of the reference model.
+ */
+void
+ble_mesh_rpl_bench(void)
+{
+    struct bt_mesh_net_rx rx;
+    clock_t start;
+    double hash_ns;
+    double ref_ns;
+    uint16_t src;
+    int i;
+
+    ble_mesh_rpl_test_util_clear();
+
+    memset(&rx, 0, sizeof rx);
+    rx.net_if = BT_MESH_NET_IF_ADV;
+    rx.local_match = 1;
+
+    start = clock();
+    for (i = 0; i < BLE_MESH_RPL_BENCH_MSGS; i++) {
+        rx.ctx.addr = 1 + i % BLE_MESH_RPL_TEST_CRPL;
+        rx.seq = i / BLE_MESH_RPL_TEST_CRPL + 1;
+        bt_mesh_rpl_check(&rx, NULL);
+    }
+    hash_ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 /
+              BLE_MESH_RPL_BENCH_MSGS;
+
+    start = clock();
+    for (i = 0; i < BLE_MESH_RPL_BENCH_MSGS; i++) {
+        src = 1 + i % BLE_MESH_RPL_TEST_CRPL;
+        ble_mesh_rpl_test_ref_check(src, i / BLE_MESH_RPL_TEST_CRPL + 1,
+                                    false, true);
+    }
+    ref_ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 /
+             BLE_MESH_RPL_BENCH_MSGS;
+
+    printf("mesh rpl (ns per message, %d entries)\n",
+           BLE_MESH_RPL_TEST_CRPL);
+    printf("  hashed %6.1f  linear scan %6.1f\n", hash_ns, ref_ns);
+}
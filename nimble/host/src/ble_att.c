@@ -582,13 +582,24 @@ ble_att_preferred_mtu(void)
     return ble_att_preferred_mtu_val;
 }
 
-int
-ble_att_set_preferred_mtu(uint16_t mtu)
+static int
+ble_att_set_preferred_mtu_conn(struct ble_hs_conn *conn, void *arg)
 {
     struct ble_l2cap_chan *chan;
-    struct ble_hs_conn *conn;
-    int i;
 
+    chan = ble_hs_conn_chan_find_by_scid(conn, BLE_L2CAP_CID_ATT);
+    BLE_HS_DBG_ASSERT(chan != NULL);
+
+    if (!(chan->flags & BLE_L2CAP_CHAN_F_TXED_MTU)) {
+        chan->my_mtu = *(uint16_t *)arg;
+    }
+
+    return 0;
+}
+
+int
+ble_att_set_preferred_mtu(uint16_t mtu)
+{
     if (mtu < BLE_ATT_MTU_DFLT) {
         return BLE_HS_EINVAL;
     }
@@ -600,19 +611,7 @@ ble_att_set_preferred_mtu(uint16_t mtu)
 
     /* Set my_mtu for established connections that haven't exchanged. */
     ble_hs_lock();
-
-    i = 0;
-    while ((conn = ble_hs_conn_find_by_idx(i)) != NULL) {
-        chan = ble_hs_conn_chan_find_by_scid(conn, BLE_L2CAP_CID_ATT);
-        BLE_HS_DBG_ASSERT(chan != NULL);
-
-        if (!(chan->flags & BLE_L2CAP_CHAN_F_TXED_MTU)) {
-            chan->my_mtu = mtu;
-        }
-
-        i++;
-    }
-
+    ble_hs_conn_foreach(ble_att_set_preferred_mtu_conn, &mtu);
     ble_hs_unlock();
 
     return 0;
@@ -55,6 +55,27 @@ static uint16_t ble_att_svr_id;
 static void *ble_att_svr_entry_mem;
 static struct os_mempool ble_att_svr_entry_pool;
 
+/**
+ * Handle-indexed view of ble_att_svr_list.  Handles are allocated
+ * sequentially, so entry N of this table holds the registered attribute with
+ * handle N + 1, or NULL if that attribute is currently hidden.
+ */
+static struct ble_att_svr_entry **ble_att_svr_handle_map;
+static uint16_t ble_att_svr_handle_map_len;
+
+/**
+ * Attribute type index.  Visible attributes are grouped into buckets by a
+ * hash of their UUID; within a bucket, entries are sorted by handle.  Bucket
+ * N occupies ble_att_svr_uuid_idx[ble_att_svr_uuid_bucket[N]] up to (but not
+ * including) ble_att_svr_uuid_idx[ble_att_svr_uuid_bucket[N + 1]].  The index
+ * is rebuilt lazily on first use after the attribute list changes.
+ */
+#define BLE_ATT_SVR_UUID_BUCKETS    MYNEWT_VAL(BLE_ATT_SVR_UUID_HASH_SIZE)
+
+static struct ble_att_svr_entry **ble_att_svr_uuid_idx;
+static uint16_t ble_att_svr_uuid_bucket[BLE_ATT_SVR_UUID_BUCKETS + 1];
+static uint8_t ble_att_svr_uuid_idx_valid;
+
 static os_membuf_t ble_att_svr_prep_entry_mem[
     OS_MEMPOOL_SIZE(MYNEWT_VAL(BLE_ATT_SVR_MAX_PREP_ENTRIES),
                     sizeof (struct ble_att_prep_entry))
@@ -81,6 +102,212 @@ ble_att_svr_entry_free(struct ble_att_svr_entry *entry)
     os_memblock_put(&ble_att_svr_entry_pool, entry);
 }
 
+static void
+ble_att_svr_handle_map_set(uint16_t handle_id,
+                           struct ble_att_svr_entry *entry)
+{
+    if (handle_id != 0 && handle_id <= ble_att_svr_handle_map_len) {
+        ble_att_svr_handle_map[handle_id - 1] = entry;
+    }
+}
+
+/**
+ * Finds the first visible attribute with a handle greater than or equal to
+ * the specified one.  The returned entry can be used as the starting point of
+ * a walk through ble_att_svr_list.
+ */
+static struct ble_att_svr_entry *
+ble_att_svr_find_first(uint16_t start_handle)
+{
+    struct ble_att_svr_entry *entry;
+    uint16_t idx;
+
+    if (start_handle == 0) {
+        start_handle = 1;
+    }
+
+    for (idx = start_handle - 1; idx < ble_att_svr_handle_map_len; idx++) {
+        if (ble_att_svr_handle_map[idx] != NULL) {
+            return ble_att_svr_handle_map[idx];
+        }
+    }
+
+    if (ble_att_svr_id <= ble_att_svr_handle_map_len) {
+        /* All registered attributes are covered by the map. */
+        return NULL;
+    }
+
+    STAILQ_FOREACH(entry, &ble_att_svr_list, ha_next) {
+        if (entry->ha_handle_id >= start_handle) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Finds the last visible attribute with a handle less than the specified
+ * one.
+ *
+ * @return                      The handle of the found attribute; 0 if there
+ *                                  is none.
+ */
+static uint16_t
+ble_att_svr_prev_visible(uint32_t handle_id)
+{
+    uint32_t idx;
+
+    if (handle_id == 0) {
+        return 0;
+    }
+
+    idx = handle_id - 1;
+    if (idx > ble_att_svr_handle_map_len) {
+        idx = ble_att_svr_handle_map_len;
+    }
+
+    while (idx > 0) {
+        if (ble_att_svr_handle_map[idx - 1] != NULL) {
+            return idx;
+        }
+        idx--;
+    }
+
+    return 0;
+}
+
+static unsigned int
+ble_att_svr_uuid_hash(const ble_uuid_t *uuid)
+{
+    const uint8_t *u8;
+    uint32_t hash;
+    int i;
+
+    switch (uuid->type) {
+    case BLE_UUID_TYPE_16:
+        hash = BLE_UUID16(uuid)->value;
+        break;
+
+    case BLE_UUID_TYPE_32:
+        hash = BLE_UUID32(uuid)->value;
+        break;
+
+    default:
+        /* FNV-1a over the 128-bit value. */
+        u8 = BLE_UUID128(uuid)->value;
+        hash = 2166136261UL;
+        for (i = 0; i < 16; i++) {
+            hash = (hash ^ u8[i]) * 16777619UL;
+        }
+        break;
+    }
+
+    /* Mix all the bits before reducing.  The assigned GATT UUIDs differ
+     * mostly in their upper bits (0x2800, 0x2900, 0x2a00, ...), so using the
+     * low bits directly would put the most common types in the same bucket.
+     */
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bUL;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35UL;
+    hash ^= hash >> 16;
+
+    return hash % BLE_ATT_SVR_UUID_BUCKETS;
+}
+
+static void
+ble_att_svr_uuid_idx_build(void)
+{
+    struct ble_att_svr_entry *entry;
+    uint16_t fill[BLE_ATT_SVR_UUID_BUCKETS];
+    unsigned int bucket;
+    int i;
+
+    memset(ble_att_svr_uuid_bucket, 0, sizeof ble_att_svr_uuid_bucket);
+
+    /* Count the entries in each bucket. */
+    STAILQ_FOREACH(entry, &ble_att_svr_list, ha_next) {
+        ble_att_svr_uuid_bucket[ble_att_svr_uuid_hash(entry->ha_uuid) + 1]++;
+    }
+
+    /* Convert counts to bucket offsets. */
+    for (i = 0; i < BLE_ATT_SVR_UUID_BUCKETS; i++) {
+        ble_att_svr_uuid_bucket[i + 1] += ble_att_svr_uuid_bucket[i];
+        fill[i] = ble_att_svr_uuid_bucket[i];
+    }
+
+    /* The list is sorted by handle, so each bucket ends up sorted as well. */
+    STAILQ_FOREACH(entry, &ble_att_svr_list, ha_next) {
+        bucket = ble_att_svr_uuid_hash(entry->ha_uuid);
+        ble_att_svr_uuid_idx[fill[bucket]++] = entry;
+    }
+
+    ble_att_svr_uuid_idx_valid = 1;
+}
+
+/**
+ * Finds the first visible attribute of the specified type whose handle is
+ * within the given range.
+ *
+ * @return                      The matching entry; NULL if there is none.
+ */
+static struct ble_att_svr_entry *
+ble_att_svr_find_by_uuid_from(uint16_t start_handle, const ble_uuid_t *uuid,
+                              uint16_t end_handle)
+{
+    struct ble_att_svr_entry *entry;
+    unsigned int bucket;
+    uint16_t lo;
+    uint16_t hi;
+    uint16_t mid;
+
+    if (uuid == NULL || ble_att_svr_uuid_idx == NULL ||
+        ble_att_svr_id > ble_att_svr_handle_map_len) {
+
+        for (entry = ble_att_svr_find_first(start_handle);
+             entry != NULL && entry->ha_handle_id <= end_handle;
+             entry = STAILQ_NEXT(entry, ha_next)) {
+
+            if (uuid == NULL || ble_uuid_cmp(entry->ha_uuid, uuid) == 0) {
+                return entry;
+            }
+        }
+
+        return NULL;
+    }
+
+    if (!ble_att_svr_uuid_idx_valid) {
+        ble_att_svr_uuid_idx_build();
+    }
+
+    bucket = ble_att_svr_uuid_hash(uuid);
+    lo = ble_att_svr_uuid_bucket[bucket];
+    hi = ble_att_svr_uuid_bucket[bucket + 1];
+
+    /* Binary search for the first entry in the bucket within the range. */
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (ble_att_svr_uuid_idx[mid]->ha_handle_id < start_handle) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (; lo < ble_att_svr_uuid_bucket[bucket + 1]; lo++) {
+        entry = ble_att_svr_uuid_idx[lo];
+        if (entry->ha_handle_id > end_handle) {
+            break;
+        }
+        if (ble_uuid_cmp(entry->ha_uuid, uuid) == 0) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
 /**
  * Allocate the next handle id and return it.
  *
@@ -125,6 +352,8 @@ ble_att_svr_register(const ble_uuid_t *uuid, uint8_t flags,
     entry->ha_cb_arg = cb_arg;
 
     STAILQ_INSERT_TAIL(&ble_att_svr_list, entry, ha_next);
+    ble_att_svr_handle_map_set(entry->ha_handle_id, entry);
+    ble_att_svr_uuid_idx_valid = 0;
 
     if (handle_id != NULL) {
         *handle_id = entry->ha_handle_id;
@@ -158,6 +387,10 @@ ble_att_svr_find_by_handle(uint16_t handle_id)
 {
     struct ble_att_svr_entry *entry;
 
+    if (handle_id != 0 && handle_id <= ble_att_svr_handle_map_len) {
+        return ble_att_svr_handle_map[handle_id - 1];
+    }
+
     for (entry = STAILQ_FIRST(&ble_att_svr_list);
          entry != NULL;
          entry = STAILQ_NEXT(entry, ha_next)) {
@@ -189,24 +422,89 @@ struct ble_att_svr_entry *
 ble_att_svr_find_by_uuid(struct ble_att_svr_entry *prev, const ble_uuid_t *uuid,
                          uint16_t end_handle)
 {
-    struct ble_att_svr_entry *entry;
+    uint16_t start_handle;
 
     if (prev == NULL) {
-        entry = STAILQ_FIRST(&ble_att_svr_list);
+        start_handle = 1;
+    } else if (prev->ha_handle_id == UINT16_MAX) {
+        return NULL;
     } else {
-        entry = STAILQ_NEXT(prev, ha_next);
+        start_handle = prev->ha_handle_id + 1;
     }
 
-    for (;
-         entry != NULL && entry->ha_handle_id <= end_handle;
-         entry = STAILQ_NEXT(entry, ha_next)) {
+    return ble_att_svr_find_by_uuid_from(start_handle, uuid, end_handle);
+}
 
-        if (uuid == NULL || ble_uuid_cmp(entry->ha_uuid, uuid) == 0) {
-            return entry;
+/**
+ * Finds the attribute which ends the group started by an attribute of the
+ * specified type.
+ *
+ * @param uuid_group            The type of the attribute starting the group.
+ * @param handle_id             The handle of the attribute starting the group.
+ *
+ * @return                      The entry ending the group; NULL if the group
+ *                                  extends to the end of the attribute list.
+ */
+static struct ble_att_svr_entry *
+ble_att_svr_find_group_end(const ble_uuid_t *uuid_group, uint16_t handle_id)
+{
+    static const ble_uuid16_t end_uuids[] = {
+        BLE_UUID16_INIT(BLE_ATT_UUID_PRIMARY_SERVICE),
+        BLE_UUID16_INIT(BLE_ATT_UUID_SECONDARY_SERVICE),
+        BLE_UUID16_INIT(BLE_ATT_UUID_CHARACTERISTIC),
+    };
+    struct ble_att_svr_entry *entry;
+    struct ble_att_svr_entry *end;
+    uint16_t end_handle;
+    int num_uuids;
+    int i;
+
+    if (handle_id == UINT16_MAX) {
+        return NULL;
+    }
+
+    /* Grouping is defined only for 16-bit UUIDs, so any attribute ends group
+     * for non-16-bit UUIDs.
+     */
+    if (uuid_group->type != BLE_UUID_TYPE_16) {
+        return ble_att_svr_find_first(handle_id + 1);
+    }
+
+    switch (ble_uuid_u16(uuid_group)) {
+    case BLE_ATT_UUID_PRIMARY_SERVICE:
+    case BLE_ATT_UUID_SECONDARY_SERVICE:
+        /* Only Primary or Secondary Service types end service group. */
+        num_uuids = 2;
+        break;
+    case BLE_ATT_UUID_CHARACTERISTIC:
+        /* Any valid grouping type ends characteristic group */
+        num_uuids = 3;
+        break;
+    default:
+        /* Any 16-bit attribute type ends group of non-grouping type */
+        for (entry = ble_att_svr_find_first(handle_id + 1);
+             entry != NULL;
+             entry = STAILQ_NEXT(entry, ha_next)) {
+
+            if (entry->ha_uuid->type == BLE_UUID_TYPE_16) {
+                return entry;
+            }
         }
+        return NULL;
     }
 
-    return NULL;
+    end = NULL;
+    end_handle = UINT16_MAX;
+    for (i = 0; i < num_uuids; i++) {
+        entry = ble_att_svr_find_by_uuid_from(handle_id + 1,
+                                              &end_uuids[i].u, end_handle);
+        if (entry != NULL) {
+            end = entry;
+            end_handle = entry->ha_handle_id;
+        }
+    }
+
+    return end;
 }
 
 static int
@@ -819,7 +1117,10 @@ ble_att_svr_fill_info(uint16_t start_handle, uint16_t end_handle,
     num_entries = 0;
     rc = 0;
 
-    STAILQ_FOREACH(ha, &ble_att_svr_list, ha_next) {
+    for (ha = ble_att_svr_find_first(start_handle);
+         ha != NULL;
+         ha = STAILQ_NEXT(ha, ha_next)) {
+
         if (ha->ha_handle_id > end_handle) {
             rc = 0;
             goto done;
@@ -1016,55 +1317,6 @@ ble_att_svr_fill_type_value_entry(struct os_mbuf *om, uint16_t first,
     return BLE_HS_EAGAIN;
 }
 
-static int
-ble_att_svr_is_valid_find_group_type(const ble_uuid_t *uuid)
-{
-    uint16_t uuid16;
-
-    uuid16 = ble_uuid_u16(uuid);
-
-    return uuid16 == BLE_ATT_UUID_PRIMARY_SERVICE ||
-           uuid16 == BLE_ATT_UUID_SECONDARY_SERVICE ||
-           uuid16 == BLE_ATT_UUID_CHARACTERISTIC;
-}
-
-static int
-ble_att_svr_is_valid_group_end(const ble_uuid_t *uuid_group,
-                               const ble_uuid_t *uuid)
-{
-    uint16_t uuid16;
-
-    /* Grouping is defined only for 16-bit UUIDs, so any attribute ends group
-     * for non-16-bit UUIDs.
-     */
-    if (uuid_group->type != BLE_UUID_TYPE_16) {
-        return 1;
-    }
-
-    /* Grouping is defined only for 16-bit UUIDs, so non-16-bit UUID attribute
-     * cannot end group.
-     */
-    if (uuid->type != BLE_UUID_TYPE_16) {
-        return 0;
-    }
-
-    switch (ble_uuid_u16(uuid_group)) {
-    case BLE_ATT_UUID_PRIMARY_SERVICE:
-    case BLE_ATT_UUID_SECONDARY_SERVICE:
-        uuid16 = ble_uuid_u16(uuid);
-
-        /* Only Primary or Secondary Service types end service group. */
-        return uuid16 == BLE_ATT_UUID_PRIMARY_SERVICE ||
-               uuid16 == BLE_ATT_UUID_SECONDARY_SERVICE;
-    case BLE_ATT_UUID_CHARACTERISTIC:
-        /* Any valid grouping type ends characteristic group */
-        return ble_att_svr_is_valid_find_group_type(uuid);
-    default:
-        /* Any attribute type ends group of non-grouping type */
-        return 1;
-    }
-}
-
 /**
  * Fills the supplied mbuf with the variable length Handles-Information-List
  * field of a Find-By-Type-Value ATT response.
@@ -1089,86 +1341,54 @@ ble_att_svr_fill_type_value(uint16_t conn_handle,
                             uint16_t mtu, uint8_t *out_att_err)
 {
     struct ble_att_svr_entry *ha;
+    struct ble_att_svr_entry *end;
     uint8_t buf[16];
     uint16_t attr_len;
-    uint16_t first;
-    uint16_t prev;
+    uint16_t last;
     int any_entries;
     int rc;
 
-    first = 0;
-    prev = 0;
     rc = 0;
 
-    /* Iterate through the attribute list, keeping track of the current
-     * matching group.  For each attribute entry, determine if data needs to be
-     * written to the response.
+    /* Iterate through the attributes of the requested type.  Each one whose
+     * value matches the request starts a group which lasts until the next
+     * attribute that is a valid end of the group, even if that is past the
+     * end handle.
      */
-    STAILQ_FOREACH(ha, &ble_att_svr_list, ha_next) {
-        if (ha->ha_handle_id < start_handle) {
-            continue;
-        }
+    for (ha = ble_att_svr_find_by_uuid_from(start_handle, &attr_type.u,
+                                            end_handle);
+         ha != NULL;
+         ha = ble_att_svr_find_by_uuid(ha, &attr_type.u, end_handle)) {
 
-        /* Continue to look for end of group in case group is in progress. */
-        if (!first && ha->ha_handle_id > end_handle) {
-            break;
+        rc = ble_att_svr_read_flat(conn_handle, ha, 0, sizeof buf, buf,
+                                   &attr_len, out_att_err);
+        if (rc != 0) {
+            goto done;
         }
 
-        /* With group in progress, check if current attribute ends it. */
-        if (first) {
-            if (!ble_att_svr_is_valid_group_end(&attr_type.u, ha->ha_uuid)) {
-                prev = ha->ha_handle_id;
-                continue;
-            }
-
-            rc = ble_att_svr_fill_type_value_entry(txom, first, prev, mtu,
-                                                   out_att_err);
-            if (rc != BLE_HS_EAGAIN) {
-                goto done;
-            }
-
-            first = 0;
-            prev = 0;
-
-            /* Break in case we were just looking for end of group past the end
-             * handle ID. */
-            if (ha->ha_handle_id > end_handle) {
-                break;
-            }
+        /* value is at the end of req */
+        rc = os_mbuf_cmpf(rxom, sizeof(struct ble_att_find_type_value_req),
+                          buf, attr_len);
+        if (rc != 0) {
+            continue;
         }
 
-        /* Compare the attribute type and value to the request fields to
-         * determine if this attribute matches.
-         */
-        if (ble_uuid_cmp(ha->ha_uuid, &attr_type.u) == 0) {
-            rc = ble_att_svr_read_flat(conn_handle, ha, 0, sizeof buf, buf,
-                                       &attr_len, out_att_err);
-            if (rc != 0) {
-                goto done;
-            }
-            /* value is at the end of req */
-            rc = os_mbuf_cmpf(rxom, sizeof(struct ble_att_find_type_value_req),
-                              buf, attr_len);
-            if (rc == 0) {
-                first = ha->ha_handle_id;
-                prev = ha->ha_handle_id;
-            }
+        end = ble_att_svr_find_group_end(&attr_type.u, ha->ha_handle_id);
+        if (end != NULL) {
+            last = ble_att_svr_prev_visible(end->ha_handle_id);
+        } else {
+            last = ble_att_svr_prev_visible((uint32_t)ble_att_svr_id + 1);
         }
-    }
 
-    /* Process last group in case a group was in progress when the end of the
-     * attribute list was reached.
-     */
-    if (first) {
-        rc = ble_att_svr_fill_type_value_entry(txom, first, prev, mtu,
-                                               out_att_err);
-        if (rc == BLE_HS_EAGAIN) {
-            rc = 0;
+        rc = ble_att_svr_fill_type_value_entry(txom, ha->ha_handle_id, last,
+                                               mtu, out_att_err);
+        if (rc != BLE_HS_EAGAIN) {
+            goto done;
         }
-    } else {
-        rc = 0;
     }
 
+    rc = 0;
+
 done:
     any_entries = OS_MBUF_PKTHDR(txom)->omp_len >
                   BLE_ATT_FIND_TYPE_VALUE_RSP_BASE_SZ;
@@ -1327,49 +1547,48 @@ ble_att_svr_build_read_type_rsp(uint16_t conn_handle, uint16_t cid,
     mtu = ble_att_mtu_by_cid(conn_handle, cid);
 
     /* Find all matching attributes, writing a record for each. */
-    entry = NULL;
+    entry = ble_att_svr_find_by_uuid_from(start_handle, uuid, end_handle);
     while (1) {
-        entry = ble_att_svr_find_by_uuid(entry, uuid, end_handle);
         if (entry == NULL) {
             rc = BLE_HS_ENOENT;
             break;
         }
 
-        if (entry->ha_handle_id >= start_handle) {
-            rc = ble_att_svr_read_flat(conn_handle, entry, 0, sizeof buf, buf,
-                                       &attr_len, att_err);
-            if (rc != 0) {
-                *err_handle = entry->ha_handle_id;
-                goto done;
-            }
-
-            if (attr_len > mtu - 4) {
-                attr_len = mtu - 4;
-            }
+        rc = ble_att_svr_read_flat(conn_handle, entry, 0, sizeof buf, buf,
+                                   &attr_len, att_err);
+        if (rc != 0) {
+            *err_handle = entry->ha_handle_id;
+            goto done;
+        }
 
-            if (prev_attr_len == 0) {
-                prev_attr_len = attr_len;
-            } else if (prev_attr_len != attr_len) {
-                break;
-            }
+        if (attr_len > mtu - 4) {
+            attr_len = mtu - 4;
+        }
 
-            txomlen = OS_MBUF_PKTHDR(txom)->omp_len + 2 + attr_len;
-            if (txomlen > mtu) {
-                break;
-            }
+        if (prev_attr_len == 0) {
+            prev_attr_len = attr_len;
+        } else if (prev_attr_len != attr_len) {
+            break;
+        }
 
-            data = os_mbuf_extend(txom, 2 + attr_len);
-            if (data == NULL) {
-                *att_err = BLE_ATT_ERR_INSUFFICIENT_RES;
-                *err_handle = entry->ha_handle_id;
-                rc = BLE_HS_ENOMEM;
-                goto done;
-            }
+        txomlen = OS_MBUF_PKTHDR(txom)->omp_len + 2 + attr_len;
+        if (txomlen > mtu) {
+            break;
+        }
 
-            data->handle = htole16(entry->ha_handle_id);
-            memcpy(data->value, buf, attr_len);
-            entry_written = 1;
+        data = os_mbuf_extend(txom, 2 + attr_len);
+        if (data == NULL) {
+            *att_err = BLE_ATT_ERR_INSUFFICIENT_RES;
+            *err_handle = entry->ha_handle_id;
+            rc = BLE_HS_ENOMEM;
+            goto done;
         }
+
+        data->handle = htole16(entry->ha_handle_id);
+        memcpy(data->value, buf, attr_len);
+        entry_written = 1;
+
+        entry = ble_att_svr_find_by_uuid(entry, uuid, end_handle);
     }
 
 done:
@@ -1657,11 +1876,15 @@ ble_att_svr_build_read_mult_rsp_var(uint16_t conn_handle, uint16_t cid,
                                     uint8_t *att_err,
                                     uint16_t *err_handle)
 {
+    struct ble_hs_mbuf_iov iov[4];
     struct os_mbuf *txom;
+    uint8_t len_buf[2];
     uint16_t handle;
     uint16_t mtu;
     uint16_t tuple_len;
+    uint16_t iov_len;
     struct os_mbuf *tmp = NULL;
+    int num_iovs;
     int rc;
 
     mtu = ble_att_mtu_by_cid(conn_handle, cid);
@@ -1706,20 +1929,24 @@ ble_att_svr_build_read_mult_rsp_var(uint16_t conn_handle, uint16_t cid,
             *err_handle = handle;
             goto done;
         }
+        /* Append the length and the value in one pass over the response. */
         tuple_len = OS_MBUF_PKTLEN(tmp);
-        rc = os_mbuf_append(txom, &tuple_len, sizeof(tuple_len));
+        put_le16(len_buf, tuple_len);
+        iov[0].data = len_buf;
+        iov[0].len = sizeof len_buf;
+        num_iovs = 1 + ble_hs_mbuf_iov_build(tmp, 0, tuple_len, iov + 1,
+                                             sizeof iov / sizeof iov[0] - 1,
+                                             &iov_len);
+        rc = ble_hs_mbuf_append_iov(txom, iov, num_iovs);
+        if (rc == 0 && iov_len < tuple_len) {
+            rc = os_mbuf_appendfrom(txom, tmp, iov_len,
+                                    tuple_len - iov_len);
+        }
         if (rc != 0) {
             *err_handle = handle;
             goto done;
         }
-        if (tuple_len != 0) {
-            rc = os_mbuf_appendfrom(txom, tmp, 0, tuple_len);
-            if (rc != 0) {
-                *err_handle = handle;
-                goto done;
-            }
-            os_mbuf_adj(tmp, tuple_len);
-        }
+        os_mbuf_adj(tmp, tuple_len);
     }
     rc = 0;
 
@@ -1832,9 +2059,12 @@ ble_att_svr_build_read_group_type_rsp(uint16_t conn_handle, uint16_t cid,
 {
     struct ble_att_read_group_type_rsp *rsp;
     struct ble_att_svr_entry *entry;
+    struct ble_att_svr_entry *end;
     struct os_mbuf *txom;
     uint16_t start_group_handle;
     uint16_t end_group_handle;
+    uint16_t next_handle;
+    uint16_t last_handle;
     uint16_t mtu;
     ble_uuid_any_t service_uuid;
     int rc;
@@ -1865,90 +2095,96 @@ ble_att_svr_build_read_group_type_rsp(uint16_t conn_handle, uint16_t cid,
     }
 
     rsp->bagp_length = 0;
-    STAILQ_FOREACH(entry, &ble_att_svr_list, ha_next) {
-        if (entry->ha_handle_id < start_handle) {
-            continue;
-        }
-        if (entry->ha_handle_id > end_handle) {
-            /* The full input range has been searched. */
-            rc = 0;
+    for (entry = ble_att_svr_find_by_uuid_from(start_handle, group_uuid,
+                                               end_handle);
+         entry != NULL;
+         entry = ble_att_svr_find_by_uuid_from(next_handle, group_uuid,
+                                               end_handle)) {
+
+        /* Found a group start.  Read the group UUID. */
+        rc = ble_att_svr_service_uuid(entry, &service_uuid, att_err);
+        if (rc != 0) {
+            *err_handle = entry->ha_handle_id;
             goto done;
         }
 
-        if (start_group_handle != 0) {
-            /* We have already found the start of a group. */
-            if (!ble_att_svr_is_valid_read_group_type(entry->ha_uuid)) {
-                /* This attribute is part of the current group. */
-                end_group_handle = entry->ha_handle_id;
+        /* Make sure the group UUID lengths are consistent.  If this group has
+         * a different length UUID, then cut the response short.
+         */
+        switch (rsp->bagp_length) {
+        case 0:
+            if (service_uuid.u.type == BLE_UUID_TYPE_16) {
+                rsp->bagp_length = BLE_ATT_READ_GROUP_TYPE_ADATA_SZ_16;
             } else {
-                /* This attribute marks the end of the group.  Write an entry
-                 * representing the group to the response.
-                 */
-                rc = ble_att_svr_read_group_type_entry_write(
-                    txom, mtu, start_group_handle, end_group_handle,
-                    &service_uuid.u);
-                start_group_handle = 0;
-                end_group_handle = 0;
-                if (rc != 0) {
-                    *err_handle = entry->ha_handle_id;
-                    if (rc == BLE_HS_ENOMEM) {
-                        *att_err = BLE_ATT_ERR_INSUFFICIENT_RES;
-                    } else {
-                        BLE_HS_DBG_ASSERT(rc == BLE_HS_EMSGSIZE);
-                    }
-                    goto done;
-                }
+                rsp->bagp_length = BLE_ATT_READ_GROUP_TYPE_ADATA_SZ_128;
             }
+            break;
+
+        case BLE_ATT_READ_GROUP_TYPE_ADATA_SZ_16:
+            if (service_uuid.u.type != BLE_UUID_TYPE_16) {
+                rc = 0;
+                goto done;
+            }
+            break;
+
+        case BLE_ATT_READ_GROUP_TYPE_ADATA_SZ_128:
+            if (service_uuid.u.type == BLE_UUID_TYPE_16) {
+                rc = 0;
+                goto done;
+            }
+            break;
+
+        default:
+            BLE_HS_DBG_ASSERT(0);
+            goto done;
         }
 
-        if (start_group_handle == 0) {
-            /* We are looking for the start of a group. */
-            if (ble_uuid_cmp(entry->ha_uuid, group_uuid) == 0) {
-                /* Found a group start.  Read the group UUID. */
-                rc = ble_att_svr_service_uuid(entry, &service_uuid, att_err);
-                if (rc != 0) {
-                    *err_handle = entry->ha_handle_id;
-                    goto done;
-                }
+        start_group_handle = entry->ha_handle_id;
 
-                /* Make sure the group UUID lengths are consistent.  If this
-                 * group has a different length UUID, then cut the response
-                 * short.
+        end = ble_att_svr_find_group_end(group_uuid, start_group_handle);
+        if (end == NULL || end->ha_handle_id > end_handle) {
+            /* The group extends past the input range.  Its entry gets added
+             * to the response below.
+             */
+            last_handle =
+                ble_att_svr_prev_visible((uint32_t)ble_att_svr_id + 1);
+            if (end == NULL && last_handle <= end_handle) {
+                /* We have reached the end of the attribute list.  Indicate an
+                 * end handle of 0xffff so that the client knows there are no
+                 * more attributes without needing to send a follow-up request.
                  */
-                switch (rsp->bagp_length) {
-                case 0:
-                    if (service_uuid.u.type == BLE_UUID_TYPE_16) {
-                        rsp->bagp_length = BLE_ATT_READ_GROUP_TYPE_ADATA_SZ_16;
-                    } else {
-                        rsp->bagp_length = BLE_ATT_READ_GROUP_TYPE_ADATA_SZ_128;
-                    }
-                    break;
-
-                case BLE_ATT_READ_GROUP_TYPE_ADATA_SZ_16:
-                    if (service_uuid.u.type != BLE_UUID_TYPE_16) {
-                        rc = 0;
-                        goto done;
-                    }
-                    break;
-
-                case BLE_ATT_READ_GROUP_TYPE_ADATA_SZ_128:
-                    if (service_uuid.u.type == BLE_UUID_TYPE_16) {
-                        rc = 0;
-                        goto done;
-                    }
-                    break;
-
-                default:
-                    BLE_HS_DBG_ASSERT(0);
-                    goto done;
-                }
+                end_group_handle = 0xffff;
+            } else {
+                end_group_handle =
+                    ble_att_svr_prev_visible((uint32_t)end_handle + 1);
+            }
+
+            rc = 0;
+            goto done;
+        }
 
-                start_group_handle = entry->ha_handle_id;
-                end_group_handle = entry->ha_handle_id;
+        /* The next service declaration marks the end of the group.  Write an
+         * entry representing the group to the response.
+         */
+        end_group_handle = ble_att_svr_prev_visible(end->ha_handle_id);
+        rc = ble_att_svr_read_group_type_entry_write(
+            txom, mtu, start_group_handle, end_group_handle,
+            &service_uuid.u);
+        start_group_handle = 0;
+        end_group_handle = 0;
+        if (rc != 0) {
+            *err_handle = end->ha_handle_id;
+            if (rc == BLE_HS_ENOMEM) {
+                *att_err = BLE_ATT_ERR_INSUFFICIENT_RES;
+            } else {
+                BLE_HS_DBG_ASSERT(rc == BLE_HS_EMSGSIZE);
             }
+            goto done;
         }
-    }
 
+        /* The attribute ending this group may start the next one. */
+        next_handle = end->ha_handle_id;
+    }
     rc = 0;
 
 done:
@@ -1957,15 +2193,6 @@ done:
             /* A group was being processed.  Add its corresponding entry to the
              * response.
              */
-
-            if (entry == NULL) {
-                /* We have reached the end of the attribute list.  Indicate an
-                 * end handle of 0xffff so that the client knows there are no
-                 * more attributes without needing to send a follow-up request.
-                 */
-                end_group_handle = 0xffff;
-            }
-
             rc = ble_att_svr_read_group_type_entry_write(txom, mtu,
                                                          start_group_handle,
                                                          end_group_handle,
@@ -2800,6 +3027,8 @@ ble_att_svr_move_entries(struct ble_att_svr_entry_list *src,
     struct ble_att_svr_entry *remove;
     struct ble_att_svr_entry *insert;
 
+    ble_att_svr_uuid_idx_valid = 0;
+
     /* Find first matching element to move */
     remove = NULL;
     entry = STAILQ_FIRST(src);
@@ -2831,6 +3060,10 @@ ble_att_svr_move_entries(struct ble_att_svr_entry_list *src,
             STAILQ_REMOVE_AFTER(src, remove, ha_next);
         }
 
+        /* Only entries in the active list are reachable through the map. */
+        ble_att_svr_handle_map_set(entry->ha_handle_id,
+                                   dst == &ble_att_svr_list ? entry : NULL);
+
         /* Insert current element */
         if (insert == NULL) {
             STAILQ_INSERT_HEAD(dst, entry, ha_next);
@@ -2878,8 +3111,14 @@ ble_att_svr_reset(void)
         ble_att_svr_entry_free(entry);
     }
 
+    if (ble_att_svr_handle_map != NULL) {
+        memset(ble_att_svr_handle_map, 0,
+               ble_att_svr_handle_map_len * sizeof *ble_att_svr_handle_map);
+    }
+
+    ble_att_svr_uuid_idx_valid = 0;
     ble_att_svr_id = 0;
-    
+
     /* Note: prep entries do not get freed here because it is assumed there are
      * no established connections.
      */
@@ -2890,6 +3129,14 @@ ble_att_svr_free_start_mem(void)
 {
     free(ble_att_svr_entry_mem);
     ble_att_svr_entry_mem = NULL;
+
+    free(ble_att_svr_handle_map);
+    ble_att_svr_handle_map = NULL;
+    ble_att_svr_handle_map_len = 0;
+
+    free(ble_att_svr_uuid_idx);
+    ble_att_svr_uuid_idx = NULL;
+    ble_att_svr_uuid_idx_valid = 0;
 }
 
 int
@@ -2915,6 +3162,21 @@ ble_att_svr_start(void)
             rc = BLE_HS_EOS;
             goto err;
         }
+
+        ble_att_svr_handle_map = calloc(ble_hs_max_attrs,
+                                        sizeof *ble_att_svr_handle_map);
+        if (ble_att_svr_handle_map == NULL) {
+            rc = BLE_HS_ENOMEM;
+            goto err;
+        }
+        ble_att_svr_handle_map_len = ble_hs_max_attrs;
+
+        ble_att_svr_uuid_idx = malloc(ble_hs_max_attrs *
+                                      sizeof *ble_att_svr_uuid_idx);
+        if (ble_att_svr_uuid_idx == NULL) {
+            rc = BLE_HS_ENOMEM;
+            goto err;
+        }
     }
 
     return 0;
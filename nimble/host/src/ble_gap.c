@@ -152,6 +152,11 @@ struct ble_gap_master_state {
 };
 static bssnz_t struct ble_gap_master_state ble_gap_master;
 
+#if NIMBLE_BLE_SCAN && !MYNEWT_VAL(BLE_EXT_ADV)
+/* Deliver advertising reports in BLE_GAP_EVENT_DISC_BATCH events */
+static uint8_t ble_gap_disc_batch;
+#endif
+
 #if MYNEWT_VAL(BLE_PERIODIC_ADV)
 /**
  * The state of the in-progress sync creation. If no sync creation connection is
@@ -983,6 +988,7 @@ ble_gap_master_connect_cancelled(void)
 #endif
 
 #if NIMBLE_BLE_SCAN
+#if MYNEWT_VAL(BLE_EXT_ADV)
 static void
 ble_gap_disc_report(void *desc)
 {
@@ -1001,7 +1007,6 @@ ble_gap_disc_report(void *desc)
     ble_gap_event_listener_call(&event);
 }
 
-#if MYNEWT_VAL(BLE_EXT_ADV)
 static void
 ble_gap_ext_disc_report(void *desc)
 {
@@ -1578,13 +1583,75 @@ ble_gap_rx_adv_report_sanity_check(const uint8_t *adv_data, uint8_t adv_data_len
 
 void
 ble_gap_rx_adv_report(struct ble_gap_disc_desc *desc)
+{
+    ble_gap_rx_adv_reports(desc, 1);
+}
+
+void
+ble_gap_rx_adv_reports(struct ble_gap_disc_desc *descs, int num_descs)
 {
 #if NIMBLE_BLE_SCAN
-    if (ble_gap_rx_adv_report_sanity_check(desc->data, desc->length_data)) {
+    struct ble_gap_master_state state;
+    struct ble_gap_event event;
+    int num;
+    int i;
+
+    /* Drop reports the discovery procedure is not interested in; the array is
+     * compacted in place.
+     */
+    num = 0;
+    for (i = 0; i < num_descs; i++) {
+        if (ble_gap_rx_adv_report_sanity_check(descs[i].data,
+                                               descs[i].length_data)) {
+            continue;
+        }
+
+        if (num != i) {
+            descs[num] = descs[i];
+        }
+        num++;
+    }
+
+    if (num == 0) {
         return;
     }
 
-    ble_gap_disc_report(desc);
+    /* Master state is extracted once for all reports in the batch. */
+    ble_gap_master_extract_state(&state, 0);
+
+    memset(&event, 0, sizeof event);
+
+#if !MYNEWT_VAL(BLE_EXT_ADV)
+    if (ble_gap_disc_batch) {
+        event.type = BLE_GAP_EVENT_DISC_BATCH;
+        event.disc_batch.descs = descs;
+        event.disc_batch.num_descs = num;
+
+        if (ble_gap_has_client(&state)) {
+            state.cb(&event, state.cb_arg);
+        }
+
+        ble_gap_event_listener_call(&event);
+        return;
+    }
+#endif
+
+    event.type = BLE_GAP_EVENT_DISC;
+
+    for (i = 0; i < num; i++) {
+        /* Application may have stopped discovery from the callback */
+        if (i > 0 && ble_gap_master.op != BLE_GAP_OP_M_DISC) {
+            break;
+        }
+
+        event.disc = descs[i];
+
+        if (ble_gap_has_client(&state)) {
+            state.cb(&event, state.cb_arg);
+        }
+
+        ble_gap_event_listener_call(&event);
+    }
 #endif
 }
 
@@ -5340,6 +5407,17 @@ done:
 #endif
 }
 
+int
+ble_gap_disc_set_batch(int enable)
+{
+#if NIMBLE_BLE_SCAN && !MYNEWT_VAL(BLE_EXT_ADV)
+    ble_gap_disc_batch = !!enable;
+    return 0;
+#else
+    return BLE_HS_ENOTSUP;
+#endif
+}
+
 int
 ble_gap_disc_active(void)
 {
@@ -7086,6 +7164,10 @@ ble_gap_init(void)
     memset(&ble_gap_master, 0, sizeof(ble_gap_master));
     memset(ble_gap_slave, 0, sizeof(ble_gap_slave));
 
+#if NIMBLE_BLE_SCAN && !MYNEWT_VAL(BLE_EXT_ADV)
+    ble_gap_disc_batch = 0;
+#endif
+
 #if MYNEWT_VAL(BLE_PERIODIC_ADV)
     memset(&ble_gap_sync, 0, sizeof(ble_gap_sync));
 #endif
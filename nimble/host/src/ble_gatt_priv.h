@@ -97,6 +97,12 @@ extern STATS_SECT_DECL(ble_gatts_stats) ble_gatts_stats;
 
 typedef uint8_t ble_gatts_conn_flags;
 
+struct ble_gatts_clt_cfg {
+    uint16_t chr_val_handle;
+    uint8_t flags;
+    uint8_t allowed;
+};
+
 struct ble_gatts_conn {
     struct ble_gatts_clt_cfg *clt_cfgs;
     int num_clt_cfgs;
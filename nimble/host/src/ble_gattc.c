@@ -4420,6 +4420,57 @@ ble_gatts_notify(uint16_t conn_handle, uint16_t chr_val_handle)
     return rc;
 }
 
+/**
+ * Transmits a run of handle-value pairs that fit into a single PDU.  A single
+ * pair is sent as a regular notification.  The values are consumed.
+ */
+static int
+ble_gatts_notify_multiple_tx(uint16_t conn_handle,
+                             struct ble_gatt_notif *tuples, size_t count)
+{
+    struct os_mbuf *txom;
+    uint8_t hdr[4];
+    size_t i;
+    int rc;
+
+    if (count == 1) {
+        rc = ble_att_clt_tx_notify(conn_handle, tuples[0].handle,
+                                   tuples[0].value);
+        tuples[0].value = NULL;
+        goto done;
+    }
+
+    txom = ble_hs_mbuf_att_pkt();
+    if (txom == NULL) {
+        rc = BLE_HS_ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < count; i++) {
+        put_le16(hdr, tuples[i].handle);
+        put_le16(hdr + 2, OS_MBUF_PKTLEN(tuples[i].value));
+
+        rc = os_mbuf_append(txom, hdr, sizeof(hdr));
+        if (rc != 0) {
+            os_mbuf_free_chain(txom);
+            rc = BLE_HS_ENOMEM;
+            goto done;
+        }
+
+        os_mbuf_concat(txom, tuples[i].value);
+        tuples[i].value = NULL;
+    }
+
+    rc = ble_att_clt_tx_notify_mult(conn_handle, txom);
+
+done:
+    for (i = 0; i < count; i++) {
+        ble_gap_notify_tx_event(rc, conn_handle, tuples[i].handle, 0);
+    }
+
+    return rc;
+}
+
 int
 ble_gatts_notify_multiple_custom(uint16_t conn_handle,
                                  size_t chr_count,
@@ -4429,27 +4480,29 @@ ble_gatts_notify_multiple_custom(uint16_t conn_handle,
     return BLE_HS_ENOTSUP;
 #endif
 
-    int rc;
-    int i = 0;
-    uint16_t cur_chr_cnt = 0;
-    /* mtu = MTU - 1 octet (OP code) */
-    uint16_t mtu = ble_att_mtu(conn_handle) - 1;
-    struct os_mbuf *txom;
     struct ble_hs_conn *conn;
+    uint16_t pdu_len;
+    uint16_t mtu;
+    size_t start;
+    size_t i;
+    int mult_sup = 0;
+    int rc;
 
-    txom = ble_hs_mbuf_att_pkt();
-    if (txom == NULL) {
-        return BLE_HS_ENOMEM;
+    ble_hs_lock();
+    conn = ble_hs_conn_find(conn_handle);
+    if (conn != NULL) {
+        mult_sup = conn->bhc_gatt_svr.peer_cl_sup_feat[0] & 0x04;
     }
+    ble_hs_unlock();
 
-    conn = ble_hs_conn_find(conn_handle);
     if (conn == NULL) {
-        return BLE_HS_ENOTCONN;
+        rc = BLE_HS_ENOTCONN;
+        goto done;
     }
 
     /* Read missing values */
     for (i = 0; i < chr_count; i++) {
-        if (tuples->handle == 0) {
+        if (tuples[i].handle == 0) {
             rc = BLE_HS_EINVAL;
             goto done;
         }
@@ -4463,52 +4516,51 @@ ble_gatts_notify_multiple_custom(uint16_t conn_handle,
 
     /* If peer does not support fall back to multiple single value
      * Notifications */
-    if ((conn->bhc_gatt_svr.peer_cl_sup_feat[0] & 0x04) == 0) {
+    if (!mult_sup) {
         for (i = 0; i < chr_count; i++) {
-            rc = ble_att_clt_tx_notify(conn_handle, tuples[chr_count].handle,
-                               tuples[chr_count].value);
+            rc = ble_gatts_notify_multiple_tx(conn_handle, tuples + i, 1);
             if (rc != 0) {
                 goto done;
             }
         }
+        goto done;
     }
 
+    /* mtu = MTU - 1 octet (OP code) */
+    mtu = ble_att_mtu(conn_handle) - 1;
+
+    /* Pack as many consecutive pairs as fit into each PDU; each pair takes
+     * 4 octets of handle and length on top of the value.
+     */
+    start = 0;
+    pdu_len = 0;
     for (i = 0; i < chr_count; i++) {
-        if (txom->om_len + tuples[i].value->om_len > mtu && cur_chr_cnt < 2) {
-            rc = ble_att_clt_tx_notify(conn_handle, tuples[i].handle,
-                                       tuples[i].value);
-            if (rc != 0) {
-                goto done;
-            }
-            continue;
-        } else if (txom->om_len + tuples[i].value->om_len > mtu) {
-            rc = ble_att_clt_tx_notify_mult(conn_handle, txom);
+        if (i > start &&
+            pdu_len + 4 + OS_MBUF_PKTLEN(tuples[i].value) > mtu) {
+            rc = ble_gatts_notify_multiple_tx(conn_handle, tuples + start,
+                                              i - start);
             if (rc != 0) {
                 goto done;
             }
-            cur_chr_cnt = 0;
-            /* buffer was consumed, allocate new one */
-            txom = ble_hs_mbuf_att_pkt();
-            if (txom == NULL) {
-                return BLE_HS_ENOMEM;
-            }
+            start = i;
+            pdu_len = 0;
         }
-
-        os_mbuf_append(txom, &tuples[i].handle, sizeof(uint16_t));
-        os_mbuf_append(txom, &tuples[i].value->om_len,
-                       sizeof(uint16_t));
-        os_mbuf_concat(txom, tuples[i].value);
-        cur_chr_cnt++;
+        pdu_len += 4 + OS_MBUF_PKTLEN(tuples[i].value);
     }
 
-    if (cur_chr_cnt == 1) {
-        rc = ble_att_clt_tx_notify(conn_handle, tuples[chr_count].handle,
-                                   tuples[chr_count].value);
-    } else {
-        rc = ble_att_clt_tx_notify_mult(conn_handle, txom);
+    rc = 0;
+    if (start < chr_count) {
+        rc = ble_gatts_notify_multiple_tx(conn_handle, tuples + start,
+                                          chr_count - start);
     }
 
 done:
+    /* Free values that were not sent. */
+    for (i = 0; i < chr_count; i++) {
+        os_mbuf_free_chain(tuples[i].value);
+        tuples[i].value = NULL;
+    }
+
     return rc;
 }
 
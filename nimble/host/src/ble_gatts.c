@@ -55,16 +55,38 @@ static uint16_t ble_gatts_num_svc_entries;
 static os_membuf_t *ble_gatts_clt_cfg_mem;
 static struct os_mempool ble_gatts_clt_cfg_pool;
 
-struct ble_gatts_clt_cfg {
-    uint16_t chr_val_handle;
-    uint8_t flags;
-    uint8_t allowed;
-};
-
 /** A cached array of handles for the configurable characteristics. */
 static struct ble_gatts_clt_cfg *ble_gatts_clt_cfgs;
 static int ble_gatts_num_cfgable_chrs;
 
+/** Number of configurable characteristics handled per notification pass. */
+#define BLE_GATTS_TX_CHUNK_SZ   8
+
+/** Updates pending for a single peer within a notification pass. */
+struct ble_gatts_tx_peer {
+    uint16_t conn_handle;
+    uint16_t indicate_handle;
+    uint8_t notify_mask;
+    uint8_t mult_sup;
+};
+
+struct ble_gatts_tx_ctxt {
+    struct ble_gatts_tx_peer peers[MYNEWT_VAL(BLE_MAX_CONNECTIONS)];
+    int num_peers;
+    int first_cfg;
+    int num_cfgs;
+    uint8_t notify_mask;
+};
+
+/**
+ * Notification pass state.  Kept off the stack because it scales with
+ * BLE_MAX_CONNECTIONS; only ever used by one pass at a time, see
+ * ble_gatts_tx_notifications().
+ */
+static struct ble_gatts_tx_ctxt ble_gatts_tx_ctxt;
+static uint8_t ble_gatts_tx_busy;
+static uint8_t ble_gatts_tx_again;
+
 STATS_SECT_DECL(ble_gatts_stats) ble_gatts_stats;
 STATS_NAME_START(ble_gatts_stats)
     STATS_NAME(ble_gatts_stats, svcs)
@@ -1482,18 +1504,35 @@ ble_gatts_rx_indicate_ack(uint16_t conn_handle, uint16_t chr_val_handle)
     return 0;
 }
 
+static int
+ble_gatts_chr_updated_mark(struct ble_hs_conn *conn, void *arg)
+{
+    struct ble_gatts_clt_cfg *clt_cfg;
+    int clt_cfg_idx;
+
+    clt_cfg_idx = *(int *)arg;
+
+    BLE_HS_DBG_ASSERT_EVAL(conn->bhc_gatt_svr.num_clt_cfgs > clt_cfg_idx);
+    clt_cfg = conn->bhc_gatt_svr.clt_cfgs + clt_cfg_idx;
+    BLE_HS_DBG_ASSERT_EVAL(clt_cfg->chr_val_handle ==
+                           ble_gatts_clt_cfgs[clt_cfg_idx].chr_val_handle);
+
+    /* Mark the CCCD entry as modified. */
+    clt_cfg->flags |= BLE_GATTS_CLT_CFG_F_MODIFIED;
+
+    return 0;
+}
+
 void
 ble_gatts_chr_updated(uint16_t chr_val_handle)
 {
     struct ble_store_value_cccd cccd_value;
     struct ble_store_key_cccd cccd_key;
-    struct ble_gatts_clt_cfg *clt_cfg;
     struct ble_hs_conn *conn;
-    int new_notifications = 0;
+    int new_notifications;
     int clt_cfg_idx;
     int persist;
     int rc;
-    int i;
 
     /* Determine if notifications or indications are allowed for this
      * characteristic.  If not, return immediately.
@@ -1507,24 +1546,8 @@ ble_gatts_chr_updated(uint16_t chr_val_handle)
     /*** Send notifications and indications to connected devices. */
 
     ble_hs_lock();
-    for (i = 0; ; i++) {
-        /* XXX: This is inefficient when there are a lot of connections.
-         * Consider using a "foreach" function to walk the connection list.
-         */
-        conn = ble_hs_conn_find_by_idx(i);
-        if (conn == NULL) {
-            break;
-        }
-
-        BLE_HS_DBG_ASSERT_EVAL(conn->bhc_gatt_svr.num_clt_cfgs >
-                               clt_cfg_idx);
-        clt_cfg = conn->bhc_gatt_svr.clt_cfgs + clt_cfg_idx;
-        BLE_HS_DBG_ASSERT_EVAL(clt_cfg->chr_val_handle == chr_val_handle);
-
-        /* Mark the CCCD entry as modified. */
-        clt_cfg->flags |= BLE_GATTS_CLT_CFG_F_MODIFIED;
-        new_notifications = 1;
-    }
+    new_notifications = ble_hs_conn_first() != NULL;
+    ble_hs_conn_foreach(ble_gatts_chr_updated_mark, &clt_cfg_idx);
     ble_hs_unlock();
 
     if (new_notifications) {
@@ -1665,65 +1688,54 @@ done:
 }
 
 /**
- * Sends notifications or indications for the specified characteristic to all
- * connected devices.  The bluetooth spec does not allow more than one
- * concurrent indication for a single peer, so this function will hold off on
- * sending such indications.
+ * Collects the updates that need to be sent to a single peer for the current
+ * chunk of configurable characteristics.  Called with the host lock held.
  */
-static void
-ble_gatts_tx_notifications_one_chr(uint16_t chr_val_handle)
+static int
+ble_gatts_tx_collect(struct ble_hs_conn *conn, void *arg)
 {
+    struct ble_gatts_tx_ctxt *ctxt;
     struct ble_gatts_clt_cfg *clt_cfg;
-    struct ble_hs_conn *conn;
-    uint16_t conn_handle;
-    uint8_t att_op;
-    int clt_cfg_idx;
+    struct ble_gatts_tx_peer *peer;
     int i;
 
-    /* Determine if notifications / indications are enabled for this
-     * characteristic.
-     */
-    clt_cfg_idx = ble_gatts_clt_cfg_find_idx(ble_gatts_clt_cfgs,
-                                             chr_val_handle);
-    if (clt_cfg_idx == -1) {
-        return;
-    }
-
-    for (i = 0; ; i++) {
-        ble_hs_lock();
+    ctxt = arg;
 
-        conn = ble_hs_conn_find_by_idx(i);
-        if (conn != NULL) {
-            BLE_HS_DBG_ASSERT_EVAL(conn->bhc_gatt_svr.num_clt_cfgs >
-                                   clt_cfg_idx);
-            clt_cfg = conn->bhc_gatt_svr.clt_cfgs + clt_cfg_idx;
-            BLE_HS_DBG_ASSERT_EVAL(clt_cfg->chr_val_handle == chr_val_handle);
+    BLE_HS_DBG_ASSERT(ctxt->num_peers <
+                      sizeof ctxt->peers / sizeof ctxt->peers[0]);
+    peer = ctxt->peers + ctxt->num_peers;
+    peer->conn_handle = conn->bhc_handle;
+    peer->indicate_handle = 0;
+    peer->notify_mask = 0;
+    peer->mult_sup = MYNEWT_VAL(BLE_GATT_NOTIFY_MULTIPLE) &&
+                     (conn->bhc_gatt_svr.peer_cl_sup_feat[0] & 0x04);
 
-            /* Determine what type of command should get sent, if any. */
-            att_op = ble_gatts_schedule_update(conn, clt_cfg);
-            conn_handle = conn->bhc_handle;
-        } else {
-            /* Silence some spurious gcc warnings. */
-            att_op = 0;
-            conn_handle = BLE_HS_CONN_HANDLE_NONE;
-        }
-        ble_hs_unlock();
-
-        if (conn == NULL) {
-            /* No more connected devices. */
-            break;
+    for (i = 0; i < ctxt->num_cfgs; i++) {
+        BLE_HS_DBG_ASSERT_EVAL(conn->bhc_gatt_svr.num_clt_cfgs >
+                               ctxt->first_cfg + i);
+        clt_cfg = conn->bhc_gatt_svr.clt_cfgs + ctxt->first_cfg + i;
+        BLE_HS_DBG_ASSERT_EVAL(
+            clt_cfg->chr_val_handle ==
+            ble_gatts_clt_cfgs[ctxt->first_cfg + i].chr_val_handle);
+
+        /* Only one indication per peer is sent per pass; any further ones
+         * stay marked as modified and go out when the ack is received.
+         */
+        if (peer->indicate_handle != 0 &&
+            !(clt_cfg->flags & BLE_GATTS_CLT_CFG_F_NOTIFY)) {
+            continue;
         }
 
-        switch (att_op) {
-        case 0:
-            break;
-
+        switch (ble_gatts_schedule_update(conn, clt_cfg)) {
         case BLE_ATT_OP_NOTIFY_REQ:
-            ble_gatts_notify(conn_handle, chr_val_handle);
+            peer->notify_mask |= 1 << i;
             break;
 
         case BLE_ATT_OP_INDICATE_REQ:
-            ble_gatts_indicate(conn_handle, chr_val_handle);
+            peer->indicate_handle = clt_cfg->chr_val_handle;
+            break;
+
+        case 0:
             break;
 
         default:
@@ -1731,6 +1743,148 @@ ble_gatts_tx_notifications_one_chr(uint16_t chr_val_handle)
             break;
         }
     }
+
+    if (peer->notify_mask != 0 || peer->indicate_handle != 0) {
+        ctxt->notify_mask |= peer->notify_mask;
+        ctxt->num_peers++;
+    }
+
+    return 0;
+}
+
+/**
+ * Reads the current value of a characteristic so that it can be shared by
+ * all peers being notified.
+ */
+static struct os_mbuf *
+ble_gatts_tx_read_value(uint16_t chr_val_handle)
+{
+    struct os_mbuf *om;
+    int rc;
+
+    om = ble_hs_mbuf_att_pkt();
+    if (om == NULL) {
+        return NULL;
+    }
+
+    rc = ble_att_svr_read_handle(BLE_HS_CONN_HANDLE_NONE, chr_val_handle, 0,
+                                 om, NULL);
+    if (rc != 0) {
+        os_mbuf_free_chain(om);
+        return NULL;
+    }
+
+    return om;
+}
+
+static struct os_mbuf *
+ble_gatts_tx_copy_value(const struct os_mbuf *val)
+{
+    struct os_mbuf *om;
+    int rc;
+
+    if (val == NULL) {
+        return NULL;
+    }
+
+    om = ble_hs_mbuf_att_pkt();
+    if (om == NULL) {
+        return NULL;
+    }
+
+    rc = os_mbuf_appendfrom(om, val, 0, OS_MBUF_PKTLEN(val));
+    if (rc != 0) {
+        os_mbuf_free_chain(om);
+        return NULL;
+    }
+
+    return om;
+}
+
+/**
+ * Sends notifications and indications for a chunk of configurable
+ * characteristics to all connected devices.  Connections are walked once per
+ * chunk, each updated value is read from the attribute only once, and
+ * notifications to peers that support it are coalesced into Multiple Handle
+ * Value Notifications.
+ */
+static void
+ble_gatts_tx_notifications_chunk(int first_cfg, int num_cfgs)
+{
+    struct os_mbuf *vals[BLE_GATTS_TX_CHUNK_SZ];
+    struct ble_gatt_notif tuples[BLE_GATTS_TX_CHUNK_SZ];
+    struct ble_gatts_tx_ctxt *ctxt;
+    struct ble_gatts_tx_peer *peer;
+    struct os_mbuf *om;
+    uint16_t chr_val_handle;
+    int num_tuples;
+    int i;
+    int j;
+
+    BLE_HS_DBG_ASSERT(num_cfgs <= BLE_GATTS_TX_CHUNK_SZ);
+
+    ctxt = &ble_gatts_tx_ctxt;
+    ctxt->first_cfg = first_cfg;
+    ctxt->num_cfgs = num_cfgs;
+    ctxt->num_peers = 0;
+    ctxt->notify_mask = 0;
+
+    ble_hs_lock();
+    ble_hs_conn_foreach(ble_gatts_tx_collect, ctxt);
+    ble_hs_unlock();
+
+    if (ctxt->num_peers == 0) {
+        return;
+    }
+
+    for (i = 0; i < num_cfgs; i++) {
+        if (ctxt->notify_mask & (1 << i)) {
+            chr_val_handle = ble_gatts_clt_cfgs[first_cfg + i].chr_val_handle;
+            vals[i] = ble_gatts_tx_read_value(chr_val_handle);
+        } else {
+            vals[i] = NULL;
+        }
+    }
+
+    for (j = 0; j < ctxt->num_peers; j++) {
+        peer = ctxt->peers + j;
+        num_tuples = 0;
+
+        for (i = 0; i < num_cfgs; i++) {
+            if (!(peer->notify_mask & (1 << i))) {
+                continue;
+            }
+
+            chr_val_handle = ble_gatts_clt_cfgs[first_cfg + i].chr_val_handle;
+            om = ble_gatts_tx_copy_value(vals[i]);
+
+            /* Without a shared copy of the value the notification falls
+             * back to reading the attribute itself, which also reports any
+             * error to the application.
+             */
+            if (om == NULL || !peer->mult_sup) {
+                ble_gatts_notify_custom(peer->conn_handle, chr_val_handle, om);
+                continue;
+            }
+
+            tuples[num_tuples].handle = chr_val_handle;
+            tuples[num_tuples].value = om;
+            num_tuples++;
+        }
+
+        if (num_tuples > 0) {
+            ble_gatts_notify_multiple_custom(peer->conn_handle, num_tuples,
+                                             tuples);
+        }
+
+        if (peer->indicate_handle != 0) {
+            ble_gatts_indicate(peer->conn_handle, peer->indicate_handle);
+        }
+    }
+
+    for (i = 0; i < num_cfgs; i++) {
+        os_mbuf_free_chain(vals[i]);
+    }
 }
 
 /**
@@ -1741,13 +1895,35 @@ ble_gatts_tx_notifications_one_chr(uint16_t chr_val_handle)
 void
 ble_gatts_tx_notifications(void)
 {
-    uint16_t chr_val_handle;
+    int num_cfgs;
     int i;
 
-    for (i = 0; i < ble_gatts_num_cfgable_chrs; i++) {
-        chr_val_handle = ble_gatts_clt_cfgs[i].chr_val_handle;
-        ble_gatts_tx_notifications_one_chr(chr_val_handle);
+    /* Before the OS is started an application callback invoked from a pass
+     * can trigger another pass directly.  The shared context must not be
+     * reused underneath the running pass, so let that pass go around again
+     * instead.
+     */
+    if (ble_gatts_tx_busy) {
+        ble_gatts_tx_again = 1;
+        return;
     }
+
+    ble_gatts_tx_busy = 1;
+
+    do {
+        ble_gatts_tx_again = 0;
+
+        for (i = 0; i < ble_gatts_num_cfgable_chrs;
+             i += BLE_GATTS_TX_CHUNK_SZ) {
+            num_cfgs = ble_gatts_num_cfgable_chrs - i;
+            if (num_cfgs > BLE_GATTS_TX_CHUNK_SZ) {
+                num_cfgs = BLE_GATTS_TX_CHUNK_SZ;
+            }
+            ble_gatts_tx_notifications_chunk(i, num_cfgs);
+        }
+    } while (ble_gatts_tx_again);
+
+    ble_gatts_tx_busy = 0;
 }
 
 void
@@ -106,6 +106,8 @@ STATS_NAME_START(ble_hs_stats)
     STATS_NAME(ble_hs_stats, sync)
     STATS_NAME(ble_hs_stats, pvcy_add_entry)
     STATS_NAME(ble_hs_stats, pvcy_add_entry_fail)
+    STATS_NAME(ble_hs_stats, sm_key_pool_miss)
+    STATS_NAME(ble_hs_stats, sm_key_rotate)
 STATS_NAME_END(ble_hs_stats)
 
 struct ble_npl_eventq *
@@ -369,6 +371,14 @@ ble_hs_reset(void)
 
     ble_hs_clear_rx_queue();
 
+    /* Fail commands which are not going to be acknowledged anymore. */
+    ble_hs_hci_cmd_reset();
+
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    /* Controller generates a new P-256 key pair after reset. */
+    ble_sm_sc_reset();
+#endif
+
     /* Clear adverising and scanning states. */
     ble_gap_reset_state(ble_hs_reset_reason);
 
@@ -27,7 +27,20 @@
 /** At least three channels required per connection (sig, att, sm). */
 #define BLE_HS_CONN_MIN_CHANS       3
 
+/**
+ * Number of buckets in the connection handle hash.  Controllers usually
+ * assign handles sequentially, so with one bucket per connection a lookup
+ * almost always inspects a single entry.
+ */
+#if MYNEWT_VAL(BLE_MAX_CONNECTIONS) > 0
+#define BLE_HS_CONN_HASH_SIZE       MYNEWT_VAL(BLE_MAX_CONNECTIONS)
+#else
+#define BLE_HS_CONN_HASH_SIZE       1
+#endif
+
 static SLIST_HEAD(, ble_hs_conn) ble_hs_conns;
+static SLIST_HEAD(ble_hs_conn_bucket, ble_hs_conn)
+    ble_hs_conn_hash[BLE_HS_CONN_HASH_SIZE];
 static struct os_mempool ble_hs_conn_pool;
 
 static os_membuf_t ble_hs_conn_elem_mem[
@@ -37,6 +50,12 @@ static os_membuf_t ble_hs_conn_elem_mem[
 
 static const uint8_t ble_hs_conn_null_addr[6];
 
+static struct ble_hs_conn_bucket *
+ble_hs_conn_bucket(uint16_t conn_handle)
+{
+    return &ble_hs_conn_hash[conn_handle % BLE_HS_CONN_HASH_SIZE];
+}
+
 int
 ble_hs_conn_can_alloc(void)
 {
@@ -280,6 +299,8 @@ ble_hs_conn_insert(struct ble_hs_conn *conn)
 
     BLE_HS_DBG_ASSERT_EVAL(ble_hs_conn_find(conn->bhc_handle) == NULL);
     SLIST_INSERT_HEAD(&ble_hs_conns, conn, bhc_next);
+    SLIST_INSERT_HEAD(ble_hs_conn_bucket(conn->bhc_handle), conn,
+                      bhc_hash_next);
 }
 
 void
@@ -292,6 +313,8 @@ ble_hs_conn_remove(struct ble_hs_conn *conn)
     BLE_HS_DBG_ASSERT(ble_hs_locked_by_cur_task());
 
     SLIST_REMOVE(&ble_hs_conns, conn, ble_hs_conn, bhc_next);
+    SLIST_REMOVE(ble_hs_conn_bucket(conn->bhc_handle), conn, ble_hs_conn,
+                 bhc_hash_next);
 }
 
 struct ble_hs_conn *
@@ -305,7 +328,7 @@ ble_hs_conn_find(uint16_t conn_handle)
 
     BLE_HS_DBG_ASSERT(ble_hs_locked_by_cur_task());
 
-    SLIST_FOREACH(conn, &ble_hs_conns, bhc_next) {
+    SLIST_FOREACH(conn, ble_hs_conn_bucket(conn_handle), bhc_hash_next) {
         if (conn->bhc_handle == conn_handle) {
             return conn;
         }
@@ -555,6 +578,7 @@ int
 ble_hs_conn_init(void)
 {
     int rc;
+    int i;
 
     rc = os_mempool_init(&ble_hs_conn_pool, MYNEWT_VAL(BLE_MAX_CONNECTIONS),
                          sizeof (struct ble_hs_conn),
@@ -564,6 +588,9 @@ ble_hs_conn_init(void)
     }
 
     SLIST_INIT(&ble_hs_conns);
+    for (i = 0; i < BLE_HS_CONN_HASH_SIZE; i++) {
+        SLIST_INIT(&ble_hs_conn_hash[i]);
+    }
 
     return 0;
 }
@@ -49,6 +49,7 @@ typedef uint8_t ble_hs_conn_flags_t;
 
 struct ble_hs_conn {
     SLIST_ENTRY(ble_hs_conn) bhc_next;
+    SLIST_ENTRY(ble_hs_conn) bhc_hash_next;
     uint16_t bhc_handle;
     uint8_t bhc_our_addr_type;
 #if MYNEWT_VAL(BLE_EXT_ADV)
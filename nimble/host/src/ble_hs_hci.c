@@ -40,6 +40,16 @@ static uint8_t ble_hs_hci_version;
 
 static struct ble_hs_hci_sup_cmd ble_hs_hci_sup_cmd;
 
+/**
+ * Number of commands the controller is able to accept
+ * (Num_HCI_Command_Packets).  Accessed only inside a critical section.
+ */
+static uint8_t ble_hs_hci_cmd_credits;
+/** A command was sent and is waiting for Command Complete or Status. */
+static bool ble_hs_hci_cmd_inflight;
+/** A command is waiting for the controller to return a credit. */
+static bool ble_hs_hci_cmd_credit_wait;
+
 #if MYNEWT_VAL(BLE_CONTROLLER)
 #define BLE_HS_HCI_FRAG_DATABUF_SIZE    \
     (BLE_ACL_MAX_PKT_SIZE +             \
@@ -306,6 +316,88 @@ ble_hs_hci_cmd_tx_no_rsp(uint16_t opcode, const void *cmd, uint8_t cmd_len)
     return rc;
 }
 
+static void
+ble_hs_hci_cmd_sem_drain(void)
+{
+    while (ble_npl_sem_get_count(&ble_hs_hci_sem) > 0) {
+        ble_npl_sem_pend(&ble_hs_hci_sem, 0);
+    }
+}
+
+/**
+ * Marks the command as no longer in flight.
+ *
+ * @return                      0 if the command was in flight;
+ *                              BLE_HS_ENOENT if it was already acknowledged.
+ */
+static int
+ble_hs_hci_cmd_inflight_clear(void)
+{
+    bool inflight;
+    uint32_t sr;
+
+    sr = ble_npl_hw_enter_critical();
+    inflight = ble_hs_hci_cmd_inflight;
+    ble_hs_hci_cmd_inflight = false;
+    ble_npl_hw_exit_critical(sr);
+
+    return inflight ? 0 : BLE_HS_ENOENT;
+}
+
+/**
+ * Takes a command credit and marks the command as in flight, waiting for the
+ * controller to return a credit if none is available.
+ */
+static int
+ble_hs_hci_cmd_credit_take(void)
+{
+#if !MYNEWT_VAL(BLE_HS_PHONY_HCI_ACKS)
+    int taken;
+    int rc;
+    uint32_t sr;
+
+    while (1) {
+        sr = ble_npl_hw_enter_critical();
+        taken = ble_hs_hci_cmd_credits > 0;
+        if (taken) {
+            ble_hs_hci_cmd_credits--;
+            ble_hs_hci_cmd_inflight = true;
+        } else {
+            ble_hs_hci_cmd_credit_wait = true;
+        }
+        ble_npl_hw_exit_critical(sr);
+
+        if (taken) {
+            return 0;
+        }
+
+        rc = ble_npl_sem_pend(&ble_hs_hci_sem,
+                              ble_npl_time_ms_to_ticks32(BLE_HCI_CMD_TIMEOUT_MS));
+        if (rc != 0) {
+            sr = ble_npl_hw_enter_critical();
+            ble_hs_hci_cmd_credit_wait = false;
+            ble_npl_hw_exit_critical(sr);
+            ble_hs_hci_cmd_sem_drain();
+
+            STATS_INC(ble_hs_stats, hci_timeout);
+            return BLE_HS_ETIMEOUT_HCI;
+        }
+    }
+#else
+    return 0;
+#endif
+}
+
+static void
+ble_hs_hci_cmd_credit_put(void)
+{
+    uint32_t sr;
+
+    sr = ble_npl_hw_enter_critical();
+    ble_hs_hci_cmd_credits++;
+    ble_npl_hw_exit_critical(sr);
+}
+
 int
 ble_hs_hci_cmd_tx(uint16_t opcode, const void *cmd, uint8_t cmd_len,
                   void *rsp, uint8_t rsp_len)
@@ -316,13 +408,26 @@ ble_hs_hci_cmd_tx(uint16_t opcode, const void *cmd, uint8_t cmd_len,
     BLE_HS_DBG_ASSERT(ble_hs_hci_ack == NULL);
     ble_hs_hci_lock();
 
+    rc = ble_hs_hci_cmd_credit_take();
+    if (rc != 0) {
+        ble_hs_sched_reset(rc);
+        goto done;
+    }
+
     rc = ble_hs_hci_cmd_send_buf(opcode, cmd, cmd_len);
     if (rc != 0) {
+        if (ble_hs_hci_cmd_inflight_clear() == 0) {
+            ble_hs_hci_cmd_credit_put();
+        }
         goto done;
     }
 
     rc = ble_hs_hci_wait_for_ack();
     if (rc != 0) {
+        if (ble_hs_hci_cmd_inflight_clear() != 0) {
+            /* Acknowledgement raced with the timeout */
+            ble_hs_hci_cmd_sem_drain();
+        }
         ble_hs_sched_reset(rc);
         goto done;
     }
@@ -351,6 +456,20 @@ done:
     return rc;
 }
 
+void
+ble_hs_hci_cmd_reset(void)
+{
+    uint32_t sr;
+
+    /* Anything sent to the old controller instance is not going to be
+     * acknowledged anymore.
+     */
+    sr = ble_npl_hw_enter_critical();
+    ble_hs_hci_cmd_credits = 1;
+    ble_hs_hci_cmd_inflight = false;
+    ble_npl_hw_exit_critical(sr);
+}
+
 #if MYNEWT_VAL(BLE_HCI_VS)
 int
 ble_hs_hci_send_vs_cmd(uint16_t ocf, const void *cmdbuf, uint8_t cmdlen,
@@ -365,10 +484,33 @@ ble_hs_hci_send_vs_cmd(uint16_t ocf, const void *cmdbuf, uint8_t cmdlen,
 }
 #endif
 
+/**
+ * Updates number of command credits from Command Complete or Command Status
+ * event and wakes up a command waiting for a credit.
+ */
+static void
+ble_hs_hci_rx_credits(uint8_t num_packets)
+{
+    bool wake = false;
+    uint32_t sr;
+
+    sr = ble_npl_hw_enter_critical();
+    ble_hs_hci_cmd_credits = num_packets;
+    if (num_packets && ble_hs_hci_cmd_credit_wait) {
+        ble_hs_hci_cmd_credit_wait = false;
+        wake = true;
+    }
+    ble_npl_hw_exit_critical(sr);
+
+    if (wake) {
+        ble_npl_sem_release(&ble_hs_hci_sem);
+    }
+}
+
 static void
 ble_hs_hci_rx_ack(uint8_t *ack_ev)
 {
-    if (ble_npl_sem_get_count(&ble_hs_hci_sem) > 0) {
+    if (ble_hs_hci_cmd_inflight_clear() != 0) {
         /* This ack is unexpected; ignore it. */
         ble_transport_free(ack_ev);
         return;
@@ -388,6 +530,7 @@ ble_hs_hci_rx_evt(uint8_t *hci_ev, void *arg)
     struct ble_hci_ev *ev = (void *) hci_ev;
     struct ble_hci_ev_command_complete *cmd_complete = (void *) ev->data;
     struct ble_hci_ev_command_status *cmd_status = (void *) ev->data;
+    uint8_t num_packets;
     int enqueue;
 
     BLE_HS_DBG_ASSERT(hci_ev != NULL);
@@ -395,13 +538,15 @@ ble_hs_hci_rx_evt(uint8_t *hci_ev, void *arg)
     switch (ev->opcode) {
     case BLE_HCI_EVCODE_COMMAND_COMPLETE:
         enqueue = (cmd_complete->opcode == BLE_HCI_OPCODE_NOP);
+        num_packets = cmd_complete->num_packets;
         break;
     case BLE_HCI_EVCODE_COMMAND_STATUS:
         enqueue = (cmd_status->opcode == BLE_HCI_OPCODE_NOP);
+        num_packets = cmd_status->num_packets;
         break;
     default:
-        enqueue = 1;
-        break;
+        ble_hs_enqueue_hci_event(hci_ev);
+        return 0;
     }
 
     if (enqueue) {
@@ -410,6 +555,11 @@ ble_hs_hci_rx_evt(uint8_t *hci_ev, void *arg)
         ble_hs_hci_rx_ack(hci_ev);
     }
 
+    /* Credits are returned only after the acknowledgement was handled so that
+     * its buffer is already owned by the waiting command.
+     */
+    ble_hs_hci_rx_credits(num_packets);
+
     return 0;
 }
 
@@ -657,6 +807,8 @@ ble_hs_hci_init(void)
     rc = ble_npl_mutex_init(&ble_hs_hci_mutex);
     BLE_HS_DBG_ASSERT_EVAL(rc == 0);
 
+    ble_hs_hci_cmd_credits = 1;
+
     rc = mem_init_mbuf_pool(ble_hs_hci_frag_data,
                             &ble_hs_hci_frag_mempool,
                             &ble_hs_hci_frag_mbuf_pool,
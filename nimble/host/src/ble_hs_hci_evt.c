@@ -86,6 +86,10 @@ static ble_hs_hci_evt_le_fn ble_hs_hci_evt_le_transmit_power_report;
 #if MYNEWT_VAL(BLE_CONN_SUBRATING)
 static ble_hs_hci_evt_le_fn ble_hs_hci_evt_le_subrate_change;
 #endif
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+static ble_hs_hci_evt_le_fn ble_hs_hci_evt_le_rd_p256_pubkey;
+static ble_hs_hci_evt_le_fn ble_hs_hci_evt_le_gen_dhkey_complete;
+#endif
 
 /* Statistics */
 struct host_hci_stats {
@@ -97,24 +101,22 @@ struct host_hci_stats {
 
 #define BLE_HS_HCI_EVT_TIMEOUT        50      /* Milliseconds. */
 
-/** Dispatch table for incoming HCI events.  Sorted by event code field. */
-struct ble_hs_hci_evt_dispatch_entry {
-    uint8_t event_code;
-    ble_hs_hci_evt_fn *cb;
-};
-
-static const struct ble_hs_hci_evt_dispatch_entry ble_hs_hci_evt_dispatch[] = {
-    { BLE_HCI_EVCODE_LE_META, ble_hs_hci_evt_le_meta },
-    { BLE_HCI_EVCODE_NUM_COMP_PKTS, ble_hs_hci_evt_num_completed_pkts },
+/**
+ * Dispatch table for incoming HCI events, indexed by event code.  The vendor
+ * specific event is handled separately so that the table does not have to
+ * span all event codes.
+ */
+static ble_hs_hci_evt_fn * const ble_hs_hci_evt_dispatch[] = {
 #if NIMBLE_BLE_CONNECT
-    { BLE_HCI_EVCODE_DISCONN_CMP, ble_hs_hci_evt_disconn_complete },
-    { BLE_HCI_EVCODE_ENCRYPT_CHG, ble_hs_hci_evt_encrypt_change },
-    { BLE_HCI_EVCODE_ENC_KEY_REFRESH, ble_hs_hci_evt_enc_key_refresh },
+    [BLE_HCI_EVCODE_DISCONN_CMP] = ble_hs_hci_evt_disconn_complete,
+    [BLE_HCI_EVCODE_ENCRYPT_CHG] = ble_hs_hci_evt_encrypt_change,
 #endif
-    { BLE_HCI_EVCODE_HW_ERROR, ble_hs_hci_evt_hw_error },
-#if MYNEWT_VAL(BLE_HCI_VS)
-    { BLE_HCI_EVCODE_VS, ble_hs_hci_evt_vs },
+    [BLE_HCI_EVCODE_HW_ERROR] = ble_hs_hci_evt_hw_error,
+    [BLE_HCI_EVCODE_NUM_COMP_PKTS] = ble_hs_hci_evt_num_completed_pkts,
+#if NIMBLE_BLE_CONNECT
+    [BLE_HCI_EVCODE_ENC_KEY_REFRESH] = ble_hs_hci_evt_enc_key_refresh,
 #endif
+    [BLE_HCI_EVCODE_LE_META] = ble_hs_hci_evt_le_meta,
 };
 
 #define BLE_HS_HCI_EVT_DISPATCH_SZ \
@@ -134,6 +136,10 @@ static ble_hs_hci_evt_le_fn * const ble_hs_hci_evt_le_dispatch[] = {
     [BLE_HCI_LE_SUBEV_DIRECT_ADV_RPT] = ble_hs_hci_evt_le_dir_adv_rpt,
 #if NIMBLE_BLE_CONNECT
     [BLE_HCI_LE_SUBEV_PHY_UPDATE_COMPLETE] = ble_hs_hci_evt_le_phy_update_complete,
+#endif
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    [BLE_HCI_LE_SUBEV_RD_LOC_P256_PUBKEY] = ble_hs_hci_evt_le_rd_p256_pubkey,
+    [BLE_HCI_LE_SUBEV_GEN_DHKEY_COMPLETE] = ble_hs_hci_evt_le_gen_dhkey_complete,
 #endif
     [BLE_HCI_LE_SUBEV_EXT_ADV_RPT] = ble_hs_hci_evt_le_ext_adv_rpt,
     [BLE_HCI_LE_SUBEV_PERIODIC_ADV_SYNC_ESTAB] = ble_hs_hci_evt_le_periodic_adv_sync_estab,
@@ -181,20 +187,20 @@ static ble_hs_hci_evt_le_fn * const ble_hs_hci_evt_le_dispatch[] = {
 #define BLE_HS_HCI_EVT_LE_DISPATCH_SZ \
     (sizeof ble_hs_hci_evt_le_dispatch / sizeof ble_hs_hci_evt_le_dispatch[0])
 
-static const struct ble_hs_hci_evt_dispatch_entry *
+static ble_hs_hci_evt_fn *
 ble_hs_hci_evt_dispatch_find(uint8_t event_code)
 {
-    const struct ble_hs_hci_evt_dispatch_entry *entry;
-    unsigned int i;
+#if MYNEWT_VAL(BLE_HCI_VS)
+    if (event_code == BLE_HCI_EVCODE_VS) {
+        return ble_hs_hci_evt_vs;
+    }
+#endif
 
-    for (i = 0; i < BLE_HS_HCI_EVT_DISPATCH_SZ; i++) {
-        entry = ble_hs_hci_evt_dispatch + i;
-        if (entry->event_code == event_code) {
-            return entry;
-        }
+    if (event_code >= BLE_HS_HCI_EVT_DISPATCH_SZ) {
+        return NULL;
     }
 
-    return NULL;
+    return ble_hs_hci_evt_dispatch[event_code];
 }
 
 static ble_hs_hci_evt_le_fn *
@@ -456,10 +462,18 @@ ble_hs_hci_evt_le_conn_complete(uint8_t subevent, const void *data,
 }
 #endif
 
+#if NIMBLE_BLE_SCAN
+/* Reports carried by a single HCI event, handed over to GAP in one call */
+static struct ble_gap_disc_desc
+ble_hs_hci_evt_adv_descs[BLE_HCI_LE_ADV_RPT_NUM_RPTS_MAX];
+#endif
+
 static int
-ble_hs_hci_evt_le_adv_rpt_first_pass(const void *data, unsigned int len)
+ble_hs_hci_evt_le_adv_rpt(uint8_t subevent, const void *data, unsigned int len)
 {
+#if NIMBLE_BLE_SCAN
     const struct ble_hci_ev_le_subev_adv_rpt *ev = data;
+    struct ble_gap_disc_desc *desc;
     const struct adv_report *rpt;
     int i;
 
@@ -475,6 +489,9 @@ ble_hs_hci_evt_le_adv_rpt_first_pass(const void *data, unsigned int len)
         return BLE_HS_EBADDATA;
     }
 
+    /* Reports are validated and parsed in a single pass; nothing is passed
+     * to GAP unless the whole event is well formed.
+     */
     for (i = 0; i < ev->num_reports; i++) {
         /* extra byte for RSSI after adv data */
         if (len < sizeof(*rpt) + 1) {
@@ -483,10 +500,19 @@ ble_hs_hci_evt_le_adv_rpt_first_pass(const void *data, unsigned int len)
 
         rpt = data;
 
-        if (rpt->data_len > len) {
+        if (rpt->data_len > len - sizeof(*rpt) - 1) {
             return BLE_HS_ECONTROLLER;
         }
 
+        desc = &ble_hs_hci_evt_adv_descs[i];
+        desc->event_type = rpt->type;
+        desc->length_data = rpt->data_len;
+        desc->addr.type = rpt->addr_type;
+        memcpy(desc->addr.val, rpt->addr, BLE_DEV_ADDR_LEN);
+        desc->rssi = rpt->data[rpt->data_len];
+        desc->data = rpt->data;
+        desc->direct_addr = *BLE_ADDR_ANY;
+
         /* extra byte for RSSI after adv data */
         len -= sizeof(*rpt) + 1 + rpt->data_len;
         data += sizeof(*rpt) + 1 + rpt->data_len;
@@ -497,42 +523,8 @@ ble_hs_hci_evt_le_adv_rpt_first_pass(const void *data, unsigned int len)
         return BLE_HS_ECONTROLLER;
     }
 
-    return 0;
-}
-
-static int
-ble_hs_hci_evt_le_adv_rpt(uint8_t subevent, const void *data, unsigned int len)
-{
-    const struct ble_hci_ev_le_subev_adv_rpt *ev = data;
-    struct ble_gap_disc_desc desc = {0};
-    const struct adv_report *rpt;
-    int rc;
-    int i;
-
-    /* Validate the event is formatted correctly */
-    rc = ble_hs_hci_evt_le_adv_rpt_first_pass(data, len);
-    if (rc != 0) {
-        return rc;
-    }
-
-    data += sizeof(*ev);
-
-    desc.direct_addr = *BLE_ADDR_ANY;
-
-    for (i = 0; i < ev->num_reports; i++) {
-        rpt = data;
-
-        data += sizeof(rpt) + rpt->data_len + 1;
-
-        desc.event_type = rpt->type;
-        desc.addr.type = rpt->addr_type;
-        memcpy(desc.addr.val, rpt->addr, BLE_DEV_ADDR_LEN);
-        desc.length_data = rpt->data_len;
-        desc.data = rpt->data;
-        desc.rssi = rpt->data[rpt->data_len];
-
-        ble_gap_rx_adv_report(&desc);
-    }
+    ble_gap_rx_adv_reports(ble_hs_hci_evt_adv_descs, ev->num_reports);
+#endif
 
     return 0;
 }
@@ -540,29 +532,39 @@ ble_hs_hci_evt_le_adv_rpt(uint8_t subevent, const void *data, unsigned int len)
 static int
 ble_hs_hci_evt_le_dir_adv_rpt(uint8_t subevent, const void *data, unsigned int len)
 {
+#if NIMBLE_BLE_SCAN
     const struct ble_hci_ev_le_subev_direct_adv_rpt *ev = data;
-    struct ble_gap_disc_desc desc = {0};
+    struct ble_gap_disc_desc *desc;
     int i;
 
-    if (len < sizeof(*ev) || len != ev->num_reports * sizeof(ev->reports[0])) {
+    if (len < sizeof(*ev) ||
+        len != sizeof(*ev) + ev->num_reports * sizeof(ev->reports[0]) ||
+        ev->num_reports > BLE_HCI_LE_ADV_RPT_NUM_RPTS_MAX) {
         return BLE_HS_ECONTROLLER;
     }
 
-    /* Data fields not present in a direct advertising report. */
-    desc.data = NULL;
-    desc.length_data = 0;
+    if (ev->num_reports == 0) {
+        return 0;
+    }
 
     for (i = 0; i < ev->num_reports; i++) {
-        desc.event_type = ev->reports[i].type;
-        desc.addr.type = ev->reports[i].addr_type;
-        memcpy(desc.addr.val, ev->reports[i].addr, BLE_DEV_ADDR_LEN);
-        desc.direct_addr.type = ev->reports[i].dir_addr_type;
-        memcpy(desc.direct_addr.val, ev->reports[i].dir_addr, BLE_DEV_ADDR_LEN);
-        desc.rssi = ev->reports[i].rssi;
-
-        ble_gap_rx_adv_report(&desc);
+        desc = &ble_hs_hci_evt_adv_descs[i];
+        desc->event_type = ev->reports[i].type;
+        desc->addr.type = ev->reports[i].addr_type;
+        memcpy(desc->addr.val, ev->reports[i].addr, BLE_DEV_ADDR_LEN);
+        desc->direct_addr.type = ev->reports[i].dir_addr_type;
+        memcpy(desc->direct_addr.val, ev->reports[i].dir_addr,
+               BLE_DEV_ADDR_LEN);
+        desc->rssi = ev->reports[i].rssi;
+
+        /* Data fields not present in a direct advertising report. */
+        desc->data = NULL;
+        desc->length_data = 0;
     }
 
+    ble_gap_rx_adv_reports(ble_hs_hci_evt_adv_descs, ev->num_reports);
+#endif
+
     return 0;
 }
 
@@ -977,6 +979,38 @@ ble_hs_hci_evt_le_subrate_change(uint8_t subevent, const void *data,
 }
 #endif
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+static int
+ble_hs_hci_evt_le_rd_p256_pubkey(uint8_t subevent, const void *data,
+                                 unsigned int len)
+{
+    const struct ble_hci_ev_le_subev_rd_loc_p256_pubkey *ev = data;
+
+    if (len != sizeof(*ev)) {
+        return BLE_HS_ECONTROLLER;
+    }
+
+    ble_sm_sc_rd_p256_pubkey_rx(ev);
+
+    return 0;
+}
+
+static int
+ble_hs_hci_evt_le_gen_dhkey_complete(uint8_t subevent, const void *data,
+                                     unsigned int len)
+{
+    const struct ble_hci_ev_le_subev_gen_dhkey_complete *ev = data;
+
+    if (len != sizeof(*ev)) {
+        return BLE_HS_ECONTROLLER;
+    }
+
+    ble_sm_sc_gen_dhkey_rx(ev);
+
+    return 0;
+}
+#endif
+
 #if NIMBLE_BLE_CONNECT
 static int
 ble_hs_hci_evt_le_conn_upd_complete(uint8_t subevent, const void *data,
@@ -1061,22 +1095,22 @@ ble_hs_hci_evt_le_phy_update_complete(uint8_t subevent, const void *data,
 int
 ble_hs_hci_evt_process(struct ble_hci_ev *ev)
 {
-    const struct ble_hs_hci_evt_dispatch_entry *entry;
+    ble_hs_hci_evt_fn *fn;
     int rc;
 
     /* Count events received */
     STATS_INC(ble_hs_stats, hci_event);
 
 
-    entry = ble_hs_hci_evt_dispatch_find(ev->opcode);
-    if (entry == NULL) {
+    fn = ble_hs_hci_evt_dispatch_find(ev->opcode);
+    if (fn == NULL) {
 #if MYNEWT_VAL(BLE_HS_GAP_UNHANDLED_HCI_EVENT)
         ble_gap_unhandled_hci_event(false, false, ev->data, ev->length);
 #endif
         STATS_INC(ble_hs_stats, hci_unknown_event);
         rc = BLE_HS_ENOTSUP;
     } else {
-        rc = entry->cb(ev->opcode, ev->data, ev->length);
+        rc = fn(ev->opcode, ev->data, ev->length);
     }
 
     ble_transport_free(ev);
@@ -17,10 +17,15 @@
  * under the License.
  */
 
+#include <string.h>
 #include "host/ble_hs.h"
 #include "host/ble_hs_mbuf.h"
 #include "ble_hs_priv.h"
 
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
 /**
  * Allocates an mbuf for use by the nimble host.
  */
@@ -164,3 +169,160 @@ ble_hs_mbuf_pullup_base(struct os_mbuf **om, int base_len)
 
     return 0;
 }
+
+/**
+ * Describes a span of an mbuf chain as a scatter-gather list.  One entry is
+ * produced per mbuf touched by the span; empty mbufs are skipped.  The list
+ * refers directly to the chain's data, so it is only valid for as long as the
+ * chain is left unmodified.
+ *
+ * @param om                    The mbuf chain to describe.
+ * @param off                   The offset of the span within the chain.
+ * @param len                   The length of the span.
+ * @param iov                   The array to fill.
+ * @param max_iovs              The number of entries in the iov array.
+ * @param out_len               On success, the number of bytes described by
+ *                                  the filled entries gets written here.
+ *                                  This is less than len if the chain is too
+ *                                  short or the iov array too small.  Pass
+ *                                  NULL if you do not require this
+ *                                  information.
+ *
+ * @return                      The number of iov entries filled.
+ */
+int
+ble_hs_mbuf_iov_build(const struct os_mbuf *om, uint16_t off, uint16_t len,
+                      struct ble_hs_mbuf_iov *iov, int max_iovs,
+                      uint16_t *out_len)
+{
+    uint16_t chunk;
+    uint16_t total;
+    int num_iovs;
+
+    while (om != NULL && off >= om->om_len) {
+        off -= om->om_len;
+        om = SLIST_NEXT(om, om_next);
+    }
+
+    total = 0;
+    num_iovs = 0;
+    while (om != NULL && total < len && num_iovs < max_iovs) {
+        chunk = min(om->om_len - off, len - total);
+        if (chunk > 0) {
+            iov[num_iovs].data = om->om_data + off;
+            iov[num_iovs].len = chunk;
+            num_iovs++;
+            total += chunk;
+        }
+
+        off = 0;
+        om = SLIST_NEXT(om, om_next);
+    }
+
+    if (out_len != NULL) {
+        *out_len = total;
+    }
+
+    return num_iovs;
+}
+
+/**
+ * Copies the data described by a scatter-gather list into a flat buffer.
+ */
+void
+ble_hs_mbuf_iov_copy(const struct ble_hs_mbuf_iov *iov, int num_iovs,
+                     void *dst)
+{
+    uint8_t *u8ptr;
+    int i;
+
+    u8ptr = dst;
+    for (i = 0; i < num_iovs; i++) {
+        memcpy(u8ptr, iov[i].data, iov[i].len);
+        u8ptr += iov[i].len;
+    }
+}
+
+/**
+ * Appends a flat buffer to the end of a chain, starting at the supplied last
+ * mbuf rather than walking the chain to find it.  New mbufs are allocated
+ * from the chain's pool as needed; on return, *last points to the new end of
+ * the chain.  The packet header length is not updated.
+ *
+ * @return                      The number of bytes that could not be
+ *                                  appended; 0 on success.
+ */
+static uint16_t
+ble_hs_mbuf_append_at(struct os_mbuf **last, const uint8_t *data,
+                      uint16_t len)
+{
+    struct os_mbuf *om;
+    uint16_t space;
+
+    om = *last;
+    while (len > 0) {
+        space = OS_MBUF_TRAILINGSPACE(om);
+        if (space == 0) {
+            om = os_mbuf_get(om->om_omp, 0);
+            if (om == NULL) {
+                break;
+            }
+
+            SLIST_NEXT(*last, om_next) = om;
+            *last = om;
+            continue;
+        }
+
+        space = min(space, len);
+        memcpy(om->om_data + om->om_len, data, space);
+        om->om_len += space;
+        data += space;
+        len -= space;
+    }
+
+    return len;
+}
+
+static struct os_mbuf *
+ble_hs_mbuf_last(struct os_mbuf *om)
+{
+    struct os_mbuf *next;
+
+    while ((next = SLIST_NEXT(om, om_next)) != NULL) {
+        om = next;
+    }
+
+    return om;
+}
+
+/**
+ * Appends the data described by a scatter-gather list to an mbuf chain.  The
+ * end of the chain is located once for the whole list.
+ *
+ * @return                      0 on success;
+ *                              BLE_HS_ENOMEM if the chain could not be
+ *                                  extended.  Whatever data fit remains
+ *                                  appended.
+ */
+int
+ble_hs_mbuf_append_iov(struct os_mbuf *om, const struct ble_hs_mbuf_iov *iov,
+                       int num_iovs)
+{
+    struct os_mbuf *last;
+    uint16_t left;
+    int i;
+
+    last = ble_hs_mbuf_last(om);
+
+    for (i = 0; i < num_iovs; i++) {
+        left = ble_hs_mbuf_append_at(&last, iov[i].data, iov[i].len);
+        if (OS_MBUF_IS_PKTHDR(om)) {
+            OS_MBUF_PKTLEN(om) += iov[i].len - left;
+        }
+        if (left != 0) {
+            return BLE_HS_ENOMEM;
+        }
+    }
+
+    return 0;
+}
@@ -24,12 +24,32 @@
 extern "C" {
 #endif
 
+#include <inttypes.h>
+
 struct os_mbuf;
 
+/**
+ * A contiguous run of packet data.  An array of these describes a
+ * scatter-gather list over one or more mbuf chains or flat buffers, letting
+ * callers walk a chain once and then copy or append the pieces
+ * without re-traversing the chain for every access.
+ */
+struct ble_hs_mbuf_iov {
+    uint8_t *data;
+    uint16_t len;
+};
+
 struct os_mbuf *ble_hs_mbuf_bare_pkt(void);
 struct os_mbuf *ble_hs_mbuf_acl_pkt(void);
 struct os_mbuf *ble_hs_mbuf_l2cap_pkt(void);
 int ble_hs_mbuf_pullup_base(struct os_mbuf **om, int base_len);
+int ble_hs_mbuf_iov_build(const struct os_mbuf *om, uint16_t off,
+                          uint16_t len, struct ble_hs_mbuf_iov *iov,
+                          int max_iovs, uint16_t *out_len);
+void ble_hs_mbuf_iov_copy(const struct ble_hs_mbuf_iov *iov, int num_iovs,
+                          void *dst);
+int ble_hs_mbuf_append_iov(struct os_mbuf *om,
+                           const struct ble_hs_mbuf_iov *iov, int num_iovs);
 
 #ifdef __cplusplus
 }
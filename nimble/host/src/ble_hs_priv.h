@@ -89,6 +89,8 @@ STATS_SECT_START(ble_hs_stats)
     STATS_SECT_ENTRY(sync)
     STATS_SECT_ENTRY(pvcy_add_entry)
     STATS_SECT_ENTRY(pvcy_add_entry_fail)
+    STATS_SECT_ENTRY(sm_key_pool_miss)
+    STATS_SECT_ENTRY(sm_key_rotate)
 STATS_SECT_END
 extern STATS_SECT_DECL(ble_hs_stats) ble_hs_stats;
 
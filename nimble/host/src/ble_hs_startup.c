@@ -250,6 +250,15 @@ ble_hs_startup_le_set_evmask_tx(void)
         mask |= 0x00000000000ff800;
     }
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    /**
+     * Enable the following LE events:
+     *   0x0000000000000080 LE Read Local P-256 Public Key Complete Event
+     *   0x0000000000000100 LE Generate DHKey Complete Event
+     */
+    mask |= 0x0000000000000180;
+#endif
+
 #if MYNEWT_VAL(BLE_PERIODIC_ADV_SYNC_TRANSFER)
     if (version >= BLE_HCI_VER_BCS_5_1) {
         /**
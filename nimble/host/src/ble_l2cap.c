@@ -179,6 +179,17 @@ ble_l2cap_get_chan_info(struct ble_l2cap_chan *chan, struct ble_l2cap_chan_info
     return 0;
 }
 
+int
+ble_l2cap_get_coc_stats(struct ble_l2cap_chan *chan,
+                        struct ble_l2cap_coc_stats *stats)
+{
+    if (!chan || !stats) {
+        return BLE_HS_EINVAL;
+    }
+
+    return ble_l2cap_coc_get_stats(chan, stats);
+}
+
 int
 ble_l2cap_enhanced_connect(uint16_t conn_handle,
                                uint16_t psm, uint16_t mtu,
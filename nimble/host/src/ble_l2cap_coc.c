@@ -182,6 +182,152 @@ ble_l2cap_event_coc_received_data(struct ble_l2cap_chan *chan,
     chan->cb(&event, chan->cb_arg);
 }
 
+static void
+ble_l2cap_coc_stats_rx_stall(struct ble_l2cap_chan *chan)
+{
+#if MYNEWT_VAL(BLE_L2CAP_COC_STATS)
+    if (!(chan->coc_rx.flags & BLE_L2CAP_COC_FLAG_STALLED)) {
+        chan->coc_rx.flags |= BLE_L2CAP_COC_FLAG_STALLED;
+        chan->coc_stats.rx_stall_start = ble_npl_time_get();
+        chan->coc_stats.rx_stalls++;
+    }
+#endif
+}
+
+static void
+ble_l2cap_coc_stats_tx_stall(struct ble_l2cap_chan *chan)
+{
+#if MYNEWT_VAL(BLE_L2CAP_COC_STATS)
+    if (!(chan->coc_tx.flags & BLE_L2CAP_COC_FLAG_STALLED)) {
+        chan->coc_stats.tx_stall_start = ble_npl_time_get();
+        chan->coc_stats.tx_stalls++;
+    }
+#endif
+}
+
+static void
+ble_l2cap_coc_stats_tx_unstall(struct ble_l2cap_chan *chan)
+{
+#if MYNEWT_VAL(BLE_L2CAP_COC_STATS)
+    chan->coc_stats.tx_stall_ticks +=
+        ble_npl_time_get() - chan->coc_stats.tx_stall_start;
+#endif
+}
+
+static void
+ble_l2cap_coc_stats_rx_credits(struct ble_l2cap_chan *chan, uint16_t credits)
+{
+#if MYNEWT_VAL(BLE_L2CAP_COC_STATS)
+    chan->coc_stats.rx_credits += credits;
+    if (chan->coc_rx.flags & BLE_L2CAP_COC_FLAG_STALLED) {
+        chan->coc_rx.flags &= ~BLE_L2CAP_COC_FLAG_STALLED;
+        chan->coc_stats.rx_stall_ticks +=
+            ble_npl_time_get() - chan->coc_stats.rx_stall_start;
+    }
+#endif
+}
+
+/* Sends credits accounted for under the host lock; must be called unlocked */
+static void
+ble_l2cap_coc_give_credits(struct ble_l2cap_chan *chan, uint16_t credits)
+{
+    if (credits > 0) {
+        ble_l2cap_sig_le_credits(chan->conn_handle, chan->scid, credits);
+    }
+}
+
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+/* Number of LE frames the SDU buffers owned by the endpoint can still absorb,
+ * assuming the peer fills frames up to our MPS.
+ */
+static uint16_t
+ble_l2cap_coc_rx_capacity(struct ble_l2cap_chan *chan)
+{
+    struct ble_l2cap_coc_endpoint *rx = &chan->coc_rx;
+    uint32_t cap;
+
+    if (rx->sdu_cnt == 0) {
+        return 0;
+    }
+
+    cap = (uint32_t)(rx->sdu_cnt - 1) * chan->initial_credits;
+    if (rx->sdu_frames < chan->initial_credits) {
+        cap += chan->initial_credits - rx->sdu_frames;
+    } else {
+        /* Peer is sending short frames, let it complete the SDU */
+        cap++;
+    }
+
+    return min(cap, UINT16_MAX);
+}
+
+/* Number of LE frames msys can take. Received frames are copied into the SDU
+ * buffers, so leave half of the free blocks for the rest of the stack.
+ */
+static uint16_t
+ble_l2cap_coc_rx_mem_budget(struct ble_l2cap_chan *chan)
+{
+    int blocks;
+
+    blocks = (chan->my_coc_mps + MYNEWT_VAL(MSYS_1_BLOCK_SIZE) - 1) /
+             MYNEWT_VAL(MSYS_1_BLOCK_SIZE);
+
+    return min(os_msys_num_free() / 2 / blocks, UINT16_MAX);
+}
+
+/* Called for every received LE frame. The window grows by one SDU whenever
+ * the peer drains it while there is buffer space left to refill it, and is
+ * halved when msys cannot back it. It never drops below one SDU, which is
+ * what is granted without auto-tuning.
+ */
+static void
+ble_l2cap_coc_rx_window_update(struct ble_l2cap_chan *chan)
+{
+    struct ble_l2cap_coc_endpoint *rx = &chan->coc_rx;
+    uint32_t max_window;
+
+    max_window = min((uint32_t)BLE_L2CAP_SDU_BUFF_CNT * chan->initial_credits,
+                     UINT16_MAX);
+
+    if (ble_l2cap_coc_rx_mem_budget(chan) < rx->window) {
+        rx->window = max(rx->window / 2, chan->initial_credits);
+    } else if (rx->credits == 0 && ble_l2cap_coc_rx_capacity(chan) > 0) {
+        rx->window = min(rx->window + chan->initial_credits, max_window);
+    }
+}
+
+/* Tops the peer up to the receive window. Updates are batched until half of
+ * the window has been consumed so that a busy channel does not generate one
+ * credits packet per received frame. Called with the host lock held; returns
+ * the number of credits to pass to ble_l2cap_coc_give_credits() once it is
+ * released.
+ */
+static uint16_t
+ble_l2cap_coc_rx_refill(struct ble_l2cap_chan *chan)
+{
+    struct ble_l2cap_coc_endpoint *rx = &chan->coc_rx;
+    uint16_t target;
+    uint16_t credits;
+
+    if (rx->credits > rx->window / 2) {
+        return 0;
+    }
+
+    target = min(rx->window, ble_l2cap_coc_rx_mem_budget(chan));
+    target = max(target, chan->initial_credits);
+    target = min(target, ble_l2cap_coc_rx_capacity(chan));
+    if (target <= rx->credits) {
+        return 0;
+    }
+
+    credits = target - rx->credits;
+    rx->credits = target;
+    ble_l2cap_coc_stats_rx_credits(chan, credits);
+
+    return credits;
+}
+#endif
+
 static int
 ble_l2cap_coc_rx_fn(struct ble_l2cap_chan *chan)
 {
@@ -190,6 +336,7 @@ ble_l2cap_coc_rx_fn(struct ble_l2cap_chan *chan)
     struct os_mbuf *rx_sdu;
     struct ble_l2cap_coc_endpoint *rx;
     uint16_t om_total;
+    uint16_t credits;
 
     /* Create a shortcut to rx_buf */
     om = &chan->rx_buf;
@@ -275,7 +422,17 @@ ble_l2cap_coc_rx_fn(struct ble_l2cap_chan *chan)
         }
     }
 
+    /* Credits are also topped up from ble_l2cap_coc_recv_ready() */
+    ble_hs_lock();
+
     rx->credits--;
+    if (rx->credits == 0) {
+        ble_l2cap_coc_stats_rx_stall(chan);
+    }
+
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+    rx->sdu_frames++;
+#endif
 
     if (OS_MBUF_PKTLEN(rx_sdu) == rx->data_offset) {
         struct os_mbuf *sdu_rx = rx_sdu;
@@ -283,6 +440,11 @@ ble_l2cap_coc_rx_fn(struct ble_l2cap_chan *chan)
         BLE_HS_LOG(DEBUG, "Received sdu_len=%d, credits left=%d\n",
                    OS_MBUF_PKTLEN(rx_sdu), rx->credits);
 
+#if MYNEWT_VAL(BLE_L2CAP_COC_STATS)
+        chan->coc_stats.rx_bytes += OS_MBUF_PKTLEN(rx_sdu);
+        chan->coc_stats.rx_sdus++;
+#endif
+
         /* Lets get back control to os_mbuf to application.
          * Since it this callback application might want to set new sdu
          * we need to prepare space for this. Therefore we need sdu_rx
@@ -292,23 +454,53 @@ ble_l2cap_coc_rx_fn(struct ble_l2cap_chan *chan)
             (chan->coc_rx.current_sdu_idx + 1) % BLE_L2CAP_SDU_BUFF_CNT;
         rx->data_offset = 0;
 
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+        if (rx->sdu_cnt > 0) {
+            rx->sdu_cnt--;
+        }
+        rx->sdu_frames = 0;
+
+        ble_l2cap_coc_rx_window_update(chan);
+        credits = ble_l2cap_coc_rx_refill(chan);
+#endif
+
+        ble_hs_unlock();
+
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+        /* Refill before handing the SDU over so that the peer can keep
+         * sending into the remaining buffers while the application handles it
+         */
+        ble_l2cap_coc_give_credits(chan, credits);
+#endif
+
         ble_l2cap_event_coc_received_data(chan, sdu_rx);
 
         return 0;
     }
 
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+    ble_l2cap_coc_rx_window_update(chan);
+    credits = ble_l2cap_coc_rx_refill(chan);
+#else
     /* If we did not received full SDU and credits are 0 it means
      * that remote was sending us not fully filled up LE frames.
      * However, we still have buffer to for next LE Frame so lets give one more
      * credit to peer so it can send us full SDU
      */
+    credits = 0;
     if (rx->credits == 0) {
         /* Remote did not send full SDU. Lets give him one more credits to do
          * so since we have still buffer to handle it
          */
         rx->credits = 1;
-        ble_l2cap_sig_le_credits(chan->conn_handle, chan->scid, rx->credits);
+        credits = rx->credits;
+        ble_l2cap_coc_stats_rx_credits(chan, credits);
     }
+#endif
+
+    ble_hs_unlock();
+
+    ble_l2cap_coc_give_credits(chan, credits);
 
     BLE_HS_LOG(DEBUG,
                "Received partial sdu_len=%d, credits left=%d, current_sdu_idx=%d\n",
@@ -327,6 +519,9 @@ ble_l2cap_coc_set_new_mtu_mps(struct ble_l2cap_chan *chan, uint16_t mtu,
     if (mtu % chan->my_coc_mps) {
         chan->initial_credits++;
     }
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+    chan->coc_rx.window = chan->initial_credits;
+#endif
 }
 
 struct ble_l2cap_chan *
@@ -369,6 +564,16 @@ ble_l2cap_coc_chan_alloc(struct ble_hs_conn *conn, uint16_t psm, uint16_t mtu,
     }
 
     chan->initial_credits = chan->coc_rx.credits;
+
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+    chan->coc_rx.sdu_cnt = sdu_rx != NULL;
+    chan->coc_rx.window = chan->initial_credits;
+#endif
+
+#if MYNEWT_VAL(BLE_L2CAP_COC_STATS)
+    chan->coc_stats.created = ble_npl_time_get();
+#endif
+
     return chan;
 }
 
@@ -448,6 +653,58 @@ ble_l2cap_event_coc_unstalled(struct ble_l2cap_chan *chan, int status)
     chan->cb(&event, chan->cb_arg);
 }
 
+/**
+ * Moves the first len bytes of an SDU to the end of a K-frame.  The SDU
+ * shrinks accordingly.  Whole mbufs are relinked into the K-frame rather than
+ * copied; only data held by the SDU packet header mbuf and by an mbuf
+ * straddling the K-frame boundary is copied.
+ */
+static int
+ble_l2cap_coc_sdu_move(struct os_mbuf *txom, struct os_mbuf *sdu,
+                       uint16_t len)
+{
+    struct os_mbuf *om;
+    uint16_t copy_len;
+    int rc;
+
+    copy_len = min(sdu->om_len, len);
+    if (copy_len) {
+        rc = os_mbuf_append(txom, sdu->om_data, copy_len);
+        if (rc) {
+            return BLE_HS_ENOMEM;
+        }
+
+        os_mbuf_adj(sdu, copy_len);
+        len -= copy_len;
+    }
+
+    while (len) {
+        om = SLIST_NEXT(sdu, om_next);
+        if (!om) {
+            return BLE_HS_EINVAL;
+        }
+
+        if (om->om_len > len) {
+            rc = os_mbuf_append(txom, om->om_data, len);
+            if (rc) {
+                return BLE_HS_ENOMEM;
+            }
+
+            os_mbuf_adj(sdu, len);
+            break;
+        }
+
+        SLIST_NEXT(sdu, om_next) = SLIST_NEXT(om, om_next);
+        SLIST_NEXT(om, om_next) = NULL;
+        OS_MBUF_PKTLEN(sdu) -= om->om_len;
+        len -= om->om_len;
+
+        os_mbuf_concat(txom, om);
+    }
+
+    return 0;
+}
+
 /* WARNING: this function is called from different task contexts. We expect the
  * host to be locked (ble_hs_lock()) before entering this function! */
 static int
@@ -474,7 +731,7 @@ ble_l2cap_coc_continue_tx(struct ble_l2cap_chan *chan)
         BLE_HS_LOG(DEBUG, "Available credits %d\n", tx->credits);
 
         /* lets calculate data we are going to send */
-        left_to_send = OS_MBUF_PKTLEN(tx->sdus[0]) - tx->data_offset;
+        left_to_send = OS_MBUF_PKTLEN(tx->sdus[0]);
 
         if (tx->data_offset == 0) {
             sdu_size_offset = BLE_L2CAP_SDU_SIZE;
@@ -510,10 +767,8 @@ ble_l2cap_coc_continue_tx(struct ble_l2cap_chan *chan)
          * that for first packet we need to decrease data size by 2 bytes for sdu
          * size
          */
-        rc = os_mbuf_appendfrom(txom, tx->sdus[0], tx->data_offset,
-                                len - sdu_size_offset);
+        rc = ble_l2cap_coc_sdu_move(txom, tx->sdus[0], len - sdu_size_offset);
         if (rc) {
-            rc = BLE_HS_ENOMEM;
             BLE_HS_LOG(DEBUG, "Could not append data rc=%d", rc);
             goto failed;
         }
@@ -536,11 +791,14 @@ ble_l2cap_coc_continue_tx(struct ble_l2cap_chan *chan)
         }
 
         BLE_HS_LOG(DEBUG, "Sent %d bytes, credits=%d, to send %d bytes \n",
-                   len, tx->credits,
-                   OS_MBUF_PKTLEN(tx->sdus[0]) - tx->data_offset);
+                   len, tx->credits, OS_MBUF_PKTLEN(tx->sdus[0]));
 
-        if (tx->data_offset == OS_MBUF_PKTLEN(tx->sdus[0])) {
+        if (OS_MBUF_PKTLEN(tx->sdus[0]) == 0) {
             BLE_HS_LOG(DEBUG, "Complete package sent\n");
+#if MYNEWT_VAL(BLE_L2CAP_COC_STATS)
+            chan->coc_stats.tx_bytes += tx->data_offset;
+            chan->coc_stats.tx_sdus++;
+#endif
             os_mbuf_free_chain(tx->sdus[0]);
             tx->sdus[0] = NULL;
             tx->data_offset = 0;
@@ -550,12 +808,14 @@ ble_l2cap_coc_continue_tx(struct ble_l2cap_chan *chan)
 
     if (tx->sdus[0]) {
         /* Not complete SDU sent, wait for credits */
+        ble_l2cap_coc_stats_tx_stall(chan);
         tx->flags |= BLE_L2CAP_COC_FLAG_STALLED;
         ble_hs_unlock();
         return BLE_HS_ESTALLED;
     }
 
     if (tx->flags & BLE_L2CAP_COC_FLAG_STALLED) {
+        ble_l2cap_coc_stats_tx_unstall(chan);
         tx->flags &= ~BLE_L2CAP_COC_FLAG_STALLED;
         ble_hs_unlock();
         ble_l2cap_event_coc_unstalled(chan, 0);
@@ -571,6 +831,7 @@ failed:
 
     os_mbuf_free_chain(txom);
     if (tx->flags & BLE_L2CAP_COC_FLAG_STALLED) {
+        ble_l2cap_coc_stats_tx_unstall(chan);
         tx->flags &= ~BLE_L2CAP_COC_FLAG_STALLED;
         ble_hs_unlock();
         ble_l2cap_event_coc_unstalled(chan, rc);
@@ -620,6 +881,7 @@ ble_l2cap_coc_recv_ready(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_rx)
 {
     struct ble_hs_conn *conn;
     struct ble_l2cap_chan *c;
+    uint16_t credits;
 
     if (!sdu_rx) {
         return BLE_HS_EINVAL;
@@ -636,6 +898,13 @@ ble_l2cap_coc_recv_ready(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_rx)
         (chan->coc_rx.next_sdu_alloc_idx + 1) % BLE_L2CAP_SDU_BUFF_CNT;
 
     ble_hs_lock();
+
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+    if (chan->coc_rx.sdu_cnt < BLE_L2CAP_SDU_BUFF_CNT) {
+        chan->coc_rx.sdu_cnt++;
+    }
+#endif
+
     conn = ble_hs_conn_find(chan->conn_handle);
     if (!conn) {
         BLE_HS_LOG(DEBUG, "Connection does not exist");
@@ -649,18 +918,25 @@ ble_l2cap_coc_recv_ready(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_rx)
         return BLE_HS_ENOENT;
     }
 
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+    credits = ble_l2cap_coc_rx_refill(c);
+    ble_hs_unlock();
+    ble_l2cap_coc_give_credits(c, credits);
+#else
     /* We want to back only that much credits which remote side is missing
      * to be able to send complete SDU.
      */
     if (chan->coc_rx.credits < c->initial_credits) {
+        credits = c->initial_credits - chan->coc_rx.credits;
+        ble_l2cap_coc_stats_rx_credits(c, credits);
         ble_hs_unlock();
-        ble_l2cap_sig_le_credits(chan->conn_handle, chan->scid,
-                                 c->initial_credits - chan->coc_rx.credits);
+        ble_l2cap_coc_give_credits(c, credits);
         ble_hs_lock();
         chan->coc_rx.credits = c->initial_credits;
     }
 
     ble_hs_unlock();
+#endif
 
     return 0;
 }
@@ -693,6 +969,60 @@ ble_l2cap_coc_send(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_tx)
     return ble_l2cap_coc_continue_tx(chan);
 }
 
+int
+ble_l2cap_coc_get_stats(struct ble_l2cap_chan *chan,
+                        struct ble_l2cap_coc_stats *stats)
+{
+#if MYNEWT_VAL(BLE_L2CAP_COC_STATS)
+    struct ble_l2cap_coc_chan_stats *cs;
+    ble_npl_time_t now;
+
+    cs = &chan->coc_stats;
+    now = ble_npl_time_get();
+
+    memset(stats, 0, sizeof(*stats));
+
+    ble_hs_lock();
+
+    stats->uptime_ms = ble_npl_time_ticks_to_ms32(now - cs->created);
+    stats->rx_bytes = cs->rx_bytes;
+    stats->rx_sdus = cs->rx_sdus;
+    stats->rx_credits = cs->rx_credits;
+    stats->rx_stalls = cs->rx_stalls;
+    stats->rx_stall_ms = ble_npl_time_ticks_to_ms32(cs->rx_stall_ticks);
+    if (chan->coc_rx.flags & BLE_L2CAP_COC_FLAG_STALLED) {
+        stats->rx_stall_ms +=
+            ble_npl_time_ticks_to_ms32(now - cs->rx_stall_start);
+    }
+    stats->tx_bytes = cs->tx_bytes;
+    stats->tx_sdus = cs->tx_sdus;
+    stats->tx_stalls = cs->tx_stalls;
+    stats->tx_stall_ms = ble_npl_time_ticks_to_ms32(cs->tx_stall_ticks);
+    if (chan->coc_tx.flags & BLE_L2CAP_COC_FLAG_STALLED) {
+        stats->tx_stall_ms +=
+            ble_npl_time_ticks_to_ms32(now - cs->tx_stall_start);
+    }
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+    stats->rx_window = chan->coc_rx.window;
+#else
+    stats->rx_window = chan->initial_credits;
+#endif
+
+    ble_hs_unlock();
+
+    if (stats->uptime_ms > 0) {
+        stats->rx_bytes_per_sec =
+            (uint64_t)stats->rx_bytes * 1000 / stats->uptime_ms;
+        stats->tx_bytes_per_sec =
+            (uint64_t)stats->tx_bytes * 1000 / stats->uptime_ms;
+    }
+
+    return 0;
+#else
+    return BLE_HS_ENOTSUP;
+#endif
+}
+
 int
 ble_l2cap_coc_init(void)
 {
@@ -24,6 +24,7 @@
 #include "syscfg/syscfg.h"
 #include "os/queue.h"
 #include "os/os_mbuf.h"
+#include "nimble/nimble_npl.h"
 #include "host/ble_l2cap.h"
 #include "ble_l2cap_sig_priv.h"
 #ifdef __cplusplus
@@ -46,7 +47,32 @@ struct ble_l2cap_coc_endpoint {
     uint16_t credits;
     uint16_t data_offset;
     uint8_t flags;
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+    /* RX only: number of SDU buffers owned by the endpoint */
+    uint8_t sdu_cnt;
+    /* RX only: LE frames received into the current SDU */
+    uint16_t sdu_frames;
+    /* RX only: auto-tuned receive window, in credits */
+    uint16_t window;
+#endif
+};
+
+#if MYNEWT_VAL(BLE_L2CAP_COC_STATS)
+struct ble_l2cap_coc_chan_stats {
+    ble_npl_time_t created;
+    ble_npl_time_t rx_stall_start;
+    ble_npl_time_t tx_stall_start;
+    ble_npl_time_t rx_stall_ticks;
+    ble_npl_time_t tx_stall_ticks;
+    uint32_t rx_bytes;
+    uint32_t rx_sdus;
+    uint32_t rx_credits;
+    uint32_t rx_stalls;
+    uint32_t tx_bytes;
+    uint32_t tx_sdus;
+    uint32_t tx_stalls;
 };
+#endif
 
 struct ble_l2cap_coc_srv {
     STAILQ_ENTRY(ble_l2cap_coc_srv) next;
@@ -74,6 +100,8 @@ int ble_l2cap_coc_recv_ready(struct ble_l2cap_chan *chan,
                              struct os_mbuf *sdu_rx);
 int ble_l2cap_coc_send(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_tx);
 void ble_l2cap_coc_set_new_mtu_mps(struct ble_l2cap_chan *chan, uint16_t mtu, uint16_t mps);
+int ble_l2cap_coc_get_stats(struct ble_l2cap_chan *chan,
+                            struct ble_l2cap_coc_stats *stats);
 #else
 static inline int
 ble_l2cap_coc_init(void) {
@@ -100,6 +128,12 @@ static inline int
 ble_l2cap_coc_send(struct ble_l2cap_chan *chan, struct os_mbuf *sdu_tx) {
     return BLE_HS_ENOTSUP;
 }
+
+static inline int
+ble_l2cap_coc_get_stats(struct ble_l2cap_chan *chan,
+                        struct ble_l2cap_coc_stats *stats) {
+    return BLE_HS_ENOTSUP;
+}
 #endif
 
 #ifdef __cplusplus
@@ -93,6 +93,9 @@ struct ble_l2cap_chan {
     uint16_t initial_credits;
     ble_l2cap_event_fn *cb;
     void *cb_arg;
+#if MYNEWT_VAL(BLE_L2CAP_COC_STATS)
+    struct ble_l2cap_coc_chan_stats coc_stats;
+#endif
 #endif
 };
 
@@ -413,6 +413,9 @@ ble_sm_proc_free(struct ble_sm_proc *proc)
 
     if (proc != NULL) {
         ble_sm_dbg_assert_not_inserted(proc);
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+        ble_sm_sc_proc_free(proc);
+#endif
 #if MYNEWT_VAL(BLE_HS_DEBUG)
         memset(proc, 0xff, sizeof *proc);
 #endif
@@ -651,6 +654,31 @@ ble_sm_proc_find(uint16_t conn_handle, uint8_t state, int is_initiator,
     return proc;
 }
 
+/**
+ * Searches the main proc list for the first entry which has any of the
+ * specified flags set.
+ *
+ * @param flags                 The flags to match against.
+ *
+ * @return                      The matching proc entry on success;
+ *                                  null on failure.
+ */
+struct ble_sm_proc *
+ble_sm_proc_find_flags(ble_sm_proc_flags flags)
+{
+    struct ble_sm_proc *proc;
+
+    BLE_HS_DBG_ASSERT(ble_hs_locked_by_cur_task());
+
+    STAILQ_FOREACH(proc, &ble_sm_procs, next) {
+        if (proc->flags & flags) {
+            break;
+        }
+    }
+
+    return proc;
+}
+
 static void
 ble_sm_insert(struct ble_sm_proc *proc)
 {
@@ -2517,6 +2545,7 @@ ble_sm_timer(void)
     struct ble_sm_proc_list exp_list;
     struct ble_sm_proc *proc;
     int32_t ticks_until_exp;
+    int32_t ticks;
 
     /* Remove timed-out procedures from the main list and insert them into a
      * temporary list.  This function also calculates the number of ticks until
@@ -2524,6 +2553,11 @@ ble_sm_timer(void)
      */
     ticks_until_exp = ble_sm_extract_expired(&exp_list);
 
+    ticks = ble_sm_sc_timer();
+    if (ticks < ticks_until_exp) {
+        ticks_until_exp = ticks;
+    }
+
     /* Notify application of each failure and free the corresponding procedure
      * object.
      * XXX: Mark connection as tainted; don't allow any subsequent SMP
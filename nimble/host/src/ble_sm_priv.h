@@ -216,6 +216,8 @@ struct ble_sm_dhkey_check {
 #define BLE_SM_PROC_F_AUTHENTICATED         0x08
 #define BLE_SM_PROC_F_SC                    0x10
 #define BLE_SM_PROC_F_BONDING               0x20
+#define BLE_SM_PROC_F_ECC_KEYS_WAIT         0x40
+#define BLE_SM_PROC_F_ECC_DHKEY             0x80
 
 #define BLE_SM_KE_F_ENC_INFO                0x01
 #define BLE_SM_KE_F_MASTER_ID               0x02
@@ -372,6 +374,15 @@ bool ble_sm_sc_oob_data_check(struct ble_sm_proc *proc,
                               bool oob_data_local_present,
                               bool oob_data_remote_present);
 void ble_sm_sc_oob_confirm(struct ble_sm_proc *proc, struct ble_sm_result *res);
+int32_t ble_sm_sc_timer(void);
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+void ble_sm_sc_proc_free(struct ble_sm_proc *proc);
+void ble_sm_sc_reset(void);
+void ble_sm_sc_rd_p256_pubkey_rx(
+    const struct ble_hci_ev_le_subev_rd_loc_p256_pubkey *ev);
+void ble_sm_sc_gen_dhkey_rx(
+    const struct ble_hci_ev_le_subev_gen_dhkey_complete *ev);
+#endif
 void ble_sm_sc_init(void);
 #else
 #define ble_sm_sc_io_action(proc, action) (BLE_HS_ENOTSUP)
@@ -382,6 +393,7 @@ void ble_sm_sc_init(void);
 #define ble_sm_sc_public_key_rx(conn_handle, op, om, res)
 #define ble_sm_sc_dhkey_check_exec(proc, res, arg)
 #define ble_sm_sc_dhkey_check_rx(conn_handle, op, om, res)
+#define ble_sm_sc_timer() BLE_HS_FOREVER
 #define ble_sm_sc_init()
 
 #endif
@@ -389,6 +401,7 @@ void ble_sm_sc_init(void);
 struct ble_sm_proc *ble_sm_proc_find(uint16_t conn_handle, uint8_t state,
                                      int is_initiator,
                                      struct ble_sm_proc **out_prev);
+struct ble_sm_proc *ble_sm_proc_find_flags(ble_sm_proc_flags flags);
 int ble_sm_gen_pair_rand(uint8_t *pair_rand);
 uint8_t *ble_sm_our_pair_rand(struct ble_sm_proc *proc);
 uint8_t *ble_sm_peer_pair_rand(struct ble_sm_proc *proc);
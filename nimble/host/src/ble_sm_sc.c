@@ -30,6 +30,13 @@
 #define BLE_SM_SC_PASSKEY_BYTES     4
 #define BLE_SM_SC_PASSKEY_BITS      20
 
+#define BLE_SM_SC_KEY_POOL_SIZE     MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE)
+#define BLE_SM_SC_KEY_ROTATE        (MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_PAIRINGS) > 0 || \
+                                     MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_TIME) > 0)
+
+/* How often a due key rotation is retried while procedures are active. */
+#define BLE_SM_SC_KEY_ROTATE_RETRY_MS   1000
+
 static uint8_t ble_sm_sc_pub_key[64];
 static uint8_t ble_sm_sc_priv_key[32];
 
@@ -39,6 +46,57 @@ static uint8_t ble_sm_sc_priv_key[32];
  */
 static uint8_t ble_sm_sc_keys_generated;
 
+#if BLE_SM_SC_KEY_POOL_SIZE > 0
+struct ble_sm_sc_key_pair {
+    uint8_t pub[64];
+    uint8_t priv[32];
+};
+
+/**
+ * Key pairs generated ahead of time so that adopting a new one does not
+ * stall pairing.  Refilled from ble_sm_sc_key_pool_ev, one pair per event,
+ * on the queue set with ble_sm_sc_key_pool_evq_set().
+ */
+static struct ble_sm_sc_key_pair ble_sm_sc_key_pool[BLE_SM_SC_KEY_POOL_SIZE];
+static uint8_t ble_sm_sc_key_pool_cnt;
+static struct ble_npl_event ble_sm_sc_key_pool_ev;
+static struct ble_npl_eventq *ble_sm_sc_key_pool_evq;
+#endif
+
+#if BLE_SM_SC_KEY_ROTATE
+/** Number of pairings the current key pair has been used for. */
+static uint16_t ble_sm_sc_key_uses;
+#if MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_TIME) > 0
+/** Time at which the current key pair is to be replaced. */
+static ble_npl_time_t ble_sm_sc_key_exp;
+#endif
+/** Replace the current key pair as soon as no procedure is using it. */
+static uint8_t ble_sm_sc_key_rotate_pending;
+
+/** OOB data computed over the current public key has been handed out. */
+#define BLE_SM_SC_KEY_PIN_OOB           0x01
+/** The current key pair was installed with ble_sm_dbg_set_sc_keys(). */
+#define BLE_SM_SC_KEY_PIN_DBG           0x02
+
+/** Reasons the current key pair must not be rotated (BLE_SM_SC_KEY_PIN_*). */
+static uint8_t ble_sm_sc_key_pins;
+#endif
+
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+/**
+ * Controller P-256 commands are issued one at a time from this event rather
+ * than from the PDU handlers; their results arrive as LE meta events.
+ */
+static struct ble_npl_event ble_sm_sc_ecc_ev;
+
+/** Whether a controller P-256 command is outstanding. */
+static uint8_t ble_sm_sc_ecc_busy;
+/** Whether our public key was asked for outside of a pairing procedure. */
+static uint8_t ble_sm_sc_ecc_key_wanted;
+/** Connection the outstanding LE Generate DHKey command belongs to. */
+static uint16_t ble_sm_sc_ecc_conn_handle;
+#endif
+
 /**
  * Create some shortened names for the passkey actions so that the table is
  * easier to read.
@@ -160,6 +218,9 @@ ble_sm_gen_pub_priv(uint8_t *pub, uint8_t *priv)
         ble_sm_dbg_sc_keys_set = 0;
         memcpy(pub, ble_sm_dbg_sc_pub_key, sizeof ble_sm_dbg_sc_pub_key);
         memcpy(priv, ble_sm_dbg_sc_priv_key, sizeof ble_sm_dbg_sc_priv_key);
+#if BLE_SM_SC_KEY_ROTATE
+        ble_sm_sc_key_pins |= BLE_SM_SC_KEY_PIN_DBG;
+#endif
         return 0;
     }
 #endif
@@ -172,26 +233,177 @@ ble_sm_gen_pub_priv(uint8_t *pub, uint8_t *priv)
     return 0;
 }
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+/**
+ * Whether P-256 operations are done by the controller.  That requires both
+ * LE Read Local P-256 Public Key and LE Generate DHKey to be supported;
+ * otherwise the host's software implementation is used.
+ */
+static bool
+ble_sm_sc_hci_ecc(void)
+{
+    struct ble_hs_hci_sup_cmd sup_cmd;
+
+    sup_cmd = ble_hs_hci_get_hci_supported_cmd();
+
+    /* Octet 34, bits 1 and 2. */
+    return (sup_cmd.commands[34] & 0x06) == 0x06;
+}
+
+static void
+ble_sm_sc_ecc_kick(void)
+{
+    ble_npl_eventq_put(ble_hs_evq_get(), &ble_sm_sc_ecc_ev);
+}
+#else
+#define ble_sm_sc_hci_ecc() (false)
+#define ble_sm_sc_ecc_kick()
+#endif
+
+#if BLE_SM_SC_KEY_POOL_SIZE > 0
+/**
+ * Starts refilling the key pool if it is not full.  Nothing is generated
+ * until the application has provided a queue to do it from, nor while the
+ * controller is doing the P-256 operations.
+ */
+static void
+ble_sm_sc_key_pool_fill(void)
+{
+    struct ble_npl_eventq *evq;
+
+    evq = ble_sm_sc_key_pool_evq;
+    if (evq != NULL && !ble_sm_sc_hci_ecc() &&
+        ble_sm_sc_key_pool_cnt < BLE_SM_SC_KEY_POOL_SIZE) {
+
+        ble_npl_eventq_put(evq, &ble_sm_sc_key_pool_ev);
+    }
+}
+
+static void
+ble_sm_sc_key_pool_event(struct ble_npl_event *ev)
+{
+    struct ble_sm_sc_key_pair kp;
+    uint32_t sr;
+    int rc;
+
+    if (ble_sm_sc_key_pool_cnt >= BLE_SM_SC_KEY_POOL_SIZE) {
+        return;
+    }
+
+    rc = ble_sm_alg_gen_key_pair(kp.pub, kp.priv);
+    if (rc != 0) {
+        return;
+    }
+
+    sr = ble_npl_hw_enter_critical();
+    if (ble_sm_sc_key_pool_cnt < BLE_SM_SC_KEY_POOL_SIZE) {
+        ble_sm_sc_key_pool[ble_sm_sc_key_pool_cnt++] = kp;
+    }
+    ble_npl_hw_exit_critical(sr);
+
+    /* One key pair per event so other events on the queue run in between. */
+    ble_sm_sc_key_pool_fill();
+}
+
+static int
+ble_sm_sc_key_pool_take(uint8_t *pub, uint8_t *priv)
+{
+    struct ble_sm_sc_key_pair *kp;
+    uint32_t sr;
+    int rc;
+
+#if MYNEWT_VAL(BLE_HS_DEBUG)
+    if (ble_sm_dbg_sc_keys_set) {
+        return BLE_HS_ENOENT;
+    }
+#endif
+
+    sr = ble_npl_hw_enter_critical();
+    if (ble_sm_sc_key_pool_cnt == 0) {
+        rc = BLE_HS_ENOENT;
+    } else {
+        kp = &ble_sm_sc_key_pool[--ble_sm_sc_key_pool_cnt];
+        memcpy(pub, kp->pub, sizeof kp->pub);
+        memcpy(priv, kp->priv, sizeof kp->priv);
+        memset(kp, 0, sizeof *kp);
+        rc = 0;
+    }
+    ble_npl_hw_exit_critical(sr);
+
+    if (rc != 0) {
+        STATS_INC(ble_hs_stats, sm_key_pool_miss);
+    }
+
+    ble_sm_sc_key_pool_fill();
+
+    return rc;
+}
+#endif
+
+#if BLE_SM_SC_KEY_ROTATE
+static void
+ble_sm_sc_key_adopted(void)
+{
+    ble_sm_sc_key_uses = 0;
+    ble_sm_sc_key_rotate_pending = 0;
+#if MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_TIME) > 0
+    ble_sm_sc_key_exp = ble_npl_time_get() +
+        ble_npl_time_ms_to_ticks32(MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_TIME) *
+                                   1000);
+    ble_hs_timer_resched();
+#endif
+}
+#endif
+
+/**
+ * Makes sure our public key is available.
+ *
+ * @return                      0 on success;
+ *                              BLE_HS_EAGAIN if the key is being read from
+ *                                  the controller;
+ *                              other nonzero on error.
+ */
 static int
 ble_sm_sc_ensure_keys_generated(void)
 {
     int rc;
 
     if (!ble_sm_sc_keys_generated) {
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+        if (ble_sm_sc_hci_ecc()) {
+            /* Picked up by ble_sm_sc_rd_p256_pubkey_rx(). */
+            ble_sm_sc_ecc_key_wanted = 1;
+            ble_sm_sc_ecc_kick();
+            return BLE_HS_EAGAIN;
+        }
+#endif
+
+#if BLE_SM_SC_KEY_POOL_SIZE > 0
+        rc = ble_sm_sc_key_pool_take(ble_sm_sc_pub_key, ble_sm_sc_priv_key);
+        if (rc != 0) {
+            rc = ble_sm_gen_pub_priv(ble_sm_sc_pub_key, ble_sm_sc_priv_key);
+        }
+#else
         rc = ble_sm_gen_pub_priv(ble_sm_sc_pub_key, ble_sm_sc_priv_key);
+#endif
         if (rc != 0) {
             return rc;
         }
 
         ble_sm_sc_keys_generated = 1;
+#if BLE_SM_SC_KEY_ROTATE
+        ble_sm_sc_key_adopted();
+#endif
     }
 
     BLE_HS_LOG(DEBUG, "our pubkey=");
     ble_hs_log_flat_buf(&ble_sm_sc_pub_key, 64);
     BLE_HS_LOG(DEBUG, "\n");
-    BLE_HS_LOG(DEBUG, "our privkey=");
-    ble_hs_log_flat_buf(&ble_sm_sc_priv_key, 32);
-    BLE_HS_LOG(DEBUG, "\n");
+    if (!ble_sm_sc_hci_ecc()) {
+        BLE_HS_LOG(DEBUG, "our privkey=");
+        ble_hs_log_flat_buf(&ble_sm_sc_priv_key, 32);
+        BLE_HS_LOG(DEBUG, "\n");
+    }
 
     return 0;
 }
@@ -267,6 +479,18 @@ ble_sm_sc_oob_confirm(struct ble_sm_proc *proc, struct ble_sm_result *res)
     bool match;
     uint8_t c[16];
 
+#if BLE_SM_SC_KEY_ROTATE
+    if (proc->oob_data_local != NULL &&
+        ble_sm_sc_key_pins & BLE_SM_SC_KEY_PIN_OOB) {
+
+        /* Our OOB data has been used; a due rotation can go ahead once this
+         * procedure is done.
+         */
+        ble_sm_sc_key_pins &= ~BLE_SM_SC_KEY_PIN_OOB;
+        ble_hs_timer_resched();
+    }
+#endif
+
     /* Authentication stage 1: Step 5 */
     if (proc->oob_data_remote) {
         err = ble_sm_alg_f4(proc->pub_key_peer.x, proc->pub_key_peer.x,
@@ -540,8 +764,14 @@ ble_sm_sc_public_key_exec(struct ble_sm_proc *proc, struct ble_sm_result *res,
     uint8_t ioact;
     int rc;
 
-    res->app_status = ble_sm_sc_ensure_keys_generated();
-    if (res->app_status != 0) {
+    rc = ble_sm_sc_ensure_keys_generated();
+    if (rc == BLE_HS_EAGAIN) {
+        /* Executed again once the key is available. */
+        proc->flags |= BLE_SM_PROC_F_ECC_KEYS_WAIT;
+        return;
+    }
+    if (rc != 0) {
+        res->app_status = rc;
         res->enc_cb = 1;
         res->sm_err = BLE_SM_ERR_UNSPECIFIED;
         return;
@@ -565,6 +795,13 @@ ble_sm_sc_public_key_exec(struct ble_sm_proc *proc, struct ble_sm_result *res,
         return;
     }
 
+#if MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_PAIRINGS) > 0
+    if (++ble_sm_sc_key_uses >= MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_PAIRINGS)) {
+        ble_sm_sc_key_rotate_pending = 1;
+        ble_hs_timer_resched();
+    }
+#endif
+
     if (!(proc->flags & BLE_SM_PROC_F_INITIATOR)) {
         if (proc->pair_alg == BLE_SM_PAIR_ALG_OOB) {
             proc->state = BLE_SM_PROC_STATE_RANDOM;
@@ -589,13 +826,49 @@ ble_sm_sc_public_key_exec(struct ble_sm_proc *proc, struct ble_sm_result *res,
     }
 }
 
+/**
+ * Advances a procedure whose DHKey has just been calculated.  Must be called
+ * with the host lock held.
+ */
+static void
+ble_sm_sc_public_key_advance(struct ble_sm_proc *proc,
+                             struct ble_sm_result *res)
+{
+    uint8_t ioact;
+    int rc;
+
+    if (proc->flags & BLE_SM_PROC_F_INITIATOR) {
+        if (proc->pair_alg == BLE_SM_PAIR_ALG_OOB) {
+            proc->state = BLE_SM_PROC_STATE_RANDOM;
+        } else {
+            proc->state = BLE_SM_PROC_STATE_CONFIRM;
+        }
+
+        rc = ble_sm_sc_io_action(proc, &ioact);
+        if (rc != 0) {
+            BLE_HS_DBG_ASSERT(0);
+        }
+
+        if (ble_sm_ioact_state(ioact) == proc->state) {
+            res->passkey_params.action = ioact;
+        }
+
+        if (ble_sm_proc_can_advance(proc) &&
+            ble_sm_sc_initiator_txes_confirm(proc)) {
+
+            res->execute = 1;
+        }
+    } else {
+        res->execute = 1;
+    }
+}
+
 void
 ble_sm_sc_public_key_rx(uint16_t conn_handle, struct os_mbuf **om,
                         struct ble_sm_result *res)
 {
     struct ble_sm_public_key *cmd;
     struct ble_sm_proc *proc;
-    uint8_t ioact;
     int rc;
 
     res->app_status = ble_hs_mbuf_pullup_base(om, sizeof(*cmd));
@@ -604,20 +877,26 @@ ble_sm_sc_public_key_rx(uint16_t conn_handle, struct os_mbuf **om,
         return;
     }
 
-    res->app_status = ble_sm_sc_ensure_keys_generated();
-    if (res->app_status != 0) {
-        res->enc_cb = 1;
-        res->sm_err = BLE_SM_ERR_UNSPECIFIED;
-        return;
-    }
-
     cmd = (struct ble_sm_public_key *)(*om)->om_data;
-    /* Check if the peer public key is same as our generated public key.
-     * Return fail if the public keys match. */
-    if (memcmp(cmd, ble_sm_sc_pub_key, 64) == 0) {
-        res->enc_cb = 1;
-        res->sm_err = BLE_SM_ERR_AUTHREQ;
-        return;
+
+    /* With controller ECC our key may not have been read yet; this check is
+     * done once it is, see ble_sm_sc_ecc_event().
+     */
+    if (!ble_sm_sc_hci_ecc()) {
+        res->app_status = ble_sm_sc_ensure_keys_generated();
+        if (res->app_status != 0) {
+            res->enc_cb = 1;
+            res->sm_err = BLE_SM_ERR_UNSPECIFIED;
+            return;
+        }
+
+        /* Check if the peer public key is same as our generated public key.
+         * Return fail if the public keys match. */
+        if (memcmp(cmd, ble_sm_sc_pub_key, 64) == 0) {
+            res->enc_cb = 1;
+            res->sm_err = BLE_SM_ERR_AUTHREQ;
+            return;
+        }
     }
 
     ble_hs_lock();
@@ -628,44 +907,301 @@ ble_sm_sc_public_key_rx(uint16_t conn_handle, struct os_mbuf **om,
         res->sm_err = BLE_SM_ERR_UNSPECIFIED;
     } else {
         memcpy(&proc->pub_key_peer, cmd, sizeof(*cmd));
-        rc = ble_sm_alg_gen_dhkey(proc->pub_key_peer.x,
-                                  proc->pub_key_peer.y,
-                                  ble_sm_sc_priv_key,
-                                  proc->dhkey);
-        if (rc != 0) {
-            res->app_status = BLE_HS_SM_US_ERR(BLE_SM_ERR_DHKEY);
-            res->sm_err = BLE_SM_ERR_DHKEY;
-            res->enc_cb = 1;
+        if (ble_sm_sc_hci_ecc()) {
+            /* The procedure stays in this state until the controller has
+             * calculated the DHKey; see ble_sm_sc_ecc_dhkey_complete().
+             */
+            proc->flags |= BLE_SM_PROC_F_ECC_DHKEY;
+            ble_sm_sc_ecc_kick();
         } else {
-            if (proc->flags & BLE_SM_PROC_F_INITIATOR) {
-                if (proc->pair_alg == BLE_SM_PAIR_ALG_OOB) {
-                    proc->state = BLE_SM_PROC_STATE_RANDOM;
-                } else {
-                    proc->state = BLE_SM_PROC_STATE_CONFIRM;
-                }
-
-                rc = ble_sm_sc_io_action(proc, &ioact);
-                if (rc != 0) {
-                        BLE_HS_DBG_ASSERT(0);
-                }
-
-                if (ble_sm_ioact_state(ioact) == proc->state) {
-                    res->passkey_params.action = ioact;
-                }
-
-                if (ble_sm_proc_can_advance(proc) &&
-                    ble_sm_sc_initiator_txes_confirm(proc)) {
-
-                    res->execute = 1;
-                }
+            rc = ble_sm_alg_gen_dhkey(proc->pub_key_peer.x,
+                                      proc->pub_key_peer.y,
+                                      ble_sm_sc_priv_key,
+                                      proc->dhkey);
+            if (rc != 0) {
+                res->app_status = BLE_HS_SM_US_ERR(BLE_SM_ERR_DHKEY);
+                res->sm_err = BLE_SM_ERR_DHKEY;
+                res->enc_cb = 1;
             } else {
-                res->execute = 1;
+                ble_sm_sc_public_key_advance(proc, res);
             }
         }
     }
     ble_hs_unlock();
 }
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+/**
+ * Feeds the result of a DHKey calculation back into the procedure's state
+ * machine.
+ *
+ * @param conn_handle           The connection the DHKey belongs to.
+ * @param dhkey                 The calculated DHKey (little endian); unused
+ *                                  if sm_err is nonzero.
+ * @param sm_err                0 on success; SM error code to fail the
+ *                                  procedure with otherwise.
+ */
+static void
+ble_sm_sc_ecc_dhkey_complete(uint16_t conn_handle, const uint8_t *dhkey,
+                             uint8_t sm_err)
+{
+    struct ble_sm_result res;
+    struct ble_sm_proc *proc;
+
+    memset(&res, 0, sizeof res);
+
+    ble_hs_lock();
+    proc = ble_sm_proc_find(conn_handle, BLE_SM_PROC_STATE_NONE, -1, NULL);
+    if (proc != NULL) {
+        if (!(proc->flags & BLE_SM_PROC_F_ECC_DHKEY) ||
+            proc->state != BLE_SM_PROC_STATE_PUBLIC_KEY) {
+            proc = NULL;
+        } else {
+            proc->flags &= ~BLE_SM_PROC_F_ECC_DHKEY;
+
+            if (sm_err != 0) {
+                res.app_status = BLE_HS_SM_US_ERR(sm_err);
+                res.sm_err = sm_err;
+                res.enc_cb = 1;
+            } else {
+                memcpy(proc->dhkey, dhkey, sizeof proc->dhkey);
+                ble_sm_sc_public_key_advance(proc, &res);
+            }
+        }
+    }
+    ble_hs_unlock();
+
+    if (proc != NULL) {
+        ble_sm_process_result(conn_handle, &res, true);
+    }
+}
+
+/**
+ * Fails every procedure which is waiting for a controller P-256 command.
+ */
+static void
+ble_sm_sc_ecc_fail_all(void)
+{
+    struct ble_sm_result res;
+    struct ble_sm_proc *proc;
+    uint16_t conn_handle;
+
+    while (1) {
+        ble_hs_lock();
+        proc = ble_sm_proc_find_flags(BLE_SM_PROC_F_ECC_KEYS_WAIT |
+                                      BLE_SM_PROC_F_ECC_DHKEY);
+        if (proc != NULL) {
+            proc->flags &= ~(BLE_SM_PROC_F_ECC_KEYS_WAIT |
+                             BLE_SM_PROC_F_ECC_DHKEY);
+            conn_handle = proc->conn_handle;
+        }
+        ble_hs_unlock();
+
+        if (proc == NULL) {
+            break;
+        }
+
+        memset(&res, 0, sizeof res);
+        res.app_status = BLE_HS_ECONTROLLER;
+        res.sm_err = BLE_SM_ERR_UNSPECIFIED;
+        res.enc_cb = 1;
+        ble_sm_process_result(conn_handle, &res, true);
+    }
+}
+
+static int
+ble_sm_sc_hci_rd_p256_pubkey(void)
+{
+    return ble_hs_hci_cmd_tx(BLE_HCI_OP(BLE_HCI_OGF_LE,
+                                        BLE_HCI_OCF_LE_RD_P256_PUBKEY),
+                             NULL, 0, NULL, 0);
+}
+
+static int
+ble_sm_sc_hci_gen_dhkey(const struct ble_sm_public_key *peer_key)
+{
+    struct ble_hci_le_gen_dhkey_cp cmd;
+
+    memcpy(cmd.pkey, peer_key->x, 32);
+    memcpy(cmd.pkey + 32, peer_key->y, 32);
+
+    return ble_hs_hci_cmd_tx(BLE_HCI_OP(BLE_HCI_OGF_LE,
+                                        BLE_HCI_OCF_LE_GEN_DHKEY),
+                             &cmd, sizeof(cmd), NULL, 0);
+}
+
+void
+ble_sm_sc_rd_p256_pubkey_rx(
+    const struct ble_hci_ev_le_subev_rd_loc_p256_pubkey *ev)
+{
+    struct ble_sm_result res;
+    struct ble_sm_proc *proc;
+    uint16_t conn_handle;
+
+    ble_sm_sc_ecc_busy = 0;
+    ble_sm_sc_ecc_key_wanted = 0;
+
+    if (ev->status != 0) {
+        ble_sm_sc_ecc_fail_all();
+        return;
+    }
+
+    /* Controller reports the key in the same byte order as the Pairing
+     * Public Key PDU.
+     */
+    memcpy(ble_sm_sc_pub_key, ev->public_key, sizeof ble_sm_sc_pub_key);
+    ble_sm_sc_keys_generated = 1;
+#if BLE_SM_SC_KEY_ROTATE
+    ble_sm_sc_key_adopted();
+#endif
+
+    /* Resume procedures which were waiting to send our public key. */
+    while (1) {
+        ble_hs_lock();
+        proc = ble_sm_proc_find_flags(BLE_SM_PROC_F_ECC_KEYS_WAIT);
+        if (proc != NULL) {
+            proc->flags &= ~BLE_SM_PROC_F_ECC_KEYS_WAIT;
+            conn_handle = proc->conn_handle;
+        }
+        ble_hs_unlock();
+
+        if (proc == NULL) {
+            break;
+        }
+
+        memset(&res, 0, sizeof res);
+        res.execute = 1;
+        ble_sm_process_result(conn_handle, &res, true);
+    }
+
+    ble_sm_sc_ecc_kick();
+}
+
+void
+ble_sm_sc_gen_dhkey_rx(const struct ble_hci_ev_le_subev_gen_dhkey_complete *ev)
+{
+    if (!ble_sm_sc_ecc_busy) {
+        return;
+    }
+
+    ble_sm_sc_ecc_busy = 0;
+
+    if (ev->status != 0) {
+        ble_sm_sc_ecc_dhkey_complete(ble_sm_sc_ecc_conn_handle, NULL,
+                                     BLE_SM_ERR_DHKEY);
+    } else {
+        ble_sm_sc_ecc_dhkey_complete(ble_sm_sc_ecc_conn_handle, ev->dh_key, 0);
+    }
+
+    ble_sm_sc_ecc_kick();
+}
+
+/**
+ * Called when a procedure is freed, e.g. on SM timeout or disconnect.  If the
+ * outstanding controller P-256 command was issued on its behalf, the command
+ * is given up on so that a controller which never answers does not stall
+ * the procedures queued behind it; a late Generate DHKey result is then
+ * ignored.
+ */
+void
+ble_sm_sc_proc_free(struct ble_sm_proc *proc)
+{
+    if (!ble_sm_sc_ecc_busy ||
+        !(proc->flags & (BLE_SM_PROC_F_ECC_KEYS_WAIT |
+                         BLE_SM_PROC_F_ECC_DHKEY))) {
+        return;
+    }
+
+    /* With the key pair known, the outstanding command is LE Generate DHKey
+     * for a single procedure; otherwise all waiters share the key read.
+     */
+    if (ble_sm_sc_keys_generated &&
+        proc->conn_handle != ble_sm_sc_ecc_conn_handle) {
+        return;
+    }
+
+    ble_sm_sc_ecc_busy = 0;
+    ble_sm_sc_ecc_kick();
+}
+
+void
+ble_sm_sc_reset(void)
+{
+    ble_sm_sc_ecc_busy = 0;
+    ble_sm_sc_ecc_key_wanted = 0;
+    ble_sm_sc_keys_generated = 0;
+#if BLE_SM_SC_KEY_ROTATE
+    /* The controller generates a new pair when we next read it. */
+    ble_sm_sc_key_pins = 0;
+#endif
+}
+
+static void
+ble_sm_sc_ecc_event(struct ble_npl_event *ev)
+{
+    struct ble_sm_public_key peer_key;
+    struct ble_sm_proc *proc;
+    uint16_t conn_handle;
+    int rc;
+
+    if (ble_sm_sc_ecc_busy) {
+        /* Kicked again on command completion. */
+        return;
+    }
+
+    if (!ble_sm_sc_keys_generated) {
+        ble_hs_lock();
+        proc = ble_sm_proc_find_flags(BLE_SM_PROC_F_ECC_KEYS_WAIT |
+                                      BLE_SM_PROC_F_ECC_DHKEY);
+        ble_hs_unlock();
+
+        if (proc != NULL || ble_sm_sc_ecc_key_wanted) {
+            rc = ble_sm_sc_hci_rd_p256_pubkey();
+            if (rc != 0) {
+                ble_sm_sc_ecc_key_wanted = 0;
+                ble_sm_sc_ecc_fail_all();
+            } else {
+                ble_sm_sc_ecc_busy = 1;
+            }
+        }
+        return;
+    }
+
+    ble_hs_lock();
+    proc = ble_sm_proc_find_flags(BLE_SM_PROC_F_ECC_DHKEY);
+    if (proc != NULL) {
+        conn_handle = proc->conn_handle;
+        peer_key = proc->pub_key_peer;
+    }
+    ble_hs_unlock();
+
+    if (proc == NULL) {
+        return;
+    }
+
+    /* Check if the peer public key is same as our generated public key.
+     * Fail if the public keys match.
+     */
+    if (memcmp(&peer_key, ble_sm_sc_pub_key, 64) == 0) {
+        ble_sm_sc_ecc_dhkey_complete(conn_handle, NULL, BLE_SM_ERR_AUTHREQ);
+        ble_sm_sc_ecc_kick();
+        return;
+    }
+
+    rc = ble_sm_sc_hci_gen_dhkey(&peer_key);
+    if (rc == 0) {
+        ble_sm_sc_ecc_busy = 1;
+        ble_sm_sc_ecc_conn_handle = conn_handle;
+        return;
+    }
+
+    ble_sm_sc_ecc_dhkey_complete(conn_handle, NULL, BLE_SM_ERR_DHKEY);
+
+    /* One command at a time; queue up the next pending procedure. */
+    ble_sm_sc_ecc_kick();
+}
+#endif
+
 static void
 ble_sm_sc_dhkey_addrs(struct ble_sm_proc *proc, ble_addr_t *our_addr,
                       ble_addr_t *peer_addr)
@@ -904,7 +1440,96 @@ ble_sm_sc_oob_generate_data(struct ble_sm_sc_oob_data *oob_data)
         return rc;
     }
 
+#if BLE_SM_SC_KEY_ROTATE
+    /* The peer checks c against our public key; keep it until the data has
+     * been used.
+     */
+    ble_hs_lock();
+    ble_sm_sc_key_pins |= BLE_SM_SC_KEY_PIN_OOB;
+    ble_hs_unlock();
+#endif
+
+    return 0;
+}
+
+int
+ble_sm_sc_key_pool_count(void)
+{
+#if BLE_SM_SC_KEY_POOL_SIZE > 0
+    return ble_sm_sc_key_pool_cnt;
+#else
     return 0;
+#endif
+}
+
+void
+ble_sm_sc_key_pool_evq_set(struct ble_npl_eventq *evq)
+{
+#if BLE_SM_SC_KEY_POOL_SIZE > 0
+    ble_sm_sc_key_pool_evq = evq;
+#endif
+}
+
+/**
+ * Refills the key pool and replaces our key pair when it is due.  The pair
+ * is only replaced while no SM procedure is active, so a procedure never
+ * sees its key change underneath it, and not while OOB data computed over
+ * it is outstanding or it was installed for debugging.
+ *
+ * @return                      The number of ticks until this function
+ *                                  should be called again.
+ */
+int32_t
+ble_sm_sc_timer(void)
+{
+    int32_t ticks_until_exp;
+#if MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_TIME) > 0
+    ble_npl_stime_t diff;
+#endif
+
+    ticks_until_exp = BLE_HS_FOREVER;
+
+#if BLE_SM_SC_KEY_POOL_SIZE > 0
+    ble_sm_sc_key_pool_fill();
+#endif
+
+#if BLE_SM_SC_KEY_ROTATE
+    ble_hs_lock();
+
+    if (ble_sm_sc_keys_generated) {
+#if MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_TIME) > 0
+        diff = ble_sm_sc_key_exp - ble_npl_time_get();
+        if (diff <= 0) {
+            ble_sm_sc_key_rotate_pending = 1;
+        } else {
+            ticks_until_exp = diff;
+        }
+#endif
+
+        if (ble_sm_sc_key_pins != 0) {
+            /* Rotation resumes once the pair is released; see
+             * ble_sm_sc_oob_confirm().
+             */
+            ticks_until_exp = BLE_HS_FOREVER;
+        } else if (ble_sm_sc_key_rotate_pending) {
+            if (ble_sm_num_procs() == 0) {
+                /* Next pairing adopts a new pair, from the pool if any. */
+                ble_sm_sc_keys_generated = 0;
+                ble_sm_sc_key_rotate_pending = 0;
+                memset(ble_sm_sc_priv_key, 0, sizeof ble_sm_sc_priv_key);
+                STATS_INC(ble_hs_stats, sm_key_rotate);
+                ticks_until_exp = BLE_HS_FOREVER;
+            } else {
+                ticks_until_exp =
+                    ble_npl_time_ms_to_ticks32(BLE_SM_SC_KEY_ROTATE_RETRY_MS);
+            }
+        }
+    }
+
+    ble_hs_unlock();
+#endif
+
+    return ticks_until_exp;
 }
 
 void
@@ -912,6 +1537,26 @@ ble_sm_sc_init(void)
 {
     ble_sm_alg_ecc_init();
     ble_sm_sc_keys_generated = 0;
+
+#if MYNEWT_VAL(BLE_HS_DEBUG)
+    ble_sm_dbg_sc_keys_set = 0;
+#endif
+
+#if BLE_SM_SC_KEY_ROTATE
+    ble_sm_sc_key_uses = 0;
+    ble_sm_sc_key_rotate_pending = 0;
+    ble_sm_sc_key_pins = 0;
+#endif
+
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    ble_npl_event_init(&ble_sm_sc_ecc_ev, ble_sm_sc_ecc_event, NULL);
+    ble_sm_sc_ecc_busy = 0;
+    ble_sm_sc_ecc_key_wanted = 0;
+#endif
+
+#if BLE_SM_SC_KEY_POOL_SIZE > 0
+    ble_npl_event_init(&ble_sm_sc_key_pool_ev, ble_sm_sc_key_pool_event, NULL);
+#endif
 }
 
 #endif  /* MYNEWT_VAL(BLE_SM_SC) */
@@ -19,7 +19,9 @@
 
 #include <stddef.h>
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include "testutil/testutil.h"
 #include "nimble/hci_common.h"
 #include "ble_hs_test.h"
@@ -2123,6 +2125,138 @@ TEST_CASE_SELF(ble_att_svr_test_unsupported_req)
     ble_att_svr_test_assert_mbufs_freed();
 }
 
+TEST_CASE_SELF(ble_att_svr_test_find_by_handle)
+{
+    static ble_uuid16_t uuids[32];
+    struct ble_att_svr_entry *entry;
+    uint16_t handles[32];
+    uint16_t conn_handle;
+    int rc;
+    int i;
+
+    conn_handle = ble_att_svr_test_misc_init(0);
+
+    for (i = 0; i < 32; i++) {
+        uuids[i] = (ble_uuid16_t) BLE_UUID16_INIT(0x2a00 + i);
+        rc = ble_att_svr_register(&uuids[i].u, HA_FLAG_PERM_RW, 0,
+                                  &handles[i],
+                                  ble_att_svr_test_misc_attr_fn_r_1, NULL);
+        TEST_ASSERT_FATAL(rc == 0);
+        if (i > 0) {
+            TEST_ASSERT_FATAL(handles[i] == handles[i - 1] + 1);
+        }
+    }
+
+    /*** Every registered attribute is found by its own handle. */
+    for (i = 0; i < 32; i++) {
+        entry = ble_att_svr_find_by_handle(handles[i]);
+        TEST_ASSERT_FATAL(entry != NULL);
+        TEST_ASSERT(entry->ha_handle_id == handles[i]);
+        TEST_ASSERT(ble_uuid_cmp(entry->ha_uuid, &uuids[i].u) == 0);
+    }
+
+    /*** Unregistered handles are not found. */
+    TEST_ASSERT(ble_att_svr_find_by_handle(0) == NULL);
+    TEST_ASSERT(ble_att_svr_find_by_handle(handles[31] + 1) == NULL);
+    TEST_ASSERT(ble_att_svr_find_by_handle(0xffff) == NULL);
+
+    /*** Hidden attributes are not found. */
+    ble_att_svr_hide_range(handles[8], handles[15]);
+    for (i = 0; i < 32; i++) {
+        entry = ble_att_svr_find_by_handle(handles[i]);
+        if (i >= 8 && i <= 15) {
+            TEST_ASSERT(entry == NULL);
+        } else {
+            TEST_ASSERT(entry != NULL && entry->ha_handle_id == handles[i]);
+        }
+    }
+
+    /*** Discovery skips the hidden range. */
+    rc = ble_hs_test_util_rx_att_find_info_req(conn_handle, BLE_L2CAP_CID_ATT,
+                                               handles[8], handles[16]);
+    TEST_ASSERT(rc == 0);
+    ble_hs_test_util_verify_tx_find_info_rsp(
+        ((struct ble_hs_test_util_att_info_entry[]) { {
+            .handle = handles[16],
+            .uuid = BLE_UUID16_DECLARE(0x2a10),
+        }, {
+            .handle = 0,
+        } }));
+
+    /*** Restored attributes are found again. */
+    ble_att_svr_restore_range(handles[8], handles[15]);
+    for (i = 0; i < 32; i++) {
+        entry = ble_att_svr_find_by_handle(handles[i]);
+        TEST_ASSERT(entry != NULL && entry->ha_handle_id == handles[i]);
+    }
+
+    ble_att_svr_test_assert_mbufs_freed();
+}
+
+TEST_CASE_SELF(ble_att_svr_test_hidden_group)
+{
+    uint16_t conn_handle;
+    int rc;
+
+    conn_handle = ble_att_svr_test_misc_init(128);
+
+    ble_att_svr_test_misc_register_group_attrs();
+
+    /*** Hide the second 16-bit service (6 to 10). */
+    ble_att_svr_hide_range(6, 10);
+
+    /*** First service ends at its last visible attribute. */
+    rc = ble_hs_test_util_rx_att_read_group_type_req16(
+        conn_handle, 1, 100, BLE_ATT_UUID_PRIMARY_SERVICE);
+    TEST_ASSERT(rc == 0);
+    ble_hs_test_util_verify_tx_read_group_type_rsp(
+        ((struct ble_hs_test_util_att_group_type_entry[]) { {
+            .start_handle = 1,
+            .end_handle = 5,
+            .uuid = BLE_UUID16_DECLARE(0x1122),
+        }, {
+            .start_handle = 0,
+        } }));
+
+    /*** Hidden service is not found. */
+    rc = ble_hs_test_util_rx_att_find_type_value_req(
+        conn_handle, 1, 100, BLE_ATT_UUID_PRIMARY_SERVICE,
+        ((uint8_t[]){ 0x33, 0x22 }), 2);
+    TEST_ASSERT(rc != 0);
+    ble_hs_test_util_verify_tx_err_rsp(
+        BLE_ATT_OP_FIND_TYPE_VALUE_REQ, 1,
+        BLE_ATT_ERR_ATTR_NOT_FOUND);
+
+    /*** Restored service is found again. */
+    ble_att_svr_restore_range(6, 10);
+
+    rc = ble_hs_test_util_rx_att_find_type_value_req(
+        conn_handle, 1, 100, BLE_ATT_UUID_PRIMARY_SERVICE,
+        ((uint8_t[]){ 0x33, 0x22 }), 2);
+    TEST_ASSERT(rc == 0);
+    ble_att_svr_test_misc_verify_tx_find_type_value_rsp(
+        ((struct ble_att_svr_test_type_value_entry[]) { {
+            .first = 6,
+            .last = 10,
+        }, {
+            .first = 0,
+        } }));
+
+    rc = ble_hs_test_util_rx_att_read_group_type_req16(
+        conn_handle, 2, 100, BLE_ATT_UUID_PRIMARY_SERVICE);
+    TEST_ASSERT(rc == 0);
+    ble_hs_test_util_verify_tx_read_group_type_rsp(
+        ((struct ble_hs_test_util_att_group_type_entry[]) { {
+            .start_handle = 6,
+            .end_handle = 10,
+            .uuid = BLE_UUID16_DECLARE(0x2233),
+        }, {
+            .start_handle = 0,
+        } }));
+
+    ble_att_svr_test_assert_mbufs_freed();
+}
+
 TEST_SUITE(ble_att_svr_suite)
 {
     ble_att_svr_test_mtu();
@@ -2140,4 +2274,76 @@ TEST_SUITE(ble_att_svr_suite)
     ble_att_svr_test_indicate();
     ble_att_svr_test_oom();
     ble_att_svr_test_unsupported_req();
+    ble_att_svr_test_find_by_handle();
+    ble_att_svr_test_hidden_group();
+}
+
+#define BLE_ATT_SVR_TEST_BENCH_ATTRS    256
+#define BLE_ATT_SVR_TEST_BENCH_LOOKUPS  1000000
+#define BLE_ATT_SVR_TEST_BENCH_REQS     20000
+
+/*
+ * Attribute lookup benchmark, run only when the test binary is given the
+ * "bench" argument.  Times handle lookups spread over a large attribute
+ * table, as done for every read and write request, and Find Information
+ * requests for the last few attributes of the table.
+ */
+void
+ble_att_svr_test_find_bench(void)
+{
+    static ble_uuid16_t uuid = BLE_UUID16_INIT(0x2a00);
+    struct ble_hs_test_util_hci_num_completed_pkts_entry ncpe[2];
+    struct ble_att_svr_entry *entry;
+    uint16_t conn_handle;
+    uint16_t last;
+    clock_t start;
+    double find_ns;
+    double info_us;
+    int rc;
+    int i;
+
+    conn_handle = ble_att_svr_test_misc_init(0);
+
+    ble_att_svr_reset();
+    ble_hs_max_attrs = BLE_ATT_SVR_TEST_BENCH_ATTRS;
+    rc = ble_att_svr_start();
+    TEST_ASSERT_FATAL(rc == 0);
+
+    for (i = 0; i < BLE_ATT_SVR_TEST_BENCH_ATTRS; i++) {
+        rc = ble_att_svr_register(&uuid.u, HA_FLAG_PERM_RW, 0, &last,
+                                  ble_att_svr_test_misc_attr_fn_r_1, NULL);
+        TEST_ASSERT_FATAL(rc == 0);
+    }
+
+    start = clock();
+    for (i = 0; i < BLE_ATT_SVR_TEST_BENCH_LOOKUPS; i++) {
+        entry = ble_att_svr_find_by_handle(1 + i % last);
+        TEST_ASSERT_FATAL(entry != NULL);
+    }
+    find_ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 /
+              BLE_ATT_SVR_TEST_BENCH_LOOKUPS;
+
+    /* Each response goes out in two 20-byte fragments; hand the controller
+     * buffers back so that responses do not pile up in the host.
+     */
+    ncpe[0].handle_id = conn_handle;
+    ncpe[0].num_pkts = 2;
+    ncpe[1].handle_id = 0;
+
+    start = clock();
+    for (i = 0; i < BLE_ATT_SVR_TEST_BENCH_REQS; i++) {
+        rc = ble_hs_test_util_rx_att_find_info_req(conn_handle,
+                                                   BLE_L2CAP_CID_ATT,
+                                                   last - 3, last);
+        TEST_ASSERT_FATAL(rc == 0);
+        ble_hs_test_util_prev_tx_queue_clear();
+        ble_hs_test_util_hci_rx_num_completed_pkts_event(ncpe);
+    }
+    TEST_ASSERT_FATAL(ble_hs_hci_avail_pkts > 0);
+    info_us = (double)(clock() - start) / CLOCKS_PER_SEC * 1e6 /
+              BLE_ATT_SVR_TEST_BENCH_REQS;
+
+    printf("att svr (%d attributes)\n", BLE_ATT_SVR_TEST_BENCH_ATTRS);
+    printf("  find by handle %6.1f ns  find info (tail) %6.2f us\n",
+           find_ns, info_us);
 }
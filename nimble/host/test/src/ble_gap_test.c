@@ -17,8 +17,10 @@
  * under the License.
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 #include "testutil/testutil.h"
 #include "nimble/ble.h"
 #include "nimble/hci_common.h"
@@ -836,6 +838,340 @@ TEST_CASE_SELF(ble_gap_test_case_disc_busy)
     ble_hs_test_util_assert_mbufs_freed(NULL);
 }
 
+#define BLE_GAP_TEST_DISC_RPT_MAX   8
+
+static struct ble_gap_disc_desc ble_gap_test_disc_rpts[BLE_GAP_TEST_DISC_RPT_MAX];
+static uint8_t ble_gap_test_disc_rpt_data[BLE_GAP_TEST_DISC_RPT_MAX][31];
+static int ble_gap_test_disc_num_rpts;
+static int ble_gap_test_disc_num_events;
+
+static void
+ble_gap_test_util_disc_rec(const struct ble_gap_disc_desc *desc)
+{
+    int idx;
+
+    idx = ble_gap_test_disc_num_rpts++;
+    TEST_ASSERT_FATAL(idx < BLE_GAP_TEST_DISC_RPT_MAX);
+    TEST_ASSERT_FATAL(desc->length_data <=
+                      sizeof ble_gap_test_disc_rpt_data[idx]);
+
+    /* Report data is only valid for the duration of the callback. */
+    ble_gap_test_disc_rpts[idx] = *desc;
+    memcpy(ble_gap_test_disc_rpt_data[idx], desc->data, desc->length_data);
+    ble_gap_test_disc_rpts[idx].data = ble_gap_test_disc_rpt_data[idx];
+}
+
+static int
+ble_gap_test_util_disc_rec_cb(struct ble_gap_event *event, void *arg)
+{
+    int i;
+
+    switch (event->type) {
+    case BLE_GAP_EVENT_DISC:
+        ble_gap_test_util_disc_rec(&event->disc);
+        break;
+
+    case BLE_GAP_EVENT_DISC_BATCH:
+        for (i = 0; i < event->disc_batch.num_descs; i++) {
+            ble_gap_test_util_disc_rec(event->disc_batch.descs + i);
+        }
+        break;
+
+    default:
+        TEST_ASSERT_FATAL(0);
+        break;
+    }
+
+    ble_gap_test_disc_num_events++;
+
+    return 0;
+}
+
+/* Feeds a recorded stream of advertising report HCI events (1, 3 and 2
+ * reports per event) through the host and verifies what reaches the
+ * discovery callback.
+ */
+static void
+ble_gap_test_util_disc_rpt_stream(int batch)
+{
+    static const uint8_t data1[] = { 0x02, 0x01, 0x06 };
+    static const uint8_t data2[] = { 0x03, 0x03, 0x0f, 0x18 };
+    static const struct ble_gap_disc_desc rpts[] = {
+        { BLE_HCI_ADV_TYPE_ADV_IND, 3, { BLE_ADDR_PUBLIC, { 1, 2, 3, 4, 5, 6 } },
+          -40, data1 },
+        { BLE_HCI_ADV_TYPE_ADV_NONCONN_IND, 0,
+          { BLE_ADDR_RANDOM, { 7, 8, 9, 10, 11, 0xc0 } }, -50, data1 },
+        { BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP, 4,
+          { BLE_ADDR_PUBLIC, { 1, 2, 3, 4, 5, 6 } }, -41, data2 },
+        { BLE_HCI_ADV_TYPE_ADV_SCAN_IND, 3,
+          { BLE_ADDR_RANDOM, { 6, 5, 4, 3, 2, 0xc1 } }, -90, data1 },
+        { BLE_HCI_ADV_TYPE_ADV_IND, 4,
+          { BLE_ADDR_PUBLIC, { 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff } }, -60,
+          data2 },
+        { BLE_HCI_ADV_TYPE_ADV_IND, 0,
+          { BLE_ADDR_PUBLIC, { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 } }, -70,
+          data2 },
+    };
+    static const struct ble_gap_disc_params disc_params = { 0 };
+    int rc;
+    int i;
+
+    ble_gap_test_util_init();
+
+    memset(ble_gap_test_disc_rpts, 0, sizeof ble_gap_test_disc_rpts);
+    ble_gap_test_disc_num_rpts = 0;
+    ble_gap_test_disc_num_events = 0;
+
+    if (batch) {
+        rc = ble_gap_disc_set_batch(1);
+        TEST_ASSERT_FATAL(rc == 0);
+    }
+
+    rc = ble_hs_test_util_disc(BLE_OWN_ADDR_PUBLIC, BLE_HS_FOREVER,
+                               &disc_params, ble_gap_test_util_disc_rec_cb,
+                               NULL, -1, 0);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    ble_hs_test_util_hci_rx_adv_rpt_event(rpts, 1);
+    ble_hs_test_util_hci_rx_adv_rpt_event(rpts + 1, 3);
+    ble_hs_test_util_hci_rx_adv_rpt_event(rpts + 4, 2);
+
+    TEST_ASSERT(ble_gap_test_disc_num_events == (batch ? 3 : 6));
+    TEST_ASSERT_FATAL(ble_gap_test_disc_num_rpts == 6);
+
+    for (i = 0; i < 6; i++) {
+        TEST_ASSERT(ble_gap_test_disc_rpts[i].event_type ==
+                    rpts[i].event_type);
+        TEST_ASSERT(ble_addr_cmp(&ble_gap_test_disc_rpts[i].addr,
+                                 &rpts[i].addr) == 0);
+        TEST_ASSERT(ble_addr_cmp(&ble_gap_test_disc_rpts[i].direct_addr,
+                                 BLE_ADDR_ANY) == 0);
+        TEST_ASSERT(ble_gap_test_disc_rpts[i].rssi == rpts[i].rssi);
+        TEST_ASSERT(ble_gap_test_disc_rpts[i].length_data ==
+                    rpts[i].length_data);
+        TEST_ASSERT(memcmp(ble_gap_test_disc_rpts[i].data, rpts[i].data,
+                           rpts[i].length_data) == 0);
+    }
+
+    if (batch) {
+        ble_gap_disc_set_batch(0);
+    }
+}
+
+TEST_CASE_SELF(ble_gap_test_case_disc_rpt_stream)
+{
+    ble_gap_test_util_disc_rpt_stream(0);
+#if !MYNEWT_VAL(BLE_EXT_ADV)
+    ble_gap_test_util_disc_rpt_stream(1);
+#endif
+
+    ble_hs_test_util_assert_mbufs_freed(NULL);
+}
+
+TEST_CASE_SELF(ble_gap_test_case_disc_dir_rpt)
+{
+    static const struct ble_gap_disc_params disc_params = { 0 };
+    static const ble_addr_t addrs[] = {
+        { BLE_ADDR_RANDOM, { 1, 2, 3, 4, 5, 0x40 } },
+        { BLE_ADDR_PUBLIC, { 6, 5, 4, 3, 2, 1 } },
+    };
+    static const ble_addr_t dir_addrs[] = {
+        { BLE_ADDR_RANDOM, { 7, 8, 9, 10, 11, 0x40 } },
+        { BLE_ADDR_RANDOM, { 1, 2, 3, 4, 5, 0xc0 } },
+    };
+    static const int8_t rssis[] = { -45, -80 };
+    uint8_t buf[sizeof(struct ble_hci_ev) +
+                sizeof(struct ble_hci_ev_le_subev_direct_adv_rpt) +
+                2 * sizeof(struct dir_adv_report)];
+    struct ble_hci_ev *ev;
+    int off;
+    int rc;
+    int i;
+
+    ble_gap_test_util_init();
+
+    memset(ble_gap_test_disc_rpts, 0, sizeof ble_gap_test_disc_rpts);
+    ble_gap_test_disc_num_rpts = 0;
+    ble_gap_test_disc_num_events = 0;
+
+    rc = ble_hs_test_util_disc(BLE_OWN_ADDR_PUBLIC, BLE_HS_FOREVER,
+                               &disc_params, ble_gap_test_util_disc_rec_cb,
+                               NULL, -1, 0);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    buf[0] = BLE_HCI_EVCODE_LE_META;
+    buf[2] = BLE_HCI_LE_SUBEV_DIRECT_ADV_RPT;
+    buf[3] = 2;
+
+    off = 4;
+    for (i = 0; i < 2; i++) {
+        buf[off++] = BLE_HCI_ADV_RPT_EVTYPE_DIR_IND;
+        buf[off++] = addrs[i].type;
+        memcpy(buf + off, addrs[i].val, 6);
+        off += 6;
+        buf[off++] = dir_addrs[i].type;
+        memcpy(buf + off, dir_addrs[i].val, 6);
+        off += 6;
+        buf[off++] = rssis[i];
+    }
+    TEST_ASSERT_FATAL(off == sizeof buf);
+    buf[1] = off - sizeof(struct ble_hci_ev);
+
+    /*** Well-formed event; both reports delivered. */
+    ble_hs_test_util_hci_rx_evt(buf);
+
+    TEST_ASSERT_FATAL(ble_gap_test_disc_num_rpts == 2);
+    for (i = 0; i < 2; i++) {
+        TEST_ASSERT(ble_gap_test_disc_rpts[i].event_type ==
+                    BLE_HCI_ADV_RPT_EVTYPE_DIR_IND);
+        TEST_ASSERT(ble_addr_cmp(&ble_gap_test_disc_rpts[i].addr,
+                                 addrs + i) == 0);
+        TEST_ASSERT(ble_addr_cmp(&ble_gap_test_disc_rpts[i].direct_addr,
+                                 dir_addrs + i) == 0);
+        TEST_ASSERT(ble_gap_test_disc_rpts[i].rssi == rssis[i]);
+        TEST_ASSERT(ble_gap_test_disc_rpts[i].length_data == 0);
+    }
+
+    /*** Event one byte short of its report count; rejected. */
+    buf[1]--;
+    ev = (void *)ble_transport_alloc_evt(1);
+    TEST_ASSERT_FATAL(ev != NULL);
+    memcpy(ev, buf, sizeof buf - 1);
+    rc = ble_hs_hci_evt_process(ev);
+    TEST_ASSERT(rc == BLE_HS_ECONTROLLER);
+    TEST_ASSERT(ble_gap_test_disc_num_rpts == 2);
+
+    ble_hs_test_util_assert_mbufs_freed(NULL);
+}
+
+#define BLE_GAP_TEST_BENCH_EVENTS   512
+#define BLE_GAP_TEST_BENCH_ROUNDS   32
+
+static int ble_gap_test_bench_num_rpts;
+
+static int
+ble_gap_test_util_bench_cb(struct ble_gap_event *event, void *arg)
+{
+    if (event->type == BLE_GAP_EVENT_DISC_BATCH) {
+        ble_gap_test_bench_num_rpts += event->disc_batch.num_descs;
+    } else {
+        ble_gap_test_bench_num_rpts++;
+    }
+
+    return 0;
+}
+
+/*
+ * Advertising report benchmark, run only when the test binary is given the
+ * "bench" argument.  Replays a fixed stream of legacy advertising report
+ * events, shaped like a busy scan (one to four reports per event, mixed data
+ * lengths and address types, generated from a constant seed so every run
+ * sees the same bytes), through the HCI event path and prints the average
+ * host cost per report in per-report and batched delivery modes.
+ */
+void
+ble_gap_test_disc_rpt_bench(void)
+{
+    static uint8_t stream[BLE_GAP_TEST_BENCH_EVENTS]
+                         [sizeof(struct ble_hci_ev) + UINT8_MAX];
+    static const struct ble_gap_disc_params disc_params = { 0 };
+    uint32_t seed;
+    clock_t start;
+    double ns;
+    int num_rpts;
+    int batch;
+    int round;
+    int off;
+    int len;
+    int rc;
+    int i;
+    int j;
+    int k;
+
+    /* Build the stream once, outside the timed loop. */
+    seed = 0x2545f491;
+    num_rpts = 0;
+    for (i = 0; i < BLE_GAP_TEST_BENCH_EVENTS; i++) {
+        stream[i][0] = BLE_HCI_EVCODE_LE_META;
+        stream[i][2] = BLE_HCI_LE_SUBEV_ADV_RPT;
+        off = 4;
+
+        seed = seed * 1103515245 + 12345;
+        stream[i][3] = 1 + (seed >> 16) % 4;
+        for (j = 0; j < stream[i][3]; j++) {
+            seed = seed * 1103515245 + 12345;
+            len = (seed >> 16) % 32;
+
+            stream[i][off++] = (seed >> 8) % 2 ? BLE_HCI_ADV_TYPE_ADV_IND :
+                                                 BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP;
+            stream[i][off++] = seed % 2 ? BLE_ADDR_RANDOM : BLE_ADDR_PUBLIC;
+            for (k = 0; k < 6; k++) {
+                stream[i][off++] = seed >> (k * 4);
+            }
+
+            /* Well-formed AD structure: manufacturer data padded to len. */
+            stream[i][off++] = len;
+            if (len >= 2) {
+                stream[i][off++] = len - 1;
+                stream[i][off++] = BLE_HS_ADV_TYPE_MFG_DATA;
+                for (k = 2; k < len; k++) {
+                    stream[i][off++] = k;
+                }
+            } else {
+                for (k = 0; k < len; k++) {
+                    stream[i][off++] = 0;
+                }
+            }
+            stream[i][off++] = -40 - (seed >> 24) % 50;
+        }
+        stream[i][1] = off - sizeof(struct ble_hci_ev);
+        num_rpts += stream[i][3];
+    }
+
+    printf("mode         events  reports  ns/report\n");
+
+    for (batch = 0; batch < 2; batch++) {
+#if MYNEWT_VAL(BLE_EXT_ADV)
+        if (batch) {
+            break;
+        }
+#endif
+        ble_gap_test_util_init();
+
+        if (batch) {
+            rc = ble_gap_disc_set_batch(1);
+            TEST_ASSERT_FATAL(rc == 0);
+        }
+
+        rc = ble_hs_test_util_disc(BLE_OWN_ADDR_PUBLIC, BLE_HS_FOREVER,
+                                   &disc_params, ble_gap_test_util_bench_cb,
+                                   NULL, -1, 0);
+        TEST_ASSERT_FATAL(rc == 0);
+
+        ble_gap_test_bench_num_rpts = 0;
+
+        start = clock();
+        for (round = 0; round < BLE_GAP_TEST_BENCH_ROUNDS; round++) {
+            for (i = 0; i < BLE_GAP_TEST_BENCH_EVENTS; i++) {
+                ble_hs_test_util_hci_rx_evt(stream[i]);
+            }
+        }
+        ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 /
+             (num_rpts * BLE_GAP_TEST_BENCH_ROUNDS);
+
+        TEST_ASSERT(ble_gap_test_bench_num_rpts ==
+                    num_rpts * BLE_GAP_TEST_BENCH_ROUNDS);
+
+        printf("%-10s  %7d  %7d  %9.1f\n", batch ? "batched" : "per-report",
+               BLE_GAP_TEST_BENCH_EVENTS * BLE_GAP_TEST_BENCH_ROUNDS,
+               num_rpts * BLE_GAP_TEST_BENCH_ROUNDS, ns);
+
+        if (batch) {
+            ble_gap_disc_set_batch(0);
+        }
+    }
+}
+
 TEST_SUITE(ble_gap_test_suite_disc)
 {
     ble_gap_test_case_disc_bad_args();
@@ -845,6 +1181,8 @@ TEST_SUITE(ble_gap_test_suite_disc)
     ble_gap_test_case_disc_dflts();
     ble_gap_test_case_disc_already();
     ble_gap_test_case_disc_busy();
+    ble_gap_test_case_disc_rpt_stream();
+    ble_gap_test_case_disc_dir_rpt();
 }
 
 /*****************************************************************************
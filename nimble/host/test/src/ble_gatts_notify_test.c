@@ -73,6 +73,11 @@ ble_gatts_notify_test_events[BLE_GATTS_NOTIFY_TEST_MAX_EVENTS];
 
 static int ble_gatts_notify_test_num_events;
 
+/* If nonzero, the next notify_tx event marks this characteristic as updated
+ * from within the GAP callback.
+ */
+static uint16_t ble_gatts_notify_test_nested_update;
+
 typedef int ble_store_write_fn(int obj_type, const union ble_store_value *val);
 
 typedef int ble_store_delete_fn(int obj_type, const union ble_store_key *key);
@@ -80,6 +85,8 @@ typedef int ble_store_delete_fn(int obj_type, const union ble_store_key *key);
 static int
 ble_gatts_notify_test_util_gap_event(struct ble_gap_event *event, void *arg)
 {
+    uint16_t attr_handle;
+
     switch (event->type) {
     case BLE_GAP_EVENT_NOTIFY_TX:
     case BLE_GAP_EVENT_SUBSCRIBE:
@@ -89,6 +96,14 @@ ble_gatts_notify_test_util_gap_event(struct ble_gap_event *event, void *arg)
         ble_gatts_notify_test_events[ble_gatts_notify_test_num_events++] =
             *event;
 
+        if (event->type == BLE_GAP_EVENT_NOTIFY_TX &&
+            ble_gatts_notify_test_nested_update != 0) {
+
+            attr_handle = ble_gatts_notify_test_nested_update;
+            ble_gatts_notify_test_nested_update = 0;
+            ble_gatts_chr_updated(attr_handle);
+        }
+
     default:
         break;
     }
@@ -1071,6 +1086,176 @@ TEST_CASE_SELF(ble_gatts_notify_test_disallowed)
     ble_hs_test_util_assert_mbufs_freed(NULL);
 }
 
+static void
+ble_gatts_notify_test_misc_mark_modified(uint16_t conn_handle)
+{
+    struct ble_hs_conn *conn;
+    int i;
+
+    ble_hs_lock();
+    conn = ble_hs_conn_find(conn_handle);
+    TEST_ASSERT_FATAL(conn != NULL);
+    for (i = 0; i < conn->bhc_gatt_svr.num_clt_cfgs; i++) {
+        conn->bhc_gatt_svr.clt_cfgs[i].flags |= BLE_GATTS_CLT_CFG_F_MODIFIED;
+    }
+    ble_hs_unlock();
+}
+
+static void
+ble_gatts_notify_test_misc_verify_tx_mult(uint16_t conn_handle)
+{
+    struct os_mbuf *om;
+    uint8_t *data;
+
+    om = ble_hs_test_util_prev_tx_dequeue_pullup();
+    TEST_ASSERT_FATAL(om != NULL);
+    TEST_ASSERT_FATAL(om->om_len == 1 + 4 + ble_gatts_notify_test_chr_1_len +
+                                    4 + ble_gatts_notify_test_chr_2_len);
+
+    data = om->om_data;
+    TEST_ASSERT(data[0] == BLE_ATT_OP_NOTIFY_MULTI_REQ);
+    data++;
+
+    TEST_ASSERT(get_le16(data) == ble_gatts_notify_test_chr_1_def_handle + 1);
+    TEST_ASSERT(get_le16(data + 2) == ble_gatts_notify_test_chr_1_len);
+    TEST_ASSERT(memcmp(data + 4, ble_gatts_notify_test_chr_1_val,
+                       ble_gatts_notify_test_chr_1_len) == 0);
+    data += 4 + ble_gatts_notify_test_chr_1_len;
+
+    TEST_ASSERT(get_le16(data) == ble_gatts_notify_test_chr_2_def_handle + 1);
+    TEST_ASSERT(get_le16(data + 2) == ble_gatts_notify_test_chr_2_len);
+    TEST_ASSERT(memcmp(data + 4, ble_gatts_notify_test_chr_2_val,
+                       ble_gatts_notify_test_chr_2_len) == 0);
+
+    ble_gatts_notify_test_util_verify_tx_event(
+        conn_handle, ble_gatts_notify_test_chr_1_def_handle + 1, 0, 0);
+    ble_gatts_notify_test_util_verify_tx_event(
+        conn_handle, ble_gatts_notify_test_chr_2_def_handle + 1, 0, 0);
+}
+
+TEST_CASE_SELF(ble_gatts_notify_test_mult_peers)
+{
+    static const uint16_t conn_handles[] = { 2, 3, 4 };
+    struct ble_hs_conn *conn;
+    uint16_t conn_handle;
+    int mult_sup;
+    int i;
+
+    ble_hs_test_util_init();
+    ble_gatts_notify_test_num_events = 0;
+
+    ble_hs_test_util_reg_svcs(ble_gatts_notify_test_svcs,
+                              ble_gatts_notify_test_misc_reg_cb,
+                              NULL);
+
+    /* Three subscribers to both characteristics; only the first two support
+     * Multiple Handle Value Notifications.
+     */
+    for (i = 0; i < sizeof conn_handles / sizeof conn_handles[0]; i++) {
+        ble_hs_test_util_create_conn(conn_handles[i],
+                                     ((uint8_t[]){ 2, 3, 4, 5, 6, 7 + i }),
+                                     ble_gatts_notify_test_util_gap_event,
+                                     NULL);
+
+        ble_gatts_notify_test_misc_enable_notify(
+            conn_handles[i], ble_gatts_notify_test_chr_1_def_handle,
+            BLE_GATTS_CLT_CFG_F_NOTIFY);
+        ble_gatts_notify_test_misc_enable_notify(
+            conn_handles[i], ble_gatts_notify_test_chr_2_def_handle,
+            BLE_GATTS_CLT_CFG_F_NOTIFY);
+
+        if (i < 2) {
+            ble_hs_lock();
+            conn = ble_hs_conn_find(conn_handles[i]);
+            TEST_ASSERT_FATAL(conn != NULL);
+            conn->bhc_gatt_svr.peer_cl_sup_feat[0] |= 0x04;
+            ble_hs_unlock();
+        }
+    }
+    ble_gatts_notify_test_num_events = 0;
+    ble_hs_test_util_prev_tx_queue_clear();
+
+    ble_gatts_notify_test_chr_1_len = 4;
+    memcpy(ble_gatts_notify_test_chr_1_val, ((uint8_t[]){ 1, 2, 3, 4 }), 4);
+    ble_gatts_notify_test_chr_2_len = 6;
+    memcpy(ble_gatts_notify_test_chr_2_val,
+           ((uint8_t[]){ 10, 11, 12, 13, 14, 15 }), 6);
+
+    /* Both values change before the next notification pass. */
+    for (i = 0; i < sizeof conn_handles / sizeof conn_handles[0]; i++) {
+        ble_gatts_notify_test_misc_mark_modified(conn_handles[i]);
+    }
+    ble_gatts_tx_notifications();
+
+    /* Each peer gets exactly one batch; peers are visited in connection list
+     * order, so identify them from the first notify_tx event of the batch.
+     */
+    for (i = 0; i < sizeof conn_handles / sizeof conn_handles[0]; i++) {
+        TEST_ASSERT_FATAL(ble_gatts_notify_test_num_events > 0);
+        TEST_ASSERT_FATAL(ble_gatts_notify_test_events[0].type ==
+                          BLE_GAP_EVENT_NOTIFY_TX);
+        conn_handle = ble_gatts_notify_test_events[0].notify_tx.conn_handle;
+
+        mult_sup = conn_handle != conn_handles[2];
+        if (mult_sup) {
+            ble_gatts_notify_test_misc_verify_tx_mult(conn_handle);
+        } else {
+            ble_gatts_notify_test_misc_verify_tx_gen(conn_handle, 1,
+                                                     BLE_GATTS_CLT_CFG_F_NOTIFY);
+            ble_gatts_notify_test_misc_verify_tx_gen(conn_handle, 2,
+                                                     BLE_GATTS_CLT_CFG_F_NOTIFY);
+        }
+    }
+
+    TEST_ASSERT(ble_gatts_notify_test_num_events == 0);
+    TEST_ASSERT(ble_hs_test_util_prev_tx_dequeue() == NULL);
+
+    /* Nothing is left pending for any peer. */
+    ble_gatts_tx_notifications();
+    TEST_ASSERT(ble_hs_test_util_prev_tx_dequeue() == NULL);
+
+    ble_hs_test_util_assert_mbufs_freed(NULL);
+}
+
+TEST_CASE_SELF(ble_gatts_notify_test_nested)
+{
+    uint16_t conn_handle;
+
+    ble_gatts_notify_test_misc_init(&conn_handle, 0,
+                                    BLE_GATTS_CLT_CFG_F_NOTIFY,
+                                    BLE_GATTS_CLT_CFG_F_NOTIFY);
+
+    ble_gatts_notify_test_chr_1_len = 1;
+    ble_gatts_notify_test_chr_1_val[0] = 0x5a;
+    ble_gatts_notify_test_chr_2_len = 2;
+    ble_gatts_notify_test_chr_2_val[0] = 0xa5;
+    ble_gatts_notify_test_chr_2_val[1] = 0x5a;
+
+    /* Characteristic 2 is updated from the notify_tx callback for
+     * characteristic 1, i.e., while the notification pass is running.
+     */
+    ble_gatts_notify_test_nested_update =
+        ble_gatts_notify_test_chr_2_def_handle + 1;
+    ble_gatts_chr_updated(ble_gatts_notify_test_chr_1_def_handle + 1);
+
+    /* Both notifications go out, in order. */
+    ble_gatts_notify_test_misc_verify_tx_n(
+        conn_handle,
+        ble_gatts_notify_test_chr_1_def_handle + 1,
+        ble_gatts_notify_test_chr_1_val,
+        ble_gatts_notify_test_chr_1_len);
+    ble_gatts_notify_test_misc_verify_tx_n(
+        conn_handle,
+        ble_gatts_notify_test_chr_2_def_handle + 1,
+        ble_gatts_notify_test_chr_2_val,
+        ble_gatts_notify_test_chr_2_len);
+
+    TEST_ASSERT(ble_gatts_notify_test_num_events == 0);
+    TEST_ASSERT(ble_hs_test_util_prev_tx_dequeue() == NULL);
+
+    ble_hs_test_util_assert_mbufs_freed(NULL);
+}
+
 TEST_SUITE(ble_gatts_notify_suite)
 {
     ble_gatts_notify_test_n();
@@ -1083,6 +1268,10 @@ TEST_SUITE(ble_gatts_notify_suite)
 
     ble_gatts_notify_test_disallowed();
 
+    ble_gatts_notify_test_mult_peers();
+
+    ble_gatts_notify_test_nested();
+
     /* XXX: Test corner cases:
      *     o Bonding after CCCD configuration.
      *     o Disconnect prior to rx of indicate ack.
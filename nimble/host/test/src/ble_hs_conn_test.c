@@ -19,7 +19,9 @@
 
 #include <stddef.h>
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include "testutil/testutil.h"
 #include "nimble/hci_common.h"
 #include "host/ble_hs_adv.h"
@@ -216,9 +218,95 @@ TEST_CASE_SELF(ble_hs_conn_test_undirect_connectable_success)
     ble_hs_test_util_assert_mbufs_freed(NULL);
 }
 
+TEST_CASE_SELF(ble_hs_conn_test_find_colliding_handles)
+{
+    struct ble_hs_conn *conn;
+    uint8_t peer_addr[6] = { 1, 2, 3, 4, 5, 0 };
+    uint16_t handle;
+    int i;
+
+    ble_hs_test_util_init();
+
+    /* Pick handles that all hash to the same bucket. */
+    for (i = 0; i < MYNEWT_VAL(BLE_MAX_CONNECTIONS); i++) {
+        handle = 1 + i * MYNEWT_VAL(BLE_MAX_CONNECTIONS);
+        peer_addr[5] = i;
+        ble_hs_test_util_create_conn(handle, peer_addr, NULL, NULL);
+    }
+
+    ble_hs_lock();
+    for (i = 0; i < MYNEWT_VAL(BLE_MAX_CONNECTIONS); i++) {
+        handle = 1 + i * MYNEWT_VAL(BLE_MAX_CONNECTIONS);
+        conn = ble_hs_conn_find(handle);
+        TEST_ASSERT_FATAL(conn != NULL);
+        TEST_ASSERT(conn->bhc_handle == handle);
+        TEST_ASSERT(conn->bhc_peer_addr.val[5] == i);
+    }
+    TEST_ASSERT(ble_hs_conn_find(0) == NULL);
+    TEST_ASSERT(ble_hs_conn_find(2) == NULL);
+    ble_hs_unlock();
+
+    /* Remove a connection from the middle of the bucket. */
+    handle = 1 + MYNEWT_VAL(BLE_MAX_CONNECTIONS);
+    ble_hs_test_util_conn_disconnect(handle);
+
+    ble_hs_lock();
+    TEST_ASSERT(ble_hs_conn_find(handle) == NULL);
+    for (i = 0; i < MYNEWT_VAL(BLE_MAX_CONNECTIONS); i++) {
+        if (i == 1) {
+            continue;
+        }
+        handle = 1 + i * MYNEWT_VAL(BLE_MAX_CONNECTIONS);
+        conn = ble_hs_conn_find(handle);
+        TEST_ASSERT_FATAL(conn != NULL);
+        TEST_ASSERT(conn->bhc_handle == handle);
+    }
+    ble_hs_unlock();
+}
+
 TEST_SUITE(ble_hs_conn_suite)
 {
     ble_hs_conn_test_direct_connect_success();
     ble_hs_conn_test_direct_connectable_success();
     ble_hs_conn_test_undirect_connectable_success();
+    ble_hs_conn_test_find_colliding_handles();
+}
+
+#define BLE_HS_CONN_TEST_BENCH_LOOKUPS  1000000
+
+/*
+ * Connection lookup benchmark, run only when the test binary is given the
+ * "bench" argument.  All connections are up, with sequential handles as
+ * controllers assign them, and are looked up in turn as interleaved ACL
+ * traffic would.
+ */
+void
+ble_hs_conn_test_find_bench(void)
+{
+    uint8_t peer_addr[6] = { 1, 2, 3, 4, 5, 0 };
+    struct ble_hs_conn *conn;
+    clock_t start;
+    double ns;
+    int i;
+
+    ble_hs_test_util_init();
+
+    for (i = 0; i < MYNEWT_VAL(BLE_MAX_CONNECTIONS); i++) {
+        peer_addr[5] = i;
+        ble_hs_test_util_create_conn(1 + i, peer_addr, NULL, NULL);
+    }
+
+    ble_hs_lock();
+    start = clock();
+    for (i = 0; i < BLE_HS_CONN_TEST_BENCH_LOOKUPS; i++) {
+        conn = ble_hs_conn_find(1 + i % MYNEWT_VAL(BLE_MAX_CONNECTIONS));
+        TEST_ASSERT_FATAL(conn != NULL);
+    }
+    ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 /
+         BLE_HS_CONN_TEST_BENCH_LOOKUPS;
+    ble_hs_unlock();
+
+    printf("conn find (ns per lookup, %d connections)\n",
+           MYNEWT_VAL(BLE_MAX_CONNECTIONS));
+    printf("  %6.1f\n", ns);
 }
@@ -19,7 +19,9 @@
 
 #include <stddef.h>
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include "nimble/hci_common.h"
 #include "nimble/transport.h"
 #include "ble_hs_test.h"
@@ -340,3 +342,56 @@ TEST_SUITE(ble_hs_hci_suite)
     ble_hs_hci_acl_one_conn();
     ble_hs_hci_acl_two_conn();
 }
+
+#define BLE_HS_HCI_TEST_BENCH_ROUNDS    2000
+
+/*
+ * Startup and connection setup benchmark, run only when the test binary is
+ * given the "bench" argument.  Prints the number of HCI commands the host
+ * sends and the average host time spent on them; with the acks answered
+ * inline this excludes controller and transport latency, which add one round
+ * trip per command.
+ */
+void
+ble_hs_hci_test_startup_bench(void)
+{
+    static const uint8_t peer_addr[6] = { 1, 2, 3, 4, 5, 6 };
+    double startup_us;
+    double conn_us;
+    clock_t elapsed;
+    clock_t start;
+    int num_cmds;
+    int rc;
+    int i;
+
+    elapsed = 0;
+    for (i = 0; i < BLE_HS_HCI_TEST_BENCH_ROUNDS; i++) {
+        ble_hs_test_util_init_no_start();
+
+        start = clock();
+        rc = ble_hs_start();
+        elapsed += clock() - start;
+
+        TEST_ASSERT_FATAL(rc == 0);
+    }
+    startup_us = (double)elapsed / CLOCKS_PER_SEC * 1e6 /
+                 BLE_HS_HCI_TEST_BENCH_ROUNDS;
+    num_cmds = ble_hs_test_util_hci_startup_seq_cnt();
+
+    ble_hs_test_util_init();
+
+    elapsed = 0;
+    for (i = 0; i < BLE_HS_HCI_TEST_BENCH_ROUNDS; i++) {
+        start = clock();
+        ble_hs_test_util_create_conn(2, peer_addr, NULL, NULL);
+        elapsed += clock() - start;
+
+        ble_hs_test_util_conn_disconnect(2);
+    }
+    conn_us = (double)elapsed / CLOCKS_PER_SEC * 1e6 /
+              BLE_HS_HCI_TEST_BENCH_ROUNDS;
+
+    printf("procedure   cmds  host us\n");
+    printf("startup     %4d  %7.2f\n", num_cmds, startup_us);
+    printf("connect     %4d  %7.2f\n", 1, conn_us);
+}
@@ -0,0 +1,280 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "testutil/testutil.h"
+#include "ble_hs_test.h"
+#include "ble_hs_test_util.h"
+
+#define BLE_HS_MBUF_TEST_BLOCK_SIZE     96
+#define BLE_HS_MBUF_TEST_BLOCK_COUNT    128
+#define BLE_HS_MBUF_TEST_SEG_LEN        16
+#define BLE_HS_MBUF_TEST_MAX_CHAIN      16
+#define BLE_HS_MBUF_TEST_MAX_LEN        \
+    (BLE_HS_MBUF_TEST_MAX_CHAIN * BLE_HS_MBUF_TEST_SEG_LEN)
+
+static os_membuf_t ble_hs_mbuf_test_mem[
+    OS_MEMPOOL_SIZE(BLE_HS_MBUF_TEST_BLOCK_COUNT,
+                    BLE_HS_MBUF_TEST_BLOCK_SIZE)
+];
+static struct os_mempool ble_hs_mbuf_test_mempool;
+static struct os_mbuf_pool ble_hs_mbuf_test_mbuf_pool;
+
+/*****************************************************************************
+ * $util                                                                     *
+ *****************************************************************************/
+
+static void
+ble_hs_mbuf_test_util_init(int num_blocks)
+{
+    int rc;
+
+    rc = os_mempool_init(&ble_hs_mbuf_test_mempool, num_blocks,
+                         BLE_HS_MBUF_TEST_BLOCK_SIZE, ble_hs_mbuf_test_mem,
+                         "ble_hs_mbuf_test");
+    TEST_ASSERT_FATAL(rc == 0);
+
+    rc = os_mbuf_pool_init(&ble_hs_mbuf_test_mbuf_pool,
+                           &ble_hs_mbuf_test_mempool,
+                           BLE_HS_MBUF_TEST_BLOCK_SIZE, num_blocks);
+    TEST_ASSERT_FATAL(rc == 0);
+}
+
+static void
+ble_hs_mbuf_test_util_assert_freed(void)
+{
+    TEST_ASSERT(ble_hs_mbuf_test_mempool.mp_num_free ==
+                ble_hs_mbuf_test_mempool.mp_num_blocks);
+}
+
+/**
+ * Builds a packet of num_mbufs mbufs with irregular segment lengths.  The
+ * packet's contents are also written to flat.
+ */
+static struct os_mbuf *
+ble_hs_mbuf_test_util_chain(int num_mbufs, uint8_t first, uint8_t *flat,
+                            uint16_t *out_len)
+{
+    struct os_mbuf *prev;
+    struct os_mbuf *om;
+    struct os_mbuf *cur;
+    uint16_t seg_len;
+    uint16_t len;
+    int i;
+    int j;
+
+    om = os_mbuf_get_pkthdr(&ble_hs_mbuf_test_mbuf_pool, 0);
+    TEST_ASSERT_FATAL(om != NULL);
+
+    len = 0;
+    prev = NULL;
+    for (i = 0; i < num_mbufs; i++) {
+        if (prev == NULL) {
+            cur = om;
+        } else {
+            cur = os_mbuf_get(&ble_hs_mbuf_test_mbuf_pool, 0);
+            TEST_ASSERT_FATAL(cur != NULL);
+            SLIST_NEXT(prev, om_next) = cur;
+        }
+
+        seg_len = BLE_HS_MBUF_TEST_SEG_LEN - i % 5;
+        for (j = 0; j < seg_len; j++) {
+            cur->om_data[j] = first + len;
+            flat[len] = first + len;
+            len++;
+        }
+        cur->om_len = seg_len;
+        prev = cur;
+    }
+
+    OS_MBUF_PKTLEN(om) = len;
+    *out_len = len;
+
+    return om;
+}
+
+static void
+ble_hs_mbuf_test_util_verify(const struct os_mbuf *om, const uint8_t *flat,
+                             uint16_t len)
+{
+    uint8_t buf[BLE_HS_MBUF_TEST_MAX_LEN * 2];
+    int rc;
+
+    TEST_ASSERT_FATAL(OS_MBUF_PKTLEN(om) == len);
+
+    rc = os_mbuf_copydata(om, 0, len, buf);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(memcmp(buf, flat, len) == 0);
+}
+
+/*****************************************************************************
+ * $iov                                                                      *
+ *****************************************************************************/
+
+static void
+ble_hs_mbuf_test_util_iov_span(const struct os_mbuf *om, const uint8_t *flat,
+                               uint16_t off, uint16_t len)
+{
+    struct ble_hs_mbuf_iov iov[BLE_HS_MBUF_TEST_MAX_CHAIN];
+    uint8_t buf[BLE_HS_MBUF_TEST_MAX_LEN];
+    uint16_t iov_len;
+    int num_iovs;
+
+    num_iovs = ble_hs_mbuf_iov_build(om, off, len, iov,
+                                     sizeof iov / sizeof iov[0], &iov_len);
+    TEST_ASSERT_FATAL(iov_len == len);
+
+    ble_hs_mbuf_iov_copy(iov, num_iovs, buf);
+    TEST_ASSERT(memcmp(buf, flat + off, len) == 0);
+}
+
+TEST_CASE_SELF(ble_hs_mbuf_test_case_iov)
+{
+    struct ble_hs_mbuf_iov iov[2];
+    uint8_t flat[BLE_HS_MBUF_TEST_MAX_LEN];
+    struct os_mbuf *om;
+    uint16_t iov_len;
+    uint16_t len;
+    int num_iovs;
+    int n;
+
+    ble_hs_mbuf_test_util_init(BLE_HS_MBUF_TEST_BLOCK_COUNT);
+
+    for (n = 1; n <= BLE_HS_MBUF_TEST_MAX_CHAIN; n++) {
+        om = ble_hs_mbuf_test_util_chain(n, n, flat, &len);
+
+        ble_hs_mbuf_test_util_iov_span(om, flat, 0, len);
+        ble_hs_mbuf_test_util_iov_span(om, flat, 1, len - 1);
+        ble_hs_mbuf_test_util_iov_span(om, flat, len / 2, len - len / 2);
+        ble_hs_mbuf_test_util_iov_span(om, flat, len - 1, 1);
+        ble_hs_mbuf_test_util_iov_span(om, flat, len, 0);
+        if (n > 1) {
+            /* Span starting exactly at an mbuf boundary. */
+            ble_hs_mbuf_test_util_iov_span(om, flat, om->om_len, 1);
+        }
+
+        /* A span past the end of the packet is cut short. */
+        num_iovs = ble_hs_mbuf_iov_build(om, 1, len, iov, 2, &iov_len);
+        if (n == 1) {
+            TEST_ASSERT(num_iovs == 1);
+            TEST_ASSERT(iov_len == len - 1);
+        } else {
+            /* So is one that needs more entries than are available. */
+            TEST_ASSERT(num_iovs == 2);
+            TEST_ASSERT(iov_len == om->om_len - 1 +
+                                   SLIST_NEXT(om, om_next)->om_len);
+        }
+
+        os_mbuf_free_chain(om);
+    }
+
+    ble_hs_mbuf_test_util_assert_freed();
+}
+
+/*****************************************************************************
+ * $append                                                                   *
+ *****************************************************************************/
+
+TEST_CASE_SELF(ble_hs_mbuf_test_case_append_iov)
+{
+    struct ble_hs_mbuf_iov iov[BLE_HS_MBUF_TEST_MAX_CHAIN];
+    uint8_t exp[BLE_HS_MBUF_TEST_MAX_LEN * 2];
+    uint8_t flat[BLE_HS_MBUF_TEST_MAX_LEN];
+    struct os_mbuf *om;
+    uint16_t len;
+    int i;
+    int n;
+    int rc;
+
+    ble_hs_mbuf_test_util_init(BLE_HS_MBUF_TEST_BLOCK_COUNT);
+
+    for (i = 0; i < sizeof flat; i++) {
+        flat[i] = i;
+    }
+
+    for (n = 1; n <= BLE_HS_MBUF_TEST_MAX_CHAIN; n++) {
+        om = ble_hs_mbuf_test_util_chain(1, 0xa0, exp, &len);
+
+        for (i = 0; i < n; i++) {
+            iov[i].data = flat + i * BLE_HS_MBUF_TEST_SEG_LEN;
+            iov[i].len = BLE_HS_MBUF_TEST_SEG_LEN - i % 3;
+            memcpy(exp + len, iov[i].data, iov[i].len);
+            len += iov[i].len;
+        }
+
+        rc = ble_hs_mbuf_append_iov(om, iov, n);
+        TEST_ASSERT_FATAL(rc == 0);
+        ble_hs_mbuf_test_util_verify(om, exp, len);
+
+        os_mbuf_free_chain(om);
+    }
+
+    ble_hs_mbuf_test_util_assert_freed();
+}
+
+TEST_CASE_SELF(ble_hs_mbuf_test_case_append_iov_enomem)
+{
+    struct ble_hs_mbuf_iov iov[2];
+    uint8_t flat[BLE_HS_MBUF_TEST_MAX_LEN];
+    struct os_mbuf *om;
+    struct os_mbuf *cur;
+    uint16_t len;
+    int i;
+    int rc;
+
+    /* Only enough mbufs for part of the data. */
+    ble_hs_mbuf_test_util_init(3);
+
+    for (i = 0; i < sizeof flat; i++) {
+        flat[i] = i;
+    }
+
+    om = os_mbuf_get_pkthdr(&ble_hs_mbuf_test_mbuf_pool, 0);
+    TEST_ASSERT_FATAL(om != NULL);
+
+    iov[0].data = flat;
+    iov[0].len = BLE_HS_MBUF_TEST_SEG_LEN;
+    iov[1].data = flat + BLE_HS_MBUF_TEST_SEG_LEN;
+    iov[1].len = sizeof flat - BLE_HS_MBUF_TEST_SEG_LEN;
+
+    rc = ble_hs_mbuf_append_iov(om, iov, 2);
+    TEST_ASSERT(rc == BLE_HS_ENOMEM);
+    TEST_ASSERT(ble_hs_mbuf_test_mempool.mp_num_free == 0);
+
+    /* What did fit is appended and accounted for. */
+    len = 0;
+    for (cur = om; cur != NULL; cur = SLIST_NEXT(cur, om_next)) {
+        len += cur->om_len;
+    }
+    TEST_ASSERT(len > BLE_HS_MBUF_TEST_SEG_LEN);
+    TEST_ASSERT(len < sizeof flat);
+    ble_hs_mbuf_test_util_verify(om, flat, len);
+
+    os_mbuf_free_chain(om);
+
+    ble_hs_mbuf_test_util_assert_freed();
+}
+
+TEST_SUITE(ble_hs_mbuf_test_suite)
+{
+    ble_hs_mbuf_test_case_iov();
+    ble_hs_mbuf_test_case_append_iov();
+    ble_hs_mbuf_test_case_append_iov_enomem();
+}
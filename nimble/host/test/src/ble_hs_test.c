@@ -17,6 +17,7 @@
  * under the License.
  */
 
+#include <string.h>
 #include "sysinit/sysinit.h"
 #include "syscfg/syscfg.h"
 #include "os/os.h"
@@ -27,6 +28,11 @@
 
 #if MYNEWT_VAL(SELFTEST)
 
+void ble_att_svr_test_find_bench(void);
+void ble_gap_test_disc_rpt_bench(void);
+void ble_hs_conn_test_find_bench(void);
+void ble_hs_hci_test_startup_bench(void);
+
 int
 main(int argc, char **argv)
 {
@@ -68,6 +74,7 @@ main(int argc, char **argv)
     ble_hs_conn_suite();
     ble_hs_hci_suite();
     ble_hs_id_test_suite_auto();
+    ble_hs_mbuf_test_suite();
     ble_hs_pvcy_test_suite_irk();
     ble_l2cap_test_suite();
     ble_os_test_suite();
@@ -77,6 +84,16 @@ main(int argc, char **argv)
     ble_store_suite();
     ble_uuid_test_suite();
 
+    /* "bench" additionally times attribute and connection lookup, the
+     * advertising report path, host startup and connection setup.
+     */
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        ble_att_svr_test_find_bench();
+        ble_gap_test_disc_rpt_bench();
+        ble_hs_conn_test_find_bench();
+        ble_hs_hci_test_startup_bench();
+    }
+
     return tu_any_failed;
 }
 
@@ -524,7 +524,7 @@ ble_hs_test_util_hci_verify_tx(uint8_t ogf, uint16_t ocf,
  * $rx                                                                       *
  *****************************************************************************/
 
-static void
+void
 ble_hs_test_util_hci_rx_evt(uint8_t *evt)
 {
     uint8_t *evbuf;
@@ -611,6 +611,78 @@ ble_hs_test_util_hci_rx_conn_cancel_evt(void)
     TEST_ASSERT_FATAL(rc == 0);
 }
 
+void
+ble_hs_test_util_hci_rx_adv_rpt_event(const struct ble_gap_disc_desc *descs,
+                                      int num_descs)
+{
+    uint8_t buf[BLE_HCI_EVENT_HDR_LEN + UINT8_MAX];
+    int off;
+    int i;
+
+    buf[0] = BLE_HCI_EVCODE_LE_META;
+    buf[2] = BLE_HCI_LE_SUBEV_ADV_RPT;
+    buf[3] = num_descs;
+
+    off = 4;
+    for (i = 0; i < num_descs; i++) {
+        TEST_ASSERT_FATAL(off + 10 + descs[i].length_data <= sizeof buf);
+
+        buf[off++] = descs[i].event_type;
+        buf[off++] = descs[i].addr.type;
+        memcpy(buf + off, descs[i].addr.val, 6);
+        off += 6;
+        buf[off++] = descs[i].length_data;
+        memcpy(buf + off, descs[i].data, descs[i].length_data);
+        off += descs[i].length_data;
+        buf[off++] = descs[i].rssi;
+    }
+
+    buf[1] = off - BLE_HCI_EVENT_HDR_LEN;
+
+    ble_hs_test_util_hci_rx_evt(buf);
+}
+
+void
+ble_hs_test_util_hci_rx_rd_p256_pubkey_event(uint8_t status,
+                                             const uint8_t *public_key)
+{
+    struct ble_hci_ev_le_subev_rd_loc_p256_pubkey *ev;
+    uint8_t buf[BLE_HCI_EVENT_HDR_LEN + sizeof(*ev)];
+
+    buf[0] = BLE_HCI_EVCODE_LE_META;
+    buf[1] = sizeof(*ev);
+
+    ev = (void *)(buf + BLE_HCI_EVENT_HDR_LEN);
+    ev->subev_code = BLE_HCI_LE_SUBEV_RD_LOC_P256_PUBKEY;
+    ev->status = status;
+    memset(ev->public_key, 0, sizeof ev->public_key);
+    if (public_key != NULL) {
+        memcpy(ev->public_key, public_key, sizeof ev->public_key);
+    }
+
+    ble_hs_test_util_hci_rx_evt(buf);
+}
+
+void
+ble_hs_test_util_hci_rx_gen_dhkey_event(uint8_t status, const uint8_t *dhkey)
+{
+    struct ble_hci_ev_le_subev_gen_dhkey_complete *ev;
+    uint8_t buf[BLE_HCI_EVENT_HDR_LEN + sizeof(*ev)];
+
+    buf[0] = BLE_HCI_EVCODE_LE_META;
+    buf[1] = sizeof(*ev);
+
+    ev = (void *)(buf + BLE_HCI_EVENT_HDR_LEN);
+    ev->subev_code = BLE_HCI_LE_SUBEV_GEN_DHKEY_COMPLETE;
+    ev->status = status;
+    memset(ev->dh_key, 0, sizeof ev->dh_key);
+    if (dhkey != NULL) {
+        memcpy(ev->dh_key, dhkey, sizeof ev->dh_key);
+    }
+
+    ble_hs_test_util_hci_rx_evt(buf);
+}
+
 /*****************************************************************************
  * $misc                                                                     *
  *****************************************************************************/
@@ -88,11 +88,18 @@ uint8_t *ble_hs_test_util_hci_verify_tx(uint8_t ogf, uint16_t ocf,
                                         uint8_t *out_param_len);
 
 /* $rx */
+void ble_hs_test_util_hci_rx_evt(uint8_t *evt);
 void ble_hs_test_util_hci_rx_num_completed_pkts_event(
     struct ble_hs_test_util_hci_num_completed_pkts_entry *entries);
 void ble_hs_test_util_hci_rx_disconn_complete_event(uint16_t conn_handle,
                                                     uint8_t status, uint8_t reason);
 void ble_hs_test_util_hci_rx_conn_cancel_evt(void);
+void ble_hs_test_util_hci_rx_adv_rpt_event(
+    const struct ble_gap_disc_desc *descs, int num_descs);
+void ble_hs_test_util_hci_rx_rd_p256_pubkey_event(uint8_t status,
+                                                  const uint8_t *public_key);
+void ble_hs_test_util_hci_rx_gen_dhkey_event(uint8_t status,
+                                             const uint8_t *dhkey);
 
 /* $misc */
 int ble_hs_test_util_hci_misc_exp_status(int cmd_idx, int fail_idx,
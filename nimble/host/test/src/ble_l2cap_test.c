@@ -695,7 +695,7 @@ struct event {
 };
 
 struct test_data {
-    struct event event[3];
+    struct event event[6];
     uint16_t expected_num_of_ev;
     uint16_t expected_num_iters;
     /* This we use to track number of events sent to application*/
@@ -1450,6 +1450,113 @@ TEST_CASE_SELF(ble_l2cap_test_case_coc_send_data_succeed)
     ble_hs_test_util_assert_mbufs_freed(NULL);
 }
 
+TEST_CASE_SELF(ble_l2cap_test_case_coc_send_data_chained)
+{
+    static uint8_t data[1024];
+    static uint8_t rx_data[1024];
+    struct test_data t;
+    struct os_mbuf *sdu;
+    struct os_mbuf *om;
+    uint16_t bounds[8];
+    uint16_t sdu_len_le;
+    uint16_t sdu_len;
+    uint16_t frame_len;
+    uint16_t off;
+    uint16_t mps;
+    int rc;
+    int i;
+
+    ble_l2cap_test_util_init();
+
+    ble_l2cap_test_set_chan_test_conf(BLE_L2CAP_TEST_PSM, sizeof(data), &t);
+    t.expected_num_of_ev = 2;
+
+    t.event[0].type = BLE_L2CAP_TEST_EVENT_COC_CONNECT;
+    t.event[1].type = BLE_L2CAP_TEST_EVENT_COC_DISCONNECT;
+
+    ble_l2cap_test_coc_connect(&t);
+    ble_hs_test_util_prev_tx_queue_clear();
+
+    /* SDU mbuf boundaries relative to K-frame boundaries; the first K-frame
+     * carries mps - 2 bytes of SDU data because of the SDU length field.
+     */
+    mps = t.chan[0]->peer_coc_mps;
+    bounds[0] = 10;                     /* in the packet header mbuf */
+    bounds[1] = mps / 2;                /* inside the first K-frame */
+    bounds[2] = mps - 2;                /* on the first K-frame boundary */
+    bounds[3] = mps - 2 + mps / 2;      /* inside the second K-frame */
+    bounds[4] = 2 * mps - 2;            /* on the second K-frame boundary */
+    bounds[5] = 2 * mps - 2 + mps / 2;  /* inside the third K-frame */
+    bounds[6] = 3 * mps - 2 + mps / 8;  /* mbuf across the third boundary */
+    bounds[7] = bounds[6] + 7;          /* end of SDU */
+    sdu_len = bounds[7];
+    TEST_ASSERT_FATAL(sdu_len <= sizeof(data));
+
+    for (i = 0; i < sdu_len; i++) {
+        data[i] = i * 7 + 1;
+    }
+
+    sdu = os_mbuf_get_pkthdr(&sdu_os_mbuf_pool, 0);
+    TEST_ASSERT_FATAL(sdu != NULL);
+    rc = os_mbuf_append(sdu, data, bounds[0]);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    for (i = 1; i < 8; i++) {
+        om = os_mbuf_get(&sdu_os_mbuf_pool, 0);
+        TEST_ASSERT_FATAL(om != NULL);
+        TEST_ASSERT_FATAL(bounds[i] - bounds[i - 1] <=
+                          OS_MBUF_TRAILINGSPACE(om));
+
+        rc = os_mbuf_append(om, data + bounds[i - 1],
+                            bounds[i] - bounds[i - 1]);
+        TEST_ASSERT_FATAL(rc == 0);
+        os_mbuf_concat(sdu, om);
+    }
+    TEST_ASSERT_FATAL(OS_MBUF_PKTLEN(sdu) == sdu_len);
+
+    rc = ble_l2cap_send(t.chan[0], sdu);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    /* Reassemble the SDU from the K-frames sent. */
+    off = 0;
+    for (i = 0; off < sdu_len; i++) {
+        om = ble_hs_test_util_prev_tx_dequeue();
+        TEST_ASSERT_FATAL(om != NULL);
+
+        frame_len = OS_MBUF_PKTLEN(om);
+        if (i == 0) {
+            TEST_ASSERT_FATAL(frame_len >= sizeof(sdu_len_le));
+            rc = os_mbuf_copydata(om, 0, sizeof(sdu_len_le), &sdu_len_le);
+            TEST_ASSERT_FATAL(rc == 0);
+            TEST_ASSERT(le16toh(sdu_len_le) == sdu_len);
+            os_mbuf_adj(om, sizeof(sdu_len_le));
+            TEST_ASSERT(frame_len == mps);
+        } else if (i < 3) {
+            TEST_ASSERT(frame_len == mps);
+        } else {
+            TEST_ASSERT(frame_len == sdu_len + 2 - 3 * mps);
+        }
+
+        TEST_ASSERT_FATAL(off + OS_MBUF_PKTLEN(om) <= sdu_len);
+        rc = os_mbuf_copydata(om, 0, OS_MBUF_PKTLEN(om), rx_data + off);
+        TEST_ASSERT_FATAL(rc == 0);
+        off += OS_MBUF_PKTLEN(om);
+    }
+    TEST_ASSERT(i == 4);
+    TEST_ASSERT(memcmp(rx_data, data, sdu_len) == 0);
+    TEST_ASSERT(ble_hs_test_util_prev_tx_dequeue() == NULL);
+
+    ble_l2cap_test_coc_disc(&t);
+
+    TEST_ASSERT(t.expected_num_of_ev == t.event_cnt);
+
+    /* SDU mbufs relinked into K-frames went back to the SDU pool. */
+    TEST_ASSERT(sdu_coc_mbuf_mempool.mp_num_free ==
+                sdu_coc_mbuf_mempool.mp_num_blocks);
+
+    ble_hs_test_util_assert_mbufs_freed(NULL);
+}
+
 TEST_CASE_SELF(ble_l2cap_test_case_coc_send_data_failed_too_big_sdu)
 {
     struct test_data t = {};
@@ -1530,6 +1637,171 @@ TEST_CASE_SELF(ble_l2cap_test_case_sig_coc_conn_multi)
     ble_hs_test_util_assert_mbufs_freed(NULL);
 }
 
+static void
+ble_l2cap_test_coc_verify_tx_credits(struct test_data *t, uint16_t credits)
+{
+    struct ble_l2cap_sig_le_credits cmd;
+
+    cmd.scid = htole16(t->chan[0]->scid);
+    cmd.credits = htole16(credits);
+
+    ble_hs_test_util_verify_tx_l2cap_sig(BLE_L2CAP_SIG_OP_FLOW_CTRL_CREDIT,
+                                         &cmd, sizeof(cmd));
+}
+
+static void
+ble_l2cap_test_coc_recv_ready(struct test_data *t)
+{
+    struct os_mbuf *sdu_rx;
+    int rc;
+
+    sdu_rx = os_mbuf_get_pkthdr(&sdu_os_mbuf_pool, 0);
+    TEST_ASSERT_FATAL(sdu_rx != NULL);
+    rc = ble_l2cap_recv_ready(t->chan[0], sdu_rx);
+    TEST_ASSERT_FATAL(rc == 0);
+}
+
+#if !MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+TEST_CASE_SELF(ble_l2cap_test_case_coc_default_credits)
+{
+    struct test_data t;
+    struct os_mbuf *om;
+    uint8_t buf[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+                     11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
+
+    ble_l2cap_test_util_init();
+
+    /* One LE frame per SDU, so the peer gets a single credit at a time. */
+    ble_l2cap_test_set_chan_test_conf(BLE_L2CAP_TEST_PSM, 64, &t);
+    t.expected_num_of_ev = 4;
+
+    t.event[0].type = BLE_L2CAP_EVENT_COC_CONNECTED;
+    t.event[1].type = BLE_L2CAP_EVENT_COC_DATA_RECEIVED;
+    t.event[1].data = buf;
+    t.event[1].data_len = 10;
+    t.event[2].type = BLE_L2CAP_EVENT_COC_DATA_RECEIVED;
+    t.event[2].data = buf;
+    t.event[2].data_len = sizeof(buf);
+    t.event[3].type = BLE_L2CAP_EVENT_COC_DISCONNECTED;
+
+    ble_l2cap_test_coc_connect(&t);
+    ble_hs_test_util_prev_tx_queue_clear();
+
+    /* No credits are given back until the application provides a new
+     * buffer, which tops the peer up to one full SDU.
+     */
+    ble_l2cap_test_coc_recv_data(&t);
+    TEST_ASSERT(ble_hs_test_util_prev_tx_dequeue() == NULL);
+
+    ble_l2cap_test_coc_recv_ready(&t);
+    ble_l2cap_test_coc_verify_tx_credits(&t, 1);
+
+    /* The peer used its only credit on the first half of an SDU and gets
+     * one more credit for the rest.
+     */
+    om = ble_hs_test_util_om_from_flat(buf, 10);
+    om = os_mbuf_prepend_pullup(om, 2);
+    TEST_ASSERT_FATAL(om != NULL);
+    put_le16(om->om_data, sizeof(buf));
+    ble_hs_test_util_inject_rx_l2cap(2, t.chan[0]->scid, om);
+    ble_l2cap_test_coc_verify_tx_credits(&t, 1);
+
+    om = ble_hs_test_util_om_from_flat(buf + 10, sizeof(buf) - 10);
+    ble_hs_test_util_inject_rx_l2cap(2, t.chan[0]->scid, om);
+    TEST_ASSERT(t.event[2].handled);
+    TEST_ASSERT(ble_hs_test_util_prev_tx_dequeue() == NULL);
+
+    ble_l2cap_test_coc_recv_ready(&t);
+    ble_l2cap_test_coc_verify_tx_credits(&t, 1);
+
+    t.event_iter = 3;
+    ble_l2cap_test_coc_disc(&t);
+
+    TEST_ASSERT(t.expected_num_of_ev == t.event_cnt);
+
+    ble_hs_test_util_assert_mbufs_freed(NULL);
+}
+#endif
+
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS) && \
+    MYNEWT_VAL(BLE_L2CAP_COC_STATS) && \
+    MYNEWT_VAL(BLE_L2CAP_COC_SDU_BUFF_COUNT) > 1
+TEST_CASE_SELF(ble_l2cap_test_case_coc_auto_credits)
+{
+    struct ble_l2cap_coc_stats stats;
+    struct test_data t;
+    uint8_t buf[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    ble_npl_time_t ticks;
+    int rc;
+    int i;
+
+    /* One LE frame per SDU, so each SDU is worth one credit. */
+    ble_l2cap_test_set_chan_test_conf(BLE_L2CAP_TEST_PSM, 64, &t);
+    t.expected_num_of_ev = 6;
+
+    t.event[0].type = BLE_L2CAP_EVENT_COC_CONNECTED;
+    for (i = 1; i <= 3; i++) {
+        t.event[i].type = BLE_L2CAP_EVENT_COC_DATA_RECEIVED;
+        t.event[i].data = buf;
+        t.event[i].data_len = sizeof(buf);
+    }
+    t.event[4].type = BLE_L2CAP_TEST_EVENT_COC_SEND_DATA;
+    t.event[4].data = buf;
+    t.event[4].data_len = sizeof(buf);
+    t.event[5].type = BLE_L2CAP_EVENT_COC_DISCONNECTED;
+
+    ble_l2cap_test_coc_connect(&t);
+    ble_hs_test_util_prev_tx_queue_clear();
+
+    /* The peer still has credits for the first SDU. */
+    ble_l2cap_test_coc_recv_ready(&t);
+    TEST_ASSERT(ble_hs_test_util_prev_tx_dequeue() == NULL);
+
+    /* The peer drained the window while a buffer was free: the window grows
+     * and the free buffer is granted right away.
+     */
+    ble_l2cap_test_coc_recv_data(&t);
+    ble_l2cap_test_coc_verify_tx_credits(&t, 1);
+
+    /* A new buffer tops the peer up to the grown window. */
+    ble_l2cap_test_coc_recv_ready(&t);
+    ble_l2cap_test_coc_verify_tx_credits(&t, 1);
+
+    /* Two SDUs without waiting for credits, leaving no buffers. */
+    ble_l2cap_test_coc_recv_data(&t);
+    ble_l2cap_test_coc_recv_data(&t);
+    TEST_ASSERT(ble_hs_test_util_prev_tx_dequeue() == NULL);
+
+    ticks = ble_npl_time_ms_to_ticks32(100);
+    os_time_advance(ticks);
+
+    rc = ble_l2cap_get_coc_stats(t.chan[0], &stats);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(stats.rx_sdus == 3);
+    TEST_ASSERT(stats.rx_bytes == 3 * sizeof(buf));
+    TEST_ASSERT(stats.rx_credits == 2);
+    TEST_ASSERT(stats.rx_stalls == 2);
+    TEST_ASSERT(stats.rx_stall_ms == ble_npl_time_ticks_to_ms32(ticks));
+    TEST_ASSERT(stats.rx_window == 2);
+    TEST_ASSERT(stats.tx_sdus == 0);
+
+    ble_l2cap_test_coc_send_data(&t);
+
+    rc = ble_l2cap_get_coc_stats(t.chan[0], &stats);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(stats.tx_sdus == 1);
+    TEST_ASSERT(stats.tx_bytes == sizeof(buf));
+    TEST_ASSERT(stats.tx_stalls == 0);
+    TEST_ASSERT(stats.uptime_ms == ble_npl_time_ticks_to_ms32(ticks));
+
+    ble_l2cap_test_coc_disc(&t);
+
+    TEST_ASSERT(t.expected_num_of_ev == t.event_cnt);
+
+    ble_hs_test_util_assert_mbufs_freed(NULL);
+}
+#endif
+
 TEST_SUITE(ble_l2cap_test_suite)
 {
     ble_l2cap_test_case_bad_header();
@@ -1558,7 +1830,16 @@ TEST_SUITE(ble_l2cap_test_suite)
     ble_l2cap_test_case_sig_coc_incoming_disconnect_failed();
     ble_l2cap_test_case_invalid_cid_in_disconnect_req();
     ble_l2cap_test_case_coc_send_data_succeed();
+    ble_l2cap_test_case_coc_send_data_chained();
     ble_l2cap_test_case_coc_send_data_failed_too_big_sdu();
     ble_l2cap_test_case_coc_recv_data_succeed();
     ble_l2cap_test_case_sig_coc_conn_multi();
+#if !MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS)
+    ble_l2cap_test_case_coc_default_credits();
+#endif
+#if MYNEWT_VAL(BLE_L2CAP_COC_AUTO_CREDITS) && \
+    MYNEWT_VAL(BLE_L2CAP_COC_STATS) && \
+    MYNEWT_VAL(BLE_L2CAP_COC_SDU_BUFF_COUNT) > 1
+    ble_l2cap_test_case_coc_auto_credits();
+#endif
 }
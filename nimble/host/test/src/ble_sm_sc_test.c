@@ -27,6 +27,9 @@
 #include "ble_hs_test.h"
 #include "ble_hs_test_util.h"
 #include "ble_sm_test_util.h"
+#if MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE) > 0
+#include "tinycrypt/ecc.h"
+#endif
 
 #if NIMBLE_BLE_SM
 
@@ -171,6 +174,12 @@ TEST_CASE_SELF(ble_sm_sc_peer_jw_iio3_rio3_b1_iat0_rat0_ik5_rk7)
     };
     ble_sm_test_util_peer_sc_good(&params);
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    /* Same again with the controller doing the P-256 operations. */
+    params.hci_ecc = 1;
+    ble_sm_test_util_peer_sc_good(&params);
+#endif
+
     ble_hs_test_util_assert_mbufs_freed(NULL);
 }
 
@@ -1675,6 +1684,12 @@ TEST_CASE_SELF(ble_sm_sc_us_jw_iio3_rio4_b1_iat0_rat0_ik7_rk5)
     };
     ble_sm_test_util_us_sc_good(&params);
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    /* Same again with the controller doing the P-256 operations. */
+    params.hci_ecc = 1;
+    ble_sm_test_util_us_sc_good(&params);
+#endif
+
     ble_hs_test_util_assert_mbufs_freed(NULL);
 }
 
@@ -5510,6 +5525,558 @@ TEST_CASE_SELF(ble_sm_sc_us_pk_iio2_rio0_b1_iat2_rat2_ik7_rk3)
     ble_hs_test_util_assert_mbufs_freed(NULL);
 }
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+/**
+ * Secure connections pairing with controller ECC; the controller fails one
+ * of the P-256 commands or never completes it.
+ */
+TEST_CASE_SELF(ble_sm_sc_hci_ecc_fail)
+{
+    struct ble_sm_test_params params;
+
+    params = (struct ble_sm_test_params) {
+        .init_id_addr = {
+            0xca, 0x61, 0xa0, 0x67, 0x94, 0xe0,
+        },
+        .resp_id_addr = {
+            0x33, 0x22, 0x11, 0x00, 0x45, 0x0a,
+        },
+        .pair_req = {
+            .io_cap = 0x03,
+            .oob_data_flag = 0x00,
+            .authreq = 0x09,
+            .max_enc_key_size = 0x10,
+            .init_key_dist = 0x0d,
+            .resp_key_dist = 0x0f,
+        },
+        .pair_rsp = {
+            .io_cap = 0x03,
+            .oob_data_flag = 0x00,
+            .authreq = 0x09,
+            .max_enc_key_size = 0x10,
+            .init_key_dist = 0x05,
+            .resp_key_dist = 0x07,
+        },
+        .our_priv_key = {
+            0x54, 0x8d, 0x20, 0xb8, 0x97, 0x0b, 0xbc, 0x43,
+            0x9a, 0xad, 0x10, 0x6f, 0x60, 0x74, 0xd4, 0x6a,
+            0x55, 0xc1, 0x7a, 0x17, 0x8b, 0x60, 0xe0, 0xb4,
+            0x5a, 0xe6, 0x58, 0xf1, 0xea, 0x12, 0xd9, 0xfb,
+        },
+        .public_key_req = {
+            .x = {
+                0xbc, 0xf2, 0xd8, 0xa5, 0xdb, 0xa3, 0x95, 0x6c,
+                0x99, 0xf9, 0x11, 0x0d, 0x4d, 0x2e, 0xf0, 0xbd,
+                0xee, 0x9b, 0x69, 0xb6, 0xcd, 0x88, 0x74, 0xbe,
+                0x40, 0xe8, 0xe5, 0xcc, 0xdc, 0x88, 0x44, 0x53,
+            },
+            .y = {
+                0xbf, 0xa9, 0x82, 0x0e, 0x18, 0x7a, 0x14, 0xf8,
+                0x77, 0xfd, 0x8e, 0x92, 0x2a, 0xf8, 0x5d, 0x39,
+                0xd1, 0x6d, 0x92, 0x1f, 0x38, 0x74, 0x99, 0xdc,
+                0x6c, 0x2c, 0x94, 0x23, 0xf9, 0x72, 0x56, 0xab,
+            },
+        },
+        .public_key_rsp = {
+            .x = {
+                0x72, 0x8c, 0xd1, 0x88, 0xd7, 0xbe, 0x49, 0xb2,
+                0xc5, 0x5c, 0x95, 0xb3, 0x64, 0xe0, 0x12, 0x32,
+                0xb6, 0xc9, 0x47, 0x63, 0x37, 0x38, 0x5b, 0x9c,
+                0x1e, 0x1b, 0x1a, 0x06, 0x09, 0xe2, 0x31, 0x85,
+            },
+            .y = {
+                0x19, 0x3a, 0x29, 0x69, 0x62, 0xd6, 0x30, 0xe7,
+                0xe8, 0x48, 0x63, 0xdc, 0x00, 0x73, 0x0a, 0x70,
+                0x7d, 0x2e, 0x29, 0xcc, 0x91, 0x77, 0x71, 0xb1,
+                0x75, 0xb8, 0xf7, 0xdc, 0xb0, 0xe2, 0x91, 0x10,
+            },
+        },
+        .pair_alg = BLE_SM_PAIR_ALG_JW,
+        .passkey_info = {
+            .passkey = {
+                .action = BLE_SM_IOACT_NONE,
+            },
+        },
+    };
+
+    /* LE Read Local P-256 Public Key rejected. */
+    ble_sm_test_util_peer_sc_hci_ecc_fail(&params,
+                                          BLE_HCI_OCF_LE_RD_P256_PUBKEY,
+                                          BLE_ERR_UNSPECIFIED, 0,
+                                          BLE_SM_ERR_UNSPECIFIED,
+                                          BLE_HS_ECONTROLLER);
+
+    /* LE Read Local P-256 Public Key completes with an error. */
+    ble_sm_test_util_peer_sc_hci_ecc_fail(&params,
+                                          BLE_HCI_OCF_LE_RD_P256_PUBKEY,
+                                          0, BLE_ERR_UNSPECIFIED,
+                                          BLE_SM_ERR_UNSPECIFIED,
+                                          BLE_HS_ECONTROLLER);
+
+    /* LE Generate DHKey rejected. */
+    ble_sm_test_util_peer_sc_hci_ecc_fail(&params, BLE_HCI_OCF_LE_GEN_DHKEY,
+                                          BLE_ERR_UNSPECIFIED, 0,
+                                          BLE_SM_ERR_DHKEY,
+                                          BLE_HS_SM_US_ERR(BLE_SM_ERR_DHKEY));
+
+    /* LE Generate DHKey completes with an error. */
+    ble_sm_test_util_peer_sc_hci_ecc_fail(&params, BLE_HCI_OCF_LE_GEN_DHKEY,
+                                          0, BLE_ERR_UNSPECIFIED,
+                                          BLE_SM_ERR_DHKEY,
+                                          BLE_HS_SM_US_ERR(BLE_SM_ERR_DHKEY));
+
+    /* LE Read Local P-256 Public Key never completes. */
+    ble_sm_test_util_peer_sc_hci_ecc_timeout(&params,
+                                             BLE_HCI_OCF_LE_RD_P256_PUBKEY);
+
+    /* LE Generate DHKey never completes. */
+    ble_sm_test_util_peer_sc_hci_ecc_timeout(&params,
+                                             BLE_HCI_OCF_LE_GEN_DHKEY);
+
+    ble_hs_test_util_assert_mbufs_freed(NULL);
+}
+
+/**
+ * OOB data generation with controller ECC: our public key is read on demand
+ * and ble_sm_sc_oob_generate_data() asks to be called again meanwhile.
+ */
+TEST_CASE_SELF(ble_sm_sc_hci_ecc_oob)
+{
+    static const struct ble_sm_public_key pub_key = {
+        .x = {
+            0xbc, 0xf2, 0xd8, 0xa5, 0xdb, 0xa3, 0x95, 0x6c,
+            0x99, 0xf9, 0x11, 0x0d, 0x4d, 0x2e, 0xf0, 0xbd,
+            0xee, 0x9b, 0x69, 0xb6, 0xcd, 0x88, 0x74, 0xbe,
+            0x40, 0xe8, 0xe5, 0xcc, 0xdc, 0x88, 0x44, 0x53,
+        },
+        .y = {
+            0xbf, 0xa9, 0x82, 0x0e, 0x18, 0x7a, 0x14, 0xf8,
+            0x77, 0xfd, 0x8e, 0x92, 0x2a, 0xf8, 0x5d, 0x39,
+            0xd1, 0x6d, 0x92, 0x1f, 0x38, 0x74, 0x99, 0xdc,
+            0x6c, 0x2c, 0x94, 0x23, 0xf9, 0x72, 0x56, 0xab,
+        },
+    };
+    struct ble_hs_test_util_hci_ack acks[3];
+    struct ble_sm_sc_oob_data oob;
+    uint8_t exp_c[16];
+    int rc;
+    int i;
+
+    ble_sm_test_util_init();
+    ble_sm_test_util_hci_ecc_init();
+
+    /* The key read fails to be sent; the request is dropped. */
+    ble_hs_test_util_hci_out_clear();
+    rc = ble_sm_sc_oob_generate_data(&oob);
+    TEST_ASSERT(rc == BLE_HS_EAGAIN);
+    ble_hs_test_util_hci_ack_set(
+        ble_hs_hci_util_opcode_join(BLE_HCI_OGF_LE,
+                                    BLE_HCI_OCF_LE_RD_P256_PUBKEY),
+        BLE_ERR_UNSPECIFIED);
+    ble_sm_test_util_hci_ecc_run();
+    ble_hs_test_util_hci_verify_tx(BLE_HCI_OGF_LE,
+                                   BLE_HCI_OCF_LE_RD_P256_PUBKEY, NULL);
+    ble_sm_test_util_hci_ecc_run();
+    TEST_ASSERT(ble_hs_test_util_hci_out_first() == NULL);
+
+    /* Asking again retries the read. */
+    rc = ble_sm_sc_oob_generate_data(&oob);
+    TEST_ASSERT(rc == BLE_HS_EAGAIN);
+    ble_sm_test_util_hci_ecc_rd_pubkey(&pub_key);
+
+    /* No OOB data until the key is known; only one read is issued. */
+    ble_sm_test_util_hci_ecc_init();
+    rc = ble_sm_sc_oob_generate_data(&oob);
+    TEST_ASSERT(rc == BLE_HS_EAGAIN);
+    ble_hs_test_util_hci_out_clear();
+    ble_hs_test_util_hci_ack_set(
+        ble_hs_hci_util_opcode_join(BLE_HCI_OGF_LE,
+                                    BLE_HCI_OCF_LE_RD_P256_PUBKEY), 0);
+    ble_sm_test_util_hci_ecc_run();
+    ble_hs_test_util_hci_verify_tx(BLE_HCI_OGF_LE,
+                                   BLE_HCI_OCF_LE_RD_P256_PUBKEY, NULL);
+
+    rc = ble_sm_sc_oob_generate_data(&oob);
+    TEST_ASSERT(rc == BLE_HS_EAGAIN);
+    ble_sm_test_util_hci_ecc_run();
+    TEST_ASSERT(ble_hs_test_util_hci_out_first() == NULL);
+
+    ble_hs_test_util_hci_rx_rd_p256_pubkey_event(0, pub_key.x);
+    ble_sm_test_util_hci_ecc_run();
+
+    /* Two LE Rand commands supply the random number. */
+    memset(acks, 0, sizeof acks);
+    for (i = 0; i < 2; i++) {
+        acks[i].opcode = ble_hs_hci_util_opcode_join(BLE_HCI_OGF_LE,
+                                                     BLE_HCI_OCF_LE_RAND);
+        acks[i].evt_params_len = 8;
+        memset(acks[i].evt_params, 0x11 * (i + 1), 8);
+    }
+    ble_hs_test_util_hci_ack_set_seq(acks);
+
+    rc = ble_sm_sc_oob_generate_data(&oob);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    rc = ble_sm_alg_f4(pub_key.x, pub_key.x, oob.r, 0, exp_c);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(memcmp(oob.c, exp_c, sizeof exp_c) == 0);
+}
+
+/**
+ * A controller without the LE P-256 commands leaves ECC to the host.
+ */
+TEST_CASE_SELF(ble_sm_sc_hci_ecc_unsupported)
+{
+    uint8_t pub_key[64] = {
+        0xbc, 0xf2, 0xd8, 0xa5, 0xdb, 0xa3, 0x95, 0x6c,
+        0x99, 0xf9, 0x11, 0x0d, 0x4d, 0x2e, 0xf0, 0xbd,
+        0xee, 0x9b, 0x69, 0xb6, 0xcd, 0x88, 0x74, 0xbe,
+        0x40, 0xe8, 0xe5, 0xcc, 0xdc, 0x88, 0x44, 0x53,
+        0xbf, 0xa9, 0x82, 0x0e, 0x18, 0x7a, 0x14, 0xf8,
+        0x77, 0xfd, 0x8e, 0x92, 0x2a, 0xf8, 0x5d, 0x39,
+        0xd1, 0x6d, 0x92, 0x1f, 0x38, 0x74, 0x99, 0xdc,
+        0x6c, 0x2c, 0x94, 0x23, 0xf9, 0x72, 0x56, 0xab,
+    };
+    uint8_t priv_key[32] = {
+        0x54, 0x8d, 0x20, 0xb8, 0x97, 0x0b, 0xbc, 0x43,
+        0x9a, 0xad, 0x10, 0x6f, 0x60, 0x74, 0xd4, 0x6a,
+        0x55, 0xc1, 0x7a, 0x17, 0x8b, 0x60, 0xe0, 0xb4,
+        0x5a, 0xe6, 0x58, 0xf1, 0xea, 0x12, 0xd9, 0xfb,
+    };
+    struct ble_hs_test_util_hci_ack acks[3];
+    struct ble_sm_sc_oob_data oob;
+    uint8_t exp_c[16];
+    int rc;
+    int i;
+
+    ble_sm_test_util_init();
+    ble_sm_dbg_set_sc_keys(pub_key, priv_key);
+
+    memset(acks, 0, sizeof acks);
+    for (i = 0; i < 2; i++) {
+        acks[i].opcode = ble_hs_hci_util_opcode_join(BLE_HCI_OGF_LE,
+                                                     BLE_HCI_OCF_LE_RAND);
+        acks[i].evt_params_len = 8;
+    }
+    ble_hs_test_util_hci_ack_set_seq(acks);
+
+    ble_hs_test_util_hci_out_clear();
+    rc = ble_sm_sc_oob_generate_data(&oob);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    /* The key pair was generated by the host; only LE Rand was sent. */
+    ble_hs_test_util_hci_verify_tx(BLE_HCI_OGF_LE, BLE_HCI_OCF_LE_RAND, NULL);
+    ble_hs_test_util_hci_verify_tx(BLE_HCI_OGF_LE, BLE_HCI_OCF_LE_RAND, NULL);
+    TEST_ASSERT(ble_hs_test_util_hci_out_first() == NULL);
+
+    rc = ble_sm_alg_f4(pub_key, pub_key, oob.r, 0, exp_c);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(memcmp(oob.c, exp_c, sizeof exp_c) == 0);
+}
+#endif
+
+#if MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE) > 0 || \
+    MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_TIME) > 0
+static const struct ble_sm_public_key ble_sm_sc_test_pub_key1 = {
+    .x = {
+        0x72, 0x8c, 0xd1, 0x88, 0xd7, 0xbe, 0x49, 0xb2,
+        0xc5, 0x5c, 0x95, 0xb3, 0x64, 0xe0, 0x12, 0x32,
+        0xb6, 0xc9, 0x47, 0x63, 0x37, 0x38, 0x5b, 0x9c,
+        0x1e, 0x1b, 0x1a, 0x06, 0x09, 0xe2, 0x31, 0x85,
+    },
+    .y = {
+        0x19, 0x3a, 0x29, 0x69, 0x62, 0xd6, 0x30, 0xe7,
+        0xe8, 0x48, 0x63, 0xdc, 0x00, 0x73, 0x0a, 0x70,
+        0x7d, 0x2e, 0x29, 0xcc, 0x91, 0x77, 0x71, 0xb1,
+        0x75, 0xb8, 0xf7, 0xdc, 0xb0, 0xe2, 0x91, 0x10,
+    },
+};
+
+static const uint8_t ble_sm_sc_test_priv_key1[32] = {
+    0x54, 0x8d, 0x20, 0xb8, 0x97, 0x0b, 0xbc, 0x43,
+    0x9a, 0xad, 0x10, 0x6f, 0x60, 0x74, 0xd4, 0x6a,
+    0x55, 0xc1, 0x7a, 0x17, 0x8b, 0x60, 0xe0, 0xb4,
+    0x5a, 0xe6, 0x58, 0xf1, 0xea, 0x12, 0xd9, 0xfb,
+};
+
+static const struct ble_sm_public_key ble_sm_sc_test_pub_key2 = {
+    .x = {
+        0xbc, 0xf2, 0xd8, 0xa5, 0xdb, 0xa3, 0x95, 0x6c,
+        0x99, 0xf9, 0x11, 0x0d, 0x4d, 0x2e, 0xf0, 0xbd,
+        0xee, 0x9b, 0x69, 0xb6, 0xcd, 0x88, 0x74, 0xbe,
+        0x40, 0xe8, 0xe5, 0xcc, 0xdc, 0x88, 0x44, 0x53,
+    },
+    .y = {
+        0xbf, 0xa9, 0x82, 0x0e, 0x18, 0x7a, 0x14, 0xf8,
+        0x77, 0xfd, 0x8e, 0x92, 0x2a, 0xf8, 0x5d, 0x39,
+        0xd1, 0x6d, 0x92, 0x1f, 0x38, 0x74, 0x99, 0xdc,
+        0x6c, 0x2c, 0x94, 0x23, 0xf9, 0x72, 0x56, 0xab,
+    },
+};
+
+/**
+ * Generates OOB data.  If pub_key is not NULL, verifies that the Confirm
+ * Value was computed over it.
+ */
+static void
+ble_sm_sc_test_oob_generate(struct ble_sm_sc_oob_data *oob,
+                            const struct ble_sm_public_key *pub_key)
+{
+    struct ble_hs_test_util_hci_ack acks[3];
+    uint8_t exp_c[16];
+    int rc;
+    int i;
+
+    /* Two LE Rand commands supply the random number. */
+    memset(acks, 0, sizeof acks);
+    for (i = 0; i < 2; i++) {
+        acks[i].opcode = ble_hs_hci_util_opcode_join(BLE_HCI_OGF_LE,
+                                                     BLE_HCI_OCF_LE_RAND);
+        acks[i].evt_params_len = 8;
+        memset(acks[i].evt_params, 0x5a + i, 8);
+    }
+    ble_hs_test_util_hci_ack_set_seq(acks);
+
+    rc = ble_sm_sc_oob_generate_data(oob);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    if (pub_key != NULL) {
+        rc = ble_sm_alg_f4(pub_key->x, pub_key->x, oob->r, 0, exp_c);
+        TEST_ASSERT_FATAL(rc == 0);
+        TEST_ASSERT(memcmp(oob->c, exp_c, sizeof exp_c) == 0);
+    }
+}
+#endif
+
+#if MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE) > 0
+/* Unit tests build without an RNG for uECC; key generation needs one. */
+static int
+ble_sm_sc_test_rng(uint8_t *dst, unsigned int size)
+{
+    static uint8_t seed;
+
+    while (size--) {
+        *dst++ = ++seed * 37;
+    }
+
+    return 1;
+}
+
+static void
+ble_sm_sc_test_run_evq(struct ble_npl_eventq *evq)
+{
+    struct ble_npl_event *ev;
+
+    while ((ev = ble_npl_eventq_get(evq, 0)) != NULL) {
+        ble_npl_event_run(ev);
+    }
+}
+
+/**
+ * Key pairs are pre-generated on the application's queue, never on the
+ * host's, and replenished when one is taken.
+ */
+TEST_CASE_SELF(ble_sm_sc_key_pool)
+{
+    static struct ble_npl_eventq evq;
+    struct ble_sm_sc_oob_data oob;
+
+    ble_sm_test_util_init();
+    uECC_set_rng(ble_sm_sc_test_rng);
+    ble_npl_eventq_init(&evq);
+
+    /* Discard events queued during startup. */
+    while (ble_npl_eventq_get(ble_hs_evq_get(), 0) != NULL) {
+    }
+
+    /* Nothing is generated until a queue is provided. */
+    ble_sm_sc_timer();
+    TEST_ASSERT(ble_sm_sc_key_pool_count() == 0);
+    TEST_ASSERT(ble_npl_eventq_get(ble_hs_evq_get(), 0) == NULL);
+
+    ble_sm_sc_key_pool_evq_set(&evq);
+    ble_sm_sc_timer();
+    TEST_ASSERT(ble_npl_eventq_get(ble_hs_evq_get(), 0) == NULL);
+    TEST_ASSERT(ble_sm_sc_key_pool_count() == 0);
+
+    ble_sm_sc_test_run_evq(&evq);
+    TEST_ASSERT(ble_sm_sc_key_pool_count() ==
+                MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE));
+
+    /* Adopting a key pair takes it from the pool. */
+    ble_sm_sc_test_oob_generate(&oob, NULL);
+    TEST_ASSERT(ble_sm_sc_key_pool_count() ==
+                MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE) - 1);
+    TEST_ASSERT(ble_npl_eventq_get(ble_hs_evq_get(), 0) == NULL);
+
+    ble_sm_sc_test_run_evq(&evq);
+    TEST_ASSERT(ble_sm_sc_key_pool_count() ==
+                MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE));
+
+    /* Debug keys bypass the pool. */
+    ble_sm_test_util_init();
+    ble_sm_dbg_set_sc_keys((uint8_t *)&ble_sm_sc_test_pub_key1,
+                           (uint8_t *)ble_sm_sc_test_priv_key1);
+    ble_sm_sc_test_oob_generate(&oob, &ble_sm_sc_test_pub_key1);
+    TEST_ASSERT(ble_sm_sc_key_pool_count() ==
+                MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE));
+
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    /* The pool is not refilled while the controller does ECC. */
+    ble_sm_test_util_init();
+    ble_sm_sc_test_oob_generate(&oob, NULL);
+    TEST_ASSERT(ble_sm_sc_key_pool_count() ==
+                MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE) - 1);
+    while (ble_npl_eventq_get(&evq, 0) != NULL) {
+    }
+
+    ble_sm_test_util_hci_ecc_init();
+    ble_sm_sc_timer();
+    TEST_ASSERT(ble_npl_eventq_get(&evq, 0) == NULL);
+#endif
+
+    ble_sm_sc_key_pool_evq_set(NULL);
+    ble_sm_sc_test_run_evq(&evq);
+    uECC_set_rng(NULL);
+}
+#endif
+
+#if MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_TIME) > 0 && \
+    MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+/**
+ * Starts pairing as initiator so that our key pair gets adopted; reads our
+ * public key from the controller if pub_key is not NULL.
+ */
+static void
+ble_sm_sc_test_key_pair_start(uint8_t oob_data_flag,
+                              const struct ble_sm_public_key *pub_key)
+{
+    struct ble_sm_pair_cmd pair_rsp = {
+        .io_cap = BLE_HS_IO_NO_INPUT_OUTPUT,
+        .oob_data_flag = oob_data_flag,
+        .authreq = BLE_SM_PAIR_AUTHREQ_SC,
+        .max_enc_key_size = 16,
+    };
+    static const uint8_t peer_addr[6] = { 1, 2, 3, 4, 5, 6 };
+    int rc;
+
+    ble_hs_cfg.sm_io_cap = BLE_HS_IO_NO_INPUT_OUTPUT;
+    ble_hs_cfg.sm_oob_data_flag = 0;
+    ble_hs_cfg.sm_bonding = 0;
+    ble_hs_cfg.sm_mitm = 0;
+    ble_hs_cfg.sm_sc = 1;
+    ble_hs_cfg.sm_our_key_dist = 0;
+    ble_hs_cfg.sm_their_key_dist = 0;
+
+    ble_hs_test_util_create_conn(2, peer_addr, NULL, NULL);
+
+    ble_sm_dbg_set_next_pair_rand(((uint8_t[16]){0}));
+    rc = ble_gap_security_initiate(2);
+    TEST_ASSERT_FATAL(rc == 0);
+    ble_sm_test_util_rx_pair_rsp(2, &pair_rsp, 0);
+
+    if (pub_key != NULL) {
+        ble_sm_test_util_hci_ecc_rd_pubkey(pub_key);
+    }
+    TEST_ASSERT(ble_sm_num_procs() == 1);
+}
+
+/**
+ * Our key pair is replaced when due, but only while no pairing is in
+ * progress and no OOB data computed over it is waiting to be used.
+ */
+TEST_CASE_SELF(ble_sm_sc_key_rotate)
+{
+    struct ble_sm_sc_oob_data oob;
+    struct ble_sm_io io;
+    uint32_t rotate_ticks;
+    int32_t ticks;
+    int rc;
+
+    rotate_ticks = ble_npl_time_ms_to_ticks32(
+        MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_TIME) * 1000);
+
+    ble_sm_test_util_init();
+    ble_sm_test_util_hci_ecc_init();
+
+    /* Not due yet. */
+    ble_sm_sc_test_key_pair_start(BLE_SM_PAIR_OOB_NO,
+                                  &ble_sm_sc_test_pub_key1);
+    ticks = ble_sm_sc_timer();
+    TEST_ASSERT(ticks == rotate_ticks);
+
+    /* Due, but our key is in use. */
+    os_time_advance(rotate_ticks);
+    ticks = ble_sm_sc_timer();
+    TEST_ASSERT(ticks == ble_npl_time_ms_to_ticks32(1000));
+    ble_hs_test_util_conn_disconnect(2);
+
+    /* Replaced once the pairing is gone; the next user reads a new one. */
+    ticks = ble_sm_sc_timer();
+    TEST_ASSERT(ticks == BLE_HS_FOREVER);
+
+    rc = ble_sm_sc_oob_generate_data(&oob);
+    TEST_ASSERT(rc == BLE_HS_EAGAIN);
+    ble_sm_test_util_hci_ecc_rd_pubkey(&ble_sm_sc_test_pub_key2);
+    ble_sm_sc_test_oob_generate(&oob, &ble_sm_sc_test_pub_key2);
+
+    /* Due, but the OOB data handed out holds it. */
+    os_time_advance(rotate_ticks);
+    ticks = ble_sm_sc_timer();
+    TEST_ASSERT(ticks == BLE_HS_FOREVER);
+    ble_sm_sc_test_oob_generate(&oob, &ble_sm_sc_test_pub_key2);
+
+    /* Released when the OOB data is injected into a pairing. */
+    ble_sm_sc_test_key_pair_start(BLE_SM_PAIR_OOB_YES, NULL);
+    ble_sm_test_util_rx_public_key(
+        2, (struct ble_sm_public_key *)&ble_sm_sc_test_pub_key1);
+    ble_sm_test_util_hci_ecc_gen_dhkey(&ble_sm_sc_test_pub_key1,
+                                       ble_sm_sc_test_priv_key1);
+
+    memset(&io, 0, sizeof io);
+    io.action = BLE_SM_IOACT_OOB_SC;
+    io.oob_sc_data.local = &oob;
+    rc = ble_sm_inject_io(2, &io);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    ticks = ble_sm_sc_timer();
+    TEST_ASSERT(ticks == ble_npl_time_ms_to_ticks32(1000));
+    ble_hs_test_util_conn_disconnect(2);
+
+    ticks = ble_sm_sc_timer();
+    TEST_ASSERT(ticks == BLE_HS_FOREVER);
+    rc = ble_sm_sc_oob_generate_data(&oob);
+    TEST_ASSERT(rc == BLE_HS_EAGAIN);
+
+    ble_hs_test_util_assert_mbufs_freed(NULL);
+}
+
+/**
+ * Debug keys are never rotated.
+ */
+TEST_CASE_SELF(ble_sm_sc_key_rotate_dbg)
+{
+    struct ble_sm_sc_oob_data oob;
+    int32_t ticks;
+
+    ble_sm_test_util_init();
+    ble_sm_dbg_set_sc_keys((uint8_t *)&ble_sm_sc_test_pub_key1,
+                           (uint8_t *)ble_sm_sc_test_priv_key1);
+
+    ble_sm_sc_test_key_pair_start(BLE_SM_PAIR_OOB_NO, NULL);
+    ble_hs_test_util_conn_disconnect(2);
+
+    os_time_advance(ble_npl_time_ms_to_ticks32(
+        MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_TIME) * 1000));
+    ticks = ble_sm_sc_timer();
+    TEST_ASSERT(ticks == BLE_HS_FOREVER);
+
+    ble_sm_sc_test_oob_generate(&oob, &ble_sm_sc_test_pub_key1);
+
+    ble_hs_test_util_assert_mbufs_freed(NULL);
+}
+#endif
+
 TEST_SUITE(ble_sm_sc_test_suite)
 {
     /*** No privacy. */
@@ -5526,6 +6093,23 @@ TEST_SUITE(ble_sm_sc_test_suite)
     ble_sm_sc_us_pk_iio0_rio4_b1_iat0_rat0_ik7_rk5();
     ble_sm_sc_us_nc_iio1_rio4_b1_iat0_rat0_ik7_rk5();
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    /*** Controller ECC. */
+    ble_sm_sc_hci_ecc_fail();
+    ble_sm_sc_hci_ecc_oob();
+    ble_sm_sc_hci_ecc_unsupported();
+#endif
+
+#if MYNEWT_VAL(BLE_SM_SC_KEY_POOL_SIZE) > 0
+    ble_sm_sc_key_pool();
+#endif
+#if MYNEWT_VAL(BLE_SM_SC_KEY_ROTATE_TIME) > 0 && \
+    MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    /*** Key rotation. */
+    ble_sm_sc_key_rotate();
+    ble_sm_sc_key_rotate_dbg();
+#endif
+
     /*** Privacy (id = public). */
     // FIXME: needs to be fixed due to fix for address type used
 #if 0
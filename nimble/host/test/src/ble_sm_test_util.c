@@ -496,6 +496,87 @@ ble_sm_test_util_params_to_entities(struct ble_sm_test_params *params,
     ble_sm_test_util_params_to_entity(params, !we_are_initiator, out_peer);
 }
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+void
+ble_sm_test_util_hci_ecc_init(void)
+{
+    struct ble_hs_hci_sup_cmd sup_cmd;
+
+    /* LE Read Local P-256 Public Key and LE Generate DHKey. */
+    sup_cmd = ble_hs_hci_get_hci_supported_cmd();
+    sup_cmd.commands[34] |= 0x06;
+    ble_hs_hci_set_hci_supported_cmd(sup_cmd);
+
+    /* Forget our key pair so that it gets read from the controller. */
+    ble_sm_sc_reset();
+
+    /* Discard events queued during startup; the test runs the host event
+     * queue itself.
+     */
+    while (ble_npl_eventq_get(ble_hs_evq_get(), 0) != NULL) {
+    }
+}
+
+void
+ble_sm_test_util_hci_ecc_run(void)
+{
+    struct ble_npl_event *ev;
+
+    while ((ev = ble_npl_eventq_get(ble_hs_evq_get(), 0)) != NULL) {
+        ble_npl_event_run(ev);
+    }
+}
+
+/**
+ * Plays the controller's part in LE Read Local P-256 Public Key: acks the
+ * command when the host task sends it, then reports the specified key.
+ */
+void
+ble_sm_test_util_hci_ecc_rd_pubkey(const struct ble_sm_public_key *our_key)
+{
+    ble_hs_test_util_hci_out_clear();
+    ble_hs_test_util_hci_ack_set(
+        ble_hs_hci_util_opcode_join(BLE_HCI_OGF_LE,
+                                    BLE_HCI_OCF_LE_RD_P256_PUBKEY), 0);
+    ble_sm_test_util_hci_ecc_run();
+    ble_hs_test_util_hci_verify_tx(BLE_HCI_OGF_LE,
+                                   BLE_HCI_OCF_LE_RD_P256_PUBKEY, NULL);
+
+    ble_hs_test_util_hci_rx_rd_p256_pubkey_event(0, our_key->x);
+}
+
+/**
+ * Plays the controller's part in LE Generate DHKey: verifies the host asks
+ * for the DHKey of the specified peer key and reports the result.
+ */
+void
+ble_sm_test_util_hci_ecc_gen_dhkey(const struct ble_sm_public_key *peer_key,
+                                   const uint8_t *our_priv_key)
+{
+    uint8_t dhkey[32];
+    uint8_t param_len;
+    uint8_t *param;
+    int rc;
+
+    ble_hs_test_util_hci_out_clear();
+    ble_hs_test_util_hci_ack_set(
+        ble_hs_hci_util_opcode_join(BLE_HCI_OGF_LE,
+                                    BLE_HCI_OCF_LE_GEN_DHKEY), 0);
+    ble_sm_test_util_hci_ecc_run();
+    param = ble_hs_test_util_hci_verify_tx(BLE_HCI_OGF_LE,
+                                           BLE_HCI_OCF_LE_GEN_DHKEY,
+                                           &param_len);
+    TEST_ASSERT_FATAL(param_len == 64);
+    TEST_ASSERT(memcmp(param, peer_key->x, 32) == 0);
+    TEST_ASSERT(memcmp(param + 32, peer_key->y, 32) == 0);
+
+    rc = ble_sm_alg_gen_dhkey(peer_key->x, peer_key->y, our_priv_key, dhkey);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    ble_hs_test_util_hci_rx_gen_dhkey_event(0, dhkey);
+}
+#endif
+
 static void
 ble_sm_test_util_init_good(struct ble_sm_test_params *params,
                            int we_are_initiator,
@@ -542,6 +623,12 @@ ble_sm_test_util_init_good(struct ble_sm_test_params *params,
                                params->our_priv_key);
     }
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    if (params->hci_ecc) {
+        ble_sm_test_util_hci_ecc_init();
+    }
+#endif
+
     ble_hs_test_util_create_rpa_conn(2, out_us->addr_type, out_us->rpa,
                                      out_peer->addr_type,
                                      out_peer->id_addr, out_peer->rpa,
@@ -815,7 +902,7 @@ ble_sm_test_util_rx_sec_req(uint16_t conn_handle, struct ble_sm_sec_req *cmd,
     TEST_ASSERT_FATAL(rc == exp_status);
 }
 
-static void
+void
 ble_sm_test_util_rx_public_key(uint16_t conn_handle,
                                struct ble_sm_public_key *cmd)
 {
@@ -2477,6 +2564,13 @@ ble_sm_test_util_us_sc_good_once_no_init(
     TEST_ASSERT(ble_sm_num_procs() == 1);
     ble_sm_test_util_io_inject_bad(2, params->passkey_info.passkey.action);
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    if (params->hci_ecc) {
+        /* Our public key is read from the controller first. */
+        ble_sm_test_util_hci_ecc_rd_pubkey(our_entity->public_key);
+    }
+#endif
+
     /* Ensure we sent the expected public key. */
     ble_sm_test_util_verify_tx_public_key(our_entity->public_key);
     TEST_ASSERT(!conn->bhc_sec_state.encrypted);
@@ -2489,6 +2583,18 @@ ble_sm_test_util_us_sc_good_once_no_init(
     TEST_ASSERT(ble_sm_num_procs() == 1);
     ble_sm_test_util_io_inject_bad(2, params->passkey_info.passkey.action);
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    if (params->hci_ecc) {
+        ble_sm_test_util_hci_ecc_gen_dhkey(peer_entity->public_key,
+                                           params->our_priv_key);
+
+        /* Re-arm the start encryption ack replaced by the above. */
+        ble_hs_test_util_hci_ack_set(
+            ble_hs_hci_util_opcode_join(BLE_HCI_OGF_LE,
+                                        BLE_HCI_OCF_LE_START_ENCRYPT), 0);
+    }
+#endif
+
     switch (params->pair_alg) {
     case BLE_SM_PAIR_ALG_PASSKEY:
         num_iters = 20;
@@ -2701,6 +2807,138 @@ ble_sm_test_util_us_sc_bad(struct ble_sm_test_params *params)
     ble_sm_test_util_us_sc_bad_once(params);
 }
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+/**
+ * Runs a peer-initiated pairing up to the specified controller P-256 command
+ * and has the controller fail it: with a command status of ack_status if
+ * nonzero, otherwise with an event status of evt_status.  Verifies that the
+ * pairing fails with the specified SM error and application status.
+ */
+void
+ble_sm_test_util_peer_sc_hci_ecc_fail(struct ble_sm_test_params *params,
+                                      uint16_t ocf, uint8_t ack_status,
+                                      uint8_t evt_status, uint8_t sm_err,
+                                      int app_status)
+{
+    struct ble_sm_test_util_entity peer_entity;
+    struct ble_sm_test_util_entity our_entity;
+    struct ble_sm_pair_fail fail;
+    struct ble_hs_conn *conn;
+    uint8_t zeros[64] = { 0 };
+
+    params->hci_ecc = 1;
+    params->sec_req.authreq = 0;
+    ble_sm_test_util_init_good(params, 0, &conn, &our_entity, &peer_entity);
+
+    ble_sm_test_util_rx_pair_req(2, peer_entity.pair_cmd, 0);
+    ble_sm_test_util_verify_tx_pair_rsp(our_entity.pair_cmd);
+    ble_sm_test_util_rx_public_key(2, peer_entity.public_key);
+    TEST_ASSERT(ble_sm_num_procs() == 1);
+
+    if (ocf == BLE_HCI_OCF_LE_GEN_DHKEY) {
+        ble_sm_test_util_hci_ecc_rd_pubkey(our_entity.public_key);
+    }
+
+    ble_hs_test_util_hci_out_clear();
+    ble_hs_test_util_hci_ack_set(
+        ble_hs_hci_util_opcode_join(BLE_HCI_OGF_LE, ocf), ack_status);
+    ble_sm_test_util_hci_ecc_run();
+    ble_hs_test_util_hci_verify_tx(BLE_HCI_OGF_LE, ocf, NULL);
+
+    if (ack_status == 0) {
+        TEST_ASSERT(ble_sm_num_procs() == 1);
+        if (ocf == BLE_HCI_OCF_LE_RD_P256_PUBKEY) {
+            ble_hs_test_util_hci_rx_rd_p256_pubkey_event(evt_status, zeros);
+        } else {
+            ble_hs_test_util_hci_rx_gen_dhkey_event(evt_status, zeros);
+        }
+    }
+
+    /* Ensure we sent the expected pair fail. */
+    fail.reason = sm_err;
+    ble_sm_test_util_verify_tx_pair_fail(&fail);
+    TEST_ASSERT(ble_sm_num_procs() == 0);
+
+    /* Verify that security callback was executed with the failure. */
+    TEST_ASSERT(ble_sm_test_gap_event_type == BLE_GAP_EVENT_ENC_CHANGE);
+    TEST_ASSERT(ble_sm_test_gap_status == app_status);
+    TEST_ASSERT(!conn->bhc_sec_state.encrypted);
+
+    /* No further commands are sent on behalf of the failed procedure. */
+    ble_hs_test_util_hci_out_clear();
+    ble_sm_test_util_hci_ecc_run();
+    TEST_ASSERT(ble_hs_test_util_hci_out_first() == NULL);
+
+    ble_hs_test_util_conn_disconnect(2);
+}
+
+/**
+ * Runs a peer-initiated pairing up to the specified controller P-256 command,
+ * which the controller acks but never completes.  Verifies that the pairing
+ * times out and that the next pairing gets its own command sent.
+ */
+void
+ble_sm_test_util_peer_sc_hci_ecc_timeout(struct ble_sm_test_params *params,
+                                         uint16_t ocf)
+{
+    struct ble_sm_test_util_entity peer_entity;
+    struct ble_sm_test_util_entity our_entity;
+    struct ble_hs_conn *conn;
+    uint8_t zeros[64] = { 0 };
+
+    params->hci_ecc = 1;
+    params->sec_req.authreq = 0;
+    ble_sm_test_util_init_good(params, 0, &conn, &our_entity, &peer_entity);
+
+    ble_sm_test_util_rx_pair_req(2, peer_entity.pair_cmd, 0);
+    ble_sm_test_util_verify_tx_pair_rsp(our_entity.pair_cmd);
+    ble_sm_test_util_rx_public_key(2, peer_entity.public_key);
+
+    if (ocf == BLE_HCI_OCF_LE_GEN_DHKEY) {
+        ble_sm_test_util_hci_ecc_rd_pubkey(our_entity.public_key);
+    }
+
+    ble_hs_test_util_hci_out_clear();
+    ble_hs_test_util_hci_ack_set(
+        ble_hs_hci_util_opcode_join(BLE_HCI_OGF_LE, ocf), 0);
+    ble_sm_test_util_hci_ecc_run();
+    ble_hs_test_util_hci_verify_tx(BLE_HCI_OGF_LE, ocf, NULL);
+    TEST_ASSERT(ble_sm_num_procs() == 1);
+
+    /* No completion event; the procedure times out. */
+    os_time_advance(ble_npl_time_ms_to_ticks32(30000));
+    ble_sm_timer();
+    TEST_ASSERT(ble_sm_num_procs() == 0);
+    TEST_ASSERT(ble_sm_test_gap_event_type == BLE_GAP_EVENT_ENC_CHANGE);
+    TEST_ASSERT(ble_sm_test_gap_status == BLE_HS_ETIMEOUT);
+    TEST_ASSERT(!conn->bhc_sec_state.encrypted);
+
+    /* A late DHKey result is not attributed to anyone. */
+    if (ocf == BLE_HCI_OCF_LE_GEN_DHKEY) {
+        ble_hs_test_util_hci_rx_gen_dhkey_event(0, zeros);
+        ble_sm_test_util_hci_ecc_run();
+        TEST_ASSERT(ble_sm_num_procs() == 0);
+    }
+
+    /* The next pairing is not stuck behind the abandoned command. */
+    ble_sm_dbg_set_next_pair_rand(our_entity.randoms[0].value);
+    ble_sm_test_util_rx_pair_req(2, peer_entity.pair_cmd, 0);
+    ble_sm_test_util_verify_tx_pair_rsp(our_entity.pair_cmd);
+    ble_sm_test_util_rx_public_key(2, peer_entity.public_key);
+
+    if (ocf == BLE_HCI_OCF_LE_RD_P256_PUBKEY) {
+        ble_sm_test_util_hci_ecc_rd_pubkey(our_entity.public_key);
+    }
+    ble_sm_test_util_hci_ecc_gen_dhkey(peer_entity.public_key,
+                                       params->our_priv_key);
+    ble_sm_test_util_verify_tx_public_key(our_entity.public_key);
+    TEST_ASSERT(ble_sm_num_procs() == 1);
+
+    ble_hs_test_util_conn_disconnect(2);
+    TEST_ASSERT(ble_sm_num_procs() == 0);
+}
+#endif
+
 static void
 ble_sm_test_util_peer_sc_good_once_no_init(struct ble_sm_test_params *params,
                                            struct ble_hs_conn *conn,
@@ -2740,6 +2978,15 @@ ble_sm_test_util_peer_sc_good_once_no_init(struct ble_sm_test_params *params,
     TEST_ASSERT(ble_sm_num_procs() == 1);
     ble_sm_test_util_io_inject_bad(2, params->passkey_info.passkey.action);
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    if (params->hci_ecc) {
+        /* Our key is read, then the DHKey calculated, by the controller. */
+        ble_sm_test_util_hci_ecc_rd_pubkey(our_entity->public_key);
+        ble_sm_test_util_hci_ecc_gen_dhkey(peer_entity->public_key,
+                                           params->our_priv_key);
+    }
+#endif
+
     /* Ensure we sent the expected public key. */
     ble_sm_test_util_verify_tx_public_key(our_entity->public_key);
     TEST_ASSERT(!conn->bhc_sec_state.encrypted);
@@ -3041,6 +3288,15 @@ ble_sm_test_util_repeat_pairing(struct ble_sm_test_params *params, int sc)
     TEST_ASSERT_FATAL(conn != NULL);
     ble_hs_unlock();
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+    if (params->hci_ecc) {
+        /* Have our key read from the controller again, as the pairing
+         * helpers expect.
+         */
+        ble_sm_sc_reset();
+    }
+#endif
+
     /* Receive a pair request from the peer; verify pairing procedure completes
      * successfully.
      */
@@ -64,6 +64,8 @@ struct ble_sm_test_params {
     struct ble_sm_public_key public_key_rsp;
     struct ble_sm_dhkey_check dhkey_check_req;
     struct ble_sm_dhkey_check dhkey_check_rsp;
+    /* Whether the controller does the P-256 operations (BLE_SM_SC_HCI_ECC). */
+    unsigned hci_ecc:1;
 
     /*** Legacy fields. */
     uint8_t stk[16];
@@ -99,6 +101,8 @@ void ble_sm_test_util_rx_sec_req(uint16_t conn_handle,
 void ble_sm_test_util_rx_pair_rsp(uint16_t conn_handle,
                                   struct ble_sm_pair_cmd *rsp,
                                   int rx_status);
+void ble_sm_test_util_rx_public_key(uint16_t conn_handle,
+                                    struct ble_sm_public_key *cmd);
 void ble_sm_test_util_verify_tx_pair_fail(struct ble_sm_pair_fail *exp_cmd);
 void ble_sm_test_util_us_lgcy_good(struct ble_sm_test_params *params);
 void ble_sm_test_util_peer_fail_inval(int we_are_master,
@@ -125,6 +129,21 @@ void ble_sm_test_util_us_sc_good(struct ble_sm_test_params *params);
 void ble_sm_test_util_us_sc_bad(struct ble_sm_test_params *params);
 void ble_sm_test_util_us_fail_inval(struct ble_sm_test_params *params);
 
+#if MYNEWT_VAL(BLE_SM_SC_HCI_ECC)
+void ble_sm_test_util_hci_ecc_init(void);
+void ble_sm_test_util_hci_ecc_run(void);
+void ble_sm_test_util_hci_ecc_rd_pubkey(
+    const struct ble_sm_public_key *our_key);
+void ble_sm_test_util_hci_ecc_gen_dhkey(
+    const struct ble_sm_public_key *peer_key, const uint8_t *our_priv_key);
+void ble_sm_test_util_peer_sc_hci_ecc_fail(struct ble_sm_test_params *params,
+                                           uint16_t ocf, uint8_t ack_status,
+                                           uint8_t evt_status, uint8_t sm_err,
+                                           int app_status);
+void ble_sm_test_util_peer_sc_hci_ecc_timeout(
+    struct ble_sm_test_params *params, uint16_t ocf);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
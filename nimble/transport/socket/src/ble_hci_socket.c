@@ -76,6 +76,7 @@ struct sockaddr_hci {
 
 #include "sysinit/sysinit.h"
 #include "os/os.h"
+#include "os/util.h"
 #include "mem/mem.h"
 
 #include "stats/stats.h"
@@ -87,6 +88,9 @@ struct sockaddr_hci {
 #include "nimble/nimble_npl.h"
 #include "nimble/transport.h"
 #include "socket/ble_hci_socket.h"
+#ifndef MYNEWT
+#include "nimble/nimble_port.h"
+#endif
 
 /***
  * NOTES:
@@ -160,6 +164,20 @@ struct os_task ble_sock_task;
 
 #endif
 
+#if (MYNEWT_VAL(BLE_SOCK_USE_LINUX_BLUE) || MYNEWT_VAL(BLE_SOCK_USE_TCP)) && \
+    MYNEWT_VAL(BLE_SOCK_TX_BATCH) > 0
+#define BLE_HCI_SOCK_TX_BATCH       MYNEWT_VAL(BLE_SOCK_TX_BATCH)
+#else
+#define BLE_HCI_SOCK_TX_BATCH       0
+#endif
+
+/* Max number of iovecs used for a single outgoing ACL/ISO packet */
+#define BLE_HCI_SOCK_PKT_IOV_MAX    8
+
+/* Indexes of ble_hci_sock_state.tx_q */
+#define BLE_HCI_SOCK_TXQ_ACL        0
+#define BLE_HCI_SOCK_TXQ_ISO        1
+
 static struct ble_hci_sock_state {
     int sock;
     struct ble_npl_eventq evq;
@@ -168,6 +186,13 @@ static struct ble_hci_sock_state {
 
     uint16_t rx_off;
     uint8_t rx_data[512];
+#if MYNEWT_VAL(BLE_SOCK_USE_LINUX_BLUE)
+    struct os_mbuf *rx_acl;
+#endif
+#if BLE_HCI_SOCK_TX_BATCH
+    struct ble_npl_event tx_ev;
+    STAILQ_HEAD(, os_mbuf_pkthdr) tx_q[2];
+#endif
 } ble_hci_sock_state;
 
 #if MYNEWT_VAL(BLE_SOCK_USE_TCP)
@@ -179,37 +204,234 @@ static int s_ble_hci_device = 0;
 #endif
 
 #if MYNEWT_VAL(BLE_SOCK_USE_LINUX_BLUE) || MYNEWT_VAL(BLE_SOCK_USE_TCP)
+/* H4 packet indicators, indexed by tx queue */
+static uint8_t ble_hci_sock_tx_h4[2] = {
+    [BLE_HCI_SOCK_TXQ_ACL] = BLE_HCI_UART_H4_ACL,
+    [BLE_HCI_SOCK_TXQ_ISO] = BLE_HCI_UART_H4_ISO,
+};
+
+/*
+ * Describes H4 packet indicator followed by mbuf chain in iovec array.
+ *
+ * Returns number of used iovecs or -1 if chain does not fit.
+ */
 static int
-ble_hci_sock_acl_tx(struct os_mbuf *om)
+ble_hci_sock_pkt_iov(struct iovec *iov, uint8_t *h4, struct os_mbuf *om)
 {
-    struct msghdr msg;
-    struct iovec iov[8];
-    int i;
     struct os_mbuf *m;
-    uint8_t ch;
-
-    memset(&msg, 0, sizeof(msg));
-    memset(iov, 0, sizeof(iov));
-
-    msg.msg_iov = iov;
+    int i;
 
-    ch = BLE_HCI_UART_H4_ACL;
+    iov[0].iov_base = h4;
     iov[0].iov_len = 1;
-    iov[0].iov_base = &ch;
     i = 1;
     for (m = om; m; m = SLIST_NEXT(m, om_next)) {
+        if (i == BLE_HCI_SOCK_PKT_IOV_MAX) {
+            return -1;
+        }
         iov[i].iov_base = m->om_data;
         iov[i].iov_len = m->om_len;
         i++;
     }
+
+    return i;
+}
+
+/*
+ * Packs chains which would not fit in the iovec array, e.g. L2CAP K-frames
+ * referencing many small SDU mbufs, rather than dropping them.
+ */
+static struct os_mbuf *
+ble_hci_sock_pkt_compact(struct os_mbuf *om)
+{
+    struct os_mbuf *m;
+    int cnt;
+
+    /* First iovec is used by H4 packet indicator */
+    cnt = 1;
+    for (m = om; m; m = SLIST_NEXT(m, om_next)) {
+        if (++cnt > BLE_HCI_SOCK_PKT_IOV_MAX) {
+            return os_mbuf_pack_chains(om, NULL);
+        }
+    }
+
+    return om;
+}
+
+#if BLE_HCI_SOCK_TX_BATCH
+/*
+ * Sends all queued packets, up to BLE_HCI_SOCK_TX_BATCH per sendmmsg() call.
+ * Runs from default event queue so that all packets queued by host (or
+ * controller) while processing single event are sent together.
+ */
+static void
+ble_hci_sock_tx_ev(struct ble_npl_event *ev)
+{
+    struct ble_hci_sock_state *bhss = &ble_hci_sock_state;
+    struct mmsghdr msgs[BLE_HCI_SOCK_TX_BATCH];
+    struct iovec iov[BLE_HCI_SOCK_TX_BATCH][BLE_HCI_SOCK_PKT_IOV_MAX];
+    struct os_mbuf *pkts[BLE_HCI_SOCK_TX_BATCH];
+    struct os_mbuf_pkthdr *omp;
+    unsigned int len;
+    int dequeued;
+    int cnt;
+    int off;
+    int sent;
+    int rc;
+    int sr;
+    int q;
+    int i;
+
+    while (1) {
+        dequeued = 0;
+
+        OS_ENTER_CRITICAL(sr);
+        for (q = 0; q < ARRAY_SIZE(bhss->tx_q); q++) {
+            while (dequeued < BLE_HCI_SOCK_TX_BATCH) {
+                omp = STAILQ_FIRST(&bhss->tx_q[q]);
+                if (!omp) {
+                    break;
+                }
+                STAILQ_REMOVE_HEAD(&bhss->tx_q[q], omp_next);
+
+                pkts[dequeued] = OS_MBUF_PKTHDR_TO_MBUF(omp);
+                rc = ble_hci_sock_pkt_iov(iov[dequeued],
+                                          &ble_hci_sock_tx_h4[q],
+                                          pkts[dequeued]);
+                memset(&msgs[dequeued], 0, sizeof(msgs[dequeued]));
+                msgs[dequeued].msg_hdr.msg_iov = iov[dequeued];
+                msgs[dequeued].msg_hdr.msg_iovlen = rc < 0 ? 0 : rc;
+                dequeued++;
+            }
+        }
+        OS_EXIT_CRITICAL(sr);
+
+        if (dequeued == 0) {
+            break;
+        }
+
+        /* Drop packets with too long chains, no need to keep order here */
+        cnt = dequeued;
+        for (i = 0; i < cnt; ) {
+            if (msgs[i].msg_hdr.msg_iovlen) {
+                i++;
+                continue;
+            }
+            STATS_INC(hci_sock_stats, oerr);
+            os_mbuf_free_chain(pkts[i]);
+            cnt--;
+            pkts[i] = pkts[cnt];
+            msgs[i] = msgs[cnt];
+        }
+
+        for (i = 0; i < cnt; i++) {
+            STATS_INC(hci_sock_stats, omsg);
+            STATS_INCN(hci_sock_stats, obytes, OS_MBUF_PKTLEN(pkts[i]) + 1);
+        }
+
+        /* sendmmsg() only reports an error if the first message failed, so
+         * resend the remainder until each message was sent or failed.
+         */
+        for (off = 0; off < cnt; off += sent) {
+            sent = sendmmsg(bhss->sock, &msgs[off], cnt - off, 0);
+            if (sent <= 0) {
+                dprintf(1, "sendmmsg() failed : %d\n", errno);
+                STATS_INC(hci_sock_stats, oerr);
+                sent = 1;
+                continue;
+            }
+
+            for (i = off; i < off + sent; i++) {
+                len = OS_MBUF_PKTLEN(pkts[i]) + 1;
+                if (msgs[i].msg_len != len) {
+                    dprintf(1, "sendmmsg() partial write: %u\n",
+                            msgs[i].msg_len);
+                    STATS_INC(hci_sock_stats, oerr);
+                }
+            }
+        }
+
+        for (i = 0; i < cnt; i++) {
+            os_mbuf_free_chain(pkts[i]);
+        }
+    }
+}
+
+static int
+ble_hci_sock_pkt_tx(struct os_mbuf *om, int q)
+{
+    struct ble_hci_sock_state *bhss = &ble_hci_sock_state;
+    int sr;
+
+    assert(OS_MBUF_IS_PKTHDR(om));
+
+    om = ble_hci_sock_pkt_compact(om);
+
+    OS_ENTER_CRITICAL(sr);
+    STAILQ_INSERT_TAIL(&bhss->tx_q[q], OS_MBUF_PKTHDR(om), omp_next);
+    OS_EXIT_CRITICAL(sr);
+
+#ifdef MYNEWT
+    ble_npl_eventq_put((struct ble_npl_eventq *)os_eventq_dflt_get(),
+                       &bhss->tx_ev);
+#else
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &bhss->tx_ev);
+#endif
+
+    return 0;
+}
+
+static void
+ble_hci_sock_tx_drop(void)
+{
+    struct ble_hci_sock_state *bhss = &ble_hci_sock_state;
+    struct os_mbuf_pkthdr *omp;
+    int sr;
+    int q;
+
+    for (q = 0; q < ARRAY_SIZE(bhss->tx_q); q++) {
+        while (1) {
+            OS_ENTER_CRITICAL(sr);
+            omp = STAILQ_FIRST(&bhss->tx_q[q]);
+            if (omp) {
+                STAILQ_REMOVE_HEAD(&bhss->tx_q[q], omp_next);
+            }
+            OS_EXIT_CRITICAL(sr);
+
+            if (!omp) {
+                break;
+            }
+            os_mbuf_free_chain(OS_MBUF_PKTHDR_TO_MBUF(omp));
+        }
+    }
+}
+#else
+static int
+ble_hci_sock_pkt_tx(struct os_mbuf *om, int q)
+{
+    struct msghdr msg;
+    struct iovec iov[BLE_HCI_SOCK_PKT_IOV_MAX];
+    int len;
+    int i;
+
+    memset(&msg, 0, sizeof(msg));
+
+    om = ble_hci_sock_pkt_compact(om);
+
+    len = OS_MBUF_PKTLEN(om) + 1;
+    i = ble_hci_sock_pkt_iov(iov, &ble_hci_sock_tx_h4[q], om);
+    if (i < 0) {
+        os_mbuf_free_chain(om);
+        STATS_INC(hci_sock_stats, oerr);
+        return BLE_ERR_MEM_CAPACITY;
+    }
+    msg.msg_iov = iov;
     msg.msg_iovlen = i;
 
     STATS_INC(hci_sock_stats, omsg);
-    STATS_INC(hci_sock_stats, oacl);
-    STATS_INCN(hci_sock_stats, obytes, OS_MBUF_PKTLEN(om) + 1);
+    STATS_INCN(hci_sock_stats, obytes, len);
     i = sendmsg(ble_hci_sock_state.sock, &msg, 0);
     os_mbuf_free_chain(om);
-    if (i != OS_MBUF_PKTLEN(om) + 1) {
+    if (i != len) {
         if (i < 0) {
             dprintf(1, "sendmsg() failed : %d\n", errno);
         } else {
@@ -220,6 +442,15 @@ ble_hci_sock_acl_tx(struct os_mbuf *om)
     }
     return 0;
 }
+#endif
+
+static int
+ble_hci_sock_acl_tx(struct os_mbuf *om)
+{
+    STATS_INC(hci_sock_stats, oacl);
+
+    return ble_hci_sock_pkt_tx(om, BLE_HCI_SOCK_TXQ_ACL);
+}
 #elif MYNEWT_VAL(BLE_SOCK_USE_NUTTX)
 static int
 ble_hci_sock_acl_tx(struct os_mbuf *om)
@@ -279,43 +510,9 @@ ble_hci_sock_acl_tx(struct os_mbuf *om)
 static int
 ble_hci_sock_iso_tx(struct os_mbuf *om)
 {
-    struct msghdr msg;
-    struct iovec iov[8];
-    int i;
-    struct os_mbuf *m;
-    uint8_t ch;
-
-    memset(&msg, 0, sizeof(msg));
-    memset(iov, 0, sizeof(iov));
-
-    msg.msg_iov = iov;
-
-    ch = BLE_HCI_UART_H4_ISO;
-    iov[0].iov_len = 1;
-    iov[0].iov_base = &ch;
-    i = 1;
-    for (m = om; m; m = SLIST_NEXT(m, om_next)) {
-        iov[i].iov_base = m->om_data;
-        iov[i].iov_len = m->om_len;
-        i++;
-    }
-    msg.msg_iovlen = i;
-
-    STATS_INC(hci_sock_stats, omsg);
     STATS_INC(hci_sock_stats, oiso);
-    STATS_INCN(hci_sock_stats, obytes, OS_MBUF_PKTLEN(om) + 1);
-    i = sendmsg(ble_hci_sock_state.sock, &msg, 0);
-    os_mbuf_free_chain(om);
-    if (i != OS_MBUF_PKTLEN(om) + 1) {
-        if (i < 0) {
-            dprintf(1, "sendmsg() failed : %d\n", errno);
-        } else {
-            dprintf(1, "sendmsg() partial write: %d\n", i);
-        }
-        STATS_INC(hci_sock_stats, oerr);
-        return BLE_ERR_MEM_CAPACITY;
-    }
-    return 0;
+
+    return ble_hci_sock_pkt_tx(om, BLE_HCI_SOCK_TXQ_ISO);
 }
 #endif /* BLE_SOCK_USE_LINUX_BLUE */
 
@@ -421,162 +618,280 @@ ble_hci_sock_cmdevt_tx(uint8_t *hci_ev, uint8_t h4_type)
 }
 #endif
 
+static struct os_mbuf *
+ble_hci_sock_acl_alloc(void)
+{
+#if MYNEWT_VAL(BLE_CONTROLLER)
+    return ble_transport_alloc_acl_from_hs();
+#else
+    return ble_transport_alloc_acl_from_ll();
+#endif
+}
+
+static void
+ble_hci_sock_acl_rx(struct os_mbuf *m)
+{
+    int sr;
+
+    OS_ENTER_CRITICAL(sr);
+#if MYNEWT_VAL(BLE_CONTROLLER)
+    ble_transport_to_ll_acl(m);
+#else
+    ble_transport_to_hs_acl(m);
+#endif
+    OS_EXIT_CRITICAL(sr);
+}
+
+/*
+ * Parses a single H4 packet from the start of 'pkt'.
+ *
+ * Returns the number of bytes consumed, 0 if the packet is not complete yet,
+ * or -1 if the packet could not be delivered and should be retried later.
+ */
 static int
-ble_hci_sock_rx_msg(void)
+ble_hci_sock_rx_pkt(const uint8_t *pkt, int avail)
 {
-    struct ble_hci_sock_state *bhss;
-    int len;
     struct os_mbuf *m;
     uint8_t *data;
+    int len;
     int sr;
     int rc;
 
-    bhss = &ble_hci_sock_state;
-    if (bhss->sock < 0) {
-        return -1;
-    }
-    len = read(bhss->sock, bhss->rx_data + bhss->rx_off,
-               sizeof(bhss->rx_data) - bhss->rx_off);
-    if (len < 0) {
-        return -2;
-    }
-    if (len == 0) {
-        return -1;
-    }
-    bhss->rx_off += len;
-    STATS_INCN(hci_sock_stats, ibytes, len);
-
-    while (bhss->rx_off > 0) {
-        switch (bhss->rx_data[0]) {
+    switch (pkt[0]) {
 #if MYNEWT_VAL(BLE_CONTROLLER)
-        case BLE_HCI_UART_H4_CMD:
-            if (bhss->rx_off < sizeof(struct ble_hci_cmd)) {
-                return -1;
-            }
-            len = 1 + sizeof(struct ble_hci_cmd) + bhss->rx_data[3];
-            if (bhss->rx_off < len) {
-                return -1;
-            }
-            STATS_INC(hci_sock_stats, imsg);
-            STATS_INC(hci_sock_stats, icmd);
-            data = ble_transport_alloc_cmd();
-            if (!data) {
-                STATS_INC(hci_sock_stats, ierr);
-                break;
-            }
-            memcpy(data, &bhss->rx_data[1], len - 1);
-            OS_ENTER_CRITICAL(sr);
-            rc = ble_transport_to_ll_cmd(data);
-            OS_EXIT_CRITICAL(sr);
-            if (rc) {
-                ble_transport_free(data);
-                STATS_INC(hci_sock_stats, ierr);
-                break;
-            }
+    case BLE_HCI_UART_H4_CMD:
+        if (avail < 1 + sizeof(struct ble_hci_cmd)) {
+            return 0;
+        }
+        len = 1 + sizeof(struct ble_hci_cmd) + pkt[3];
+        if (avail < len) {
+            return 0;
+        }
+        STATS_INC(hci_sock_stats, imsg);
+        STATS_INC(hci_sock_stats, icmd);
+        data = ble_transport_alloc_cmd();
+        if (!data) {
+            STATS_INC(hci_sock_stats, ierr);
+            break;
+        }
+        memcpy(data, &pkt[1], len - 1);
+        OS_ENTER_CRITICAL(sr);
+        rc = ble_transport_to_ll_cmd(data);
+        OS_EXIT_CRITICAL(sr);
+        if (rc) {
+            ble_transport_free(data);
+            STATS_INC(hci_sock_stats, ierr);
             break;
+        }
+        break;
 #endif
 #if MYNEWT_VAL(BLE_HOST)
-        case BLE_HCI_UART_H4_EVT:
-            if (bhss->rx_off < sizeof(struct ble_hci_ev)) {
-                return -1;
-            }
-            len = 1 + sizeof(struct ble_hci_ev) + bhss->rx_data[2];
-            if (bhss->rx_off < len) {
-                return -1;
-            }
-            STATS_INC(hci_sock_stats, imsg);
-            STATS_INC(hci_sock_stats, ievt);
-            data = ble_transport_alloc_evt(0);
-            if (!data) {
-                STATS_INC(hci_sock_stats, ierr);
-                break;
-            }
-            memcpy(data, &bhss->rx_data[1], len - 1);
-            OS_ENTER_CRITICAL(sr);
-            rc = ble_transport_to_hs_evt(data);
-            OS_EXIT_CRITICAL(sr);
-            if (rc) {
-                ble_transport_free(data);
-                STATS_INC(hci_sock_stats, ierr);
-                return 0;
-            }
+    case BLE_HCI_UART_H4_EVT:
+        if (avail < 1 + sizeof(struct ble_hci_ev)) {
+            return 0;
+        }
+        len = 1 + sizeof(struct ble_hci_ev) + pkt[2];
+        if (avail < len) {
+            return 0;
+        }
+        STATS_INC(hci_sock_stats, imsg);
+        STATS_INC(hci_sock_stats, ievt);
+        data = ble_transport_alloc_evt(0);
+        if (!data) {
+            STATS_INC(hci_sock_stats, ierr);
             break;
+        }
+        memcpy(data, &pkt[1], len - 1);
+        OS_ENTER_CRITICAL(sr);
+        rc = ble_transport_to_hs_evt(data);
+        OS_EXIT_CRITICAL(sr);
+        if (rc) {
+            ble_transport_free(data);
+            STATS_INC(hci_sock_stats, ierr);
+            return -1;
+        }
+        break;
 #endif
-        case BLE_HCI_UART_H4_ACL:
-            if (bhss->rx_off < BLE_HCI_DATA_HDR_SZ) {
-                return -1;
-            }
-            len = 1 + BLE_HCI_DATA_HDR_SZ + (bhss->rx_data[4] << 8) +
-              bhss->rx_data[3];
-            if (bhss->rx_off < len) {
-                return -1;
-            }
-            STATS_INC(hci_sock_stats, imsg);
-            STATS_INC(hci_sock_stats, iacl);
-#if MYNEWT_VAL(BLE_CONTROLLER)
-            m = ble_transport_alloc_acl_from_hs();
-#else
-            m = ble_transport_alloc_acl_from_ll();
-#endif
-            if (!m) {
-                STATS_INC(hci_sock_stats, imem);
-                break;
-            }
-            if (os_mbuf_append(m, &bhss->rx_data[1], len - 1)) {
-                STATS_INC(hci_sock_stats, imem);
-                os_mbuf_free_chain(m);
-                break;
-            }
-            OS_ENTER_CRITICAL(sr);
+    case BLE_HCI_UART_H4_ACL:
+        if (avail < 1 + BLE_HCI_DATA_HDR_SZ) {
+            return 0;
+        }
+        len = 1 + BLE_HCI_DATA_HDR_SZ + get_le16(&pkt[3]);
+        if (avail < len) {
+            return 0;
+        }
+        STATS_INC(hci_sock_stats, imsg);
+        STATS_INC(hci_sock_stats, iacl);
+        m = ble_hci_sock_acl_alloc();
+        if (!m) {
+            STATS_INC(hci_sock_stats, imem);
+            break;
+        }
+        if (os_mbuf_append(m, &pkt[1], len - 1)) {
+            STATS_INC(hci_sock_stats, imem);
+            os_mbuf_free_chain(m);
+            break;
+        }
+        ble_hci_sock_acl_rx(m);
+        break;
+    case BLE_HCI_UART_H4_ISO:
+        if (avail < 1 + BLE_HCI_DATA_HDR_SZ) {
+            return 0;
+        }
+        len = 1 + BLE_HCI_DATA_HDR_SZ + get_le16(&pkt[3]);
+        if (avail < len) {
+            return 0;
+        }
+        STATS_INC(hci_sock_stats, imsg);
+        STATS_INC(hci_sock_stats, iiso);
 #if MYNEWT_VAL(BLE_CONTROLLER)
-            ble_transport_to_ll_acl(m);
+        m = ble_transport_alloc_iso_from_hs();
 #else
-            ble_transport_to_hs_acl(m);
+        m = ble_transport_alloc_iso_from_ll();
 #endif
-            OS_EXIT_CRITICAL(sr);
+        if (!m) {
+            STATS_INC(hci_sock_stats, imem);
             break;
-        case BLE_HCI_UART_H4_ISO:
-            if (bhss->rx_off < BLE_HCI_DATA_HDR_SZ) {
-                return -1;
-            }
-            len = 1 + BLE_HCI_DATA_HDR_SZ + (bhss->rx_data[4] << 8) +
-                  bhss->rx_data[3];
-            if (bhss->rx_off < len) {
-                return -1;
-            }
-            STATS_INC(hci_sock_stats, imsg);
-            STATS_INC(hci_sock_stats, iiso);
+        }
+        if (os_mbuf_append(m, &pkt[1], len - 1)) {
+            STATS_INC(hci_sock_stats, imem);
+            os_mbuf_free_chain(m);
+            break;
+        }
+        OS_ENTER_CRITICAL(sr);
 #if MYNEWT_VAL(BLE_CONTROLLER)
-            m = ble_transport_alloc_iso_from_hs();
+        ble_transport_to_ll_iso(m);
 #else
-            m = ble_transport_alloc_iso_from_ll();
+        ble_transport_to_hs_iso(m);
 #endif
-            if (!m) {
-                STATS_INC(hci_sock_stats, imem);
-                break;
-            }
-            if (os_mbuf_append(m, &bhss->rx_data[1], len - 1)) {
-                STATS_INC(hci_sock_stats, imem);
-                os_mbuf_free_chain(m);
-                break;
-            }
-            OS_ENTER_CRITICAL(sr);
-#if MYNEWT_VAL(BLE_CONTROLLER)
-            ble_transport_to_ll_iso(m);
+        OS_EXIT_CRITICAL(sr);
+        break;
+    default:
+        /* Unknown packet type, drop a byte and try to resync */
+        STATS_INC(hci_sock_stats, ierr);
+        len = 1;
+        break;
+    }
+
+    return len;
+}
+
+#if MYNEWT_VAL(BLE_SOCK_USE_LINUX_BLUE)
+/*
+ * HCI user channel preserves packet boundaries, so each read returns exactly
+ * one H4 packet. Scatter the read so that everything following the packet
+ * indicator lands directly in a preallocated ACL mbuf. ACL packets are then
+ * handed over without any copy; other packets are moved back in front of the
+ * overflow part in rx_data and parsed as usual.
+ *
+ * Returns number of bytes placed in rx_data, 0 if the packet was consumed
+ * here, or -1 on socket error/EOF.
+ */
+static int
+ble_hci_sock_rx_read(struct ble_hci_sock_state *bhss)
+{
+    struct iovec iov[3];
+    struct os_mbuf *m;
+    uint16_t cap;
+    int len;
+
+    if (!bhss->rx_acl) {
+        bhss->rx_acl = ble_hci_sock_acl_alloc();
+    }
+    m = bhss->rx_acl;
+    if (!m || bhss->rx_off) {
+        len = read(bhss->sock, bhss->rx_data + bhss->rx_off,
+                   sizeof(bhss->rx_data) - bhss->rx_off);
+        return len > 0 ? len : -1;
+    }
+
+    cap = OS_MBUF_TRAILINGSPACE(m);
+    if (cap > sizeof(bhss->rx_data) - 1) {
+        cap = sizeof(bhss->rx_data) - 1;
+    }
+
+    iov[0].iov_base = bhss->rx_data;
+    iov[0].iov_len = 1;
+    iov[1].iov_base = m->om_data;
+    iov[1].iov_len = cap;
+    iov[2].iov_base = bhss->rx_data + 1 + cap;
+    iov[2].iov_len = sizeof(bhss->rx_data) - 1 - cap;
+
+    len = readv(bhss->sock, iov, 3);
+    if (len <= 0) {
+        return -1;
+    }
+
+    if (bhss->rx_data[0] == BLE_HCI_UART_H4_ACL &&
+        len - 1 >= BLE_HCI_DATA_HDR_SZ && len - 1 <= cap &&
+        len - 1 == BLE_HCI_DATA_HDR_SZ + get_le16(&m->om_data[2])) {
+        STATS_INCN(hci_sock_stats, ibytes, len);
+        STATS_INC(hci_sock_stats, imsg);
+        STATS_INC(hci_sock_stats, iacl);
+        m->om_len = len - 1;
+        OS_MBUF_PKTHDR(m)->omp_len = len - 1;
+        bhss->rx_acl = NULL;
+        ble_hci_sock_acl_rx(m);
+        return 0;
+    }
+
+    memcpy(&bhss->rx_data[1], m->om_data, len - 1 < cap ? len - 1 : cap);
+
+    return len;
+}
 #else
-            ble_transport_to_hs_iso(m);
+static int
+ble_hci_sock_rx_read(struct ble_hci_sock_state *bhss)
+{
+    int len;
+
+    len = read(bhss->sock, bhss->rx_data + bhss->rx_off,
+               sizeof(bhss->rx_data) - bhss->rx_off);
+
+    return len > 0 ? len : -1;
+}
 #endif
-            OS_EXIT_CRITICAL(sr);
-            break;
-        default:
-            STATS_INC(hci_sock_stats, ierr);
+
+static int
+ble_hci_sock_rx_msg(void)
+{
+    struct ble_hci_sock_state *bhss;
+    uint16_t off;
+    int len;
+    int rc;
+
+    bhss = &ble_hci_sock_state;
+    if (bhss->sock < 0) {
+        return -1;
+    }
+    len = ble_hci_sock_rx_read(bhss);
+    if (len < 0) {
+        return -1;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    bhss->rx_off += len;
+    STATS_INCN(hci_sock_stats, ibytes, len);
+
+    /* Parse all complete packets first and compact the buffer only once */
+    rc = 0;
+    off = 0;
+    while (off < bhss->rx_off) {
+        len = ble_hci_sock_rx_pkt(&bhss->rx_data[off], bhss->rx_off - off);
+        if (len <= 0) {
+            rc = len ? 0 : -1;
             break;
         }
+        off += len;
+    }
 
-        memmove(bhss->rx_data, &bhss->rx_data[len], bhss->rx_off - len);
-        bhss->rx_off -= len;
+    if (off) {
+        memmove(bhss->rx_data, &bhss->rx_data[off], bhss->rx_off - off);
+        bhss->rx_off -= off;
     }
-    return 0;
+
+    return rc;
 }
 
 static void
@@ -831,6 +1146,10 @@ ble_hci_trans_reset(void)
 
     ble_npl_callout_stop(&ble_hci_sock_state.timer);
 
+#if BLE_HCI_SOCK_TX_BATCH
+    ble_hci_sock_tx_drop();
+#endif
+
     /* Reopen the UART. */
     rc = ble_hci_sock_config();
     if (rc != 0) {
@@ -905,6 +1224,11 @@ ble_hci_sock_init(void)
 
     ble_hci_sock_init_task();
     ble_npl_event_init(&ble_hci_sock_state.ev, ble_hci_sock_rx_ev, NULL);
+#if BLE_HCI_SOCK_TX_BATCH
+    ble_npl_event_init(&ble_hci_sock_state.tx_ev, ble_hci_sock_tx_ev, NULL);
+    STAILQ_INIT(&ble_hci_sock_state.tx_q[BLE_HCI_SOCK_TXQ_ACL]);
+    STAILQ_INIT(&ble_hci_sock_state.tx_q[BLE_HCI_SOCK_TXQ_ISO]);
+#endif
 
     rc = ble_hci_sock_config();
     SYSINIT_PANIC_ASSERT_MSG(rc == 0, "Failure configuring socket HCI");
@@ -223,6 +223,10 @@
 #define MYNEWT_VAL_OS_MEMPOOL_GUARD (0)
 #endif
 
+#ifndef MYNEWT_VAL_OS_MEMPOOL_MAGAZINE_SIZE
+#define MYNEWT_VAL_OS_MEMPOOL_MAGAZINE_SIZE (0)
+#endif
+
 #ifndef MYNEWT_VAL_OS_MEMPOOL_POISON
 #define MYNEWT_VAL_OS_MEMPOOL_POISON (0)
 #endif
@@ -581,6 +585,10 @@
 #define MYNEWT_VAL_BLE_ATT_SVR_SIGNED_WRITE (1)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_ATT_SVR_UUID_HASH_SIZE
+#define MYNEWT_VAL_BLE_ATT_SVR_UUID_HASH_SIZE (16)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_ATT_SVR_WRITE
 #define MYNEWT_VAL_BLE_ATT_SVR_WRITE (1)
 #endif
@@ -777,6 +785,10 @@
 #define MYNEWT_VAL_BLE_ISO_MAX_BISES (4)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_L2CAP_COC_AUTO_CREDITS
+#define MYNEWT_VAL_BLE_L2CAP_COC_AUTO_CREDITS (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_L2CAP_COC_MAX_NUM
 #define MYNEWT_VAL_BLE_L2CAP_COC_MAX_NUM (0)
 #endif
@@ -789,6 +801,10 @@
 #define MYNEWT_VAL_BLE_L2CAP_COC_SDU_BUFF_COUNT (1)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_L2CAP_COC_STATS
+#define MYNEWT_VAL_BLE_L2CAP_COC_STATS (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_L2CAP_ENHANCED_COC
 #define MYNEWT_VAL_BLE_L2CAP_ENHANCED_COC (0)
 #endif
@@ -865,6 +881,22 @@
 #define MYNEWT_VAL_BLE_SM_SC_DEBUG_KEYS (0)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_SM_SC_HCI_ECC
+#define MYNEWT_VAL_BLE_SM_SC_HCI_ECC (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_SM_SC_KEY_POOL_SIZE
+#define MYNEWT_VAL_BLE_SM_SC_KEY_POOL_SIZE (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_SM_SC_KEY_ROTATE_PAIRINGS
+#define MYNEWT_VAL_BLE_SM_SC_KEY_ROTATE_PAIRINGS (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_SM_SC_KEY_ROTATE_TIME
+#define MYNEWT_VAL_BLE_SM_SC_KEY_ROTATE_TIME (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_SM_SC_ONLY
 #define MYNEWT_VAL_BLE_SM_SC_ONLY (0)
 #endif
@@ -1206,6 +1238,10 @@
 #define MYNEWT_VAL_BLE_SOCK_TCP_PORT (14433)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_SOCK_TX_BATCH
+#define MYNEWT_VAL_BLE_SOCK_TX_BATCH (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_SOCK_USE_LINUX_BLUE
 #define MYNEWT_VAL_BLE_SOCK_USE_LINUX_BLUE (1)
 #endif
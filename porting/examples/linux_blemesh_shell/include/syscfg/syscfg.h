@@ -230,6 +230,10 @@
 #define MYNEWT_VAL_OS_MEMPOOL_GUARD (0)
 #endif
 
+#ifndef MYNEWT_VAL_OS_MEMPOOL_MAGAZINE_SIZE
+#define MYNEWT_VAL_OS_MEMPOOL_MAGAZINE_SIZE (0)
+#endif
+
 #ifndef MYNEWT_VAL_OS_MEMPOOL_POISON
 #define MYNEWT_VAL_OS_MEMPOOL_POISON (0)
 #endif
@@ -602,6 +606,10 @@
 #define MYNEWT_VAL_BLE_ATT_SVR_SIGNED_WRITE (1)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_ATT_SVR_UUID_HASH_SIZE
+#define MYNEWT_VAL_BLE_ATT_SVR_UUID_HASH_SIZE (16)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_ATT_SVR_WRITE
 #define MYNEWT_VAL_BLE_ATT_SVR_WRITE (1)
 #endif
@@ -790,6 +798,10 @@
 #define MYNEWT_VAL_BLE_HS_SYSINIT_STAGE (200)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_L2CAP_COC_AUTO_CREDITS
+#define MYNEWT_VAL_BLE_L2CAP_COC_AUTO_CREDITS (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_L2CAP_COC_MAX_NUM
 #define MYNEWT_VAL_BLE_L2CAP_COC_MAX_NUM (0)
 #endif
@@ -802,6 +814,10 @@
 #define MYNEWT_VAL_BLE_L2CAP_COC_SDU_BUFF_COUNT (1)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_L2CAP_COC_STATS
+#define MYNEWT_VAL_BLE_L2CAP_COC_STATS (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_L2CAP_ENHANCED_COC
 #define MYNEWT_VAL_BLE_L2CAP_ENHANCED_COC (0)
 #endif
@@ -888,6 +904,22 @@
 #define MYNEWT_VAL_BLE_SM_SC_DEBUG_KEYS (0)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_SM_SC_HCI_ECC
+#define MYNEWT_VAL_BLE_SM_SC_HCI_ECC (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_SM_SC_KEY_POOL_SIZE
+#define MYNEWT_VAL_BLE_SM_SC_KEY_POOL_SIZE (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_SM_SC_KEY_ROTATE_PAIRINGS
+#define MYNEWT_VAL_BLE_SM_SC_KEY_ROTATE_PAIRINGS (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_SM_SC_KEY_ROTATE_TIME
+#define MYNEWT_VAL_BLE_SM_SC_KEY_ROTATE_TIME (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_SM_SC_ONLY
 #define MYNEWT_VAL_BLE_SM_SC_ONLY (0)
 #endif
@@ -1207,6 +1239,10 @@
 #define MYNEWT_VAL_BLE_MESH_MODEL_LOG_MOD (16)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_MESH_MODEL_OP_TABLE_SIZE
+#define MYNEWT_VAL_BLE_MESH_MODEL_OP_TABLE_SIZE (0)
+#endif
+
 /* Overridden by @apache-mynewt-nimble/porting/targets/linux_blemesh (defined by @apache-mynewt-nimble/nimble/host/mesh) */
 #ifndef MYNEWT_VAL_BLE_MESH_MODEL_VND_MSG_CID_FORCE
 #define MYNEWT_VAL_BLE_MESH_MODEL_VND_MSG_CID_FORCE (1)
@@ -1824,6 +1860,10 @@
 #endif
 
 /* Overridden by @apache-mynewt-nimble/porting/targets/linux_blemesh (defined by @apache-mynewt-nimble/nimble/transport/socket) */
+#ifndef MYNEWT_VAL_BLE_SOCK_TX_BATCH
+#define MYNEWT_VAL_BLE_SOCK_TX_BATCH (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_SOCK_USE_LINUX_BLUE
 #define MYNEWT_VAL_BLE_SOCK_USE_LINUX_BLUE (1)
 #endif
@@ -79,6 +79,12 @@ struct os_mempool {
  */
 #define OS_MEMPOOL_F_EXT        0x01
 
+/**
+ * Indicates that blocks of this pool are cached in per-thread magazines.  See
+ * os_mempool_magazine_enable().
+ */
+#define OS_MEMPOOL_F_MAGAZINE   0x02
+
 struct os_mempool_ext;
 
 /**
@@ -211,6 +217,22 @@ os_error_t os_mempool_ext_init(struct os_mempool_ext *mpe, uint16_t blocks,
  */
 os_error_t os_mempool_unregister(struct os_mempool *mp);
 
+/**
+ * Enables per-thread caching of free blocks for a memory pool.  Each thread
+ * keeps up to OS_MEMPOOL_MAGAZINE_SIZE free blocks of the pool and only
+ * takes the pool lock to exchange blocks with the shared free list in
+ * batches.  Blocks held in magazines still count as free in mp_num_free;
+ * when the shared free list runs dry, a thread takes blocks from other
+ * threads' magazines.
+ *
+ * This is a no-op unless OS_MEMPOOL_MAGAZINE_SIZE is non-zero, which is only
+ * supported on ports with POSIX threads.  A pool with magazines enabled must
+ * not be cleared with os_mempool_clear().
+ *
+ * @param mp                    The mempool to enable magazines for.
+ */
+void os_mempool_magazine_enable(struct os_mempool *mp);
+
 /**
  * Clears a memory pool.
  *
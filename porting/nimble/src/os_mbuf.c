@@ -412,64 +412,94 @@ os_mbuf_len(const struct os_mbuf *om)
     return len;
 }
 
-int
-os_mbuf_append(struct os_mbuf *om, const void *data,  uint16_t len)
+/**
+ * Copies data to the end of a chain whose last mbuf is already known, and
+ * allocates new mbufs from the pool as required.
+ *
+ * @param omp                   The pool to allocate new mbufs from.
+ * @param last                  On entry, the last mbuf of the chain; on
+ *                                  exit, the new last mbuf.
+ * @param data                  The data to copy.
+ * @param len                   The number of bytes to copy.
+ *
+ * @return                      The number of bytes that could not be copied
+ *                                  due to lack of mbufs.
+ */
+static int
+os_mbuf_append_tail(struct os_mbuf_pool *omp, struct os_mbuf **last,
+                    const uint8_t *data, int len)
 {
-    struct os_mbuf_pool *omp;
-    struct os_mbuf *last;
     struct os_mbuf *new;
-    int remainder;
+    struct os_mbuf *cur;
     int space;
-    int rc;
-
-    if (om == NULL) {
-        rc = OS_EINVAL;
-        goto err;
-    }
 
-    omp = om->om_omp;
-
-    /* Scroll to last mbuf in the chain */
-    last = om;
-    while (SLIST_NEXT(last, om_next) != NULL) {
-        last = SLIST_NEXT(last, om_next);
-    }
-
-    remainder = len;
-    space = OS_MBUF_TRAILINGSPACE(last);
+    cur = *last;
+    space = OS_MBUF_TRAILINGSPACE(cur);
 
     /* If room in current mbuf, copy the first part of the data into the
      * remaining space in that mbuf.
      */
     if (space > 0) {
-        if (space > remainder) {
-            space = remainder;
+        if (space > len) {
+            space = len;
         }
 
-        memcpy(OS_MBUF_DATA(last, uint8_t *) + last->om_len , data, space);
+        memcpy(OS_MBUF_DATA(cur, uint8_t *) + cur->om_len, data, space);
 
-        last->om_len += space;
+        cur->om_len += space;
         data += space;
-        remainder -= space;
+        len -= space;
     }
 
     /* Take the remaining data, and keep allocating new mbufs and copying
      * data into it, until data is exhausted.
      */
-    while (remainder > 0) {
+    while (len > 0) {
         new = os_mbuf_get(omp, 0);
         if (!new) {
             break;
         }
 
-        new->om_len = min(omp->omp_databuf_len, remainder);
+        new->om_len = min(omp->omp_databuf_len, len);
         memcpy(OS_MBUF_DATA(new, void *), data, new->om_len);
         data += new->om_len;
-        remainder -= new->om_len;
-        SLIST_NEXT(last, om_next) = new;
-        last = new;
+        len -= new->om_len;
+        SLIST_NEXT(cur, om_next) = new;
+        cur = new;
+    }
+
+    *last = cur;
+
+    return len;
+}
+
+static struct os_mbuf *
+os_mbuf_last(struct os_mbuf *om)
+{
+    while (SLIST_NEXT(om, om_next) != NULL) {
+        om = SLIST_NEXT(om, om_next);
     }
 
+    return om;
+}
+
+int
+os_mbuf_append(struct os_mbuf *om, const void *data,  uint16_t len)
+{
+    struct os_mbuf *last;
+    int remainder;
+    int rc;
+
+    if (om == NULL) {
+        rc = OS_EINVAL;
+        goto err;
+    }
+
+    /* Scroll to last mbuf in the chain */
+    last = os_mbuf_last(om);
+
+    remainder = os_mbuf_append_tail(om->om_omp, &last, data, len);
+
     /* Adjust the packet header length in the buffer */
     if (OS_MBUF_IS_PKTHDR(om)) {
         OS_MBUF_PKTHDR(om)->omp_len += len - remainder;
@@ -491,9 +521,19 @@ os_mbuf_appendfrom(struct os_mbuf *dst, const struct os_mbuf *src,
                    uint16_t src_off, uint16_t len)
 {
     const struct os_mbuf *src_cur_om;
+    struct os_mbuf *last;
     uint16_t src_cur_off;
     uint16_t chunk_sz;
-    int rc;
+    int remainder;
+
+    if (dst == NULL) {
+        return OS_EINVAL;
+    }
+
+    /* The destination tail is located once and then tracked while copying,
+     * rather than rescanning the chain for every source mbuf.
+     */
+    last = os_mbuf_last(dst);
 
     src_cur_om = os_mbuf_off(src, src_off, &src_cur_off);
     while (len > 0) {
@@ -502,9 +542,16 @@ os_mbuf_appendfrom(struct os_mbuf *dst, const struct os_mbuf *src,
         }
 
         chunk_sz = min(len, src_cur_om->om_len - src_cur_off);
-        rc = os_mbuf_append(dst, src_cur_om->om_data + src_cur_off, chunk_sz);
-        if (rc != 0) {
-            return rc;
+        remainder = os_mbuf_append_tail(dst->om_omp, &last,
+                                        src_cur_om->om_data + src_cur_off,
+                                        chunk_sz);
+
+        if (OS_MBUF_IS_PKTHDR(dst)) {
+            OS_MBUF_PKTHDR(dst)->omp_len += chunk_sz - remainder;
+        }
+
+        if (remainder != 0) {
+            return OS_ENOMEM;
         }
 
         len -= chunk_sz;
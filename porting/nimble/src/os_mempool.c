@@ -24,6 +24,9 @@
 #include <assert.h>
 #include <stdbool.h>
 #include "syscfg/syscfg.h"
+#if MYNEWT_VAL(OS_MEMPOOL_MAGAZINE_SIZE) > 0
+#include <pthread.h>
+#endif
 #if !MYNEWT_VAL(OS_SYSVIEW_TRACE_MEMPOOL)
 #define OS_TRACE_DISABLE_FILE_API
 #endif
@@ -116,6 +119,310 @@ os_mempool_guard_check(const struct os_mempool *mp, void *start)
 #define os_mempool_guard_check(mp, start)
 #endif
 
+#if MYNEWT_VAL(OS_MEMPOOL_MAGAZINE_SIZE) > 0
+/* Number of distinct pools a single thread can cache blocks for */
+#define OS_MEMPOOL_MAG_POOLS    (4)
+/* Number of blocks exchanged with the shared free list at once */
+#define OS_MEMPOOL_MAG_BATCH                                            \
+    ((MYNEWT_VAL(OS_MEMPOOL_MAGAZINE_SIZE) + 1) / 2)
+
+/*
+ * Per-thread cache of free blocks of a single pool.  Blocks are chained
+ * through mb_next, same as on the shared free list.  The owning thread holds
+ * the busy flag while using the magazine; other threads only try to take it
+ * when stealing blocks, so it is practically never contended.
+ */
+struct os_mempool_mag {
+    struct os_mempool *mp;
+    struct os_memblock *head;
+    uint16_t count;
+    uint8_t busy;
+};
+
+/* All magazines of a single thread */
+struct os_mempool_mag_set {
+    struct os_mempool_mag mags[OS_MEMPOOL_MAG_POOLS];
+    SLIST_ENTRY(os_mempool_mag_set) next;
+    bool registered;
+};
+
+static __thread struct os_mempool_mag_set os_mempool_mag_set;
+static pthread_key_t os_mempool_mag_key;
+static pthread_once_t os_mempool_mag_once = PTHREAD_ONCE_INIT;
+
+/* Magazine sets of all live threads; protected by OS_ENTER_CRITICAL */
+static SLIST_HEAD(, os_mempool_mag_set) os_mempool_mag_sets;
+
+/*
+ * Blocks cached in magazines are still free, so mp_num_free is adjusted
+ * outside of the critical section and all updates need to be atomic.  Any
+ * thread can get a cached block by stealing it, so the count is accurate for
+ * os_msys_find_pool() and friends.
+ */
+#define os_mempool_num_free_add(mp, n)                                  \
+    __atomic_add_fetch(&(mp)->mp_num_free, (n), __ATOMIC_RELAXED)
+#define os_mempool_num_free_sub(mp, n)                                  \
+    __atomic_sub_fetch(&(mp)->mp_num_free, (n), __ATOMIC_RELAXED)
+
+static void
+os_mempool_min_free_update(struct os_mempool *mp, uint16_t num_free)
+{
+    if (__atomic_load_n(&mp->mp_min_free, __ATOMIC_RELAXED) > num_free) {
+        __atomic_store_n(&mp->mp_min_free, num_free, __ATOMIC_RELAXED);
+    }
+}
+
+static bool
+os_mempool_mag_trylock(struct os_mempool_mag *mag)
+{
+    return !__atomic_test_and_set(&mag->busy, __ATOMIC_ACQUIRE);
+}
+
+static void
+os_mempool_mag_lock(struct os_mempool_mag *mag)
+{
+    /* Only a stealing thread can hold it, and only for a few instructions */
+    while (!os_mempool_mag_trylock(mag)) {
+    }
+}
+
+static void
+os_mempool_mag_unlock(struct os_mempool_mag *mag)
+{
+    __atomic_clear(&mag->busy, __ATOMIC_RELEASE);
+}
+
+/*
+ * Moves up to cnt blocks from the magazine back to the shared free list.
+ * Caller must own the magazine.
+ */
+static void
+os_mempool_mag_flush(struct os_mempool_mag *mag, uint16_t cnt)
+{
+    struct os_memblock *first;
+    struct os_memblock *last;
+    uint16_t i;
+    os_sr_t sr;
+
+    if ((mag->head == NULL) || (cnt == 0)) {
+        return;
+    }
+
+    /* Detach the blocks before entering the critical section */
+    first = mag->head;
+    last = first;
+    for (i = 1; (i < cnt) && (SLIST_NEXT(last, mb_next) != NULL); i++) {
+        last = SLIST_NEXT(last, mb_next);
+    }
+    mag->head = SLIST_NEXT(last, mb_next);
+    mag->count -= i;
+
+    OS_ENTER_CRITICAL(sr);
+    SLIST_NEXT(last, mb_next) = SLIST_FIRST(mag->mp);
+    SLIST_FIRST(mag->mp) = first;
+    OS_EXIT_CRITICAL(sr);
+}
+
+/*
+ * Moves up to OS_MEMPOOL_MAG_BATCH blocks from the shared free list.  Caller
+ * must own the magazine.
+ */
+static void
+os_mempool_mag_refill(struct os_mempool_mag *mag)
+{
+    struct os_memblock *first;
+    struct os_memblock *last;
+    uint16_t i;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    first = SLIST_FIRST(mag->mp);
+    if (first == NULL) {
+        OS_EXIT_CRITICAL(sr);
+        return;
+    }
+
+    last = first;
+    for (i = 1; (i < OS_MEMPOOL_MAG_BATCH) &&
+                (SLIST_NEXT(last, mb_next) != NULL); i++) {
+        last = SLIST_NEXT(last, mb_next);
+    }
+    SLIST_FIRST(mag->mp) = SLIST_NEXT(last, mb_next);
+    OS_EXIT_CRITICAL(sr);
+
+    SLIST_NEXT(last, mb_next) = mag->head;
+    mag->head = first;
+    mag->count += i;
+}
+
+/*
+ * Takes a free block from the shared list or, if that is empty, from another
+ * thread's magazine.  Without this, blocks cached by idle threads would count
+ * as free but be unobtainable by everyone else.  Caller must not hold its own
+ * magazine.
+ */
+static struct os_memblock *
+os_mempool_mag_steal(struct os_mempool *mp)
+{
+    struct os_mempool_mag_set *set;
+    struct os_mempool_mag *mag;
+    struct os_memblock *block;
+    bool busy;
+    os_sr_t sr;
+    int i;
+
+    do {
+        busy = false;
+
+        OS_ENTER_CRITICAL(sr);
+
+        block = SLIST_FIRST(mp);
+        if (block != NULL) {
+            SLIST_FIRST(mp) = SLIST_NEXT(block, mb_next);
+        }
+
+        SLIST_FOREACH(set, &os_mempool_mag_sets, next) {
+            if (block != NULL) {
+                break;
+            }
+            if (set == &os_mempool_mag_set) {
+                continue;
+            }
+
+            for (i = 0; (block == NULL) && (i < OS_MEMPOOL_MAG_POOLS); i++) {
+                mag = &set->mags[i];
+
+                /* The owner may be in the middle of using the magazine;
+                 * don't wait for it with the critical section held, but do
+                 * retry afterwards if it could have had blocks for us.
+                 */
+                if (!os_mempool_mag_trylock(mag)) {
+                    if (__atomic_load_n(&mag->mp, __ATOMIC_RELAXED) == mp) {
+                        busy = true;
+                    }
+                    continue;
+                }
+
+                if ((mag->mp == mp) && (mag->head != NULL)) {
+                    block = mag->head;
+                    mag->head = SLIST_NEXT(block, mb_next);
+                    mag->count--;
+                }
+
+                os_mempool_mag_unlock(mag);
+            }
+        }
+
+        OS_EXIT_CRITICAL(sr);
+    } while ((block == NULL) && busy);
+
+    return block;
+}
+
+static void
+os_mempool_mag_thread_exit(void *arg)
+{
+    struct os_mempool_mag_set *set = arg;
+    os_sr_t sr;
+    int i;
+
+    /* Once unlisted, no other thread can touch the magazines */
+    OS_ENTER_CRITICAL(sr);
+    SLIST_REMOVE(&os_mempool_mag_sets, set, os_mempool_mag_set, next);
+    OS_EXIT_CRITICAL(sr);
+
+    for (i = 0; i < OS_MEMPOOL_MAG_POOLS; i++) {
+        if (set->mags[i].mp != NULL) {
+            os_mempool_mag_flush(&set->mags[i], set->mags[i].count);
+            set->mags[i].mp = NULL;
+        }
+    }
+
+    set->registered = false;
+}
+
+static void
+os_mempool_mag_key_init(void)
+{
+    int rc;
+
+    rc = pthread_key_create(&os_mempool_mag_key, os_mempool_mag_thread_exit);
+    assert(rc == 0);
+}
+
+/*
+ * Returns calling thread's magazine for the pool, assigning a free slot if
+ * needed.  Returns NULL if the thread already caches blocks for the maximum
+ * number of pools; caller shall use the shared free list in that case.
+ */
+static struct os_mempool_mag *
+os_mempool_mag_get(struct os_mempool *mp)
+{
+    struct os_mempool_mag_set *set;
+    struct os_mempool_mag *empty;
+    os_sr_t sr;
+    int i;
+
+    set = &os_mempool_mag_set;
+
+    empty = NULL;
+    for (i = 0; i < OS_MEMPOOL_MAG_POOLS; i++) {
+        if (set->mags[i].mp == mp) {
+            return &set->mags[i];
+        }
+        if ((empty == NULL) && (set->mags[i].mp == NULL)) {
+            empty = &set->mags[i];
+        }
+    }
+
+    if (empty != NULL) {
+        if (!set->registered) {
+            /* Make sure cached blocks are returned when this thread exits,
+             * and can be stolen until then.
+             */
+            pthread_once(&os_mempool_mag_once, os_mempool_mag_key_init);
+            pthread_setspecific(os_mempool_mag_key, set);
+
+            OS_ENTER_CRITICAL(sr);
+            SLIST_INSERT_HEAD(&os_mempool_mag_sets, set, next);
+            OS_EXIT_CRITICAL(sr);
+            set->registered = true;
+        }
+
+        os_mempool_mag_lock(empty);
+        __atomic_store_n(&empty->mp, mp, __ATOMIC_RELAXED);
+        empty->head = NULL;
+        empty->count = 0;
+        os_mempool_mag_unlock(empty);
+    }
+
+    return empty;
+}
+
+void
+os_mempool_magazine_enable(struct os_mempool *mp)
+{
+    mp->mp_flags |= OS_MEMPOOL_F_MAGAZINE;
+}
+#else
+#define os_mempool_num_free_add(mp, n)  ((mp)->mp_num_free += (n))
+#define os_mempool_num_free_sub(mp, n)  ((mp)->mp_num_free -= (n))
+
+static void
+os_mempool_min_free_update(struct os_mempool *mp, uint16_t num_free)
+{
+    if (mp->mp_min_free > num_free) {
+        mp->mp_min_free = num_free;
+    }
+}
+
+void
+os_mempool_magazine_enable(struct os_mempool *mp)
+{
+    (void)mp;
+}
+#endif
+
 static os_error_t
 os_mempool_init_internal(struct os_mempool *mp, uint16_t blocks,
                          uint32_t block_size, void *membuf, char *name,
@@ -254,6 +561,9 @@ os_mempool_clear(struct os_mempool *mp)
         return OS_INVALID_PARM;
     }
 
+    /* Other threads may hold blocks of this pool in their magazines */
+    assert(!(mp->mp_flags & OS_MEMPOOL_F_MAGAZINE));
+
     true_block_size = OS_MEMPOOL_TRUE_BLOCK_SIZE(mp);
 
     /* cleanup the memory pool structure */
@@ -332,12 +642,48 @@ os_memblock_get(struct os_mempool *mp)
 {
     os_sr_t sr;
     struct os_memblock *block;
+    uint16_t num_free;
+#if MYNEWT_VAL(OS_MEMPOOL_MAGAZINE_SIZE) > 0
+    struct os_mempool_mag *mag;
+#endif
 
     os_trace_api_u32(OS_TRACE_ID_MEMBLOCK_GET, (uint32_t)(uintptr_t)mp);
 
     /* Check to make sure they passed in a memory pool (or something) */
     block = NULL;
     if (mp) {
+#if MYNEWT_VAL(OS_MEMPOOL_MAGAZINE_SIZE) > 0
+        if (mp->mp_flags & OS_MEMPOOL_F_MAGAZINE) {
+            mag = os_mempool_mag_get(mp);
+            if (mag != NULL) {
+                os_mempool_mag_lock(mag);
+                if (mag->head == NULL) {
+                    os_mempool_mag_refill(mag);
+                }
+
+                block = mag->head;
+                if (block) {
+                    mag->head = SLIST_NEXT(block, mb_next);
+                    mag->count--;
+                }
+                os_mempool_mag_unlock(mag);
+            }
+
+            if (block == NULL) {
+                block = os_mempool_mag_steal(mp);
+            }
+
+            if (block) {
+                num_free = os_mempool_num_free_sub(mp, 1);
+                os_mempool_min_free_update(mp, num_free);
+
+                os_mempool_poison_check(mp, block);
+                os_mempool_guard_check(mp, block);
+            }
+            goto done;
+        }
+#endif
+
         OS_ENTER_CRITICAL(sr);
         /* Check for any free */
         if (mp->mp_num_free) {
@@ -348,10 +694,8 @@ os_memblock_get(struct os_mempool *mp)
             SLIST_FIRST(mp) = SLIST_NEXT(block, mb_next);
 
             /* Decrement number free by 1 */
-            mp->mp_num_free--;
-            if (mp->mp_min_free > mp->mp_num_free) {
-                mp->mp_min_free = mp->mp_num_free;
-            }
+            num_free = os_mempool_num_free_sub(mp, 1);
+            os_mempool_min_free_update(mp, num_free);
         }
         OS_EXIT_CRITICAL(sr);
 
@@ -361,6 +705,9 @@ os_memblock_get(struct os_mempool *mp)
         }
     }
 
+#if MYNEWT_VAL(OS_MEMPOOL_MAGAZINE_SIZE) > 0
+done:
+#endif
     os_trace_api_ret_u32(OS_TRACE_ID_MEMBLOCK_GET, (uint32_t)(uintptr_t)block);
 
     return (void *)block;
@@ -371,6 +718,9 @@ os_memblock_put_from_cb(struct os_mempool *mp, void *block_addr)
 {
     os_sr_t sr;
     struct os_memblock *block;
+#if MYNEWT_VAL(OS_MEMPOOL_MAGAZINE_SIZE) > 0
+    struct os_mempool_mag *mag;
+#endif
 
     os_trace_api_u32x2(OS_TRACE_ID_MEMBLOCK_PUT_FROM_CB, (uint32_t)(uintptr_t)mp,
                        (uint32_t)(uintptr_t)block_addr);
@@ -379,6 +729,27 @@ os_memblock_put_from_cb(struct os_mempool *mp, void *block_addr)
     os_mempool_poison(mp, block_addr);
 
     block = (struct os_memblock *)block_addr;
+
+#if MYNEWT_VAL(OS_MEMPOOL_MAGAZINE_SIZE) > 0
+    if (mp->mp_flags & OS_MEMPOOL_F_MAGAZINE) {
+        mag = os_mempool_mag_get(mp);
+        if (mag != NULL) {
+            os_mempool_mag_lock(mag);
+            if (mag->count >= MYNEWT_VAL(OS_MEMPOOL_MAGAZINE_SIZE)) {
+                os_mempool_mag_flush(mag, OS_MEMPOOL_MAG_BATCH);
+            }
+
+            SLIST_NEXT(block, mb_next) = mag->head;
+            mag->head = block;
+            mag->count++;
+            os_mempool_mag_unlock(mag);
+
+            os_mempool_num_free_add(mp, 1);
+            goto done;
+        }
+    }
+#endif
+
     OS_ENTER_CRITICAL(sr);
 
     /* Chain current free list pointer to this block; make this block head */
@@ -387,10 +758,14 @@ os_memblock_put_from_cb(struct os_mempool *mp, void *block_addr)
 
     /* XXX: Should we check that the number free <= number blocks? */
     /* Increment number free */
-    mp->mp_num_free++;
+    os_mempool_num_free_add(mp, 1);
 
     OS_EXIT_CRITICAL(sr);
 
+#if MYNEWT_VAL(OS_MEMPOOL_MAGAZINE_SIZE) > 0
+done:
+#endif
+
     os_trace_api_ret_u32(OS_TRACE_ID_MEMBLOCK_PUT_FROM_CB, (uint32_t)OS_OK);
 
     return OS_OK;
@@ -114,6 +114,13 @@ os_msys_init_once(void *data, struct os_mempool *mempool,
                             name);
     SYSINIT_PANIC_ASSERT(rc == 0);
 
+#if MYNEWT_VAL(OS_MEMPOOL_MAGAZINE_SIZE) > 0
+    /* msys blocks are allocated and freed from host, controller and
+     * transport threads alike; cache them per thread.
+     */
+    os_mempool_magazine_enable(mempool);
+#endif
+
     rc = os_msys_register(mbuf_pool);
     SYSINIT_PANIC_ASSERT(rc == 0);
 }
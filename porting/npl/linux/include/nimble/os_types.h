@@ -40,18 +40,25 @@ struct ble_npl_event {
     uint8_t                 ev_queued;
     ble_npl_event_fn       *ev_cb;
     void                   *ev_arg;
+    struct ble_npl_event   *ev_next;
 };
 
 struct ble_npl_eventq {
-    void               *q;
+    struct ble_npl_event   *q_head;
+    struct ble_npl_event   *q_tail;
+    pthread_mutex_t         q_lock;
+    pthread_cond_t          q_cond;
+    int                     q_waiters;
+    bool                    q_inited;
 };
 
 struct ble_npl_callout {
     struct ble_npl_event    c_ev;
     struct ble_npl_eventq  *c_evq;
     uint32_t                c_ticks;
-    timer_t                 c_timer;
+    uint32_t                c_heap_idx;
     bool                    c_active;
+    bool                    c_inited;
 };
 
 struct ble_npl_mutex {
@@ -18,66 +18,263 @@
  */
 
 #include <assert.h>
-#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
-
 #include <time.h>
-#include <signal.h>
 
 #include "nimble/nimble_npl.h"
 
+/*
+ * All callouts are kept in a single binary min-heap ordered by expiry time
+ * and serviced by one timer thread, which sleeps until the earliest expiry
+ * and then posts the callout event to its event queue.  Arming or stopping
+ * a callout is O(log n) and never involves a kernel timer.
+ */
+
+#define CALLOUT_HEAP_MIN_SIZE   (16)
+
+static pthread_mutex_t callout_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t callout_cond;
+static pthread_once_t callout_once = PTHREAD_ONCE_INIT;
+static pthread_t callout_thread;
+
+static struct ble_npl_callout **callout_heap;
+static uint32_t callout_heap_cnt;
+static uint32_t callout_heap_size;
+
+static inline bool
+ble_npl_callout_before(struct ble_npl_callout *a, struct ble_npl_callout *b)
+{
+    return (int32_t)(a->c_ticks - b->c_ticks) < 0;
+}
+
+static void
+ble_npl_callout_heap_set(uint32_t idx, struct ble_npl_callout *c)
+{
+    callout_heap[idx] = c;
+    c->c_heap_idx = idx;
+}
+
+static void
+ble_npl_callout_heap_up(uint32_t idx)
+{
+    struct ble_npl_callout *c = callout_heap[idx];
+    uint32_t parent;
+
+    while (idx > 0) {
+        parent = (idx - 1) / 2;
+        if (!ble_npl_callout_before(c, callout_heap[parent])) {
+            break;
+        }
+        ble_npl_callout_heap_set(idx, callout_heap[parent]);
+        idx = parent;
+    }
+
+    ble_npl_callout_heap_set(idx, c);
+}
+
+static void
+ble_npl_callout_heap_down(uint32_t idx)
+{
+    struct ble_npl_callout *c = callout_heap[idx];
+    uint32_t child;
+
+    while ((child = 2 * idx + 1) < callout_heap_cnt) {
+        if (child + 1 < callout_heap_cnt &&
+            ble_npl_callout_before(callout_heap[child + 1],
+                                   callout_heap[child])) {
+            child++;
+        }
+        if (!ble_npl_callout_before(callout_heap[child], c)) {
+            break;
+        }
+        ble_npl_callout_heap_set(idx, callout_heap[child]);
+        idx = child;
+    }
+
+    ble_npl_callout_heap_set(idx, c);
+}
+
+static int
+ble_npl_callout_heap_insert(struct ble_npl_callout *c)
+{
+    struct ble_npl_callout **heap;
+    uint32_t size;
+
+    if (callout_heap_cnt == callout_heap_size) {
+        size = callout_heap_size ? callout_heap_size * 2 :
+                                   CALLOUT_HEAP_MIN_SIZE;
+        heap = realloc(callout_heap, size * sizeof(*heap));
+        if (!heap) {
+            return BLE_NPL_ENOMEM;
+        }
+        callout_heap = heap;
+        callout_heap_size = size;
+    }
+
+    callout_heap[callout_heap_cnt] = c;
+    ble_npl_callout_heap_up(callout_heap_cnt++);
+    c->c_active = true;
+
+    return 0;
+}
+
 static void
-ble_npl_callout_timer_cb(union sigval sv)
+ble_npl_callout_heap_remove(struct ble_npl_callout *c)
 {
-    struct ble_npl_callout *c = (struct ble_npl_callout *)sv.sival_ptr;
-    assert(c);
+    uint32_t idx = c->c_heap_idx;
+
+    assert(c->c_active);
+    assert(callout_heap[idx] == c);
+
     c->c_active = false;
-    if (c->c_evq) {
-        ble_npl_eventq_put(c->c_evq, &c->c_ev);
+
+    if (--callout_heap_cnt == idx) {
+        return;
+    }
+
+    /* Move last entry into the hole and restore heap order */
+    ble_npl_callout_heap_set(idx, callout_heap[callout_heap_cnt]);
+    if (idx > 0 && ble_npl_callout_before(callout_heap[idx],
+                                          callout_heap[(idx - 1) / 2])) {
+        ble_npl_callout_heap_up(idx);
     } else {
-        c->c_ev.ev_cb(&c->c_ev);
+        ble_npl_callout_heap_down(idx);
+    }
+}
+
+/* Whether c is armed. Looks the callout up by address only, so that it can
+ * be used on a structure which has never been initialized.
+ */
+static bool
+ble_npl_callout_heap_contains(struct ble_npl_callout *c)
+{
+    uint32_t i;
+
+    for (i = 0; i < callout_heap_cnt; i++) {
+        if (callout_heap[i] == c) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void *
+ble_npl_callout_thread(void *arg)
+{
+    struct ble_npl_callout *c;
+    struct timespec abstime;
+    ble_npl_stime_t diff;
+
+    pthread_mutex_lock(&callout_lock);
+
+    while (1) {
+        if (!callout_heap_cnt) {
+            pthread_cond_wait(&callout_cond, &callout_lock);
+            continue;
+        }
+
+        c = callout_heap[0];
+        diff = c->c_ticks - ble_npl_time_get();
+        if (diff > 0) {
+            clock_gettime(CLOCK_MONOTONIC, &abstime);
+            abstime.tv_sec += diff / 1000;
+            abstime.tv_nsec += (diff % 1000) * 1000000;
+            if (abstime.tv_nsec >= 1000000000) {
+                abstime.tv_sec++;
+                abstime.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&callout_cond, &callout_lock, &abstime);
+            continue;
+        }
+
+        ble_npl_callout_heap_remove(c);
+
+        /* Event is posted with the lock held so that a concurrent stop can
+         * reliably remove it from the queue again.
+         */
+        if (c->c_evq) {
+            ble_npl_eventq_put(c->c_evq, &c->c_ev);
+        } else {
+            pthread_mutex_unlock(&callout_lock);
+            ble_npl_event_run(&c->c_ev);
+            pthread_mutex_lock(&callout_lock);
+        }
     }
+
+    return NULL;
+}
+
+static void
+ble_npl_callout_thread_init(void)
+{
+    pthread_condattr_t attr;
+    int rc;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&callout_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    rc = pthread_create(&callout_thread, NULL, ble_npl_callout_thread, NULL);
+    assert(rc == 0);
+    (void)rc;
 }
 
-void ble_npl_callout_init(struct ble_npl_callout *c, 
+void ble_npl_callout_init(struct ble_npl_callout *c,
                           struct ble_npl_eventq *evq,
-                          ble_npl_event_fn *ev_cb, 
+                          ble_npl_event_fn *ev_cb,
                           void *ev_arg)
 {
-    struct sigevent         event;
+    pthread_once(&callout_once, ble_npl_callout_thread_init);
+
+    pthread_mutex_lock(&callout_lock);
+
+    /* Re-initializing a callout that is still armed must not leave a stale
+     * entry in the heap pointing at the cleared structure. The structure may
+     * hold garbage, so nothing in it is trusted until the heap has been
+     * searched for it. As with the other ports, a callout which has already
+     * expired and whose event is still on its queue has to be stopped with
+     * ble_npl_callout_stop() before it is re-initialized.
+     */
+    if (ble_npl_callout_heap_contains(c)) {
+        ble_npl_callout_heap_remove(c);
+    }
 
     /* Initialize the callout. */
     memset(c, 0, sizeof(*c));
-    c->c_ev.ev_cb = ev_cb;
-    c->c_ev.ev_arg = ev_arg;
+    ble_npl_event_init(&c->c_ev, ev_cb, ev_arg);
     c->c_evq = evq;
     c->c_active = false;
+    c->c_inited = true;
 
-    event.sigev_notify = SIGEV_THREAD;
-    event.sigev_value.sival_ptr = c;     // put callout obj in signal args
-    event.sigev_notify_function = ble_npl_callout_timer_cb;
-    event.sigev_notify_attributes = NULL;
-
-    timer_create(CLOCK_REALTIME, &event, &c->c_timer);
+    pthread_mutex_unlock(&callout_lock);
 }
 
 bool ble_npl_callout_is_active(struct ble_npl_callout *c)
 {
-    // TODO: seek native posix method to determine whether timer_t is active.
-    // TODO: fix bug where one-shot timer is still active after fired.
-    return c->c_active;
+    bool active;
+
+    pthread_mutex_lock(&callout_lock);
+    active = c->c_active;
+    pthread_mutex_unlock(&callout_lock);
+
+    return active;
 }
 
 int ble_npl_callout_inited(struct ble_npl_callout *c)
 {
-    return (c->c_timer != NULL);
+    return c->c_inited;
 }
 
 ble_npl_error_t ble_npl_callout_reset(struct ble_npl_callout *c,
-				      ble_npl_time_t ticks)
+                                      ble_npl_time_t ticks)
 {
-    struct itimerspec       its;
+    int rc;
 
     if (ticks < 0) {
         return BLE_NPL_EINVAL;
@@ -87,26 +284,28 @@ ble_npl_error_t ble_npl_callout_reset(struct ble_npl_callout *c,
         ticks = 1;
     }
 
+    pthread_mutex_lock(&callout_lock);
+
+    if (c->c_active) {
+        ble_npl_callout_heap_remove(c);
+    }
+
     c->c_ticks = ble_npl_time_get() + ticks;
 
-    its.it_interval.tv_sec = 0;
-    its.it_interval.tv_nsec = 0;                     // one shot
-    its.it_value.tv_sec = (ticks / 1000);
-    its.it_value.tv_nsec = (ticks % 1000) * 1000000; // expiration
-    its.it_value.tv_nsec %= 1000000000;
-    c->c_active = true;
-    timer_settime(c->c_timer, 0, &its, NULL);
+    rc = ble_npl_callout_heap_insert(c);
+    if (rc == 0 && c->c_heap_idx == 0) {
+        /* New earliest expiry, timer thread needs to re-arm */
+        pthread_cond_signal(&callout_cond);
+    }
 
-    return BLE_NPL_OK;
+    pthread_mutex_unlock(&callout_lock);
+
+    return rc ? BLE_NPL_ENOMEM : BLE_NPL_OK;
 }
 
 int ble_npl_callout_queued(struct ble_npl_callout *c)
 {
-    struct itimerspec its;
-    timer_gettime(c->c_timer, &its);
-
-    return ((its.it_value.tv_sec > 0) ||
-            (its.it_value.tv_nsec > 0));
+    return ble_npl_callout_is_active(c);
 }
 
 void ble_npl_callout_stop(struct ble_npl_callout *c)
@@ -115,13 +314,17 @@ void ble_npl_callout_stop(struct ble_npl_callout *c)
         return;
     }
 
-    struct itimerspec its;
-    its.it_interval.tv_sec = 0;
-    its.it_interval.tv_nsec = 0;
-    its.it_value.tv_sec = 0;
-    its.it_value.tv_nsec = 0;
-    timer_settime(c->c_timer, 0, &its, NULL);
-    c->c_active = false;
+    pthread_mutex_lock(&callout_lock);
+
+    if (c->c_active) {
+        ble_npl_callout_heap_remove(c);
+    }
+
+    if (c->c_evq) {
+        ble_npl_eventq_remove(c->c_evq, &c->c_ev);
+    }
+
+    pthread_mutex_unlock(&callout_lock);
 }
 
 ble_npl_time_t
@@ -141,18 +344,16 @@ ble_npl_callout_remaining_ticks(struct ble_npl_callout *co,
                                 ble_npl_time_t now)
 {
     ble_npl_time_t rt;
-    uint32_t exp;
 
-    struct itimerspec its;
-    timer_gettime(co->c_timer, &its);
+    pthread_mutex_lock(&callout_lock);
 
-    exp = its.it_value.tv_sec * 1000;
-
-    if (exp > now) {
-        rt = exp - now;
+    if (co->c_active && (ble_npl_stime_t)(co->c_ticks - now) > 0) {
+        rt = co->c_ticks - now;
     } else {
         rt = 0;
     }
 
+    pthread_mutex_unlock(&callout_lock);
+
     return rt;
 }
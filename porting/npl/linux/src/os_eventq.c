@@ -0,0 +1,259 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "nimble/nimble_npl.h"
+
+/*
+ * Event queues are intrusive singly-linked FIFOs: queued events are chained
+ * through ev_next, so putting an event never allocates.  The queue lock is
+ * only held for a few pointer updates and the condition variable is only
+ * signalled when a consumer is actually blocked on the queue.
+ */
+
+static struct ble_npl_eventq dflt_evq;
+static pthread_once_t dflt_evq_once = PTHREAD_ONCE_INIT;
+
+static void
+ble_npl_eventq_dflt_init(void)
+{
+    ble_npl_eventq_init(&dflt_evq);
+}
+
+struct ble_npl_eventq *
+ble_npl_eventq_dflt_get(void)
+{
+    pthread_once(&dflt_evq_once, ble_npl_eventq_dflt_init);
+
+    return &dflt_evq;
+}
+
+void
+ble_npl_eventq_init(struct ble_npl_eventq *evq)
+{
+    pthread_condattr_t attr;
+
+    evq->q_head = NULL;
+    evq->q_tail = NULL;
+    evq->q_waiters = 0;
+
+    pthread_mutex_init(&evq->q_lock, NULL);
+
+    /* Use monotonic clock so timeouts are not affected by wall clock
+     * changes.
+     */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&evq->q_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    evq->q_inited = true;
+}
+
+bool
+ble_npl_eventq_is_empty(struct ble_npl_eventq *evq)
+{
+    bool empty;
+
+    pthread_mutex_lock(&evq->q_lock);
+    empty = (evq->q_head == NULL);
+    pthread_mutex_unlock(&evq->q_lock);
+
+    return empty;
+}
+
+int
+ble_npl_eventq_inited(const struct ble_npl_eventq *evq)
+{
+    return evq->q_inited;
+}
+
+void
+ble_npl_eventq_put(struct ble_npl_eventq *evq, struct ble_npl_event *ev)
+{
+    pthread_mutex_lock(&evq->q_lock);
+
+    if (ev->ev_queued) {
+        pthread_mutex_unlock(&evq->q_lock);
+        return;
+    }
+
+    ev->ev_queued = 1;
+    ev->ev_next = NULL;
+
+    if (evq->q_tail) {
+        evq->q_tail->ev_next = ev;
+    } else {
+        evq->q_head = ev;
+    }
+    evq->q_tail = ev;
+
+    if (evq->q_waiters) {
+        pthread_cond_signal(&evq->q_cond);
+    }
+
+    pthread_mutex_unlock(&evq->q_lock);
+}
+
+static void
+ble_npl_eventq_wait(struct ble_npl_eventq *evq, ble_npl_time_t tmo)
+{
+    struct timespec abstime;
+    int rc;
+
+    if (tmo == BLE_NPL_TIME_FOREVER) {
+        while (!evq->q_head) {
+            evq->q_waiters++;
+            pthread_cond_wait(&evq->q_cond, &evq->q_lock);
+            evq->q_waiters--;
+        }
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &abstime);
+    abstime.tv_sec += tmo / 1000;
+    abstime.tv_nsec += (tmo % 1000) * 1000000;
+    if (abstime.tv_nsec >= 1000000000) {
+        abstime.tv_sec++;
+        abstime.tv_nsec -= 1000000000;
+    }
+
+    while (!evq->q_head) {
+        evq->q_waiters++;
+        rc = pthread_cond_timedwait(&evq->q_cond, &evq->q_lock, &abstime);
+        evq->q_waiters--;
+        if (rc == ETIMEDOUT) {
+            break;
+        }
+    }
+}
+
+struct ble_npl_event *
+ble_npl_eventq_get(struct ble_npl_eventq *evq, ble_npl_time_t tmo)
+{
+    struct ble_npl_event *ev;
+
+    pthread_mutex_lock(&evq->q_lock);
+
+    if (!evq->q_head && tmo) {
+        ble_npl_eventq_wait(evq, tmo);
+    }
+
+    ev = evq->q_head;
+    if (ev) {
+        evq->q_head = ev->ev_next;
+        if (!evq->q_head) {
+            evq->q_tail = NULL;
+        }
+        ev->ev_next = NULL;
+        ev->ev_queued = 0;
+    }
+
+    pthread_mutex_unlock(&evq->q_lock);
+
+    return ev;
+}
+
+void
+ble_npl_eventq_run(struct ble_npl_eventq *evq)
+{
+    struct ble_npl_event *ev;
+
+    ev = ble_npl_eventq_get(evq, BLE_NPL_TIME_FOREVER);
+    ble_npl_event_run(ev);
+}
+
+void
+ble_npl_eventq_remove(struct ble_npl_eventq *evq, struct ble_npl_event *ev)
+{
+    struct ble_npl_event *prev;
+    struct ble_npl_event *cur;
+
+    pthread_mutex_lock(&evq->q_lock);
+
+    if (!ev->ev_queued) {
+        pthread_mutex_unlock(&evq->q_lock);
+        return;
+    }
+
+    prev = NULL;
+    for (cur = evq->q_head; cur; cur = cur->ev_next) {
+        if (cur == ev) {
+            if (prev) {
+                prev->ev_next = ev->ev_next;
+            } else {
+                evq->q_head = ev->ev_next;
+            }
+            if (evq->q_tail == ev) {
+                evq->q_tail = prev;
+            }
+            ev->ev_next = NULL;
+            ev->ev_queued = 0;
+            break;
+        }
+        prev = cur;
+    }
+
+    pthread_mutex_unlock(&evq->q_lock);
+}
+
+// ========================================================================
+//                         Event Implementation
+// ========================================================================
+
+void
+ble_npl_event_init(struct ble_npl_event *ev, ble_npl_event_fn *fn,
+                   void *arg)
+{
+    memset(ev, 0, sizeof(*ev));
+    ev->ev_cb = fn;
+    ev->ev_arg = arg;
+}
+
+bool
+ble_npl_event_is_queued(struct ble_npl_event *ev)
+{
+    return ev->ev_queued;
+}
+
+void *
+ble_npl_event_get_arg(struct ble_npl_event *ev)
+{
+    return ev->ev_arg;
+}
+
+void
+ble_npl_event_set_arg(struct ble_npl_event *ev, void *arg)
+{
+    ev->ev_arg = arg;
+}
+
+void
+ble_npl_event_run(struct ble_npl_event *ev)
+{
+    assert(ev->ev_cb != NULL);
+
+    ev->ev_cb(ev);
+}
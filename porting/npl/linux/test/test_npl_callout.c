@@ -27,6 +27,7 @@
   void ble_npl_callout_stop(struct ble_npl_callout *c);
 */
 
+#include <string.h>
 #include "test_util.h"
 #include "nimble/nimble_npl.h"
 
@@ -36,6 +37,8 @@
 static bool                   s_tests_running = true;
 static struct ble_npl_task    s_task;
 static struct ble_npl_callout s_callout;
+static struct ble_npl_callout s_callout_stopped;
+static struct ble_npl_callout s_callout_garbage;
 static int                    s_callout_args = TEST_ARGS_VALUE;
 
 static struct ble_npl_eventq  s_eventq;
@@ -49,9 +52,17 @@ void on_callout(struct ble_npl_event *ev)
     VerifyOrQuit(*(int*)ev->ev_arg == TEST_ARGS_VALUE,
 		 "callout: args corrupted");
 
+    VerifyOrQuit(!ble_npl_callout_is_active(&s_callout),
+                 "callout: still active after expiry");
+
     s_tests_running = false;
 }
 
+void on_callout_stopped(struct ble_npl_event *ev)
+{
+    VerifyOrQuit(0, "callout: stopped callout expired");
+}
+
 /**
  * ble_npl_callout_init(struct ble_npl_callout *c, struct ble_npl_eventq *evq,
  *                 ble_npl_event_fn *ev_cb, void *ev_arg)
@@ -74,14 +85,60 @@ int test_queued(void)
 
 int test_reset(void)
 {
-    return ble_npl_callout_reset(&s_callout, TEST_INTERVAL);
+    int rc;
+
+    rc = ble_npl_callout_reset(&s_callout, TEST_INTERVAL);
+    VerifyOrQuit(ble_npl_callout_is_active(&s_callout),
+                 "callout: not active after reset");
+    VerifyOrQuit(ble_npl_callout_remaining_ticks(&s_callout,
+                                                 ble_npl_time_get()) <=
+                 TEST_INTERVAL, "callout: wrong remaining ticks");
+
+    return rc;
 }
 
 int test_stop(void)
 {
+    ble_npl_callout_init(&s_callout_stopped, &s_eventq, on_callout_stopped,
+                         NULL);
+    ble_npl_callout_reset(&s_callout_stopped, TEST_INTERVAL / 2);
+    ble_npl_callout_stop(&s_callout_stopped);
+    VerifyOrQuit(!ble_npl_callout_is_active(&s_callout_stopped),
+                 "callout: active after stop");
+    return PASS;
+}
+
+int test_reinit(void)
+{
+    ble_npl_callout_init(&s_callout_stopped, &s_eventq, on_callout_stopped,
+                         NULL);
+    ble_npl_callout_reset(&s_callout_stopped, TEST_INTERVAL / 2);
+    ble_npl_callout_init(&s_callout_stopped, &s_eventq, on_callout_stopped,
+                         NULL);
+    VerifyOrQuit(!ble_npl_callout_is_active(&s_callout_stopped),
+                 "callout: active after re-init");
     return PASS;
 }
 
+/* Callouts on the stack or from a pool are not zeroed before init. */
+int test_init_garbage(void)
+{
+    memset(&s_callout_garbage, 0xff, sizeof(s_callout_garbage));
+
+    ble_npl_callout_init(&s_callout_garbage, &s_eventq, on_callout_stopped,
+                         NULL);
+    VerifyOrQuit(!ble_npl_callout_is_active(&s_callout_garbage),
+                 "callout: active after init");
+
+    ble_npl_callout_reset(&s_callout_garbage, TEST_INTERVAL / 2);
+    VerifyOrQuit(ble_npl_callout_is_active(&s_callout_garbage),
+                 "callout: not active after reset");
+    ble_npl_callout_stop(&s_callout_garbage);
+    VerifyOrQuit(!ble_npl_callout_is_active(&s_callout_garbage),
+                 "callout: active after stop");
+
+    return PASS;
+}
 
 /**
  * ble_npl_callout_init(struct ble_npl_callout *c, struct ble_npl_eventq *evq,
@@ -92,6 +149,9 @@ void *test_task_run(void *args)
     SuccessOrQuit(test_init(),   "callout_init failed");
     SuccessOrQuit(test_queued(), "callout_queued failed");
     SuccessOrQuit(test_reset(),  "callout_reset failed");
+    SuccessOrQuit(test_stop(),   "callout_stop failed");
+    SuccessOrQuit(test_reinit(), "callout_init re-init failed");
+    SuccessOrQuit(test_init_garbage(), "callout_init on garbage failed");
 
     while (s_tests_running)
     {
@@ -0,0 +1,325 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Unit test and contention benchmark for per-thread mempool magazines
+ * (OS_MEMPOOL_MAGAZINE_SIZE).
+ *
+ * Run with "bench" to also time concurrent get/put loops on a pool with and
+ * without magazines.
+ */
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <string.h>
+#include <time.h>
+#include "test_util.h"
+#include "os/os_mempool.h"
+
+#if MYNEWT_VAL(OS_MEMPOOL_MAGAZINE_SIZE) == 0
+#error "Build with MYNEWT_VAL_OS_MEMPOOL_MAGAZINE_SIZE > 0"
+#endif
+
+#define TEST_MAG_BLOCKS         16
+#define TEST_MAG_BLOCK_SIZE     32
+#define TEST_MAG_CACHED         8
+
+#define BENCH_THREADS           4
+#define BENCH_BLOCKS            64
+#define BENCH_HELD              4
+#define BENCH_ITERS             200000
+
+static os_membuf_t s_basic_mem[OS_MEMPOOL_SIZE(TEST_MAG_BLOCKS,
+                                               TEST_MAG_BLOCK_SIZE)];
+static os_membuf_t s_steal_mem[OS_MEMPOOL_SIZE(TEST_MAG_BLOCKS,
+                                               TEST_MAG_BLOCK_SIZE)];
+static os_membuf_t s_exit_mem[OS_MEMPOOL_SIZE(TEST_MAG_BLOCKS,
+                                              TEST_MAG_BLOCK_SIZE)];
+static os_membuf_t s_bench_mem[2][OS_MEMPOOL_SIZE(BENCH_BLOCKS,
+                                                  TEST_MAG_BLOCK_SIZE)];
+
+static struct os_mempool s_basic_pool;
+static struct os_mempool s_steal_pool;
+static struct os_mempool s_exit_pool;
+static struct os_mempool s_bench_pool[2];
+
+static sem_t s_cached;
+static sem_t s_done;
+
+extern void os_mempool_module_init(void);
+
+static void
+init_pool(struct os_mempool *mp, void *mem, int blocks, char *name,
+          int magazine)
+{
+    int rc;
+
+    rc = os_mempool_init(mp, blocks, TEST_MAG_BLOCK_SIZE, mem, name);
+    SuccessOrQuit(rc, "os_mempool_init failed");
+
+    if (magazine) {
+        os_mempool_magazine_enable(mp);
+    }
+}
+
+static int
+shared_list_len(const struct os_mempool *mp)
+{
+    const struct os_memblock *block;
+    int len;
+
+    len = 0;
+    SLIST_FOREACH(block, mp, mb_next) {
+        len++;
+    }
+
+    return len;
+}
+
+/* Leaves TEST_MAG_CACHED blocks of mp in the calling thread's magazine. */
+static void
+fill_magazine(struct os_mempool *mp)
+{
+    void *blocks[TEST_MAG_CACHED];
+    int i;
+
+    for (i = 0; i < TEST_MAG_CACHED; i++) {
+        blocks[i] = os_memblock_get(mp);
+        VerifyOrQuit(blocks[i] != NULL, "os_memblock_get failed");
+    }
+
+    for (i = 0; i < TEST_MAG_CACHED; i++) {
+        SuccessOrQuit(os_memblock_put(mp, blocks[i]),
+                      "os_memblock_put failed");
+    }
+}
+
+/**
+ * All blocks can be taken and returned by a single thread, and the free
+ * counters follow.
+ */
+int
+test_basic(void)
+{
+    void *blocks[TEST_MAG_BLOCKS];
+    int i;
+    int j;
+
+    init_pool(&s_basic_pool, s_basic_mem, TEST_MAG_BLOCKS, "basic", 1);
+
+    for (i = 0; i < TEST_MAG_BLOCKS; i++) {
+        blocks[i] = os_memblock_get(&s_basic_pool);
+        VerifyOrQuit(blocks[i] != NULL, "os_memblock_get failed");
+        for (j = 0; j < i; j++) {
+            VerifyOrQuit(blocks[i] != blocks[j], "block handed out twice");
+        }
+    }
+
+    VerifyOrQuit(os_memblock_get(&s_basic_pool) == NULL,
+                 "got a block from an empty pool");
+    VerifyOrQuit(s_basic_pool.mp_num_free == 0, "wrong mp_num_free");
+    VerifyOrQuit(s_basic_pool.mp_min_free == 0, "wrong mp_min_free");
+
+    for (i = 0; i < TEST_MAG_BLOCKS; i++) {
+        SuccessOrQuit(os_memblock_put(&s_basic_pool, blocks[i]),
+                      "os_memblock_put failed");
+    }
+    VerifyOrQuit(s_basic_pool.mp_num_free == TEST_MAG_BLOCKS,
+                 "wrong mp_num_free");
+
+    /* Some of the blocks are now cached in this thread's magazine. */
+    VerifyOrQuit(shared_list_len(&s_basic_pool) < TEST_MAG_BLOCKS,
+                 "nothing cached");
+
+    return PASS;
+}
+
+static void *
+steal_thread(void *arg)
+{
+    fill_magazine(&s_steal_pool);
+
+    sem_post(&s_cached);
+    sem_wait(&s_done);
+
+    return NULL;
+}
+
+/**
+ * Blocks cached by a live but idle thread are still obtainable by others,
+ * so that mp_num_free (and os_msys_num_free()) can be relied on.
+ */
+int
+test_steal(void)
+{
+    void *blocks[TEST_MAG_BLOCKS];
+    pthread_t thread;
+    int i;
+
+    init_pool(&s_steal_pool, s_steal_mem, TEST_MAG_BLOCKS, "steal", 1);
+    sem_init(&s_cached, 0, 0);
+    sem_init(&s_done, 0, 0);
+
+    pthread_create(&thread, NULL, steal_thread, NULL);
+    sem_wait(&s_cached);
+
+    VerifyOrQuit(shared_list_len(&s_steal_pool) ==
+                 TEST_MAG_BLOCKS - TEST_MAG_CACHED,
+                 "blocks not cached by other thread");
+    VerifyOrQuit(s_steal_pool.mp_num_free == TEST_MAG_BLOCKS,
+                 "cached blocks not counted as free");
+
+    for (i = 0; i < TEST_MAG_BLOCKS; i++) {
+        blocks[i] = os_memblock_get(&s_steal_pool);
+        VerifyOrQuit(blocks[i] != NULL, "free block not obtainable");
+    }
+    VerifyOrQuit(os_memblock_get(&s_steal_pool) == NULL,
+                 "got a block from an empty pool");
+    VerifyOrQuit(s_steal_pool.mp_num_free == 0, "wrong mp_num_free");
+
+    for (i = 0; i < TEST_MAG_BLOCKS; i++) {
+        SuccessOrQuit(os_memblock_put(&s_steal_pool, blocks[i]),
+                      "os_memblock_put failed");
+    }
+
+    sem_post(&s_done);
+    pthread_join(thread, NULL);
+
+    VerifyOrQuit(s_steal_pool.mp_num_free == TEST_MAG_BLOCKS,
+                 "wrong mp_num_free");
+
+    return PASS;
+}
+
+static void *
+exit_thread(void *arg)
+{
+    fill_magazine(&s_exit_pool);
+
+    return NULL;
+}
+
+/**
+ * A thread's cached blocks go back to the shared list when it exits.
+ */
+int
+test_thread_exit(void)
+{
+    pthread_t thread;
+
+    init_pool(&s_exit_pool, s_exit_mem, TEST_MAG_BLOCKS, "exit", 1);
+
+    pthread_create(&thread, NULL, exit_thread, NULL);
+    pthread_join(thread, NULL);
+
+    VerifyOrQuit(shared_list_len(&s_exit_pool) == TEST_MAG_BLOCKS,
+                 "cached blocks not returned on thread exit");
+    VerifyOrQuit(s_exit_pool.mp_num_free == TEST_MAG_BLOCKS,
+                 "wrong mp_num_free");
+
+    return PASS;
+}
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *
+bench_thread(void *arg)
+{
+    struct os_mempool *mp = arg;
+    void *blocks[BENCH_HELD];
+    int i;
+    int j;
+
+    for (i = 0; i < BENCH_ITERS; i++) {
+        for (j = 0; j < BENCH_HELD; j++) {
+            blocks[j] = os_memblock_get(mp);
+            VerifyOrQuit(blocks[j] != NULL, "os_memblock_get failed");
+        }
+        for (j = 0; j < BENCH_HELD; j++) {
+            os_memblock_put(mp, blocks[j]);
+        }
+    }
+
+    return NULL;
+}
+
+static uint64_t
+bench_one(struct os_mempool *mp)
+{
+    pthread_t threads[BENCH_THREADS];
+    uint64_t start;
+    int i;
+
+    start = now_ns();
+    for (i = 0; i < BENCH_THREADS; i++) {
+        pthread_create(&threads[i], NULL, bench_thread, mp);
+    }
+    for (i = 0; i < BENCH_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    return now_ns() - start;
+}
+
+void
+bench_contention(void)
+{
+    uint64_t ops;
+    uint64_t ns;
+    int i;
+
+    ops = (uint64_t)BENCH_THREADS * BENCH_ITERS * BENCH_HELD * 2;
+
+    for (i = 0; i < 2; i++) {
+        init_pool(&s_bench_pool[i], s_bench_mem[i], BENCH_BLOCKS,
+                  i ? "bench_mag" : "bench_shared", i);
+
+        ns = bench_one(&s_bench_pool[i]);
+        printf("%s: %d threads, %llu get/put in %.3f s (%.1f ns/op)\n",
+               i ? "magazines" : "shared list", BENCH_THREADS,
+               (unsigned long long)ops, ns / 1e9, (double)ns / ops);
+
+        VerifyOrQuit(s_bench_pool[i].mp_num_free == BENCH_BLOCKS,
+                     "blocks lost");
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    os_mempool_module_init();
+
+    SuccessOrQuit(test_basic(), "Failed: test_basic");
+    SuccessOrQuit(test_steal(), "Failed: test_steal");
+    SuccessOrQuit(test_thread_exit(), "Failed: test_thread_exit");
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        bench_contention();
+    }
+
+    printf("All tests passed\n");
+    return PASS;
+}
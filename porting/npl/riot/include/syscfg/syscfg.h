@@ -1812,6 +1812,10 @@
 #define MYNEWT_VAL_BLE_ATT_SVR_SIGNED_WRITE (1)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_ATT_SVR_UUID_HASH_SIZE
+#define MYNEWT_VAL_BLE_ATT_SVR_UUID_HASH_SIZE (16)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_ATT_SVR_WRITE
 #define MYNEWT_VAL_BLE_ATT_SVR_WRITE (1)
 #endif
@@ -2008,6 +2012,10 @@
 #define MYNEWT_VAL_BLE_ISO_MAX_BISES (4)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_L2CAP_COC_AUTO_CREDITS
+#define MYNEWT_VAL_BLE_L2CAP_COC_AUTO_CREDITS (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_L2CAP_COC_MAX_NUM
 #define MYNEWT_VAL_BLE_L2CAP_COC_MAX_NUM (0)
 #endif
@@ -2020,6 +2028,10 @@
 #define MYNEWT_VAL_BLE_L2CAP_COC_SDU_BUFF_COUNT (1)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_L2CAP_COC_STATS
+#define MYNEWT_VAL_BLE_L2CAP_COC_STATS (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_L2CAP_ENHANCED_COC
 #define MYNEWT_VAL_BLE_L2CAP_ENHANCED_COC (0)
 #endif
@@ -2096,6 +2108,22 @@
 #define MYNEWT_VAL_BLE_SM_SC_DEBUG_KEYS (0)
 #endif
 
+#ifndef MYNEWT_VAL_BLE_SM_SC_HCI_ECC
+#define MYNEWT_VAL_BLE_SM_SC_HCI_ECC (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_SM_SC_KEY_POOL_SIZE
+#define MYNEWT_VAL_BLE_SM_SC_KEY_POOL_SIZE (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_SM_SC_KEY_ROTATE_PAIRINGS
+#define MYNEWT_VAL_BLE_SM_SC_KEY_ROTATE_PAIRINGS (0)
+#endif
+
+#ifndef MYNEWT_VAL_BLE_SM_SC_KEY_ROTATE_TIME
+#define MYNEWT_VAL_BLE_SM_SC_KEY_ROTATE_TIME (0)
+#endif
+
 #ifndef MYNEWT_VAL_BLE_SM_SC_ONLY
 #define MYNEWT_VAL_BLE_SM_SC_ONLY (0)
 #endif